@@ -0,0 +1,101 @@
+#!/bin/bash
+#
+# attributes: isulad-shim stdout throughput
+# concurrent: NA
+# spend time: 60
+
+#######################################################################
+##- Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+# - iSulad licensed under the Mulan PSL v2.
+# - You can use this software according to the terms and conditions of the Mulan PSL v2.
+# - You may obtain a copy of Mulan PSL v2 at:
+# -     http://license.coscl.org.cn/MulanPSL2
+# - THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+# - IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+# - PURPOSE.
+# - See the Mulan PSL v2 for more details.
+##- @Description: measure how fast isulad-shim forwards 1GB written to stdout by a container
+##- @Author: agent
+##- @Create: 2026-10-19
+#######################################################################
+
+declare -r curr_path=$(dirname $(readlink -f "$0"))
+source ../helpers.sh
+
+# 1GB of 1KB lines, lines keep json log encoding in the measurement
+total_bytes=$((1024 * 1024 * 1024))
+writer="yes \$(printf '%01023d' 0) | head -c ${total_bytes}"
+
+function now_ms()
+{
+    echo $(($(date +%s%N) / 1000000))
+}
+
+function report()
+{
+    local name=$1
+    local cost_ms=$2
+
+    [[ ${cost_ms} -le 0 ]] && cost_ms=1
+    msg_info "${name}: 1GB in ${cost_ms}ms, $((total_bytes / 1024 / 1024 * 1000 / cost_ms))MB/s"
+}
+
+# run container detached with log options in $4..., report time from start to exit
+function run_detached()
+{
+    local name=$1
+    local image=$2
+    local containername=$3
+    local begin
+    local cost
+
+    shift 3
+    isula create --name ${containername} --runtime runc "$@" ${image} sh -c "${writer}"
+    [[ $? -ne 0 ]] && msg_err "${FUNCNAME[0]}:${LINENO} - failed to create container" && return ${FAILURE}
+    begin=$(now_ms)
+    isula start ${containername}
+    [[ $? -ne 0 ]] && msg_err "${FUNCNAME[0]}:${LINENO} - failed to start container" && isula rm -f ${containername} && return ${FAILURE}
+    isula wait ${containername}
+    cost=$(($(now_ms) - begin))
+    report "${name}" ${cost}
+    isula rm -f ${containername}
+}
+
+function test_shim_stdout_throughput()
+{
+    local ret=0
+    local image="busybox"
+    local test="isulad-shim stdout throughput => (${FUNCNAME[@]})"
+    local containername="shim_stdout_throughput"
+    local begin
+    local cost
+
+    msg_info "${test} starting..."
+
+    isula pull ${image}
+    [[ $? -ne 0 ]] && msg_err "${FUNCNAME[0]}:${LINENO} - failed to pull image: ${image}" && return ${FAILURE}
+
+    # output is read and dropped by isulad-shim, cost of forwarding itself
+    run_detached "log disabled" ${image} ${containername} --log-opt disable-log=true || ((ret++))
+
+    # output only goes to json log file
+    run_detached "log file only" ${image} ${containername} --log-opt max-size=100m --log-opt max-file=2 || ((ret++))
+
+    # output also goes to fifo of isulad for the attached client
+    begin=$(now_ms)
+    isula run --name ${containername} --runtime runc --log-opt max-size=100m --log-opt max-file=2 \
+        ${image} sh -c "${writer}" > /dev/null
+    [[ $? -ne 0 ]] && msg_err "${FUNCNAME[0]}:${LINENO} - failed to run attached container" && ((ret++))
+    cost=$(($(now_ms) - begin))
+    report "log file and attached client" ${cost}
+    isula rm -f ${containername}
+
+    msg_info "${test} finished with return ${ret}..."
+    return ${ret}
+}
+
+declare -i ans=0
+
+test_shim_stdout_throughput || ((ans++))
+
+show_result ${ans} "${curr_path}/${0}"
@@ -28,6 +28,7 @@
 #include <stdarg.h>
 #include <limits.h>
 #include <time.h>
+#include <sys/syscall.h>
 
 #include <isula_libutils/utils_memory.h>
 #include <isula_libutils/utils_file.h>
@@ -378,6 +379,40 @@ int open_no_inherit(const char *path, int flag, mode_t mode)
     return fd;
 }
 
+void close_inherited_fds(int max_fd)
+{
+    int fd;
+
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, 0) == 0) {
+        return;
+    }
+#endif
+    for (fd = STDERR_FILENO + 1; fd < max_fd; fd++) {
+        (void)close(fd);
+    }
+}
+
+int shim_pidfd_open(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int shim_pidfd_send_signal(int pidfd, int sig)
+{
+#ifdef SYS_pidfd_send_signal
+    return (int)syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 /* judge the fd whether is attach fifo */
 struct isula_linked_list *get_attach_fifo_item(int fd, struct isula_linked_list *list)
 {
@@ -121,6 +121,14 @@ void close_fd(int *pfd);
 
 int open_no_inherit(const char *path, int flag, mode_t mode);
 
+// close all fds of a forked child except std fds. only raw syscalls are made, so it is safe in a child forked
+// from the multithreaded shim. max_fd bounds the fallback for kernels without close_range, get it before fork
+void close_inherited_fds(int max_fd);
+
+int shim_pidfd_open(pid_t pid);
+
+int shim_pidfd_send_signal(int pidfd, int sig);
+
 struct isula_linked_list *get_attach_fifo_item(int fd, struct isula_linked_list *list);
 
 void free_shim_fifos_fd(struct shim_fifos_fd *item);
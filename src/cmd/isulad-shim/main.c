@@ -96,6 +96,7 @@ int main(int argc, char **argv)
     char *engine_log_path = NULL;
     int ret = SHIM_ERR;
     process_t *p = NULL;
+    bool log_compress = false;
     // execSync timeout
     uint64_t timeout = 0;
     pthread_t tid_epoll;
@@ -117,9 +118,12 @@ int main(int argc, char **argv)
         _exit(EXIT_FAILURE);
     }
 
+    log_compress = getenv(SHIIM_LOG_COMPRESS_ENV) != NULL;
+
     // environment variables are required for initialization logs and are not needed later.
-    if (unsetenv(SHIIM_LOG_PATH_ENV) != 0 || unsetenv(SHIIM_LOG_LEVEL_ENV) != 0) {
-        ERROR("failed to unset SHIIM_LOG_PATH_ENV or SHIIM_LOG_LEVEL_ENV");
+    if (unsetenv(SHIIM_LOG_PATH_ENV) != 0 || unsetenv(SHIIM_LOG_LEVEL_ENV) != 0 ||
+        unsetenv(SHIIM_LOG_COMPRESS_ENV) != 0) {
+        ERROR("failed to unset SHIIM_LOG_PATH_ENV, SHIIM_LOG_LEVEL_ENV or SHIIM_LOG_COMPRESS_ENV");
         error_exit(EXIT_FAILURE);
     }
 
@@ -146,6 +150,9 @@ int main(int argc, char **argv)
         ERROR("new process failed");
         error_exit(EXIT_FAILURE);
     }
+    if (p->terminal != NULL) {
+        p->terminal->log_compress = log_compress;
+    }
 
     // If isulad-shim is a child process of the isulad process,
     // print the log to stderr so that isulad can obtain the exit information of isulad-shim.
@@ -24,6 +24,7 @@
 #include <sys/resource.h> // IWYU pragma: keep
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/timerfd.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <limits.h>
@@ -35,6 +36,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <signal.h>
+#include <strings.h>
+#include <time.h>
 
 #include <isula_libutils/json_common.h>
 #include <isula_libutils/shim_client_process_state.h>
@@ -51,10 +55,34 @@
 
 #include "common.h"
 #include "terminal.h"
+#include "shim_constants.h"
 
 #define MAX_EVENTS 100
 #define DEFAULT_IO_COPY_BUF (16 * 1024)
 #define DEFAULT_LOG_FILE_SIZE (4 * 1024)
+#define EXEC_REQUEST_ARGS_NUM 3
+
+typedef struct {
+    char workdir[PATH_MAX];
+    char log_path[PATH_MAX];
+    char pid_path[PATH_MAX];
+    char process_desc[PATH_MAX];
+    // runtime found in PATH before fork, the child only calls execve
+    char runtime_path[PATH_MAX];
+    int max_fd;
+    int stdio[3];
+    int conn_fd;
+    uint64_t timeout;
+    const char *params[MAX_RUNTIME_ARGS];
+    // runtime exec forked by the shim, waited with its pidfd in epoll loop
+    pid_t pid;
+    int pidfd;
+    struct timespec deadline;
+    bool timed_out;
+    process_t *p;
+} exec_request_t;
+
+static int exec_request_handle(process_t *p, int fd, const char *msg, isula_epoll_descr_t *descr);
 
 static shim_client_process_state *load_process()
 {
@@ -362,61 +390,48 @@ err_out:
     return EPOLL_LOOP_HANDLE_CONTINUE;
 }
 
-static int stdout_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+// write count bytes of output to isulad fifo and attach fifos, skipping the first
+// teed[i] bytes which consumer i already got by tee, teed is NULL if nothing is teed
+static void write_output_consumers(process_t *p, int std_id, int count, const int *teed,
+                                   isula_epoll_descr_t *descr)
 {
-    process_t *p = (process_t *)cbdata;
-    int r_count = 0;
+    int i = 0;
+    int off = 0;
     int w_count = 0;
+    int *isulad_fd = (std_id == STDID_OUT) ? &p->isulad_io->out : &p->isulad_io->err;
+    struct isula_linked_list *it = NULL;
+    struct isula_linked_list *next = NULL;
 
-    (void)memset(p->buf, 0, DEFAULT_IO_COPY_BUF);
-
-    r_count = isula_file_read_nointr(fd, p->buf, DEFAULT_IO_COPY_BUF);
-    if (r_count <= 0 ) {
-        isula_epoll_remove_handler(descr, fd);
-        // fd cannot be closed here, which will cause the container process to exit abnormally
-        // due to terminal fd receiving the sighup signal.
-        return EPOLL_LOOP_HANDLE_CONTINUE;
-    }
-
-    shim_write_container_log_file(p->terminal, STDID_OUT, p->buf, r_count);
-
-    if (p->isulad_io->out != -1) {
-        w_count = isula_file_total_write_nointr(p->isulad_io->out, p->buf, r_count);
+    off = (teed != NULL) ? teed[i] : 0;
+    if (*isulad_fd != -1 && off < count) {
+        w_count = isula_file_total_write_nointr(*isulad_fd, p->buf + off, count - off);
         if (w_count < 0) {
             /* When any error occurs, set the write fd -1  */
-            WARN("write out_fd %d error:%d", p->isulad_io->out, SHIM_SYS_ERR(errno));
-            close(p->isulad_io->out);
-            p->isulad_io->out = -1;
+            WARN("write %s fd %d error:%d", std_id == STDID_OUT ? "out" : "err", *isulad_fd, SHIM_SYS_ERR(errno));
+            close(*isulad_fd);
+            *isulad_fd = -1;
         }
     }
 
-    if (isula_linked_list_empty(p->attach_fifos)) {
-        return EPOLL_LOOP_HANDLE_CONTINUE;
-    }
-
-    struct isula_linked_list *it = NULL;
-    struct isula_linked_list *next = NULL;
-
     isula_linked_list_for_each_safe(it, p->attach_fifos, next) {
         struct shim_fifos_fd *elem = (struct shim_fifos_fd *)it->elem;
-        w_count = isula_file_total_write_nointr(elem->out_fd, p->buf, r_count);
+        i++;
+        off = (teed != NULL) ? teed[i] : 0;
+        if (off >= count) {
+            continue;
+        }
+        w_count = isula_file_total_write_nointr(elem->out_fd, p->buf + off, count - off);
         if (w_count < 0) {
             remove_attach_terminal_fifos(descr, it);
         }
     }
-
-    return EPOLL_LOOP_HANDLE_CONTINUE;
 }
 
-static int stderr_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+static int output_cb(process_t *p, int fd, int std_id, int count, isula_epoll_descr_t *descr)
 {
-    process_t *p = (process_t *)cbdata;
     int r_count = 0;
-    int w_count = 0;
-
-    (void)memset(p->buf, 0, DEFAULT_IO_COPY_BUF);
 
-    r_count = isula_file_read_nointr(fd, p->buf, DEFAULT_IO_COPY_BUF);
+    r_count = isula_file_read_nointr(fd, p->buf, count);
     if (r_count <= 0 ) {
         isula_epoll_remove_handler(descr, fd);
         // fd cannot be closed here, which will cause the container process to exit abnormally
@@ -424,36 +439,103 @@ static int stderr_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t
         return EPOLL_LOOP_HANDLE_CONTINUE;
     }
 
-    shim_write_container_log_file(p->terminal, STDID_ERR, p->buf, r_count);
+    shim_write_container_log_file(p->terminal, std_id, p->buf, r_count);
+    write_output_consumers(p, std_id, r_count, NULL, descr);
 
-    if (p->isulad_io->err != -1) {
-        w_count = isula_file_total_write_nointr(p->isulad_io->err, p->buf, r_count);
-        if (w_count < 0) {
-            /* When any error occurs, set the write fd -1  */
-            WARN("write err_fd %d error:%d", p->isulad_io->err, SHIM_SYS_ERR(errno));
-            close(p->isulad_io->err);
-            p->isulad_io->err = -1;
-        }
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
+static int stdout_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+{
+    return output_cb((process_t *)cbdata, fd, STDID_OUT, DEFAULT_IO_COPY_BUF, descr);
+}
+
+// bytes duplicated into consumer, the rest is written from userspace buffer,
+// which also reports errors of the consumer as before
+static int output_tee(int fd, int consumer, int count)
+{
+    ssize_t ret;
+
+    if (consumer < 0) {
+        return 0;
     }
 
-    if (isula_linked_list_empty(p->attach_fifos)) {
-        return EPOLL_LOOP_HANDLE_CONTINUE;
+    // fifos of isulad and attach clients are opened nonblock, as writes to them are
+    ret = tee(fd, consumer, (size_t)count, SPLICE_F_NONBLOCK);
+    return ret > 0 ? (int)ret : 0;
+}
+
+static int get_devnull_fd(void)
+{
+    static int devnull_fd = -1;
+
+    if (devnull_fd < 0) {
+        devnull_fd = isula_file_open("/dev/null", O_WRONLY | O_CLOEXEC, 0);
     }
+    return devnull_fd;
+}
 
+/*
+ * output of container without terminal is read from a pipe, so it is duplicated into fifos of
+ * isulad and attach clients by tee without copying it to userspace. It is only read when the
+ * log file needs it for json encoding or some fifo does not take all of it, otherwise it is
+ * dropped from the pipe by splice to /dev/null.
+ */
+static int pipe_output_cb(process_t *p, int fd, int std_id, isula_epoll_descr_t *descr)
+{
+    int i = 0;
+    int avail = 0;
+    int count = 0;
+    int teed[MAX_ATTACH_NUM + 1] = { 0 };
+    bool need_read = (p->terminal != NULL);
+    int isulad_fd = (std_id == STDID_OUT) ? p->isulad_io->out : p->isulad_io->err;
+    int devnull_fd = -1;
     struct isula_linked_list *it = NULL;
     struct isula_linked_list *next = NULL;
 
+    // nothing buffered means eof or error, which is handled by read
+    if (ioctl(fd, FIONREAD, &avail) != 0 || avail <= 0) {
+        return output_cb(p, fd, std_id, DEFAULT_IO_COPY_BUF, descr);
+    }
+    count = avail < DEFAULT_IO_COPY_BUF ? avail : DEFAULT_IO_COPY_BUF;
+
+    teed[i] = (isulad_fd == -1) ? count : output_tee(fd, isulad_fd, count);
+    need_read = need_read || teed[i] < count;
     isula_linked_list_for_each_safe(it, p->attach_fifos, next) {
         struct shim_fifos_fd *elem = (struct shim_fifos_fd *)it->elem;
-        w_count = isula_file_total_write_nointr(elem->out_fd, p->buf, r_count);
-        if (w_count < 0) {
-            remove_attach_terminal_fifos(descr, it);
+        i++;
+        teed[i] = output_tee(fd, elem->out_fd, count);
+        need_read = need_read || teed[i] < count;
+    }
+
+    if (!need_read) {
+        devnull_fd = get_devnull_fd();
+        if (devnull_fd >= 0 && splice(fd, NULL, devnull_fd, NULL, (size_t)count, 0) == count) {
+            return EPOLL_LOOP_HANDLE_CONTINUE;
         }
     }
 
+    // single reader, so read gets all count bytes which are in the pipe
+    if (isula_file_read_nointr(fd, p->buf, count) != count) {
+        ERROR("Failed to read %d bytes of container output:%d", count, SHIM_SYS_ERR(errno));
+        return EPOLL_LOOP_HANDLE_CONTINUE;
+    }
+    shim_write_container_log_file(p->terminal, std_id, p->buf, count);
+    write_output_consumers(p, std_id, count, teed, descr);
+
     return EPOLL_LOOP_HANDLE_CONTINUE;
 }
 
+static int stdout_pipe_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+{
+    return pipe_output_cb((process_t *)cbdata, fd, STDID_OUT, descr);
+}
+
+static int stderr_pipe_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+{
+    return pipe_output_cb((process_t *)cbdata, fd, STDID_ERR, descr);
+}
+
 static int resize_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
 {
     process_t *p = (process_t *)cbdata;
@@ -560,6 +642,10 @@ static int attach_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t
         goto out;
     }
 
+    if (isula_has_prefix(tmp_buf, SHIM_EXEC_REQUEST " ")) {
+        return exec_request_handle(p, fd, tmp_buf, descr);
+    }
+
     // limit the number of attach connections to MAX_ATTACH_NUM
     if (isula_linked_list_len(p->attach_fifos) >= MAX_ATTACH_NUM) {
         ERROR("The number of attach connections exceeds the limit:%d, and this connection is rejected.",
@@ -860,13 +946,13 @@ static int open_generic_io(process_t *p, isula_epoll_descr_t *descr)
         return SHIM_ERR;
     }
     // p->shim_io->out ----> p->isulad_io->out
-    ret = isula_epoll_add_handler(descr, p->shim_io->out, stdout_cb, p);
+    ret = isula_epoll_add_handler(descr, p->shim_io->out, stdout_pipe_cb, p);
     if (ret != SHIM_OK) {
         ERROR("add  out fd %d to epoll loop failed:%d", p->shim_io->out, SHIM_SYS_ERR(errno));
         return SHIM_ERR;
     }
     // p->shim_io->err ----> p->isulad_io->err
-    ret = isula_epoll_add_handler(descr, p->shim_io->err, stderr_cb, p);
+    ret = isula_epoll_add_handler(descr, p->shim_io->err, stderr_pipe_cb, p);
     if (ret != SHIM_OK) {
         ERROR("add err fd %d to epoll loop failed:%d", p->shim_io->err, SHIM_SYS_ERR(errno));
         return SHIM_ERR;
@@ -1180,6 +1266,7 @@ process_t *new_process(char *id, char *bundle, char *runtime_cmd)
     p->exit_fd = -1;
     p->io_loop_fd = -1;
     p->ctr_pid = -1;
+    p->notify_fd = -1;
     p->listen_fd = -1;
     p->recv_fd = -1;
     p->stdio = NULL;
@@ -1221,6 +1308,17 @@ process_t *new_process(char *id, char *bundle, char *runtime_cmd)
 
     isula_linked_list_init(p->attach_fifos);
 
+    p->exec_requests = isula_common_calloc_s(sizeof(struct isula_linked_list));
+    if (p->exec_requests == NULL) {
+        goto failure;
+    }
+
+    isula_linked_list_init(p->exec_requests);
+    p->exec_timer_fd = -1;
+    if (pthread_mutex_init(&p->exec_requests_lock, NULL) != 0) {
+        goto failure;
+    }
+
     return p;
 
 failure:
@@ -1306,17 +1404,39 @@ static void get_runtime_cmd(process_t *p, const char *log_path, const char *pid_
     params[i++] = p->id;
 }
 
-static int reap_container(int ctr_pid, int *status)
+static bool is_exec_request_pid(process_t *p, pid_t pid);
+
+// peek an exited child without reaping it. runtime exec of exec requests is reaped by epoll loop with its
+// pidfd, so it is skipped, 0 is returned then or if no child exited with WNOHANG in options.
+static pid_t exited_child(process_t *p, int options)
+{
+    siginfo_t info = { 0 };
+
+    if (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT | options) != 0) {
+        return -1;
+    }
+    if (info.si_pid == 0 || is_exec_request_pid(p, info.si_pid)) {
+        return 0;
+    }
+
+    return info.si_pid;
+}
+
+static int reap_container(process_t *p, int *status)
 {
 #define EXIT_SIGNAL_OFFSET 128
     int st;
     struct rusage rus;
 
     // block wait
-    int pid = wait4(-1, &st, 0, &rus);
+    int pid = exited_child(p, 0);
+    if (pid <= 0) {
+        return SHIM_ERR_WAIT;
+    }
+    pid = wait4(pid, &st, 0, &rus);
     if (pid <= 0) {
         return SHIM_ERR_WAIT;
-    } else if (pid != ctr_pid) {
+    } else if (pid != p->ctr_pid) {
         return SHIM_ERR;
     }
 
@@ -1449,6 +1569,569 @@ static void exec_runtime_process(process_t *p, int exec_fd)
     _exit(EXIT_FAILURE);
 }
 
+static void notify_container_pid(process_t *p)
+{
+    ssize_t nwrite;
+
+    // notify fifo is created by isulad, old isulad polls the pid file instead
+    if (!isula_file_exists(SHIM_NOTIFY_FIFO)) {
+        return;
+    }
+
+    // opened for read and write, so open does not block without a reader, and the pid
+    // written is kept in the fifo until isulad reads it once
+    p->notify_fd = open_no_inherit(SHIM_NOTIFY_FIFO, O_RDWR | O_NONBLOCK, -1);
+    if (p->notify_fd < 0) {
+        ERROR("open notify fifo failed:%d", SHIM_SYS_ERR(errno));
+        return;
+    }
+
+    nwrite = isula_file_write_nointr(p->notify_fd, &p->ctr_pid, sizeof(p->ctr_pid));
+    if (nwrite != (ssize_t)sizeof(p->ctr_pid)) {
+        ERROR("write container pid to notify fifo failed:%d", SHIM_SYS_ERR(errno));
+        close_fd(&p->notify_fd);
+    }
+}
+
+static bool exec_workdir_security_check(process_t *p, const char *workdir, char *real_path)
+{
+    struct stat st = { 0 };
+    char exec_root[PATH_MAX] = { 0 };
+    int nret = 0;
+
+    if (isula_validate_absolute_path(workdir) != 0) {
+        ERROR("exec workdir \"%s\" must be an valid absolute path", workdir);
+        return false;
+    }
+
+    if (realpath(workdir, real_path) == NULL) {
+        ERROR("Failed to get realpath for '%s': %d.", workdir, SHIM_SYS_ERR(errno));
+        return false;
+    }
+
+    nret = snprintf(exec_root, sizeof(exec_root), "%s/exec/", p->workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(exec_root)) {
+        ERROR("Failed to join exec root path");
+        return false;
+    }
+
+    // workdir: /run/isulad/runc/{container_id}/exec/{exec_id}
+    if (!isula_has_prefix(real_path, exec_root) || strchr(real_path + strlen(exec_root), '/') != NULL) {
+        ERROR("exec workdir \"%s\" must be under the exec path: %s", real_path, exec_root);
+        return false;
+    }
+
+    if (lstat(real_path, &st) != 0) {
+        ERROR("Failed to lstat %s : %d", real_path, SHIM_SYS_ERR(errno));
+        return false;
+    }
+
+    if (!S_ISDIR(st.st_mode) || st.st_uid != 0) {
+        ERROR("exec workdir \"%s\" must be a directory owned by root", real_path);
+        return false;
+    }
+
+    return true;
+}
+
+// exec process gets the fifo of isulad as its stdio directly, without io copy in isulad-shim
+static int open_exec_stdio(const char *isulad_stdio, int flag)
+{
+    int fd = -1;
+    int fl = 0;
+
+    if (isulad_stdio == NULL || !isula_file_exists(isulad_stdio)) {
+        return open_no_inherit("/dev/null", flag, -1);
+    }
+
+    fd = open_fifo_noblock(isulad_stdio, flag);
+    if (fd < 0) {
+        return -1;
+    }
+
+    fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl & ~O_NONBLOCK) < 0) {
+        ERROR("Failed to set fifo %s blocking:%d", isulad_stdio, SHIM_SYS_ERR(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// find runtime in PATH like execvp does, execvp is not safe in a child forked from the multithreaded shim
+static int lookup_runtime(const char *cmd, char *path, size_t len)
+{
+    const char *env_path = NULL;
+    char *dirs = NULL;
+    char *dir = NULL;
+    char *saveptr = NULL;
+    int nret = 0;
+
+    if (strchr(cmd, '/') != NULL) {
+        nret = snprintf(path, len, "%s", cmd);
+        return (nret < 0 || (size_t)nret >= len) ? -1 : 0;
+    }
+
+    env_path = getenv("PATH");
+    if (env_path == NULL) {
+        env_path = "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin";
+    }
+    dirs = isula_strdup_s(env_path);
+    for (dir = strtok_r(dirs, ":", &saveptr); dir != NULL; dir = strtok_r(NULL, ":", &saveptr)) {
+        nret = snprintf(path, len, "%s/%s", dir, cmd);
+        if (nret < 0 || (size_t)nret >= len) {
+            continue;
+        }
+        if (access(path, X_OK) == 0) {
+            free(dirs);
+            return 0;
+        }
+    }
+    free(dirs);
+
+    return -1;
+}
+
+static int exec_request_prepare(process_t *p, const char *msg, exec_request_t *req)
+{
+    int ret = SHIM_ERR;
+    int i = 0;
+    int nret = 0;
+    parser_error err = NULL;
+    isula_string_array *args = NULL;
+    shim_client_process_state *state = NULL;
+
+    // kata-runtime runs exec process in guest, it is served by a new isulad-shim
+    if (strcasecmp(p->state->runtime, "kata-runtime") == 0) {
+        ERROR("exec request is not supported by kata-runtime");
+        return SHIM_ERR;
+    }
+
+    args = isula_string_split_to_multi(msg, ' ');
+    if (args == NULL || args->len != EXEC_REQUEST_ARGS_NUM || strcmp(args->items[0], SHIM_EXEC_REQUEST) != 0) {
+        ERROR("Invalid exec msg from isulad");
+        goto out;
+    }
+
+    if (!exec_workdir_security_check(p, args->items[1], req->workdir)) {
+        goto out;
+    }
+
+    if (isula_safe_strto_uint64(args->items[2], &req->timeout) != 0) {
+        ERROR("Invalid exec timeout: %s", args->items[2]);
+        goto out;
+    }
+
+    nret = snprintf(req->log_path, sizeof(req->log_path), "%s/log.json", req->workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(req->log_path)) {
+        goto out;
+    }
+    nret = snprintf(req->pid_path, sizeof(req->pid_path), "%s/pid", req->workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(req->pid_path)) {
+        goto out;
+    }
+    nret = snprintf(req->process_desc, sizeof(req->process_desc), "%s/process.json", req->workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(req->process_desc)) {
+        goto out;
+    }
+
+    state = shim_client_process_state_parse_file(req->process_desc, NULL, &err);
+    if (state == NULL) {
+        ERROR("parse exec process state failed: %s", err);
+        goto out;
+    }
+
+    // terminal exec needs console socket of runtime, it is served by a new isulad-shim
+    if (!state->exec || state->terminal) {
+        ERROR("exec request of terminal process is not supported");
+        goto out;
+    }
+
+    req->stdio[STDID_IN] = open_exec_stdio(state->isulad_stdin, O_RDONLY);
+    req->stdio[STDID_OUT] = open_exec_stdio(state->isulad_stdout, O_WRONLY);
+    req->stdio[STDID_ERR] = open_exec_stdio(state->isulad_stderr, O_WRONLY);
+    if (req->stdio[STDID_IN] < 0 || req->stdio[STDID_OUT] < 0 || req->stdio[STDID_ERR] < 0) {
+        ERROR("Failed to open exec stdio");
+        goto out;
+    }
+
+    // runtime exec runs in foreground, its exit code is the exit code of exec process.
+    // cwd is set in process.json
+    set_common_params(p, req->params, &i, req->log_path);
+    req->params[i++] = "exec";
+    req->params[i++] = "--process";
+    req->params[i++] = req->process_desc;
+    req->params[i++] = "--pid-file";
+    req->params[i++] = req->pid_path;
+    req->params[i++] = p->id;
+
+    if (lookup_runtime(p->runtime_cmd, req->runtime_path, sizeof(req->runtime_path)) != 0) {
+        ERROR("Failed to find runtime %s", p->runtime_cmd);
+        goto out;
+    }
+    req->max_fd = (int)sysconf(_SC_OPEN_MAX);
+    ret = SHIM_OK;
+
+out:
+    free(err);
+    free_shim_client_process_state(state);
+    isula_string_array_free(args);
+    return ret;
+}
+
+static void exec_request_reply(int fd, const void *buf, size_t len)
+{
+    ssize_t nret = 0;
+
+    // isulad may have gone, a closed connection must not kill the shim with SIGPIPE
+    do {
+        nret = send(fd, buf, len, MSG_NOSIGNAL);
+    } while (nret < 0 && errno == EINTR);
+    if (nret != (ssize_t)len) {
+        ERROR("Failed to reply exec request:%d", SHIM_SYS_ERR(errno));
+    }
+}
+
+// pid of exec request is reaped by epoll loop with its pidfd, the reaper of container leaves it alone
+static bool is_exec_request_pid(process_t *p, pid_t pid)
+{
+    struct isula_linked_list *it = NULL;
+    struct isula_linked_list *next = NULL;
+    bool found = false;
+
+    (void)pthread_mutex_lock(&p->exec_requests_lock);
+    isula_linked_list_for_each_safe(it, p->exec_requests, next) {
+        if (((exec_request_t *)it->elem)->pid == pid) {
+            found = true;
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&p->exec_requests_lock);
+
+    return found;
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// arm timer of shim at the nearest deadline of exec requests, or disarm it if there is none
+static void exec_timer_rearm(process_t *p)
+{
+    struct isula_linked_list *it = NULL;
+    struct isula_linked_list *next = NULL;
+    struct itimerspec its = { 0 };
+    bool armed = false;
+
+    if (p->exec_timer_fd < 0) {
+        return;
+    }
+
+    isula_linked_list_for_each_safe(it, p->exec_requests, next) {
+        exec_request_t *req = (exec_request_t *)it->elem;
+        if (req->timeout == 0 || req->timed_out) {
+            continue;
+        }
+        if (!armed || timespec_before(&req->deadline, &its.it_value)) {
+            its.it_value = req->deadline;
+            armed = true;
+        }
+    }
+
+    if (timerfd_settime(p->exec_timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        ERROR("Failed to set exec timer:%d", SHIM_SYS_ERR(errno));
+    }
+}
+
+static void exec_request_kill(exec_request_t *req)
+{
+    char *data = NULL;
+    int exec_pid = 0;
+
+    data = read_text_file(req->pid_path);
+    if (data != NULL) {
+        exec_pid = atoi(data);
+        free(data);
+    }
+
+    if (exec_pid > 0) {
+        (void)kill(exec_pid, SIGKILL);
+    }
+    if (shim_pidfd_send_signal(req->pidfd, SIGKILL) != 0 && errno != ESRCH) {
+        ERROR("Failed to kill runtime exec %d:%d", req->pid, SHIM_SYS_ERR(errno));
+    }
+    // exit of runtime makes its pidfd readable, exec_exit_cb replies isulad then
+    req->timed_out = true;
+}
+
+// the timer handler stays registered until epoll loop exits, so it is never removed
+// while its event is pending in the same epoll batch as an exit of exec request
+static int exec_timer_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+{
+    process_t *p = (process_t *)cbdata;
+    struct isula_linked_list *it = NULL;
+    struct isula_linked_list *next = NULL;
+    struct timespec now = { 0 };
+    uint64_t expirations = 0;
+
+    (void)isula_file_read_nointr(fd, &expirations, sizeof(expirations));
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    isula_linked_list_for_each_safe(it, p->exec_requests, next) {
+        exec_request_t *req = (exec_request_t *)it->elem;
+        if (req->timeout > 0 && !req->timed_out && !timespec_before(&now, &req->deadline)) {
+            exec_request_kill(req);
+        }
+    }
+    exec_timer_rearm(p);
+
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
+static void free_exec_request(exec_request_t *req)
+{
+    if (req == NULL) {
+        return;
+    }
+
+    close_fd(&req->stdio[STDID_IN]);
+    close_fd(&req->stdio[STDID_OUT]);
+    close_fd(&req->stdio[STDID_ERR]);
+    close_fd(&req->pidfd);
+    free(req);
+}
+
+// reply isulad with the shim exit code and the exit code of exec process waited by waitpid, which
+// returned nret with status st, so the reaper of container process does not need to know it.
+static void exec_request_finish(exec_request_t *req, pid_t nret, int st)
+{
+    process_t *p = req->p;
+    struct isula_linked_list *it = NULL;
+    struct isula_linked_list *next = NULL;
+    // shim exit code and exit code of exec process
+    int result[2] = { EXIT_FAILURE, -1 };
+
+    if (req->timed_out) {
+        result[0] = SHIM_EXIT_TIMEOUT;
+    } else if (nret == req->pid) {
+        if (WIFSIGNALED(st)) {
+            result[1] = EXIT_SIGNAL_OFFSET + WTERMSIG(st);
+        } else {
+            result[1] = WEXITSTATUS(st);
+        }
+        // pid file is written once exec process is started, otherwise runtime failed and its log is in log.json
+        if (isula_file_exists(req->pid_path)) {
+            result[0] = 0;
+        }
+    } else {
+        ERROR("Failed to wait runtime exec %d:%d", req->pid, SHIM_SYS_ERR(errno));
+    }
+    exec_request_reply(req->conn_fd, result, sizeof(result));
+
+    (void)pthread_mutex_lock(&p->exec_requests_lock);
+    isula_linked_list_for_each_safe(it, p->exec_requests, next) {
+        if (it->elem == req) {
+            isula_linked_list_del(it);
+            free(it);
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&p->exec_requests_lock);
+    exec_timer_rearm(p);
+
+    close_fd(&req->conn_fd);
+    free_exec_request(req);
+}
+
+static int exec_exit_cb(int fd, uint32_t events, void *cbdata, isula_epoll_descr_t *descr)
+{
+    exec_request_t *req = (exec_request_t *)cbdata;
+    int st = 0;
+    pid_t nret = -1;
+
+    do {
+        nret = waitpid(req->pid, &st, WNOHANG);
+    } while (nret < 0 && errno == EINTR);
+    if (nret == 0) {
+        return EPOLL_LOOP_HANDLE_CONTINUE;
+    }
+
+    // only the handler being called is removed, no other handler of the request is in epoll
+    isula_epoll_remove_handler(descr, fd);
+    exec_request_finish(req, nret, st);
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
+// exec_request_child runs in the child forked from the multithreaded shim, so only async-signal-safe
+// calls are made here. everything it needs is prepared by exec_request_prepare before fork.
+static void exec_request_child(const exec_request_t *req)
+{
+    struct sigaction sa = { 0 };
+
+    if (dup2(req->stdio[STDID_IN], STDIN_FILENO) < 0 || dup2(req->stdio[STDID_OUT], STDOUT_FILENO) < 0 ||
+        dup2(req->stdio[STDID_ERR], STDERR_FILENO) < 0) {
+        _exit(EXIT_FAILURE);
+    }
+    // only std fds are passed to runtime and exec process
+    close_inherited_fds(req->max_fd);
+    // ignored signals stay ignored across exec, shim ignores SIGALRM after its start timeout
+    sa.sa_handler = SIG_DFL;
+    (void)sigaction(SIGALRM, &sa, NULL);
+    execve(req->runtime_path, (char * const *)req->params, environ);
+    _exit(EXIT_FAILURE);
+}
+
+static int exec_timer_open(process_t *p, isula_epoll_descr_t *descr)
+{
+    if (p->exec_timer_fd >= 0) {
+        return SHIM_OK;
+    }
+
+    p->exec_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (p->exec_timer_fd < 0) {
+        ERROR("Failed to create exec timer:%d", SHIM_SYS_ERR(errno));
+        return SHIM_ERR;
+    }
+
+    if (isula_epoll_add_handler(descr, p->exec_timer_fd, exec_timer_cb, p) != SHIM_OK) {
+        ERROR("add exec timer fd %d to epoll loop failed:%d", p->exec_timer_fd, SHIM_SYS_ERR(errno));
+        close_fd(&p->exec_timer_fd);
+        return SHIM_ERR;
+    }
+
+    return SHIM_OK;
+}
+
+// fork runtime exec as a direct child of shim and track it by pidfd.
+// the pid is added to exec requests before the reaper of container can see it exit
+static int exec_request_start(process_t *p, exec_request_t *req)
+{
+    struct isula_linked_list *node = NULL;
+    int pidfd = -1;
+
+    node = (struct isula_linked_list *)isula_common_calloc_s(sizeof(struct isula_linked_list));
+    if (node == NULL) {
+        ERROR("Out of memory");
+        return SHIM_ERR;
+    }
+
+    (void)pthread_mutex_lock(&p->exec_requests_lock);
+    req->pid = fork();
+    if (req->pid < 0) {
+        (void)pthread_mutex_unlock(&p->exec_requests_lock);
+        ERROR("fork failed when handle exec request:%d", SHIM_SYS_ERR(errno));
+        free(node);
+        return SHIM_ERR;
+    }
+
+    if (req->pid == 0) {
+        exec_request_child(req);
+    }
+
+    node->elem = req;
+    isula_linked_list_add_tail(p->exec_requests, node);
+    (void)pthread_mutex_unlock(&p->exec_requests_lock);
+
+    pidfd = shim_pidfd_open(req->pid);
+    if (pidfd < 0) {
+        // checked before fork, kill it to keep the exit of runtime from the reply of request
+        ERROR("Failed to open pidfd of runtime exec %d:%d", req->pid, SHIM_SYS_ERR(errno));
+        (void)kill(req->pid, SIGKILL);
+        (void)waitpid(req->pid, NULL, 0);
+        (void)pthread_mutex_lock(&p->exec_requests_lock);
+        isula_linked_list_del(node);
+        (void)pthread_mutex_unlock(&p->exec_requests_lock);
+        free(node);
+        return SHIM_ERR;
+    }
+    req->pidfd = pidfd;
+
+    return SHIM_OK;
+}
+
+// exec_request_handle starts exec process with the shim of container instead of a new isulad-shim,
+// only exec without terminal is handled. runtime exec is forked by the shim and waited with its pidfd
+// in epoll loop, which replies isulad over connection fd, so epoll loop is not blocked by long running exec.
+// if the request is rejected, -1 is written to connection fd and isulad starts a new isulad-shim.
+static int exec_request_handle(process_t *p, int fd, const char *msg, isula_epoll_descr_t *descr)
+{
+    exec_request_t *req = NULL;
+    int status = -1;
+    int pidfd = -1;
+    int st = 0;
+    pid_t nret = -1;
+
+    // pidfd is required to wait runtime in epoll loop, older kernel is served by a new isulad-shim
+    pidfd = shim_pidfd_open(getpid());
+    if (pidfd < 0) {
+        ERROR("exec request is not supported without pidfd:%d", SHIM_SYS_ERR(errno));
+        goto out;
+    }
+    close(pidfd);
+
+    req = (exec_request_t *)isula_common_calloc_s(sizeof(exec_request_t));
+    if (req == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+    req->p = p;
+    req->conn_fd = fd;
+    req->pidfd = -1;
+    req->stdio[STDID_IN] = -1;
+    req->stdio[STDID_OUT] = -1;
+    req->stdio[STDID_ERR] = -1;
+
+    if (exec_request_prepare(p, msg, req) != SHIM_OK) {
+        ERROR("Invalid exec request from isulad");
+        goto out;
+    }
+
+    if (req->timeout > 0) {
+        if (exec_timer_open(p, descr) != SHIM_OK) {
+            goto out;
+        }
+        (void)clock_gettime(CLOCK_MONOTONIC, &req->deadline);
+        req->deadline.tv_sec += (time_t)req->timeout;
+    }
+
+    if (exec_request_start(p, req) != SHIM_OK) {
+        goto out;
+    }
+
+    // exec process and runtime are the only writers of fifos now
+    close_fd(&req->stdio[STDID_IN]);
+    close_fd(&req->stdio[STDID_OUT]);
+    close_fd(&req->stdio[STDID_ERR]);
+
+    // connection fd is owned by the request from now on
+    isula_epoll_remove_handler(descr, fd);
+    if (isula_epoll_add_handler(descr, req->pidfd, exec_exit_cb, req) != SHIM_OK) {
+        // runtime is started already, report it as a failed exec rather than let isulad run it again
+        ERROR("add pidfd %d to epoll loop failed:%d", req->pidfd, SHIM_SYS_ERR(errno));
+        (void)shim_pidfd_send_signal(req->pidfd, SIGKILL);
+        status = 0;
+        exec_request_reply(fd, &status, sizeof(int));
+        do {
+            nret = waitpid(req->pid, &st, 0);
+        } while (nret < 0 && errno == EINTR);
+        exec_request_finish(req, nret, st);
+        return EPOLL_LOOP_HANDLE_CONTINUE;
+    }
+    exec_timer_rearm(p);
+
+    // let isulad know that the request is accepted
+    status = 0;
+    exec_request_reply(fd, &status, sizeof(int));
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+
+out:
+    free_exec_request(req);
+    exec_request_reply(fd, &status, sizeof(int));
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
 int create_process(process_t *p)
 {
     int ret = SHIM_ERR;
@@ -1516,6 +2199,7 @@ int create_process(process_t *p)
     }
 
     p->ctr_pid = ctr_pid;
+    notify_container_pid(p);
     adapt_for_isulad_stdin(p);
     ret = SHIM_OK;
 
@@ -1539,15 +2223,18 @@ static int try_wait_all_child(void)
     return 1;
 }
 
-static int waitpid_with_timeout(int ctr_pid,  int *status, const uint64_t timeout)
+static int waitpid_with_timeout(process_t *p, int *status, const uint64_t timeout)
 {
     int nret = 0;
     time_t start_time = time(NULL);
     int st;
 
     for (;;) {
-        nret = waitpid(-1, &st, WNOHANG);
-        if (nret == ctr_pid) {
+        nret = exited_child(p, WNOHANG);
+        if (nret > 0) {
+            nret = waitpid(nret, &st, WNOHANG);
+        }
+        if (nret == p->ctr_pid) {
             break;
         }
         time_t end_time = time(NULL);
@@ -1587,11 +2274,11 @@ static int wait_container_process_with_timeout(process_t *p, const uint64_t time
 {
     // currently, kata runtime does not support setting timeout during exec
     if (strcasecmp(p->state->runtime, "kata-runtime") != 0 && timeout > 0) {
-        return waitpid_with_timeout(p->ctr_pid, status, timeout);
+        return waitpid_with_timeout(p, status, timeout);
     }
 
     for (;;) {
-        int ret = reap_container(p->ctr_pid, status);
+        int ret = reap_container(p, status);
         if (ret == SHIM_OK) {
             if (*status == CONTAINER_ACTION_REBOOT) {
                 ret = setenv("CONTAINER_ACTION", "reboot", 1);
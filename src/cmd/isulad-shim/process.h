@@ -53,6 +53,9 @@ typedef struct process {
     int attach_socket_fd; // the server socket fd that establishes a connection with isulad
     int ctr_pid;
     int sync_fd;
+    // write end of notify fifo, kept open so the pid is not dropped before isulad opens the fifo.
+    // only the first read gets it, later readers use the pid file written by runtime before notify
+    int notify_fd;
     int listen_fd;
     int recv_fd;
     log_terminal *terminal;
@@ -60,6 +63,10 @@ typedef struct process {
     stdio_t *shim_io; // shim io on isulad side, in: w  out/err: r
     stdio_t *isulad_io; // isulad io, in:r out/err: w
     struct isula_linked_list *attach_fifos; /* isulad: fifos used to attach teminal */
+    // exec requests in progress, owned by epoll loop. pids are also read by the reaper of container
+    struct isula_linked_list *exec_requests;
+    pthread_mutex_t exec_requests_lock;
+    int exec_timer_fd; // fires at the nearest deadline of exec requests
     shim_client_process_state *state;
     sem_t sem_mainloop;
     char *buf;
@@ -24,81 +24,150 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
 
-#include <isula_libutils/json_common.h>
-#include <isula_libutils/logger_json_file.h>
 #include <isula_libutils/utils_memory.h>
 #include <isula_libutils/utils_file.h>
+#include <isula_libutils/log.h>
 
 #include "common.h"
 #include "process.h"
+#include "log_compress.h"
 
 #define BUF_CACHE_SIZE (32 * 1024)
 #define STDOUT_STR "stdout"
 #define STDERR_STR "stderr"
-
-static int shim_rename_old_log_file(log_terminal *terminal)
+// a chunk of BUF_CACHE_SIZE has at most this many lines written by one writev, less than IOV_MAX
+#define LOG_BATCH_MAX_LINES 256
+#define LOG_ENCODER_INIT_SIZE (64 * 1024)
+#define LOG_COMPRESS_BUF_SIZE (64 * 1024)
+
+// json lines of one chunk of output, buf is reused between chunks
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    // end offset of each line in buf
+    size_t ends[LOG_BATCH_MAX_LINES];
+    size_t lines;
+    // formatted seconds of time_sec, like 2006-01-02T15:04:05
+    time_t time_sec;
+    char time_prefix[32];
+    size_t time_prefix_len;
+} log_encoder;
+
+static log_encoder encoder_out = { 0 };
+static log_encoder encoder_err = { 0 };
+
+// compress filename to filename.gz and remove filename, isulad-shim does not link util_gzip of isulad
+static int shim_gzip_file(const char *filename)
 {
-    int nret;
+    static char buf[LOG_COMPRESS_BUF_SIZE];
     int ret = SHIM_ERR;
-    unsigned int i;
-    char tmp[PATH_MAX] = { 0 };
-    char *rename_fname = NULL;
+    int fd = -1;
+    int gz_fd = -1;
+    ssize_t nread;
+    gzFile gz = NULL;
+    struct stat st;
+    char gz_path[PATH_MAX] = { 0 };
+    int nret;
 
-    for (i = terminal->log_maxfile - 1; i > 1; i--) {
-        nret = snprintf(tmp, PATH_MAX, "%s.%u", terminal->log_path, i);
-        if (nret < 0 || (size_t)nret >= PATH_MAX) {
-            goto out;
-        }
-        free(rename_fname);
-        rename_fname = safe_strdup(tmp);
+    nret = snprintf(gz_path, PATH_MAX, "%s%s", filename, LOG_COMPRESS_SUFFIX);
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        return SHIM_ERR;
+    }
 
-        nret = snprintf(tmp, PATH_MAX, "%s.%u", terminal->log_path, (i - 1));
-        if (nret < 0 || (size_t)nret >= PATH_MAX) {
-            goto out;
-        }
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        SYSERROR("Failed to open %s", filename);
+        return SHIM_ERR;
+    }
+    if (fstat(fd, &st) != 0) {
+        SYSERROR("Failed to stat %s", filename);
+        goto out;
+    }
 
-        nret = rename(tmp, rename_fname);
-        if (nret < 0 && errno != ENOENT) {
+    gz_fd = open(gz_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777);
+    if (gz_fd < 0) {
+        SYSERROR("Failed to create %s", gz_path);
+        goto out;
+    }
+    gz = gzdopen(gz_fd, "wb");
+    if (gz == NULL) {
+        ERROR("Failed to open gzip stream of %s", gz_path);
+        goto out;
+    }
+    // closed by gzclose
+    gz_fd = -1;
+
+    while ((nread = isula_file_read_nointr(fd, buf, sizeof(buf))) > 0) {
+        if (gzwrite(gz, buf, (unsigned int)nread) != (int)nread) {
+            ERROR("Failed to compress %s", filename);
             goto out;
         }
     }
+    if (nread < 0) {
+        SYSERROR("Failed to read %s", filename);
+        goto out;
+    }
+
+    nret = gzclose(gz);
+    gz = NULL;
+    if (nret != Z_OK) {
+        ERROR("Failed to finish compress of %s", filename);
+        goto out;
+    }
+    if (unlink(filename) != 0) {
+        SYSERROR("Failed to remove %s", filename);
+        goto out;
+    }
     ret = SHIM_OK;
+
 out:
-    free(rename_fname);
+    if (gz != NULL) {
+        (void)gzclose(gz);
+    }
+    if (gz_fd >= 0) {
+        close(gz_fd);
+    }
+    close(fd);
+    if (ret != SHIM_OK) {
+        (void)unlink(gz_path);
+    }
     return ret;
 }
 
+// there is one log terminal in a shim
+static log_compressor g_log_compressor = LOG_COMPRESSOR_INITIALIZER(shim_gzip_file);
+
+// index of the oldest rotated log file
+static unsigned int shim_last_rotated_index(unsigned int log_maxfile)
+{
+    return log_maxfile > 1 ? log_maxfile - 1 : 1;
+}
+
 static int shim_dump_log_file(log_terminal *terminal)
 {
-    int ret;
-    size_t len_path;
-    char *file_newname = NULL;
+    int ret = SHIM_ERR;
+    char file_newname[PATH_MAX] = { 0 };
+    char gz_name[PATH_MAX] = { 0 };
 
-    if (strlen(terminal->log_path) > (PATH_MAX - sizeof(".1"))) {
+    if (log_rotated_file_name(file_newname, terminal->log_path, 1, "") != 0 ||
+        log_rotated_file_name(gz_name, terminal->log_path, 1, LOG_COMPRESS_SUFFIX) != 0) {
         return SHIM_ERR;
     }
-    len_path = strlen(terminal->log_path) + sizeof(".1");
 
+    (void)pthread_mutex_lock(&g_log_compressor.mutex);
     /* isulad: rotate old log file first */
-    ret = shim_rename_old_log_file(terminal);
+    ret = log_rotate_old_files(terminal->log_path, shim_last_rotated_index(terminal->log_maxfile));
     if (ret != 0) {
+        (void)pthread_mutex_unlock(&g_log_compressor.mutex);
         return SHIM_ERR;
     }
 
-    file_newname = isula_smart_calloc_s(1, len_path);
-    if (file_newname == NULL) {
-        return SHIM_ERR;
-    }
-
-    ret = snprintf(file_newname, len_path, "%s.1", terminal->log_path);
-    if (ret < 0 || (size_t)ret >= len_path) {
-        ret = -1;
-        goto clean_out;
-    }
-
     /*
      * Rename the file console.log to console.log.1 then create and open console.log again.
      * fd points to console.log file always.
@@ -106,10 +175,14 @@ static int shim_dump_log_file(log_terminal *terminal)
     close(terminal->fd);
     terminal->fd = -1;
     (void)rename(terminal->log_path, file_newname);
-    ret = shim_create_container_log_file(terminal);
-clean_out:
-    free(file_newname);
-    return ret;
+    // left if there are at most two log files
+    (void)unlink(gz_name);
+    if (terminal->log_compress) {
+        log_compressor_notify(&g_log_compressor, terminal->log_path, shim_last_rotated_index(terminal->log_maxfile));
+    }
+    (void)pthread_mutex_unlock(&g_log_compressor.mutex);
+
+    return shim_create_container_log_file(terminal);
 }
 
 static int64_t get_log_file_size(int fd)
@@ -129,138 +202,210 @@ static int64_t get_log_file_size(int fd)
     return log_st.st_size;
 }
 
-static int shim_json_data_write(log_terminal *terminal, const char *buf, int read_count)
+// log lines of one chunk of output are encoded into buf and written by one writev
+static int shim_writev_all(int fd, struct iovec *iov, int cnt)
 {
-    int ret = 0;
-    int nret = 0;
-    int64_t available_space = -1;
-    int64_t file_size;
+    ssize_t nret;
+
+    while (cnt > 0) {
+        nret = writev(fd, iov, cnt);
+        if (nret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SHIM_ERR;
+        }
+        while (cnt > 0 && (size_t)nret >= iov->iov_len) {
+            nret -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + nret;
+            iov->iov_len -= (size_t)nret;
+        }
+    }
 
-    (void)pthread_rwlock_wrlock(&terminal->log_terminal_rwlock);
+    return SHIM_OK;
+}
 
+static void shim_json_lines_write(log_terminal *terminal, log_encoder *enc)
+{
+    size_t i;
+    size_t off = 0;
+    size_t line_len = 0;
+    int cnt = 0;
+    int64_t batch = 0;
+    struct iovec iov[LOG_BATCH_MAX_LINES];
 
-    file_size = get_log_file_size(terminal->fd);
-    if (file_size < 0) {
-        ret = -1;
-        goto out;
-    }
+    (void)pthread_rwlock_wrlock(&terminal->log_terminal_rwlock);
 
-    available_space = terminal->log_maxsize - file_size;
-    if (read_count <= available_space) {
-        ret = isula_file_total_write_nointr(terminal->fd, buf, read_count);
+    if (terminal->fd < 0 || terminal->log_size < 0) {
         goto out;
     }
 
-    if (shim_dump_log_file(terminal) < 0) {
-        ret = -1;
-        goto out;
+    for (i = 0; i < enc->lines; i++) {
+        line_len = enc->ends[i] - off;
+        if ((uint64_t)(terminal->log_size + batch) + line_len > terminal->log_maxsize) {
+            if (cnt > 0 && shim_writev_all(terminal->fd, iov, cnt) != SHIM_OK) {
+                goto err_out;
+            }
+            cnt = 0;
+            batch = 0;
+            if (shim_dump_log_file(terminal) < 0 || terminal->log_size < 0) {
+                goto out;
+            }
+            /*
+             * Now file is new, then write the max bytes that will be wrote to log file.
+             * We have set the log file min size 16k, so the scenario of log_maxsize < line_len
+             * shouldn't happen, otherwise, discard some last bytes.
+             */
+            if (line_len > terminal->log_maxsize) {
+                line_len = terminal->log_maxsize;
+            }
+        }
+        iov[cnt].iov_base = enc->buf + off;
+        iov[cnt].iov_len = line_len;
+        cnt++;
+        batch += (int64_t)line_len;
+        off = enc->ends[i];
     }
 
-    /*
-     * Now file is new, then write the max bytes that will be wrote to log file.
-     * We have set the log file min size 16k, so the scenario of log_maxsize < read_count
-     * shouldn't happen, otherwise, discard some last bytes.
-     */
-    nret = isula_file_total_write_nointr(terminal->fd, buf,
-                                         terminal->log_maxsize < read_count ? terminal->log_maxsize : read_count);
-    if (nret < 0) {
-        ret = -1;
-        goto out;
+    if (cnt > 0 && shim_writev_all(terminal->fd, iov, cnt) != SHIM_OK) {
+        goto err_out;
     }
+    terminal->log_size += batch;
+    goto out;
 
-    ret = read_count - nret;
-
+err_out:
+    // part of the lines may be written, find out how many
+    terminal->log_size = get_log_file_size(terminal->fd);
 out:
     (void)pthread_rwlock_unlock(&terminal->log_terminal_rwlock);
-    return ret;
+    enc->len = 0;
+    enc->lines = 0;
 }
 
-static bool util_get_time_buffer(struct timespec *timestamp, char *timebuffer, size_t maxsize)
+static int log_encoder_reserve(log_encoder *enc, size_t size)
 {
-    struct tm tm_utc = { 0 };
-    int32_t nanos = 0;
-    time_t seconds;
-    size_t len = 0;
-    int ret = 0;
+    size_t cap = enc->cap > 0 ? enc->cap : LOG_ENCODER_INIT_SIZE;
+    char *buf = NULL;
 
-    if (timebuffer == NULL || maxsize == 0) {
-        return false;
+    if (enc->len + size <= enc->cap) {
+        return SHIM_OK;
     }
 
-    seconds = (time_t)timestamp->tv_sec;
-    gmtime_r(&seconds, &tm_utc);
-    len = strftime(timebuffer, maxsize, "%Y-%m-%dT%H:%M:%S", &tm_utc);
-    if (len == 0) {
-        return false;
+    while (cap < enc->len + size) {
+        cap *= 2;
     }
-
-    nanos = (int32_t)timestamp->tv_nsec;
-    ret = snprintf(timebuffer + len, (maxsize - len), ".%09dZ", nanos);
-    if (ret < 0 || (size_t)ret >= (maxsize - len)) {
-        return false;
+    buf = realloc(enc->buf, cap);
+    if (buf == NULL) {
+        return SHIM_ERR;
     }
+    enc->buf = buf;
+    enc->cap = cap;
 
-    return true;
+    return SHIM_OK;
 }
 
-static bool util_get_now_time_buffer(char *timebuffer, size_t maxsize)
+static inline void log_encoder_append(log_encoder *enc, const char *str, size_t len)
 {
-    int err = 0;
-    struct timespec ts;
+    memcpy(enc->buf + enc->len, str, len);
+    enc->len += len;
+}
 
-    err = clock_gettime(CLOCK_REALTIME, &ts);
-    if (err != 0) {
-        return false;
+// same format as logger_json_file_generate_json with OPT_GEN_SIMPLIFY | OPT_GEN_NO_VALIDATE_UTF8:
+// {"log":"...","stream":"stdout","time":"2006-01-02T15:04:05.999999999Z"}
+static void log_encoder_add_line(log_encoder *enc, const char *stream, const char *buf, int read_count,
+                                 const char *timebuffer, size_t time_len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const unsigned char *in = (const unsigned char *)buf;
+    char *out = NULL;
+    size_t start = enc->len;
+    int i;
+
+    // every byte takes 6 bytes at most when it is escaped as \u00XX
+    if (log_encoder_reserve(enc, (size_t)read_count * 6 + strlen(stream) + time_len + 64) != SHIM_OK) {
+        return;
     }
 
-    return util_get_time_buffer(&ts, timebuffer, maxsize);
+    log_encoder_append(enc, "{\"log\":\"", sizeof("{\"log\":\"") - 1);
+    out = enc->buf + enc->len;
+    for (i = 0; i < read_count; i++) {
+        unsigned char c = in[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            *out++ = (char)c;
+            continue;
+        }
+        *out++ = '\\';
+        switch (c) {
+            case '"':
+            case '\\':
+                *out++ = (char)c;
+                break;
+            case '\b':
+                *out++ = 'b';
+                break;
+            case '\f':
+                *out++ = 'f';
+                break;
+            case '\n':
+                *out++ = 'n';
+                break;
+            case '\r':
+                *out++ = 'r';
+                break;
+            case '\t':
+                *out++ = 't';
+                break;
+            default:
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = hex[c >> 4];
+                *out++ = hex[c & 0xf];
+                break;
+        }
+    }
+    enc->len = (size_t)(out - enc->buf);
+    log_encoder_append(enc, "\",\"stream\":\"", sizeof("\",\"stream\":\"") - 1);
+    log_encoder_append(enc, stream, strlen(stream));
+    log_encoder_append(enc, "\",\"time\":\"", sizeof("\",\"time\":\"") - 1);
+    log_encoder_append(enc, timebuffer, time_len);
+    log_encoder_append(enc, "\"}\n", sizeof("\"}\n") - 1);
+
+    if (enc->lines >= LOG_BATCH_MAX_LINES) {
+        enc->len = start;
+        return;
+    }
+    enc->ends[enc->lines++] = enc->len;
 }
 
-static ssize_t shim_logger_write(log_terminal *terminal, const char *type, const char *buf, int read_count)
+// time of log lines, seconds part is formatted only when it changes
+static size_t log_encoder_time(log_encoder *enc, char *timebuffer, size_t maxsize)
 {
-    logger_json_file *msg = NULL;
-    ssize_t ret = -1;
-    size_t len;
-    char *json = NULL;
-    char timebuffer[64] = { 0 };
-    parser_error err = NULL;
-    struct parser_context ctx = { OPT_GEN_SIMPLIFY | OPT_GEN_NO_VALIDATE_UTF8, stderr };
+    struct timespec ts = { 0 };
+    struct tm tm_utc = { 0 };
+    int nret;
 
-    if (read_count < 0 || read_count >= INT_MAX) {
-        return SHIM_ERR;
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return 0;
     }
 
-    msg = calloc(sizeof(logger_json_file), 1);
-    if (msg == NULL) {
-        return SHIM_ERR;
+    if (ts.tv_sec != enc->time_sec || enc->time_prefix_len == 0) {
+        time_t seconds = (time_t)ts.tv_sec;
+        gmtime_r(&seconds, &tm_utc);
+        enc->time_prefix_len = strftime(enc->time_prefix, sizeof(enc->time_prefix), "%Y-%m-%dT%H:%M:%S", &tm_utc);
+        enc->time_sec = ts.tv_sec;
     }
 
-    msg->log = calloc(read_count, 1);
-    if (!msg->log) {
-        goto cleanup;
+    nret = snprintf(timebuffer, maxsize, "%s.%09ldZ", enc->time_prefix, (long)ts.tv_nsec);
+    if (nret < 0 || (size_t)nret >= maxsize) {
+        return 0;
     }
-    memcpy(msg->log, buf, read_count);
-    msg->log_len = read_count;
-    msg->stream = type ? safe_strdup(type) : safe_strdup("stdout");
 
-    util_get_now_time_buffer(timebuffer, sizeof(timebuffer));
-    msg->time = safe_strdup(timebuffer);
-    json = logger_json_file_generate_json(msg, &ctx, &err);
-    if (!json) {
-        goto cleanup;
-    }
-    len = strlen(json);
-    json[len] = '\n';
-    if (terminal->fd < 0) {
-        goto cleanup;
-    }
-
-    ret = shim_json_data_write(terminal, json, len + 1);
-cleanup:
-    free(json);
-    free_logger_json_file(msg);
-    free(err);
-    return ret;
+    return (size_t)nret;
 }
 
 // BUF_CACHE_SIZE must be larger than read_count of buf readed
@@ -274,11 +419,14 @@ void shim_write_container_log_file(log_terminal *terminal, int type, char *buf,
 {
     char *cache = NULL;
     int *size = NULL;
+    log_encoder *enc = NULL;
     const char *type_str = NULL;
     int upto, index;
     int begin = 0;
     int buf_readed = 0;
     int buf_left = 0;
+    char timebuffer[64] = { 0 };
+    size_t time_len = 0;
 
     if (terminal == NULL) {
         return;
@@ -288,11 +436,13 @@ void shim_write_container_log_file(log_terminal *terminal, int type, char *buf,
             type_str = STDOUT_STR;
             cache = cache_out;
             size = &size_out;
+            enc = &encoder_out;
             break;
         case STDID_ERR:
             type_str = STDERR_STR;
             cache = cache_err;
             size = &size_err;
+            enc = &encoder_err;
             break;
         default:
             return;
@@ -317,21 +467,30 @@ void shim_write_container_log_file(log_terminal *terminal, int type, char *buf,
         return;
     }
 
+    // lines of one chunk arrive together and share the time
+    time_len = log_encoder_time(enc, timebuffer, sizeof(timebuffer));
+
     for (index = 0; index < *size; index++) {
         if (cache[index] == '\n') {
-            (void)shim_logger_write(terminal, type_str, cache + begin, index - begin + 1);
+            if (enc->lines == LOG_BATCH_MAX_LINES) {
+                shim_json_lines_write(terminal, enc);
+            }
+            log_encoder_add_line(enc, type_str, cache + begin, index - begin + 1, timebuffer, time_len);
             begin = index + 1;
         }
     }
 
     if (buf == NULL || (begin == 0 && *size == BUF_CACHE_SIZE)) {
         if (begin < *size) {
-            (void)shim_logger_write(terminal, type_str, cache + begin, *size - begin);
+            if (enc->lines == LOG_BATCH_MAX_LINES) {
+                shim_json_lines_write(terminal, enc);
+            }
+            log_encoder_add_line(enc, type_str, cache + begin, *size - begin, timebuffer, time_len);
             begin = 0;
             *size = 0;
         }
         if (buf == NULL) {
-            return;
+            goto out;
         }
     }
 
@@ -344,6 +503,9 @@ void shim_write_container_log_file(log_terminal *terminal, int type, char *buf,
         memcpy(cache + *size, buf + buf_readed, buf_left);
         *size += buf_left;
     }
+
+out:
+    shim_json_lines_write(terminal, enc);
 }
 
 int shim_create_container_log_file(log_terminal *terminal)
@@ -357,5 +519,8 @@ int shim_create_container_log_file(log_terminal *terminal)
         return SHIM_ERR;
     }
 
+    // negative if log path is not a regular file, then logs are dropped as before
+    terminal->log_size = get_log_file_size(terminal->fd);
+
     return SHIM_OK;
 }
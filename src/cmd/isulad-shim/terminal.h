@@ -19,6 +19,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "isula_libutils/logger_json_file.h"
 
@@ -30,7 +31,11 @@ typedef struct {
     uint64_t log_maxsize;
     char *log_path;
     int fd;
+    // size of log file, tracked in memory so writes do not fstat it
+    int64_t log_size;
     unsigned int log_maxfile;
+    // gzip rotated log files in background
+    bool log_compress;
     pthread_rwlock_t log_terminal_rwlock;
 } log_terminal;
 
@@ -58,6 +58,7 @@
 #include "verify.h"
 #include "service_common.h"
 #include "callback.h"
+#include "execution_extend.h"
 #include "log_gather_api.h"
 #include "container_api.h"
 #include "plugin_api.h"
@@ -277,6 +278,9 @@ static void daemon_shutdown()
     /* shutdown server */
     server_common_shutdown();
 
+    container_stats_sampler_exit();
+    EVENT("Stats sampler exit completed");
+
     /* clean resource first, left time to wait finish */
     image_module_exit();
     EVENT("Image module exit completed");
@@ -1682,6 +1686,10 @@ static int start_daemon_threads()
         goto out;
     }
 
+    if (container_stats_sampler_init() != 0) {
+        goto out;
+    }
+
 #ifndef DISABLE_CLEANUP
     clean_module_do_clean();
 #endif
@@ -103,9 +103,20 @@ static int log_opt_disable_log_cb(const char *key, const char *value, char **par
     return ret;
 }
 
+static int log_opt_compress_cb(const char *key, const char *value, char **parsed_val)
+{
+    if (strcmp(value, "true") != 0 && strcmp(value, "false") != 0) {
+        ERROR("Invalid option 'compress', value:%s", value);
+        return -1;
+    }
+
+    *parsed_val = util_strdup_s(value);
+    return 0;
+}
+
 bool parse_container_log_opt(const char *key, const char *val, json_map_string_string *opts)
 {
-#define LOG_PARSER_MAX 5
+#define LOG_PARSER_MAX 6
     size_t i, j;
     log_opt_parse_t support_parsers[LOG_PARSER_MAX] = {
         {
@@ -133,6 +144,11 @@ bool parse_container_log_opt(const char *key, const char *val, json_map_string_s
             .real_key = CONTAINER_LOG_CONFIG_KEY_SYSLOG_FACILITY,
             .cb = &log_opt_syslog_facility,
         },
+        {
+            .key = "compress",
+            .real_key = CONTAINER_LOG_CONFIG_KEY_COMPRESS,
+            .cb = &log_opt_compress_cb,
+        },
     };
 
     if (key == NULL || opts == NULL) {
@@ -208,10 +224,13 @@ bool parse_container_log_opts(json_map_string_string **opts)
 bool check_opt_container_log_opt(const char *driver, const char *opt_key)
 {
 #define DRIVER_MAX 2
-#define MAX_SUPPORT_KEY_LEN 3
+#define MAX_SUPPORT_KEY_LEN 4
     const char *support_keys[][MAX_SUPPORT_KEY_LEN] = {
-        { CONTAINER_LOG_CONFIG_KEY_FILE, CONTAINER_LOG_CONFIG_KEY_ROTATE, CONTAINER_LOG_CONFIG_KEY_SIZE },
-        { CONTAINER_LOG_CONFIG_KEY_SYSLOG_TAG, CONTAINER_LOG_CONFIG_KEY_SYSLOG_FACILITY, NULL}
+        {
+            CONTAINER_LOG_CONFIG_KEY_FILE, CONTAINER_LOG_CONFIG_KEY_ROTATE, CONTAINER_LOG_CONFIG_KEY_SIZE,
+            CONTAINER_LOG_CONFIG_KEY_COMPRESS
+        },
+        { CONTAINER_LOG_CONFIG_KEY_SYSLOG_TAG, CONTAINER_LOG_CONFIG_KEY_SYSLOG_FACILITY, NULL, NULL }
     };
     const char *driver_idx[] = { CONTAINER_LOG_CONFIG_JSON_FILE_DRIVER, CONTAINER_LOG_CONFIG_SYSLOG_DRIVER };
     size_t i, idx;
@@ -246,7 +265,7 @@ bool check_raw_log_opt(const char *key)
 {
     size_t i;
     const char *support_keys[] = {
-        "max-size", "max-file", "disable-log", "syslog-tag", "syslog-facility"
+        "max-size", "max-file", "disable-log", "syslog-tag", "syslog-facility", "compress"
     };
 
     if (key == NULL) {
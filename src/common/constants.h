@@ -100,6 +100,7 @@ extern "C" {
 #define CONTAINER_LOG_CONFIG_KEY_FILE "log.console.file"
 #define CONTAINER_LOG_CONFIG_KEY_ROTATE "log.console.filerotate"
 #define CONTAINER_LOG_CONFIG_KEY_SIZE "log.console.filesize"
+#define CONTAINER_LOG_CONFIG_KEY_COMPRESS "log.console.compress"
 #define CONTAINER_LOG_CONFIG_KEY_SYSLOG_TAG "log.console.tag"
 #define CONTAINER_LOG_CONFIG_KEY_SYSLOG_FACILITY "log.console.facility"
 
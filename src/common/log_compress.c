@@ -0,0 +1,205 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: rotate log files and compress rotated ones in background, shared by isulad and isulad-shim
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "log_compress.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/*
+ * No log is printed here: the log of isulad is written by the thread doing rotation,
+ * logging with compressor mutex held may deadlock with it. Failures leave rotated
+ * files uncompressed, which readers handle.
+ */
+
+// suffix of the hard link of a rotated file being compressed, like console.log.compress
+#define LOG_COMPRESS_SNAPSHOT_SUFFIX ".compress"
+// lowest cpu priority for the thread compressing rotated log files
+#define LOG_COMPRESS_NICE 19
+// ioprio definitions from linux/ioprio.h, which is not shipped by every libc
+#define LOG_IOPRIO_CLASS_SHIFT 13
+#define LOG_IOPRIO_CLASS_BE 2
+#define LOG_IOPRIO_WHO_PROCESS 1
+// lowest priority of best effort class, idle class may starve compression forever on busy disks
+#define LOG_IOPRIO_LEVEL 7
+
+int log_rotated_file_name(char *buf, const char *log_path, unsigned int index, const char *suffix)
+{
+    int nret = snprintf(buf, PATH_MAX, "%s.%u%s", log_path, index, suffix);
+
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        return -1;
+    }
+    return 0;
+}
+
+int log_rotate_old_files(const char *log_path, unsigned int last_index)
+{
+    unsigned int i;
+    size_t j;
+    char from[PATH_MAX] = { 0 };
+    char to[PATH_MAX] = { 0 };
+    // a rotated log file is plain or compressed
+    const char *suffixes[] = { "", LOG_COMPRESS_SUFFIX };
+
+    for (i = last_index; i > 1; i--) {
+        for (j = 0; j < sizeof(suffixes) / sizeof(suffixes[0]); j++) {
+            if (log_rotated_file_name(from, log_path, i - 1, suffixes[j]) != 0 ||
+                log_rotated_file_name(to, log_path, i, suffixes[j]) != 0) {
+                return -1;
+            }
+            if (rename(from, to) == 0) {
+                continue;
+            }
+            if (errno != ENOENT) {
+                return -1;
+            }
+            // file i - 1 is in the other format, do not keep the oldest file in this format at i
+            if (unlink(to) < 0 && errno != ENOENT) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// find the rotated file by inode, rotation may move it to a bigger index while it is compressed
+static void commit_compressed_file(log_compressor *compressor, const char *log_path, const struct stat *st,
+                                   const char *gz_tmp)
+{
+    unsigned int i;
+    struct stat cur;
+    char path[PATH_MAX] = { 0 };
+    char gz_path[PATH_MAX] = { 0 };
+
+    (void)pthread_mutex_lock(&compressor->mutex);
+    for (i = 1; i <= compressor->last_index; i++) {
+        if (log_rotated_file_name(path, log_path, i, "") != 0 ||
+            log_rotated_file_name(gz_path, log_path, i, LOG_COMPRESS_SUFFIX) != 0) {
+            break;
+        }
+        if (stat(path, &cur) != 0 || cur.st_ino != st->st_ino || cur.st_dev != st->st_dev) {
+            continue;
+        }
+        // compressed file is in place before the plain one is removed, so readers always find one of them
+        if (rename(gz_tmp, gz_path) == 0) {
+            (void)unlink(path);
+        }
+        break;
+    }
+    (void)pthread_mutex_unlock(&compressor->mutex);
+}
+
+static void compress_rotated_file(log_compressor *compressor, const char *log_path, unsigned int index)
+{
+    struct stat st;
+    char path[PATH_MAX] = { 0 };
+    char snapshot[PATH_MAX] = { 0 };
+    char gz_tmp[PATH_MAX] = { 0 };
+    int nret;
+
+    nret = snprintf(snapshot, PATH_MAX, "%s%s", log_path, LOG_COMPRESS_SNAPSHOT_SUFFIX);
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        return;
+    }
+    nret = snprintf(gz_tmp, PATH_MAX, "%s%s", snapshot, LOG_COMPRESS_SUFFIX);
+    if (nret < 0 || (size_t)nret >= PATH_MAX || log_rotated_file_name(path, log_path, index, "") != 0) {
+        return;
+    }
+
+    // the hard link pins the inode compressed, rotation may rename path at any time
+    (void)unlink(snapshot);
+    if (link(path, snapshot) != 0) {
+        // not rotated yet or compressed already
+        return;
+    }
+    if (stat(snapshot, &st) != 0) {
+        goto out;
+    }
+
+    if (compressor->compress(snapshot) != 0) {
+        goto out;
+    }
+
+    commit_compressed_file(compressor, log_path, &st, gz_tmp);
+
+out:
+    (void)unlink(snapshot);
+    // left only if compressed file is not committed
+    (void)unlink(gz_tmp);
+}
+
+static void *compress_loop(void *arg)
+{
+    log_compressor *compressor = (log_compressor *)arg;
+    unsigned int i;
+    unsigned int last;
+    char log_path[PATH_MAX] = { 0 };
+
+    (void)prctl(PR_SET_NAME, "LogCompress");
+    // best effort, only use cpu and disk time left by others, who 0 means the calling thread
+    (void)setpriority(PRIO_PROCESS, 0, LOG_COMPRESS_NICE);
+    (void)syscall(SYS_ioprio_set, LOG_IOPRIO_WHO_PROCESS, 0,
+                  (LOG_IOPRIO_CLASS_BE << LOG_IOPRIO_CLASS_SHIFT) | LOG_IOPRIO_LEVEL);
+
+    for (;;) {
+        (void)pthread_mutex_lock(&compressor->mutex);
+        while (!compressor->pending) {
+            (void)pthread_cond_wait(&compressor->cond, &compressor->mutex);
+        }
+        compressor->pending = false;
+        (void)memcpy(log_path, compressor->log_path, sizeof(log_path));
+        last = compressor->last_index;
+        (void)pthread_mutex_unlock(&compressor->mutex);
+
+        // a file missed by a rotation during last round is compressed as well
+        for (i = 1; i <= last; i++) {
+            compress_rotated_file(compressor, log_path, i);
+        }
+    }
+
+    return NULL;
+}
+
+void log_compressor_notify(log_compressor *compressor, const char *log_path, unsigned int last_index)
+{
+    pthread_t tid;
+
+    if (compressor == NULL || compressor->compress == NULL || log_path == NULL ||
+        strlen(log_path) >= sizeof(compressor->log_path)) {
+        return;
+    }
+    (void)strcpy(compressor->log_path, log_path);
+    compressor->last_index = last_index;
+
+    if (!compressor->started) {
+        // do not retry on every rotation, rotated files are kept uncompressed
+        compressor->started = true;
+        if (pthread_create(&tid, NULL, compress_loop, compressor) != 0) {
+            return;
+        }
+        (void)pthread_detach(tid);
+    }
+
+    compressor->pending = true;
+    (void)pthread_cond_signal(&compressor->cond);
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: rotate log files and compress rotated ones in background, shared by isulad and isulad-shim
+ ******************************************************************************/
+#ifndef COMMON_LOG_COMPRESS_H
+#define COMMON_LOG_COMPRESS_H
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// suffix of compressed rotated log files, like console.log.1.gz
+#define LOG_COMPRESS_SUFFIX ".gz"
+
+/* compress filename to filename.gz and remove filename like gzip -f, return 0 on success */
+typedef int (*log_compress_file_cb)(const char *filename);
+
+// state of the thread compressing rotated files of one log file
+typedef struct {
+    // serializes rename of log files between rotation and compression
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool started;
+    bool pending;
+    char log_path[PATH_MAX];
+    // index of the oldest rotated log file
+    unsigned int last_index;
+    log_compress_file_cb compress;
+} log_compressor;
+
+#define LOG_COMPRESSOR_INITIALIZER(cb) \
+    { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false, false, { 0 }, 0, (cb) }
+
+int log_rotated_file_name(char *buf, const char *log_path, unsigned int index, const char *suffix);
+
+/* move rotated file i - 1 to i for i from last_index down to 2, plain or compressed,
+ * called with compressor mutex held */
+int log_rotate_old_files(const char *log_path, unsigned int last_index);
+
+/* compress rotated files of log_path in background, the thread is started on first call,
+ * called with compressor mutex held and never waits for compression */
+void log_compressor_notify(log_compressor *compressor, const char *log_path, unsigned int last_index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMON_LOG_COMPRESS_H
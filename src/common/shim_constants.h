@@ -22,6 +22,8 @@ extern "C" {
 
 #define SHIIM_LOG_PATH_ENV "ISULAD_SHIIM_LOG_PATH"
 #define SHIIM_LOG_LEVEL_ENV "ISULAD_SHIIM_LOG_LEVEL"
+// set by isulad if rotated json-file logs of container should be compressed by isulad-shim
+#define SHIIM_LOG_COMPRESS_ENV "ISULAD_SHIIM_LOG_COMPRESS"
 
 // common exit code is defined in stdlib.h
 // EXIT_FAILURE 1   : Failing exit status.
@@ -32,6 +34,16 @@ extern "C" {
 
 #define ATTACH_SOCKET "attach.sock"
 
+// fifo in shim workdir, isulad-shim writes the container process pid to it
+// as soon as runtime create returns, so isulad does not poll the pid file
+#define SHIM_NOTIFY_FIFO "notify_fifo"
+
+// exec request sent to the shim of container over attach socket:
+// exec exec-workdir timeout
+// isulad-shim replies an int, 0 if the request is accepted, and then
+// two ints when exec process exits: shim exit code and process exit code
+#define SHIM_EXEC_REQUEST "exec"
+
 #define LOG_FIFO_MODE 0600
 
 #ifdef __cplusplus
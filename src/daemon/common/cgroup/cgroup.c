@@ -135,6 +135,16 @@ char *common_get_own_cgroup_path(const char *subsystem)
     return g_cgroup_ops.get_own_cgroup_path(subsystem);
 }
 
+char *common_get_process_cgroup_path(pid_t pid, const char *subsystem)
+{
+    if (g_cgroup_ops.get_process_cgroup_path == NULL) {
+        ERROR("Unimplemented get_process_cgroup_path ops");
+        return NULL;
+    }
+
+    return g_cgroup_ops.get_process_cgroup_path(pid, subsystem);
+}
+
 char *common_convert_cgroup_path(const char *cgroup_path)
 {
     char *token = NULL;
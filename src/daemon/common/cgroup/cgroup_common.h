@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 #include <isula_libutils/log.h>
 
@@ -95,6 +96,7 @@ typedef struct {
 
 typedef struct {
     uint64_t cpu_use_nanos;
+    uint64_t cpu_system_use;
 } cgroup_cpu_metrics_t;
 
 typedef struct {
@@ -104,8 +106,16 @@ typedef struct {
     uint64_t total_pgfault;
     uint64_t total_pgmajfault;
     uint64_t total_inactive_file;
+    // memory and swap, same as memsw of cgroup v1
+    uint64_t swap_used;
+    uint64_t swap_limit;
 } cgroup_mem_metrics_t;
 
+typedef struct {
+    uint64_t blkio_read;
+    uint64_t blkio_write;
+} cgroup_blkio_metrics_t;
+
 typedef struct {
     uint64_t pid_current;
 } cgroup_pids_metrics_t;
@@ -114,6 +124,7 @@ typedef struct {
     cgroup_cpu_metrics_t cgcpu_metrics;
     cgroup_mem_metrics_t cgmem_metrics;
     cgroup_pids_metrics_t cgpids_metrics;
+    cgroup_blkio_metrics_t cgblkio_metrics;
 } cgroup_metrics_t;
 
 #define CGROUP_OOM_HANDLE_CONTINUE false
@@ -139,6 +150,7 @@ typedef struct {
 
     char *(*get_init_cgroup_path)(const char *subsystem);
     char *(*get_own_cgroup_path)(const char *subsystem);
+    char *(*get_process_cgroup_path)(pid_t pid, const char *subsystem);
 
     cgroup_oom_handler_info_t *(*get_cgroup_oom_handler)(int fd, const char *name, const char *cgroup_path, const char *exit_fifo);
 } cgroup_ops;
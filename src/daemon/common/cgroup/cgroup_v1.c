@@ -23,6 +23,7 @@
 #include <sys/eventfd.h>
 
 #include "utils.h"
+#include "utils_timestamp.h"
 #include "sysinfo.h"
 #include "err_msg.h"
 #include "events_sender_api.h"
@@ -50,6 +51,37 @@ static int get_value_string(const char *content, const char *match, void *result
     return 0;
 }
 
+// sum bytes of all devices for match operation, lines are like "8:0 Read 4096"
+static int get_blkio_value_ull(const char *content, const char *match, void *result)
+{
+    uint64_t total = 0;
+    __isula_auto_array_t char **lines = NULL;
+    char **worker = NULL;
+
+    lines = util_string_split(content, '\n');
+    if (lines == NULL) {
+        ERROR("Failed to split content %s", content);
+        return -1;
+    }
+
+    for (worker = lines; worker && *worker; worker++) {
+        __isula_auto_array_t char **fields = util_string_split(*worker, ' ');
+        uint64_t value = 0;
+
+        if (util_array_len((const char **)fields) != 3 || strcmp(fields[1], match) != 0) {
+            continue;
+        }
+        if (util_safe_uint64(fields[2], &value) != 0) {
+            ERROR("Failed to convert %s to uint64", fields[2]);
+            return -1;
+        }
+        total += value;
+    }
+
+    *(uint64_t *)result = total;
+    return 0;
+}
+
 typedef enum {
     // CPU subsystem
     CPU_RT_PERIOD, CPU_RT_RUNTIME, CPU_SHARES, CPU_CFS_PERIOD, CPU_CFS_QUOTA,
@@ -67,6 +99,7 @@ typedef enum {
     MEMORY_TOTAL_INACTIVE_FILE, MEMORY_OOM_CONTROL,
     // BLKIO subsystem
     BLKIO_WEIGTH, BLKIO_WEIGTH_DEVICE, BLKIO_READ_BPS, BLKIO_WRITE_BPS, BLKIO_READ_IOPS, BLKIO_WRITE_IOPS,
+    BLKIO_SERVICE_BYTES_READ, BLKIO_SERVICE_BYTES_WRITE,
     // PIDS subsystem
     PIDS_CURRENT,
     // MAX
@@ -85,8 +118,8 @@ static struct cgfile_t g_cgroup_v1_files[] = {
     [CPUSET_MEMS]                 = {"cpuset_mems",           "cpuset.mems",                      NULL,                    get_value_string},
     // CPUACCT subsystem
     [CPUACCT_USE_NANOS]           = {"cpu_use_nanos",         "cpuacct.usage",                    NULL,                    get_match_value_ull},
-    [CPUACCT_USE_USER]            = {"cpu_use_user",          "cpuacct.stat",                     NULL,                    get_match_value_ull},
-    [CPUACCT_USE_SYS]             = {"cpu_use_sys",           "cpuacct.stat",                     NULL,                    get_match_value_ull},
+    [CPUACCT_USE_USER]            = {"cpu_use_user",          "cpuacct.stat",                     "user",                  get_match_value_ull},
+    [CPUACCT_USE_SYS]             = {"cpu_use_sys",           "cpuacct.stat",                     "system",                get_match_value_ull},
     // MEMORY subsystem
     [MEMORY_LIMIT]                = {"mem_limit",             "memory.limit_in_bytes",            NULL,                    get_match_value_ull},
     [MEMORY_USAGE]                = {"mem_usage",             "memory.usage_in_bytes",            NULL,                    get_match_value_ull},
@@ -110,6 +143,8 @@ static struct cgfile_t g_cgroup_v1_files[] = {
     [BLKIO_WRITE_BPS]             = {"blkio_write_bps",       "blkio.throttle.write_bps_device",  NULL,                    NULL},
     [BLKIO_READ_IOPS]             = {"blkio_read_iops",       "blkio.throttle.read_iops_device",  NULL,                    NULL},
     [BLKIO_WRITE_IOPS]            = {"blkio_write_iops",      "blkio.throttle.write_iops_device", NULL,                    NULL},
+    [BLKIO_SERVICE_BYTES_READ]    = {"blkio_service_bytes_read",  "blkio.throttle.io_service_bytes_recursive", "Read",  get_blkio_value_ull},
+    [BLKIO_SERVICE_BYTES_WRITE]   = {"blkio_service_bytes_write", "blkio.throttle.io_service_bytes_recursive", "Write", get_blkio_value_ull},
     // PIDS subsystem
     [PIDS_CURRENT]                = {"pids_current",          "pids.current",                     NULL,                    get_match_value_ull},
 };
@@ -862,6 +897,8 @@ static void get_cgroup_v1_metrics_cpu(const cgroup_layer_t *layers, const char *
     int nret = 0;
     char *mountpoint = NULL;
     char path[PATH_MAX] = { 0 };
+    uint64_t sys_ticks = 0;
+    long clk_tck = sysconf(_SC_CLK_TCK);
 
     mountpoint = common_find_cgroup_subsystem_mountpoint(layers, "cpuacct");
     if (mountpoint == NULL) {
@@ -876,6 +913,11 @@ static void get_cgroup_v1_metrics_cpu(const cgroup_layer_t *layers, const char *
     }
 
     get_cgroup_v1_value_helper(path, CPUACCT_USE_NANOS, (void *)&cgroup_cpu_metrics->cpu_use_nanos);
+
+    // cpuacct.stat is in USER_HZ
+    if (clk_tck > 0 && get_cgroup_v1_value_helper(path, CPUACCT_USE_SYS, (void *)&sys_ticks) == 0) {
+        cgroup_cpu_metrics->cpu_system_use = sys_ticks * (Time_Second / (uint64_t)clk_tck);
+    }
 }
 
 static void get_cgroup_v1_metrics_memory(const cgroup_layer_t *layers, const char *cgroup_path,
@@ -906,6 +948,11 @@ static void get_cgroup_v1_metrics_memory(const cgroup_layer_t *layers, const cha
                                (void *)&cgroup_mem_metrics->total_pgmajfault);
     get_cgroup_v1_value_helper(path, MEMORY_TOTAL_INACTIVE_FILE,
                                (void *)&cgroup_mem_metrics->total_inactive_file);
+    // memsw files exist only if swap accounting is enabled
+    if (check_cgroup_v1_file_exists(path, MEMORY_SW_USAGE, true)) {
+        get_cgroup_v1_value_helper(path, MEMORY_SW_USAGE, (void *)&cgroup_mem_metrics->swap_used);
+        get_cgroup_v1_value_helper(path, MEMORY_SW_LIMIT, (void *)&cgroup_mem_metrics->swap_limit);
+    }
 }
 
 static void get_cgroup_v1_metrics_pid(const cgroup_layer_t *layers, const char *cgroup_path,
@@ -930,6 +977,29 @@ static void get_cgroup_v1_metrics_pid(const cgroup_layer_t *layers, const char *
     get_cgroup_v1_value_helper(path, PIDS_CURRENT, (void *)&cgroup_pids_metrics->pid_current);
 }
 
+static void get_cgroup_v1_metrics_blkio(const cgroup_layer_t *layers, const char *cgroup_path,
+                                        cgroup_blkio_metrics_t *cgroup_blkio_metrics)
+{
+    int nret = 0;
+    char *mountpoint = NULL;
+    char path[PATH_MAX] = { 0 };
+
+    mountpoint = common_find_cgroup_subsystem_mountpoint(layers, "blkio");
+    if (mountpoint == NULL) {
+        ERROR("Unable to find blkio cgroup in mounts");
+        return;
+    }
+
+    nret = snprintf(path, sizeof(path), "%s/%s", mountpoint, cgroup_path);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to snprintf");
+        return;
+    }
+
+    get_cgroup_v1_value_helper(path, BLKIO_SERVICE_BYTES_READ, (void *)&cgroup_blkio_metrics->blkio_read);
+    get_cgroup_v1_value_helper(path, BLKIO_SERVICE_BYTES_WRITE, (void *)&cgroup_blkio_metrics->blkio_write);
+}
+
 static int get_cgroup_metrics_v1(const char *cgroup_path, cgroup_metrics_t *cgroup_metrics)
 {
     cgroup_layer_t *layers = NULL;
@@ -948,6 +1018,7 @@ static int get_cgroup_metrics_v1(const char *cgroup_path, cgroup_metrics_t *cgro
     get_cgroup_v1_metrics_cpu(layers, cgroup_path, &cgroup_metrics->cgcpu_metrics);
     get_cgroup_v1_metrics_memory(layers, cgroup_path, &cgroup_metrics->cgmem_metrics);
     get_cgroup_v1_metrics_pid(layers, cgroup_path, &cgroup_metrics->cgpids_metrics);
+    get_cgroup_v1_metrics_blkio(layers, cgroup_path, &cgroup_metrics->cgblkio_metrics);
 
     common_free_cgroup_layer(layers);
 
@@ -1214,6 +1285,20 @@ char *get_own_cgroup_v1(const char *subsystem)
     return common_get_cgroup_path("/proc/self/cgroup", subsystem);
 }
 
+static char *get_process_cgroup_path_v1(pid_t pid, const char *subsystem)
+{
+    int nret = 0;
+    char path[PATH_MAX] = { 0 };
+
+    nret = snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to snprintf");
+        return NULL;
+    }
+
+    return common_get_cgroup_path(path, subsystem);
+}
+
 int get_cgroup_version_v1()
 {
     return CGROUP_VERSION_1;
@@ -1230,6 +1315,7 @@ int cgroup_v1_ops_init(cgroup_ops *ops)
     ops->get_cgroup_mnt_and_root_path = get_cgroup_mnt_and_root_path_v1;
     ops->get_init_cgroup_path = get_init_cgroup_path_v1;
     ops->get_own_cgroup_path = get_own_cgroup_v1;
+    ops->get_process_cgroup_path = get_process_cgroup_path_v1;
     ops->get_cgroup_oom_handler = get_cgroup_oom_handler_v1;
     return 0;
 }
\ No newline at end of file
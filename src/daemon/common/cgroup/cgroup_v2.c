@@ -22,6 +22,7 @@
 #include <isula_libutils/auto_cleanup.h>
 
 #include "utils.h"
+#include "utils_timestamp.h"
 #include "path.h"
 #include "sysinfo.h"
 #include "events_sender_api.h"
@@ -39,6 +40,7 @@
 #define CGROUP2_MEMORY_MAX "memory.max"
 #define CGROUP2_MEMORY_LOW "memory.low"
 #define CGROUP2_MEMORY_SWAP_MAX "memory.swap.max"
+#define CGROUP2_MEMORY_SWAP_CURRENT "memory.swap.current"
 #define CGROUP2_HUGETLB_MAX "hugetlb.%s.max"
 #define CGROUP2_PIDS_MAX "pids.max"
 #define CGROUP2_FILES_LIMIT "files.limit"
@@ -72,6 +74,42 @@ static int get_value_ull_v2(const char *content, const char *match, void *result
     return 0;
 }
 
+// sum bytes of all devices for match key, lines are like "8:0 rbytes=4096 wbytes=0 rios=1 wios=0"
+static int get_io_stat_value_ull(const char *content, const char *match, void *result)
+{
+    uint64_t total = 0;
+    size_t match_len = strlen(match);
+    __isula_auto_array_t char **lines = NULL;
+    char **line = NULL;
+
+    lines = util_string_split(content, '\n');
+    if (lines == NULL) {
+        ERROR("Failed to split content %s", content);
+        return -1;
+    }
+
+    for (line = lines; line && *line; line++) {
+        __isula_auto_array_t char **fields = util_string_split(*line, ' ');
+        char **field = NULL;
+
+        for (field = fields; field && *field; field++) {
+            uint64_t value = 0;
+
+            if (strncmp(*field, match, match_len) != 0 || (*field)[match_len] != '=') {
+                continue;
+            }
+            if (util_safe_uint64(*field + match_len + 1, &value) != 0) {
+                ERROR("Failed to convert %s to uint64", *field);
+                return -1;
+            }
+            total += value;
+        }
+    }
+
+    *(uint64_t *)result = total;
+    return 0;
+}
+
 typedef enum {
     // cpu
     CPUACCT_USE_USER, CPUACCT_USE_SYS, CPUACCT_USE_NANOS,
@@ -79,8 +117,10 @@ typedef enum {
     MEMORY_USAGE, MEMORY_LIMIT, MEMORY_ANON,
     MEMORY_TOTAL_PGFAULT, MEMORY_TOTAL_INACTIVE_FILE, MEMORY_TOTAL_PGMAJFAULT,
     MEMORY_CACHE, MEMORY_CACHE_TOTAL,
+    MEMORY_SWAP_USAGE, MEMORY_SWAP_LIMIT,
     // BLKIO subsystem
     BLKIO_READ_BPS, BLKIO_WRITE_BPS, BLKIO_READ_IOPS, BLKIO_WRITE_IOPS,
+    IO_STAT_READ_BYTES, IO_STAT_WRITE_BYTES,
     // PIDS subsystem
     PIDS_CURRENT,
     // MAX
@@ -101,6 +141,11 @@ static struct cgfile_t g_cgroup_v2_files[] = {
     [MEMORY_TOTAL_INACTIVE_FILE]    = {"total_inactive_file",   "memory.stat",     "inactive_file",     get_match_value_ull},
     [MEMORY_CACHE]                  = {"cache",                 "memory.stat",     "file",              get_match_value_ull},
     [MEMORY_CACHE_TOTAL]            = {"cache_total",           "memory.stat",     "file",              get_match_value_ull},
+    [MEMORY_SWAP_USAGE]             = {"swap_usage",            CGROUP2_MEMORY_SWAP_CURRENT, NULL,      get_value_ull_v2},
+    [MEMORY_SWAP_LIMIT]             = {"swap_limit",            CGROUP2_MEMORY_SWAP_MAX, NULL,          get_value_ull_v2},
+    // io
+    [IO_STAT_READ_BYTES]            = {"io_read_bytes",         "io.stat",         "rbytes",            get_io_stat_value_ull},
+    [IO_STAT_WRITE_BYTES]           = {"io_write_bytes",        "io.stat",         "wbytes",            get_io_stat_value_ull},
     // pids
     [PIDS_CURRENT]                  = {"pids_current",          "pids.current",    NULL,                get_value_ull_v2},
 };
@@ -119,6 +164,8 @@ static void get_cgroup_v2_metrics_cpu(const char *cgroup_path, cgroup_cpu_metric
 {
     int nret = 0;
     char path[PATH_MAX] = { 0 };
+    uint64_t usage_usec = 0;
+    uint64_t system_usec = 0;
 
     nret = snprintf(path, sizeof(path), "%s/%s", CGROUP_MOUNTPOINT, cgroup_path);
     if (nret < 0 || (size_t)nret >= sizeof(path)) {
@@ -126,13 +173,22 @@ static void get_cgroup_v2_metrics_cpu(const char *cgroup_path, cgroup_cpu_metric
         return;
     }
 
-    get_cgroup_v2_value_helper(path, CPUACCT_USE_NANOS, (void *)&cgroup_cpu_metrics->cpu_use_nanos);
+    // cpu.stat is in microseconds
+    if (get_cgroup_v2_value_helper(path, CPUACCT_USE_NANOS, (void *)&usage_usec) == 0) {
+        cgroup_cpu_metrics->cpu_use_nanos = usage_usec * Time_Micro;
+    }
+    if (get_cgroup_v2_value_helper(path, CPUACCT_USE_SYS, (void *)&system_usec) == 0) {
+        cgroup_cpu_metrics->cpu_system_use = system_usec * Time_Micro;
+    }
 }
 
 static void get_cgroup_v2_metrics_memory(const char *cgroup_path, cgroup_mem_metrics_t *cgroup_mem_metrics)
 {
     int nret = 0;
     char path[PATH_MAX] = { 0 };
+    char swap_file[PATH_MAX] = { 0 };
+    uint64_t swap_used = 0;
+    uint64_t swap_limit = 0;
 
     nret = snprintf(path, sizeof(path), "%s/%s", CGROUP_MOUNTPOINT, cgroup_path);
     if (nret < 0 || (size_t)nret >= sizeof(path)) {
@@ -151,6 +207,19 @@ static void get_cgroup_v2_metrics_memory(const char *cgroup_path, cgroup_mem_met
                                (void *)&cgroup_mem_metrics->total_pgmajfault);
     get_cgroup_v2_value_helper(path, MEMORY_TOTAL_INACTIVE_FILE,
                                (void *)&cgroup_mem_metrics->total_inactive_file);
+
+    // swap files exist only if swap is enabled, report memory and swap like memsw of cgroup v1
+    nret = snprintf(swap_file, sizeof(swap_file), "%s/%s", path, CGROUP2_MEMORY_SWAP_CURRENT);
+    if (nret < 0 || (size_t)nret >= sizeof(swap_file) || !util_file_exists(swap_file)) {
+        return;
+    }
+    if (get_cgroup_v2_value_helper(path, MEMORY_SWAP_USAGE, (void *)&swap_used) == 0) {
+        cgroup_mem_metrics->swap_used = swap_used + cgroup_mem_metrics->mem_used;
+    }
+    if (get_cgroup_v2_value_helper(path, MEMORY_SWAP_LIMIT, (void *)&swap_limit) == 0) {
+        cgroup_mem_metrics->swap_limit = (swap_limit == UINT64_MAX || cgroup_mem_metrics->mem_limit == UINT64_MAX) ?
+                                         UINT64_MAX : swap_limit + cgroup_mem_metrics->mem_limit;
+    }
 }
 
 static void get_cgroup_v2_metrics_pid(const char *cgroup_path, cgroup_pids_metrics_t *cgroup_pids_metrics)
@@ -167,6 +236,21 @@ static void get_cgroup_v2_metrics_pid(const char *cgroup_path, cgroup_pids_metri
     get_cgroup_v2_value_helper(path, PIDS_CURRENT, (void *)&cgroup_pids_metrics->pid_current);
 }
 
+static void get_cgroup_v2_metrics_io(const char *cgroup_path, cgroup_blkio_metrics_t *cgroup_blkio_metrics)
+{
+    int nret = 0;
+    char path[PATH_MAX] = { 0 };
+
+    nret = snprintf(path, sizeof(path), "%s/%s", CGROUP_MOUNTPOINT, cgroup_path);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to snprintf");
+        return;
+    }
+
+    get_cgroup_v2_value_helper(path, IO_STAT_READ_BYTES, (void *)&cgroup_blkio_metrics->blkio_read);
+    get_cgroup_v2_value_helper(path, IO_STAT_WRITE_BYTES, (void *)&cgroup_blkio_metrics->blkio_write);
+}
+
 static int cgroup2_enable_all()
 {
     int ret = 0;
@@ -404,10 +488,44 @@ static int get_cgroup_metrics_v2(const char *cgroup_path, cgroup_metrics_t *cgro
     get_cgroup_v2_metrics_cpu(cgroup_path, &cgroup_metrics->cgcpu_metrics);
     get_cgroup_v2_metrics_memory(cgroup_path, &cgroup_metrics->cgmem_metrics);
     get_cgroup_v2_metrics_pid(cgroup_path, &cgroup_metrics->cgpids_metrics);
+    get_cgroup_v2_metrics_io(cgroup_path, &cgroup_metrics->cgblkio_metrics);
 
     return 0;
 }
 
+// cgroup v2 has a single hierarchy, the entry is like "0::/path"
+static char *get_process_cgroup_path_v2(pid_t pid, const char *subsystem)
+{
+    int nret = 0;
+    size_t length = 0;
+    char path[PATH_MAX] = { 0 };
+    char *res = NULL;
+    __isula_auto_file FILE *fp = NULL;
+    __isula_auto_free char *pline = NULL;
+
+    nret = snprintf(path, sizeof(path), "/proc/%d/cgroup", pid);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to snprintf");
+        return NULL;
+    }
+
+    fp = util_fopen(path, "r");
+    if (fp == NULL) {
+        SYSERROR("Failed to open %s", path);
+        return NULL;
+    }
+
+    while (getline(&pline, &length, fp) != -1) {
+        if (util_has_prefix(pline, "0::")) {
+            util_trim_newline(pline);
+            res = util_strdup_s(pline + strlen("0::"));
+            break;
+        }
+    }
+
+    return res;
+}
+
 static int get_cgroup_mnt_and_root_v2(const char *subsystem, char **mountpoint, char **root)
 {
     if (mountpoint != NULL) {
@@ -560,6 +678,7 @@ int cgroup_v2_ops_init(cgroup_ops *ops)
     ops->get_cgroup_version = get_cgroup_version_v2;
     ops->get_cgroup_info = get_cgroup_info_v2;
     ops->get_cgroup_metrics = get_cgroup_metrics_v2;
+    ops->get_process_cgroup_path = get_process_cgroup_path_v2;
     ops->get_cgroup_mnt_and_root_path = get_cgroup_mnt_and_root_v2;
     ops->get_cgroup_oom_handler = get_cgroup_oom_handler_v2;
     return 0;
@@ -39,6 +39,7 @@ const std::string Constants::CONTAINER_TYPE_LABEL_SANDBOX { "podsandbox" };
 const std::string Constants::CONTAINER_TYPE_LABEL_CONTAINER { "container" };
 const std::string Constants::CONTAINER_LOGPATH_LABEL_KEY { "cri.container.logpath" };
 const std::string Constants::CONTAINER_HUGETLB_ANNOTATION_KEY { "cri.container.hugetlblimit" };
+const std::string Constants::CONTAINER_TMPFS_SIZE_ANNOTATION_KEY { "cri.container.tmpfs-size" };
 const std::string Constants::SANDBOX_ID_LABEL_KEY { "cri.sandbox.id" };
 const std::string Constants::POD_SANDBOX_KEY { "sandboxkey" };
 const std::string Constants::KUBERNETES_CONTAINER_NAME_LABEL { "io.kubernetes.container.name" };
@@ -48,6 +49,8 @@ const std::string Constants::DOCKER_PULLABLE_IMAGEID_PREFIX { "docker-pullable:/
 const std::string Constants::RUNTIME_READY { "RuntimeReady" };
 const std::string Constants::NETWORK_READY { "NetworkReady" };
 const std::string Constants::POD_CHECKPOINT_KEY { "cri.sandbox.isulad.checkpoint" };
+const int64_t Constants::LIST_STATS_TIMEOUT_MS;
+const size_t Constants::LIST_STATS_MAX_WORKERS;
 const std::string Constants::CONTAINER_TYPE_ANNOTATION_KEY { "io.kubernetes.cri.container-type" };
 const std::string Constants::CONTAINER_NAME_ANNOTATION_KEY { "io.kubernetes.cri.container-name" };
 const std::string Constants::CONTAINER_ATTEMPT_ANNOTATION_KEY { "io.kubernetes.cri.container-attempt" };
@@ -39,6 +39,7 @@ public:
     static const std::string CONTAINER_TYPE_LABEL_CONTAINER;
     static const std::string CONTAINER_LOGPATH_LABEL_KEY;
     static const std::string CONTAINER_HUGETLB_ANNOTATION_KEY;
+    static const std::string CONTAINER_TMPFS_SIZE_ANNOTATION_KEY;
     static const std::string SANDBOX_ID_LABEL_KEY;
     static const std::string POD_SANDBOX_KEY;
     static const std::string KUBERNETES_CONTAINER_NAME_LABEL;
@@ -51,6 +52,9 @@ public:
     static const std::string NETWORK_READY;
     static const std::string POD_CHECKPOINT_KEY;
     static const size_t MAX_CHECKPOINT_KEY_LEN { 250 };
+    // stats list calls return what is collected before deadline, kubelet waits 2 minutes at most
+    static const int64_t LIST_STATS_TIMEOUT_MS { 10000 };
+    static const size_t LIST_STATS_MAX_WORKERS { 16 };
     static const std::string CONTAINER_TYPE_ANNOTATION_KEY;
     static const std::string CONTAINER_NAME_ANNOTATION_KEY;
     static const std::string CONTAINER_ATTEMPT_ANNOTATION_KEY;
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <pthread.h>
 #include <limits.h>
 #include <fcntl.h>
@@ -987,6 +988,57 @@ out:
     return check_flag;
 }
 
+static bool runtime_in_list(const char *runtime, const char *list)
+{
+    size_t i;
+    bool found = false;
+    char **runtimes = util_string_split(list, ',');
+
+    for (i = 0; i < util_array_len((const char **)runtimes); i++) {
+        if (strcasecmp(util_trim_space(runtimes[i]), runtime) == 0) {
+            found = true;
+            break;
+        }
+    }
+
+    util_free_array(runtimes);
+    return found;
+}
+
+/* conf get whether container rootfs of the runtime is mounted with overlay volatile */
+bool conf_is_volatile_rootfs_runtime(const char *runtime)
+{
+    size_t i;
+    bool found = false;
+    struct service_arguments *conf = NULL;
+    const size_t prefix_len = strlen(OVERLAY_VOLATILE_RUNTIMES_OPTION "=");
+
+    if (runtime == NULL) {
+        return false;
+    }
+
+    if (isulad_server_conf_rdlock() != 0) {
+        return false;
+    }
+
+    conf = conf_get_server_conf();
+    if (conf == NULL || conf->json_confs == NULL) {
+        goto out;
+    }
+
+    for (i = 0; i < conf->json_confs->storage_opts_len && !found; i++) {
+        const char *opt = conf->json_confs->storage_opts[i];
+
+        if (opt != NULL && strncasecmp(opt, OVERLAY_VOLATILE_RUNTIMES_OPTION "=", prefix_len) == 0) {
+            found = runtime_in_list(runtime, opt + prefix_len);
+        }
+    }
+
+out:
+    (void)isulad_server_conf_unlock();
+    return found;
+}
+
 /* conf get flag of use decrypted key to pull image */
 bool conf_get_use_decrypted_key_flag(void)
 {
@@ -31,6 +31,9 @@ extern "C" {
 
 #define DEFAULT_RUNTIME_NAME "lcr"
 
+// comma separated runtimes whose container rootfs are mounted with overlay volatile
+#define OVERLAY_VOLATILE_RUNTIMES_OPTION "overlay2.volatile_runtimes"
+
 struct isulad_conf {
     pthread_rwlock_t isulad_conf_rwlock;
     struct service_arguments *server_conf;
@@ -103,6 +106,8 @@ char *conf_get_graph_check_flag_file(void);
 
 bool conf_get_image_layer_check_flag(void);
 
+bool conf_is_volatile_rootfs_runtime(const char *runtime);
+
 int merge_json_confs_into_global(struct service_arguments *args);
 
 bool conf_get_use_decrypted_key_flag(void);
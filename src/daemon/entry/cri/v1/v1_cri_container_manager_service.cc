@@ -172,6 +172,22 @@ auto ContainerManagerService::GenerateCreateContainerHostConfig(
         }
         hostconfig->pids_limit = converted;
     }
+    // iSulad: keep the writable layer of short-lived containers on a size limited tmpfs
+    if (containerConfig.annotations().count(CRIHelpers::Constants::CONTAINER_TMPFS_SIZE_ANNOTATION_KEY) != 0) {
+        if (hostconfig->storage_opt == nullptr) {
+            hostconfig->storage_opt = (json_map_string_string *)util_common_calloc_s(sizeof(json_map_string_string));
+            if (hostconfig->storage_opt == nullptr) {
+                error.SetError("Out of memory");
+                goto cleanup;
+            }
+        }
+        if (append_json_map_string_string(hostconfig->storage_opt, STORAGE_OPT_TMPFS_SIZE,
+                                          containerConfig.annotations()
+                                          .at(CRIHelpers::Constants::CONTAINER_TMPFS_SIZE_ANNOTATION_KEY).c_str()) != 0) {
+            error.SetError("Failed to append tmpfs size storage option");
+            goto cleanup;
+        }
+    }
     CRIHelpersV1::GenerateMountBindings(containerConfig.mounts(), hostconfig, error);
     if (error.NotEmpty()) {
         goto cleanup;
@@ -913,6 +929,32 @@ void ContainerManagerService::ContainerStatsToGRPC(
     }
 }
 
+void ContainerManagerService::RequestContainerStats(
+    const container_stats_request *request,
+    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats, Errors &error)
+{
+    int ret { 0 };
+    container_stats_response *response { nullptr };
+
+    if (m_cb->container.stats_batch != nullptr) {
+        ret = m_cb->container.stats_batch(request, CRIHelpers::Constants::LIST_STATS_TIMEOUT_MS, &response);
+    } else {
+        ret = m_cb->container.stats(request, &response);
+    }
+    if (ret != 0) {
+        if (response != nullptr && response->errmsg != nullptr) {
+            error.SetError(response->errmsg);
+        } else {
+            error.SetError("Failed to call stats container callback");
+        }
+        goto cleanup;
+    }
+    ContainerStatsToGRPC(response, containerstats, error);
+
+cleanup:
+    free_container_stats_response(response);
+}
+
 void ContainerManagerService::ListContainerStats(
     const runtime::v1::ContainerStatsFilter *filter,
     std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats, Errors &error)
@@ -922,7 +964,6 @@ void ContainerManagerService::ListContainerStats(
         return;
     }
 
-    container_stats_response *response { nullptr };
     container_stats_request *request = (container_stats_request *)util_common_calloc_s(sizeof(container_stats_request));
     if (request == nullptr) {
         error.SetError("Out of memory");
@@ -940,19 +981,55 @@ void ContainerManagerService::ListContainerStats(
         goto cleanup;
     }
 
-    if (m_cb->container.stats(request, &response) != 0) {
-        if (response != nullptr && response->errmsg != nullptr) {
-            error.SetError(response->errmsg);
-        } else {
-            error.SetError("Failed to call stats container callback");
-        }
+    RequestContainerStats(request, containerstats, error);
+
+cleanup:
+    free_container_stats_request(request);
+}
+
+void ContainerManagerService::ListContainerStats(
+    const std::vector<std::string> &containerIDs,
+    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats, Errors &error)
+{
+    if (m_cb == nullptr || m_cb->container.stats == nullptr) {
+        error.SetError("Unimplemented callback");
+        return;
+    }
+
+    if (containerIDs.empty()) {
+        return;
+    }
+
+    container_stats_request *request = (container_stats_request *)util_common_calloc_s(sizeof(container_stats_request));
+    if (request == nullptr) {
+        error.SetError("Out of memory");
+        goto cleanup;
+    }
+    request->all = true;
+
+    request->filters = (defs_filters *)util_common_calloc_s(sizeof(defs_filters));
+    if (request->filters == nullptr) {
+        error.SetError("Out of memory");
+        goto cleanup;
+    }
+
+    if (PackContainerStatsFilter(nullptr, request, error) != 0) {
         goto cleanup;
     }
-    ContainerStatsToGRPC(response, containerstats, error);
+
+    request->containers = (char **)util_smart_calloc_s(sizeof(char *), containerIDs.size());
+    if (request->containers == nullptr) {
+        error.SetError("Out of memory");
+        goto cleanup;
+    }
+    for (const auto &id : containerIDs) {
+        request->containers[request->containers_len++] = util_strdup_s(id.c_str());
+    }
+
+    RequestContainerStats(request, containerstats, error);
 
 cleanup:
     free_container_stats_request(request);
-    free_container_stats_response(response);
 }
 
 auto ContainerManagerService::ContainerStats(const std::string &containerID, Errors &error)
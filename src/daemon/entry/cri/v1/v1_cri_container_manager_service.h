@@ -56,6 +56,11 @@ public:
                             std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats,
                             Errors &error);
 
+    // stats of the given containers, containers removed meanwhile are left out when stats_batch is supported
+    void ListContainerStats(const std::vector<std::string> &containerIDs,
+                            std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats,
+                            Errors &error);
+
     auto ContainerStats(const std::string &containerID, Errors &error)
     -> std::unique_ptr<runtime::v1::ContainerStats>;
 
@@ -102,6 +107,9 @@ private:
                               std::vector<std::unique_ptr<runtime::v1::Container>> &pods, Errors &error);
     auto PackContainerStatsFilter(const runtime::v1::ContainerStatsFilter *filter,
                                   container_stats_request *request, Errors &error) -> int;
+    void RequestContainerStats(const container_stats_request *request,
+                               std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats,
+                               Errors &error);
     void ContainerStatsToGRPC(container_stats_response *response,
                               std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerstats,
                               Errors &error);
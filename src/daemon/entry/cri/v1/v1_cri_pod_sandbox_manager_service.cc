@@ -20,6 +20,7 @@
 #include <isula_libutils/container_config.h>
 #include <isula_libutils/auto_cleanup.h>
 #include <algorithm>
+#include <set>
 
 #include "checkpoint_handler.h"
 #include "utils.h"
@@ -1064,20 +1065,9 @@ auto PodSandboxManagerService::GetAvailableBytes(const uint64_t &memoryLimit, co
 }
 
 void PodSandboxManagerService::PackagePodSandboxContainerStats(
-    const std::string &id,
-    const std::unique_ptr<ContainerManagerService> &containerManager,
+    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
     std::unique_ptr<runtime::v1::PodSandboxStats> &podStatsPtr, Errors &error)
 {
-    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> containerStats;
-    runtime::v1::ContainerStatsFilter filter;
-
-    filter.set_pod_sandbox_id(id);
-    containerManager->ListContainerStats(&filter, containerStats, error);
-    if (error.NotEmpty()) {
-        error.Errorf("Failed to list container stats: %s", error.GetCMessage());
-        return;
-    }
-
     for (auto &itor : containerStats) {
         auto container = podStatsPtr->mutable_linux()->add_containers();
         if (container == nullptr) {
@@ -1089,9 +1079,54 @@ void PodSandboxManagerService::PackagePodSandboxContainerStats(
     }
 }
 
+void PodSandboxManagerService::GetPodSandboxContainerStats(
+    const std::unique_ptr<ContainerManagerService> &containerManager, const std::vector<std::string> &podSandboxIDs,
+    bool allPods, std::map<std::string, std::vector<std::unique_ptr<runtime::v1::ContainerStats>>> &podContainerStats,
+    Errors &error)
+{
+    std::vector<std::unique_ptr<runtime::v1::Container>> containers;
+    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> containerStats;
+    std::set<std::string> pods(podSandboxIDs.begin(), podSandboxIDs.end());
+    std::vector<std::string> containerIDs;
+    std::map<std::string, std::string> containerPods;
+
+    // sandbox id label is internal and not in stats attributes, map containers to pods by listing them,
+    // listing reads no runtime stats
+    containerManager->ListContainers(nullptr, containers, error);
+    if (error.NotEmpty()) {
+        error.Errorf("Failed to list containers: %s", error.GetCMessage());
+        return;
+    }
+    for (auto &container : containers) {
+        if (pods.count(container->pod_sandbox_id()) == 0) {
+            continue;
+        }
+        containerPods[container->id()] = container->pod_sandbox_id();
+        containerIDs.push_back(container->id());
+    }
+
+    // stats of containers of all selected pods are read in one batch, bounded by its workers and deadline
+    if (allPods) {
+        containerManager->ListContainerStats(nullptr, containerStats, error);
+    } else {
+        containerManager->ListContainerStats(containerIDs, containerStats, error);
+    }
+    if (error.NotEmpty()) {
+        error.Errorf("Failed to list container stats: %s", error.GetCMessage());
+        return;
+    }
+    for (auto &stats : containerStats) {
+        auto pod = containerPods.find(stats->attributes().id());
+        if (pod == containerPods.end()) {
+            continue;
+        }
+        podContainerStats[pod->second].push_back(std::move(stats));
+    }
+}
+
 void PodSandboxManagerService::PodSandboxStatsToGRPC(const std::string &id, const cgroup_metrics_t &cgroupMetrics,
                                                      const std::vector<Network::NetworkInterfaceStats> &netMetrics,
-                                                     const std::unique_ptr<ContainerManagerService> &containerManager,
+                                                     std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
                                                      std::unique_ptr<runtime::v1::PodSandboxStats> &podStats,
                                                      sandbox::StatsInfo &oldStatsRec,
                                                      Errors &error)
@@ -1163,7 +1198,7 @@ void PodSandboxManagerService::PodSandboxStatsToGRPC(const std::string &id, cons
     process->set_timestamp(timestamp);
     process->mutable_process_count()->set_value(cgroupMetrics.cgpids_metrics.pid_current);
 
-    PackagePodSandboxContainerStats(id, containerManager, podStatsPtr, error);
+    PackagePodSandboxContainerStats(containerStats, podStatsPtr, error);
     if (error.NotEmpty()) {
         return;
     }
@@ -1175,6 +1210,24 @@ void PodSandboxManagerService::PodSandboxStatsToGRPC(const std::string &id, cons
 auto PodSandboxManagerService::PodSandboxStats(const std::string &podSandboxID,
                                                const std::unique_ptr<ContainerManagerService> &containerManager,
                                                Errors &error) -> std::unique_ptr<runtime::v1::PodSandboxStats>
+{
+    std::vector<std::unique_ptr<runtime::v1::ContainerStats>> containerStats;
+    runtime::v1::ContainerStatsFilter filter;
+
+    filter.set_pod_sandbox_id(podSandboxID);
+    containerManager->ListContainerStats(&filter, containerStats, error);
+    if (error.NotEmpty()) {
+        ERROR("Failed to list container stats of sandbox id %s: %s", podSandboxID.c_str(), error.GetCMessage());
+        error.Errorf("Failed to list container stats of sandbox id %s", podSandboxID.c_str());
+        return nullptr;
+    }
+
+    return GetPodSandboxStats(podSandboxID, containerStats, error);
+}
+
+auto PodSandboxManagerService::GetPodSandboxStats(const std::string &podSandboxID,
+                                                  std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
+                                                  Errors &error) -> std::unique_ptr<runtime::v1::PodSandboxStats>
 {
     Errors tmpErr;
     cgroup_metrics_t cgroupMetrics { 0 };
@@ -1212,7 +1265,7 @@ auto PodSandboxManagerService::PodSandboxStats(const std::string &podSandboxID,
         tmpErr.Clear();
     }
 
-    PodSandboxStatsToGRPC(sandbox->GetId(), cgroupMetrics, netMetrics, containerManager, podStats, oldStatsRec, tmpErr);
+    PodSandboxStatsToGRPC(sandbox->GetId(), cgroupMetrics, netMetrics, containerStats, podStats, oldStatsRec, tmpErr);
     if (tmpErr.NotEmpty()) {
         ERROR("Failed to set PodSandboxStats: %s", tmpErr.GetCMessage());
         error.Errorf("Failed to set PodSandboxStats");
@@ -1297,6 +1350,9 @@ void PodSandboxManagerService::ListPodSandboxStats(const runtime::v1::PodSandbox
                                                    Errors &error)
 {
     std::vector<std::string> podSandboxIDs;
+    std::map<std::string, std::vector<std::unique_ptr<runtime::v1::ContainerStats>>> podContainerStats;
+    bool allPods = false;
+    Errors tmpErr;
 
     GetFilterPodSandbox(filter, podSandboxIDs, error);
     if (error.NotEmpty()) {
@@ -1310,15 +1366,24 @@ void PodSandboxManagerService::ListPodSandboxStats(const runtime::v1::PodSandbox
         return;
     }
 
+    // without filter every running pod is wanted, reading stats of all containers is cheaper than naming them
+    allPods = filter == nullptr || (filter->id().empty() && filter->label_selector().empty());
+    GetPodSandboxContainerStats(containerManager, podSandboxIDs, allPods, podContainerStats, tmpErr);
+    if (tmpErr.NotEmpty()) {
+        ERROR("Failed to get container stats of pods: %s", tmpErr.GetCMessage());
+        error.SetError("Failed to get container stats of pods");
+        return;
+    }
+
+    // pod level metrics are read from cgroup files and netns, cheap enough to be done in place
     for (auto &id : podSandboxIDs) {
-        Errors tmpErr;
-        auto podStats = PodSandboxStats(id, containerManager, tmpErr);
+        tmpErr.Clear();
+        auto podStats = GetPodSandboxStats(id, podContainerStats[id], tmpErr);
         if (podStats == nullptr) {
             WARN("Failed to get podSandbox %s stats: %s", id.c_str(), tmpErr.GetCMessage());
             continue;
         }
-
-        podsStats.push_back(move(podStats));
+        podsStats.push_back(std::move(podStats));
     }
 }
 
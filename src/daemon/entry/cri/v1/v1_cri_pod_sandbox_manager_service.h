@@ -115,16 +115,23 @@ private:
     void PackagePodSandboxStatsAttributes(const std::string &id,
                                           std::unique_ptr<runtime::v1::PodSandboxStats> &podStatsPtr,
                                           Errors &error);
-    void PackagePodSandboxContainerStats(const std::string &id,
-                                         const std::unique_ptr<ContainerManagerService> &containerManager,
+    void PackagePodSandboxContainerStats(std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
                                          std::unique_ptr<runtime::v1::PodSandboxStats> &podStatsPtr,
                                          Errors &error);
+    void GetPodSandboxContainerStats(
+        const std::unique_ptr<ContainerManagerService> &containerManager, const std::vector<std::string> &podSandboxIDs,
+        bool allPods,
+        std::map<std::string, std::vector<std::unique_ptr<runtime::v1::ContainerStats>>> &podContainerStats,
+        Errors &error);
     void PodSandboxStatsToGRPC(const std::string &id, const cgroup_metrics_t &cgroupMetrics,
                                const std::vector<Network::NetworkInterfaceStats> &netMetrics,
-                               const std::unique_ptr<ContainerManagerService> &containerManager,
+                               std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
                                std::unique_ptr<runtime::v1::PodSandboxStats> &podStats,
                                sandbox::StatsInfo &statsInfo,
                                Errors &error);
+    auto GetPodSandboxStats(const std::string &podSandboxID,
+                            std::vector<std::unique_ptr<runtime::v1::ContainerStats>> &containerStats,
+                            Errors &error) -> std::unique_ptr<runtime::v1::PodSandboxStats>;
     void GetFilterPodSandbox(const runtime::v1::PodSandboxStatsFilter *filter,
                              std::vector<std::string> &podSandboxIDs, Errors &error);
     void ApplySandboxLinuxOptions(const runtime::v1::LinuxPodSandboxConfig &lc, host_config *hc,
@@ -202,6 +202,22 @@ auto ContainerManagerService::GenerateCreateContainerHostConfig(
         }
         hostconfig->pids_limit = converted;
     }
+    // iSulad: keep the writable layer of short-lived containers on a size limited tmpfs
+    if (containerConfig.annotations().count(CRIHelpers::Constants::CONTAINER_TMPFS_SIZE_ANNOTATION_KEY) != 0) {
+        if (hostconfig->storage_opt == nullptr) {
+            hostconfig->storage_opt = (json_map_string_string *)util_common_calloc_s(sizeof(json_map_string_string));
+            if (hostconfig->storage_opt == nullptr) {
+                error.SetError("Out of memory");
+                goto cleanup;
+            }
+        }
+        if (append_json_map_string_string(hostconfig->storage_opt, STORAGE_OPT_TMPFS_SIZE,
+                                          containerConfig.annotations()
+                                          .at(CRIHelpers::Constants::CONTAINER_TMPFS_SIZE_ANNOTATION_KEY).c_str()) != 0) {
+            error.SetError("Failed to append tmpfs size storage option");
+            goto cleanup;
+        }
+    }
     CRIHelpersV1Alpha::GenerateMountBindings(containerConfig.mounts(), hostconfig, error);
     if (error.NotEmpty()) {
         goto cleanup;
@@ -239,6 +239,11 @@ typedef struct {
 
     int (*stats)(const container_stats_request *request, container_stats_response **response);
 
+    // stats of containers are collected concurrently, if timeout_ms > 0, containers whose stats
+    // are not collected before deadline are left out of response, so are named containers that no longer exist
+    int (*stats_batch)(const container_stats_request *request, int64_t timeout_ms,
+                       container_stats_response **response);
+
     int (*pause)(const container_pause_request *request, container_pause_response **response);
 
     int (*resume)(const container_resume_request *request, container_resume_response **response);
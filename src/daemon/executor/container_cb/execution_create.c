@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include <isula_libutils/log.h>
 #include <isula_libutils/auto_cleanup.h>
@@ -1160,9 +1161,43 @@ static int get_basic_spec(const container_create_request *request, host_config *
     return 0;
 }
 
+// runtimes listed in overlay2.volatile_runtimes get volatile rootfs unless the container sets it itself
+static int append_runtime_volatile_storage_opt(const char *runtime, im_prepare_request *request)
+{
+    size_t i;
+
+    if (request->image_type == NULL || strcmp(request->image_type, IMAGE_TYPE_OCI) != 0 ||
+        !conf_is_volatile_rootfs_runtime(runtime)) {
+        return 0;
+    }
+
+    if (request->storage_opt == NULL) {
+        request->storage_opt = util_common_calloc_s(sizeof(json_map_string_string));
+        if (request->storage_opt == NULL) {
+            ERROR("Out of memory");
+            return -1;
+        }
+    }
+
+    for (i = 0; i < request->storage_opt->len; i++) {
+        // same match as the driver, which parses the key case insensitively
+        if (strcasecmp(request->storage_opt->keys[i], STORAGE_OPT_VOLATILE) == 0) {
+            return 0;
+        }
+    }
+
+    if (append_json_map_string_string(request->storage_opt, STORAGE_OPT_VOLATILE, "true") != 0) {
+        ERROR("Failed to append volatile storage opt");
+        return -1;
+    }
+
+    return 0;
+}
+
 static int do_image_create_container_roofs_layer(const char *container_id, const char *image_type,
                                                  const char *image_name, const char *mount_label, const char *rootfs,
-                                                 json_map_string_string *storage_opt, char **real_rootfs)
+                                                 const char *runtime, json_map_string_string *storage_opt,
+                                                 char **real_rootfs)
 {
     int ret = 0;
     im_prepare_request *request = NULL;
@@ -1192,6 +1227,11 @@ static int do_image_create_container_roofs_layer(const char *container_id, const
         }
     }
 
+    if (append_runtime_volatile_storage_opt(runtime, request) != 0) {
+        ret = -1;
+        goto out;
+    }
+
     if (im_prepare_container_rootfs(request, real_rootfs)) {
         ret = -1;
         goto out;
@@ -1480,7 +1520,7 @@ int container_create_cb(const container_create_request *request, container_creat
     }
 
     ret = do_image_create_container_roofs_layer(id, image_type, image_name, v2_spec->mount_label, request->rootfs,
-                                                host_spec->storage_opt, &real_rootfs);
+                                                runtime, host_spec->storage_opt, &real_rootfs);
     if (ret != 0) {
         ERROR("Can not create container %s rootfs layer", id);
         cc = ISULAD_ERR_EXEC;
@@ -15,6 +15,10 @@
 #include "execution_extend.h"
 
 #include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/prctl.h>
 #include <sys/sysinfo.h>
 #include <isula_libutils/container_config.h>
 #include <isula_libutils/container_config_v2.h>
@@ -56,6 +60,15 @@
 #include "stream_wrapper.h"
 #include "utils_array.h"
 #include "utils_verify.h"
+#include "utils_timestamp.h"
+
+// stats is mostly read from cgroup files, workers wait on io rather than cpu
+#define CONTAINER_STATS_MAX_WORKERS 16
+
+// duration like 1s or 500ms, stats of running containers are sampled in background at this
+// interval and served to stats callers, unset to collect stats on demand only
+#define CONTAINER_STATS_SAMPLE_INTERVAL_ENV "ISULAD_STATS_SAMPLE_INTERVAL"
+#define CONTAINER_STATS_MIN_SAMPLE_INTERVAL (100 * Time_Milli)
 
 struct stats_context {
     struct filters_args *stats_filters;
@@ -232,14 +245,11 @@ static uint64_t get_available_bytes(const uint64_t memory_limit, const uint64_t
 }
 
 static container_info *get_container_stats(const container_t *cont,
-                                           const struct runtime_container_resources_stats_info *einfo,
-                                           const struct stats_context *ctx)
+                                           const struct runtime_container_resources_stats_info *einfo)
 {
-    int ret = 0;
     uint64_t sysmem_limit;
     uint64_t sys_cpu_usage = 0;
     container_info *info = NULL;
-    map_t *map_labels = NULL;
 
     info = util_common_calloc_s(sizeof(container_info));
     if (info == NULL) {
@@ -293,30 +303,33 @@ static container_info *get_container_stats(const container_t *cont,
     info->cache_total = einfo->cache_total;
     info->inactive_file_total = einfo->inactive_file_total;
 
+    return info;
+}
+
+// filters are checked before runtime stats is read, so containers filtered out cost nothing
+static bool stats_filter_match(const container_t *cont, const struct stats_context *ctx)
+{
+    bool ret = false;
+    map_t *map_labels = NULL;
+
     if (copy_map_labels(cont->common_config->config, &map_labels) != 0) {
-        ret = -1;
         goto cleanup;
     }
 
-    if (!filters_args_match(ctx->stats_filters, "id", info->id)) {
-        ret = -1;
+    if (!filters_args_match(ctx->stats_filters, "id", cont->common_config->id)) {
         goto cleanup;
     }
 
     // Do not include container if any of the labels don't match
     if (!filters_args_match_kv_list(ctx->stats_filters, "label", map_labels)) {
-        ret = -1;
         goto cleanup;
     }
 
+    ret = true;
+
 cleanup:
     map_free(map_labels);
-    if (ret != 0) {
-        free_container_info(info);
-        info = NULL;
-    }
-
-    return info;
+    return ret;
 }
 
 static struct stats_context *fold_stats_filter(const container_stats_request *request)
@@ -445,24 +458,601 @@ static void update_usage_nano_cores(container_info *stats, const container_info
     stats->cpu_use_nanos_per_second = (uint64_t)(((double)usage / (double)nanoSeconds) * (double)Time_Second);
 }
 
+struct stats_batch {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    // containers matching filters, stats of conts[i] is saved to infos[i]
+    container_t **conts;
+    container_info **infos;
+    size_t len;
+    size_t next;
+    size_t done;
+    // set when deadline expires, workers stop taking new containers
+    bool expired;
+    // the caller and each worker hold one, the last one frees the batch
+    size_t refs;
+};
+
+static void free_stats_batch(struct stats_batch *batch)
+{
+    size_t i;
+
+    for (i = 0; i < batch->len; i++) {
+        container_unref(batch->conts[i]);
+        free_container_info(batch->infos[i]);
+    }
+    free(batch->conts);
+    free(batch->infos);
+    (void)pthread_cond_destroy(&batch->cond);
+    (void)pthread_mutex_destroy(&batch->mutex);
+    free(batch);
+}
+
+static void put_stats_batch(struct stats_batch *batch)
+{
+    bool last = false;
+
+    (void)pthread_mutex_lock(&batch->mutex);
+    batch->refs--;
+    last = batch->refs == 0;
+    (void)pthread_mutex_unlock(&batch->mutex);
+
+    if (last) {
+        free_stats_batch(batch);
+    }
+}
+
+static struct stats_batch *stats_batch_new(size_t cap)
+{
+    pthread_condattr_t attr;
+    struct stats_batch *batch = NULL;
+
+    batch = util_common_calloc_s(sizeof(struct stats_batch));
+    if (batch == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    batch->conts = util_smart_calloc_s(sizeof(container_t *), cap);
+    batch->infos = util_smart_calloc_s(sizeof(container_info *), cap);
+    if (batch->conts == NULL || batch->infos == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+
+    if (pthread_mutex_init(&batch->mutex, NULL) != 0) {
+        ERROR("Failed to init stats batch mutex");
+        goto err_out;
+    }
+
+    // deadline is measured with monotonic clock
+    if (pthread_condattr_init(&attr) != 0 || pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0 ||
+        pthread_cond_init(&batch->cond, &attr) != 0) {
+        ERROR("Failed to init stats batch cond");
+        (void)pthread_mutex_destroy(&batch->mutex);
+        goto err_out;
+    }
+    (void)pthread_condattr_destroy(&attr);
+    batch->refs = 1;
+
+    return batch;
+
+err_out:
+    free(batch->conts);
+    free(batch->infos);
+    free(batch);
+    return NULL;
+}
+
+static container_info *collect_container_stats(container_t *cont)
+{
+    int nret;
+    container_info *cont_info = NULL;
+    container_info *old_cont_info = NULL;
+    struct runtime_container_resources_stats_info einfo = { 0 };
+
+    if (container_is_running(cont->state)) {
+        rt_stats_params_t params = { 0 };
+        params.rootpath = cont->root_path;
+        params.state = cont->state_path;
+
+        nret = runtime_resources_stats(cont->common_config->id, cont->runtime, &params, &einfo);
+        if (nret != 0) {
+            return NULL;
+        }
+    }
+
+    cont_info = get_container_stats(cont, &einfo);
+    if (cont_info == NULL) {
+        return NULL;
+    }
+
+    if (container_update_info(cont, cont_info, &old_cont_info) != 0) {
+        WARN("Failed to update container info");
+    }
+
+    update_usage_nano_cores(cont_info, old_cont_info);
+    free_container_info(old_cont_info);
+
+    return cont_info;
+}
+
+static void *stats_worker(void *arg)
+{
+    struct stats_batch *batch = (struct stats_batch *)arg;
+    container_info *cont_info = NULL;
+    size_t i;
+
+    prctl(PR_SET_NAME, "StatsWorker");
+
+    for (;;) {
+        (void)pthread_mutex_lock(&batch->mutex);
+        // stats served from sampler snapshot are filled before workers start
+        while (batch->next < batch->len && batch->infos[batch->next] != NULL) {
+            batch->next++;
+        }
+        if (batch->expired || batch->next >= batch->len) {
+            (void)pthread_mutex_unlock(&batch->mutex);
+            break;
+        }
+        i = batch->next++;
+        (void)pthread_mutex_unlock(&batch->mutex);
+
+        cont_info = collect_container_stats(batch->conts[i]);
+
+        (void)pthread_mutex_lock(&batch->mutex);
+        batch->infos[i] = cont_info;
+        batch->done++;
+        if (batch->done == batch->len) {
+            (void)pthread_cond_signal(&batch->cond);
+        }
+        (void)pthread_mutex_unlock(&batch->mutex);
+    }
+
+    put_stats_batch(batch);
+    return NULL;
+}
+
+static size_t start_stats_workers(struct stats_batch *batch)
+{
+    pthread_t tid;
+    pthread_attr_t attr;
+    size_t pending = batch->len - batch->done;
+    size_t workers = pending < CONTAINER_STATS_MAX_WORKERS ? pending : CONTAINER_STATS_MAX_WORKERS;
+    size_t started = 0;
+
+    if (pthread_attr_init(&attr) != 0) {
+        return 0;
+    }
+    (void)pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for (; started < workers; started++) {
+        (void)pthread_mutex_lock(&batch->mutex);
+        batch->refs++;
+        (void)pthread_mutex_unlock(&batch->mutex);
+        if (pthread_create(&tid, &attr, stats_worker, batch) != 0) {
+            WARN("Failed to start stats worker");
+            (void)pthread_mutex_lock(&batch->mutex);
+            batch->refs--;
+            (void)pthread_mutex_unlock(&batch->mutex);
+            break;
+        }
+    }
+    (void)pthread_attr_destroy(&attr);
+
+    return started;
+}
+
+// wait workers until all stats are collected or deadline expires
+static void wait_stats_batch(struct stats_batch *batch, int64_t timeout_ms)
+{
+    struct timespec deadline = { 0 };
+
+    if (timeout_ms > 0) {
+        (void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    (void)pthread_mutex_lock(&batch->mutex);
+    while (batch->done < batch->len) {
+        if (timeout_ms <= 0) {
+            (void)pthread_cond_wait(&batch->cond, &batch->mutex);
+        } else if (pthread_cond_timedwait(&batch->cond, &batch->mutex, &deadline) == ETIMEDOUT) {
+            WARN("Stats of %zu containers are not collected before deadline", batch->len - batch->done);
+            break;
+        }
+    }
+    batch->expired = true;
+    (void)pthread_mutex_unlock(&batch->mutex);
+}
+
+// collect stats not filled yet, by workers if more than one is pending
+static void run_stats_batch(struct stats_batch *batch, int64_t timeout_ms)
+{
+    size_t i;
+
+    // stats of one container is collected in place, no thread is needed
+    if (batch->len - batch->done <= 1 || start_stats_workers(batch) == 0) {
+        for (i = 0; i < batch->len; i++) {
+            if (batch->infos[i] == NULL) {
+                batch->infos[i] = collect_container_stats(batch->conts[i]);
+            }
+        }
+        batch->done = batch->len;
+        return;
+    }
+
+    wait_stats_batch(batch, timeout_ms);
+}
+
+struct stats_snapshot {
+    // stats of running containers sorted by id, never changed once published
+    container_info **infos;
+    size_t len;
+    // monotonic time when sampling finished
+    int64_t sampled_at;
+    // protected by g_stats_snapshot_mutex
+    size_t refs;
+};
+
+static pthread_mutex_t g_stats_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_snapshot *g_stats_snapshot = NULL;
+// nanoseconds between two samples, 0 if sampler is disabled, shared by request threads and the sampler
+static int64_t g_stats_sample_interval = 0;
+// sampler waits on cond between two samples, so it is woken up at once to stop
+static pthread_mutex_t g_stats_sampler_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_stats_sampler_cond;
+static pthread_t g_stats_sampler_tid;
+static bool g_stats_sampler_started = false;
+static bool g_stats_sampler_stop = false;
+
+static int64_t stats_sample_interval_get(void)
+{
+    return __atomic_load_n(&g_stats_sample_interval, __ATOMIC_ACQUIRE);
+}
+
+static void stats_sample_interval_set(int64_t interval)
+{
+    __atomic_store_n(&g_stats_sample_interval, interval, __ATOMIC_RELEASE);
+}
+
+static int64_t get_monotonic_nanos(void)
+{
+    struct timespec ts = { 0 };
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * Time_Second + ts.tv_nsec;
+}
+
+static void free_stats_snapshot(struct stats_snapshot *snapshot)
+{
+    size_t i;
+
+    for (i = 0; i < snapshot->len; i++) {
+        free_container_info(snapshot->infos[i]);
+    }
+    free(snapshot->infos);
+    free(snapshot);
+}
+
+static void put_stats_snapshot(struct stats_snapshot *snapshot)
+{
+    bool last = false;
+
+    if (snapshot == NULL) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&g_stats_snapshot_mutex);
+    snapshot->refs--;
+    last = snapshot->refs == 0;
+    (void)pthread_mutex_unlock(&g_stats_snapshot_mutex);
+
+    if (last) {
+        free_stats_snapshot(snapshot);
+    }
+}
+
+// readers only take a reference under the lock, sampling never holds it
+static struct stats_snapshot *get_stats_snapshot(void)
+{
+    struct stats_snapshot *snapshot = NULL;
+    int64_t interval = stats_sample_interval_get();
+
+    if (interval == 0) {
+        return NULL;
+    }
+
+    (void)pthread_mutex_lock(&g_stats_snapshot_mutex);
+    snapshot = g_stats_snapshot;
+    // a stuck sampler must not serve stale stats, callers collect them on demand then
+    if (snapshot != NULL && get_monotonic_nanos() - snapshot->sampled_at > 2 * interval) {
+        snapshot = NULL;
+    }
+    if (snapshot != NULL) {
+        snapshot->refs++;
+    }
+    (void)pthread_mutex_unlock(&g_stats_snapshot_mutex);
+
+    return snapshot;
+}
+
+static void publish_stats_snapshot(struct stats_snapshot *snapshot)
+{
+    struct stats_snapshot *old = NULL;
+
+    snapshot->refs = 1;
+    (void)pthread_mutex_lock(&g_stats_snapshot_mutex);
+    old = g_stats_snapshot;
+    g_stats_snapshot = snapshot;
+    (void)pthread_mutex_unlock(&g_stats_snapshot_mutex);
+
+    put_stats_snapshot(old);
+}
+
+static int stats_info_cmp(const void *a, const void *b)
+{
+    const container_info *ia = *(const container_info * const *)a;
+    const container_info *ib = *(const container_info * const *)b;
+
+    return strcmp(ia->id, ib->id);
+}
+
+// copy of sampled stats of cont, status is read again as it may be changed since sampling
+static container_info *get_sampled_stats(const struct stats_snapshot *snapshot, const container_t *cont)
+{
+    container_info key = { 0 };
+    const container_info *pkey = &key;
+    container_info **found = NULL;
+    const container_info *src = NULL;
+    container_info *info = NULL;
+
+    key.id = cont->common_config->id;
+    found = bsearch(&pkey, snapshot->infos, snapshot->len, sizeof(container_info *), stats_info_cmp);
+    if (found == NULL) {
+        return NULL;
+    }
+    src = *found;
+
+    info = util_common_calloc_s(sizeof(container_info));
+    if (info == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    info->id = util_strdup_s(src->id);
+    info->name = util_strdup_s(src->name);
+    info->image_type = util_strdup_s(src->image_type);
+    info->status = util_strdup_s(container_state_to_string(container_state_get_status(cont->state)));
+    info->pids_current = src->pids_current;
+    info->cpu_use_nanos = src->cpu_use_nanos;
+    info->cpu_use_nanos_per_second = src->cpu_use_nanos_per_second;
+    info->cpu_system_use = src->cpu_system_use;
+    info->online_cpus = src->online_cpus;
+    info->blkio_read = src->blkio_read;
+    info->blkio_write = src->blkio_write;
+    info->mem_used = src->mem_used;
+    info->mem_limit = src->mem_limit;
+    info->rss_bytes = src->rss_bytes;
+    info->page_faults = src->page_faults;
+    info->major_page_faults = src->major_page_faults;
+    info->kmem_used = src->kmem_used;
+    info->kmem_limit = src->kmem_limit;
+    info->swap_used = src->swap_used;
+    info->swap_limit = src->swap_limit;
+    info->workingset_bytes = src->workingset_bytes;
+    info->avaliable_bytes = src->avaliable_bytes;
+    info->cache = src->cache;
+    info->cache_total = src->cache_total;
+    info->inactive_file_total = src->inactive_file_total;
+    info->timestamp = src->timestamp;
+
+    return info;
+}
+
+static struct stats_snapshot *sample_containers_stats(void)
+{
+    size_t i;
+    size_t ids_len = 0;
+    char **idsarray = NULL;
+    struct stats_batch *batch = NULL;
+    struct stats_snapshot *snapshot = NULL;
+
+    idsarray = containers_store_list_ids();
+    ids_len = util_array_len((const char **)idsarray);
+
+    snapshot = util_common_calloc_s(sizeof(struct stats_snapshot));
+    if (snapshot == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+
+    if (ids_len == 0) {
+        goto out;
+    }
+
+    batch = stats_batch_new(ids_len);
+    if (batch == NULL) {
+        goto err_out;
+    }
+    snapshot->infos = util_smart_calloc_s(sizeof(container_info *), ids_len);
+    if (snapshot->infos == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+
+    for (i = 0; i < ids_len; i++) {
+        container_t *cont = containers_store_get(idsarray[i]);
+        if (cont == NULL) {
+            continue;
+        }
+        if (!container_is_running(cont->state)) {
+            container_unref(cont);
+            continue;
+        }
+        batch->conts[batch->len++] = cont;
+    }
+
+    run_stats_batch(batch, 0);
+
+    for (i = 0; i < batch->len; i++) {
+        if (batch->infos[i] != NULL) {
+            snapshot->infos[snapshot->len++] = batch->infos[i];
+            batch->infos[i] = NULL;
+        }
+    }
+    qsort(snapshot->infos, snapshot->len, sizeof(container_info *), stats_info_cmp);
+    goto out;
+
+err_out:
+    if (snapshot != NULL) {
+        free(snapshot->infos);
+        free(snapshot);
+        snapshot = NULL;
+    }
+out:
+    if (snapshot != NULL) {
+        snapshot->sampled_at = get_monotonic_nanos();
+    }
+    if (batch != NULL) {
+        put_stats_batch(batch);
+    }
+    util_free_array(idsarray);
+    return snapshot;
+}
+
+// wait one interval, return true if sampler is asked to stop
+static bool stats_sampler_wait(void)
+{
+    bool stop = false;
+    int64_t deadline_nanos = get_monotonic_nanos() + stats_sample_interval_get();
+    struct timespec deadline = { 0 };
+
+    deadline.tv_sec = deadline_nanos / Time_Second;
+    deadline.tv_nsec = deadline_nanos % Time_Second;
+
+    (void)pthread_mutex_lock(&g_stats_sampler_mutex);
+    while (!g_stats_sampler_stop) {
+        if (pthread_cond_timedwait(&g_stats_sampler_cond, &g_stats_sampler_mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    stop = g_stats_sampler_stop;
+    (void)pthread_mutex_unlock(&g_stats_sampler_mutex);
+
+    return stop;
+}
+
+static void *stats_sampler(void *arg)
+{
+    struct stats_snapshot *snapshot = NULL;
+
+    prctl(PR_SET_NAME, "StatsSampler");
+
+    do {
+        snapshot = sample_containers_stats();
+        if (snapshot != NULL) {
+            publish_stats_snapshot(snapshot);
+        }
+    } while (!stats_sampler_wait());
+
+    return NULL;
+}
+
+int container_stats_sampler_init(void)
+{
+    int ret = 0;
+    int64_t interval = 0;
+    pthread_condattr_t attr;
+    const char *val = getenv(CONTAINER_STATS_SAMPLE_INTERVAL_ENV);
+
+    if (val == NULL || strlen(val) == 0) {
+        return 0;
+    }
+
+    if (util_time_str_to_nanoseconds(val, &interval) != 0 || interval < CONTAINER_STATS_MIN_SAMPLE_INTERVAL) {
+        ERROR("Invalid %s: '%s', at least %dms", CONTAINER_STATS_SAMPLE_INTERVAL_ENV, val,
+              (int)(CONTAINER_STATS_MIN_SAMPLE_INTERVAL / Time_Milli));
+        return -1;
+    }
+
+    if (g_stats_sampler_started) {
+        ERROR("Stats sampler is started already");
+        return -1;
+    }
+
+    // interval is measured with monotonic clock
+    if (pthread_condattr_init(&attr) != 0 || pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0 ||
+        pthread_cond_init(&g_stats_sampler_cond, &attr) != 0) {
+        ERROR("Failed to init stats sampler cond");
+        return -1;
+    }
+    (void)pthread_condattr_destroy(&attr);
+
+    stats_sample_interval_set(interval);
+    g_stats_sampler_stop = false;
+    ret = pthread_create(&g_stats_sampler_tid, NULL, stats_sampler, NULL);
+    if (ret != 0) {
+        ERROR("Failed to create stats sampler thread");
+        stats_sample_interval_set(0);
+        (void)pthread_cond_destroy(&g_stats_sampler_cond);
+        return -1;
+    }
+    g_stats_sampler_started = true;
+
+    INFO("Stats of containers are sampled every %lldms", (long long)(interval / Time_Milli));
+    return 0;
+}
+
+void container_stats_sampler_exit(void)
+{
+    struct stats_snapshot *old = NULL;
+
+    if (!g_stats_sampler_started) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&g_stats_sampler_mutex);
+    g_stats_sampler_stop = true;
+    (void)pthread_cond_signal(&g_stats_sampler_cond);
+    (void)pthread_mutex_unlock(&g_stats_sampler_mutex);
+
+    // a sample in progress is finished before the thread exits
+    (void)pthread_join(g_stats_sampler_tid, NULL);
+    (void)pthread_cond_destroy(&g_stats_sampler_cond);
+    g_stats_sampler_started = false;
+
+    // stats are collected on demand from now on
+    stats_sample_interval_set(0);
+    (void)pthread_mutex_lock(&g_stats_snapshot_mutex);
+    old = g_stats_snapshot;
+    g_stats_snapshot = NULL;
+    (void)pthread_mutex_unlock(&g_stats_snapshot_mutex);
+    put_stats_snapshot(old);
+}
+
 static int generate_containers_stats(char **idsarray, size_t ids_len, const struct stats_context *ctx,
-                                     bool check_exists, container_info ***info, size_t *info_len)
+                                     bool check_exists, int64_t timeout_ms, container_info ***info,
+                                     size_t *info_len)
 {
     int ret = 0;
-    int nret;
     size_t i;
+    struct stats_batch *batch = NULL;
+    struct stats_snapshot *snapshot = NULL;
 
-    nret = service_stats_make_memory(info, ids_len);
-    if (nret != 0) {
-        ret = -1;
-        goto cleanup;
+    batch = stats_batch_new(ids_len);
+    if (batch == NULL) {
+        return -1;
     }
+    snapshot = get_stats_snapshot();
 
     for (i = 0; i < ids_len; i++) {
-        struct runtime_container_resources_stats_info einfo = { 0 };
         container_t *cont = NULL;
-        container_info *cont_info = NULL;
-        container_info *old_cont_info = NULL;
 
         cont = containers_store_get(idsarray[i]);
         if (cont == NULL) {
@@ -474,46 +1064,49 @@ static int generate_containers_stats(char **idsarray, size_t ids_len, const stru
             }
             continue;
         }
-        if (container_is_running(cont->state)) {
-            rt_stats_params_t params = { 0 };
-            params.rootpath = cont->root_path;
-            params.state = cont->state_path;
-
-            nret = runtime_resources_stats(cont->common_config->id, cont->runtime, &params, &einfo);
-            if (nret != 0) {
-                container_unref(cont);
-                continue;
-            }
-        } else {
-            if (!ctx->stats_config->all) {
-                container_unref(cont);
-                continue;
-            }
-        }
-
-        cont_info = get_container_stats(cont, &einfo, ctx);
-        if (cont_info == NULL) {
+        if ((!container_is_running(cont->state) && !ctx->stats_config->all) || !stats_filter_match(cont, ctx)) {
             container_unref(cont);
             continue;
         }
-
-        if (container_update_info(cont, cont_info, &old_cont_info) != 0) {
-            WARN("Failed to update container info");
+        // containers started after last sample are collected on demand
+        if (snapshot != NULL && container_is_running(cont->state)) {
+            batch->infos[batch->len] = get_sampled_stats(snapshot, cont);
+            if (batch->infos[batch->len] != NULL) {
+                batch->done++;
+            }
         }
+        batch->conts[batch->len++] = cont;
+    }
 
-        update_usage_nano_cores(cont_info, old_cont_info);
+    if (batch->len == 0) {
+        goto cleanup;
+    }
 
-        (*info)[*info_len] = cont_info;
+    if (service_stats_make_memory(info, batch->len) != 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    run_stats_batch(batch, timeout_ms);
 
-        free_container_info(old_cont_info);
-        container_unref(cont);
-        (*info_len)++;
+    // stats collected after deadline are dropped with the batch
+    (void)pthread_mutex_lock(&batch->mutex);
+    for (i = 0; i < batch->len; i++) {
+        if (batch->infos[i] != NULL) {
+            (*info)[(*info_len)++] = batch->infos[i];
+            batch->infos[i] = NULL;
+        }
     }
+    (void)pthread_mutex_unlock(&batch->mutex);
+
 cleanup:
+    put_stats_snapshot(snapshot);
+    put_stats_batch(batch);
     return ret;
 }
 
-static int container_stats_cb(const container_stats_request *request, container_stats_response **response)
+static int do_container_stats(const container_stats_request *request, int64_t timeout_ms, bool skip_missing,
+                              container_stats_response **response)
 {
     bool check_exists = false;
     size_t ids_len = 0;
@@ -550,7 +1143,8 @@ static int container_stats_cb(const container_stats_request *request, container_
         goto pack_response;
     }
 
-    if (generate_containers_stats(idsarray, ids_len, ctx, check_exists, &info, &info_len)) {
+    if (generate_containers_stats(idsarray, ids_len, ctx, check_exists && !skip_missing, timeout_ms, &info,
+                                  &info_len)) {
         cc = ISULAD_ERR_EXEC;
         goto pack_response;
     }
@@ -562,6 +1156,18 @@ pack_response:
     return (cc == ISULAD_SUCCESS) ? 0 : -1;
 }
 
+static int container_stats_cb(const container_stats_request *request, container_stats_response **response)
+{
+    return do_container_stats(request, 0, false, response);
+}
+
+static int container_stats_batch_cb(const container_stats_request *request, int64_t timeout_ms,
+                                    container_stats_response **response)
+{
+    // callers of batch list containers first, ones removed since then are left out like slow ones
+    return do_container_stats(request, timeout_ms, true, response);
+}
+
 static int do_resume_container(container_t *cont)
 {
     int ret = 0;
@@ -1606,6 +2212,7 @@ void container_extend_callback_init(service_container_callback_t *cb)
     cb->pause = container_pause_cb;
     cb->resume = container_resume_cb;
     cb->stats = container_stats_cb;
+    cb->stats_batch = container_stats_batch_cb;
     cb->events = container_events_cb;
     cb->export_rootfs = container_export_cb;
     cb->resize = container_resize_cb;
@@ -25,6 +25,12 @@ extern "C" {
 
 void container_extend_callback_init(service_container_callback_t *cb);
 
+// start background sampler of container stats if it is enabled
+int container_stats_sampler_init(void);
+
+// stop background sampler of container stats and drop its last sample
+void container_stats_sampler_exit(void);
+
 #ifdef __cplusplus
 }
 #endif
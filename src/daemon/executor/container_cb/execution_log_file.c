@@ -0,0 +1,227 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide container json-file log file reading functions
+ ******************************************************************************/
+#include "execution_log_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "isula_libutils/log.h"
+#include "utils.h"
+#include "utils_file.h"
+#include "log_compress.h"
+
+/*
+ * Rotated log files may be compressed by isulad-shim in background, log.1 is replaced by log.1.gz.
+ * gzFile reads plain and compressed files in the same way, offsets are of uncompressed content.
+ */
+gzFile container_log_file_open(const char *path)
+{
+    int fd = -1;
+    int nret;
+    gzFile fp = NULL;
+    char gz_path[PATH_MAX] = { 0 };
+
+    fd = util_open(path, O_RDONLY, 0);
+    if (fd < 0 && errno == ENOENT) {
+        nret = snprintf(gz_path, PATH_MAX, "%s%s", path, LOG_COMPRESS_SUFFIX);
+        if (nret < 0 || (size_t)nret >= PATH_MAX) {
+            errno = ENOENT;
+            return NULL;
+        }
+        // plain file is removed after compressed one is in place
+        fd = util_open(gz_path, O_RDONLY, 0);
+    }
+    if (fd < 0) {
+        return NULL;
+    }
+
+    fp = gzdopen(fd, "r");
+    if (fp == NULL) {
+        close(fd);
+        errno = ENOMEM;
+    }
+    return fp;
+}
+
+bool container_log_file_exists(const char *path)
+{
+    char gz_path[PATH_MAX] = { 0 };
+    int nret;
+
+    if (util_file_exists(path)) {
+        return true;
+    }
+    nret = snprintf(gz_path, PATH_MAX, "%s%s", path, LOG_COMPRESS_SUFFIX);
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        return false;
+    }
+    return util_file_exists(gz_path);
+}
+
+static int do_tail_find(FILE *fp, int64_t require_line, int64_t *get_line, long *get_pos)
+{
+#define SECTION_SIZE 4096
+    char buffer[SECTION_SIZE] = { 0 };
+    size_t read_size, i;
+    long len, pos, step_size;
+    int ret = -1;
+
+    if (fseek(fp, 0L, SEEK_END) != 0) {
+        SYSERROR("Fseek failed");
+        goto out;
+    }
+    len = ftell(fp);
+    if (len < 0) {
+        SYSERROR("Ftell failed");
+        goto out;
+    }
+    if (len < SECTION_SIZE) {
+        pos = len;
+        step_size = len;
+    } else {
+        step_size = SECTION_SIZE;
+        pos = len - step_size;
+    }
+    while (true) {
+        if (fseek(fp, pos, SEEK_SET) != 0) {
+            SYSERROR("Fseek failed");
+            goto out;
+        }
+        read_size = fread(buffer, sizeof(char), (size_t)step_size, fp);
+        for (i = read_size; i > 0; i--) {
+            if (buffer[i - 1] != '\n') {
+                continue;
+            }
+            (*get_line) += 1;
+            if ((*get_line) > require_line) {
+                (*get_pos) = pos + (long)i;
+                (*get_line) = require_line;
+                ret = 0;
+                goto out;
+            }
+        }
+        if (pos == 0) {
+            break;
+        }
+        if (pos < step_size) {
+            step_size = pos;
+            pos = 0;
+        } else {
+            pos -= step_size;
+        }
+    }
+
+    ret = 0;
+out:
+    return ret;
+}
+
+/*
+ * Compressed file can not be read backward, count its lines forward twice:
+ * once for total lines, once for the offset after the (total - require_line)th line.
+ */
+static int do_tail_find_compressed(gzFile fp, int64_t require_line, int64_t *get_line, long *get_pos)
+{
+    char buffer[SECTION_SIZE] = { 0 };
+    int64_t total = 0;
+    int64_t skip = 0;
+    long pos = 0;
+    int read_size, i;
+
+    while ((read_size = gzread(fp, buffer, sizeof(buffer))) > 0) {
+        for (i = 0; i < read_size; i++) {
+            total += (buffer[i] == '\n') ? 1 : 0;
+        }
+    }
+    if (read_size < 0) {
+        ERROR("Read compressed log file failed");
+        return -1;
+    }
+    if (total <= require_line) {
+        (*get_line) += total;
+        return 0;
+    }
+
+    skip = total - require_line;
+    if (gzrewind(fp) != 0) {
+        ERROR("Rewind compressed log file failed");
+        return -1;
+    }
+    while ((read_size = gzread(fp, buffer, sizeof(buffer))) > 0) {
+        for (i = 0; i < read_size; i++) {
+            if (buffer[i] != '\n') {
+                continue;
+            }
+            skip--;
+            if (skip == 0) {
+                (*get_pos) = pos + i + 1;
+                (*get_line) = require_line;
+                return 0;
+            }
+        }
+        pos += read_size;
+    }
+
+    ERROR("Compressed log file changed while reading");
+    return -1;
+}
+
+static int find_compressed_tail_position(const char *file_name, int64_t require_line, int64_t *get_line, long *pos)
+{
+    gzFile fp = NULL;
+    int ret = -1;
+
+    fp = container_log_file_open(file_name);
+    if (fp == NULL) {
+        SYSERROR("open file: %s failed.", file_name);
+        return -1;
+    }
+
+    ret = do_tail_find_compressed(fp, require_line, get_line, pos);
+
+    gzclose(fp);
+    return ret;
+}
+
+int container_log_find_tail_position(const char *file_name, int64_t require_line, int64_t *get_line, long *pos)
+{
+    FILE *fp = NULL;
+    int ret = -1;
+
+    if (file_name == NULL) {
+        return 0;
+    }
+    if (get_line == NULL || pos == NULL) {
+        ERROR("Invalid Arguments");
+        return -1;
+    }
+
+    fp = util_fopen(file_name, "rb");
+    if (fp == NULL && errno == ENOENT) {
+        return find_compressed_tail_position(file_name, require_line, get_line, pos);
+    }
+    if (fp == NULL) {
+        SYSERROR("open file: %s failed.", file_name);
+        return -1;
+    }
+
+    ret = do_tail_find(fp, require_line, get_line, pos);
+
+    fclose(fp);
+    return ret;
+}
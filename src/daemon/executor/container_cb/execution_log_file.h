@@ -0,0 +1,41 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide container json-file log file reading functions
+ ******************************************************************************/
+#ifndef DAEMON_EXECUTOR_CONTAINER_CB_EXECUTION_LOG_FILE_H
+#define DAEMON_EXECUTOR_CONTAINER_CB_EXECUTION_LOG_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* open log file for read, fall back to compressed one if path is removed after compression.
+ * return NULL with errno set on failure */
+gzFile container_log_file_open(const char *path);
+
+/* whether log file exists in plain or compressed format */
+bool container_log_file_exists(const char *path);
+
+/* find offset of the last require_line lines of file_name, plain or compressed.
+ * get_line is increased by lines found, pos is 0 if file has no more than require_line lines */
+int container_log_find_tail_position(const char *file_name, int64_t require_line, int64_t *get_line, long *pos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DAEMON_EXECUTOR_CONTAINER_CB_EXECUTION_LOG_FILE_H
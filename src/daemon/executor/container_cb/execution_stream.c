@@ -63,6 +63,7 @@
 #include "utils_file.h"
 #include "utils_verify.h"
 #include "isulad_config.h"
+#include "execution_log_file.h"
 
 #if defined (__ANDROID__) || defined(__MUSL__)
 #define SIG_CANCEL_SIGNAL     SIGUSR1
@@ -1081,11 +1082,11 @@ static int64_t do_read_log_file(const char *path, int64_t require_line, long pos
     int retries = 0;
     int decode_retries = 0;
     int64_t read_lines = 0;
-    FILE *fp = NULL;
+    gzFile fp = NULL;
     char buffer[MAXLINE + 1] = { 0 };
 
     for (retries = 0; retries <= LOG_MAX_RETRIES; retries++) {
-        fp = util_fopen(path, "r");
+        fp = container_log_file_open(path);
         if (fp != NULL || errno != ENOENT) {
             break;
         }
@@ -1096,14 +1097,14 @@ static int64_t do_read_log_file(const char *path, int64_t require_line, long pos
         SYSERROR("open file: %s failed.", path);
         return -1;
     }
-    if (pos > 0 && fseek(fp, pos, SEEK_SET) != 0) {
-        SYSERROR("fseek to %ld failed.", pos);
+    if (pos > 0 && gzseek(fp, pos, SEEK_SET) != pos) {
+        SYSERROR("gzseek to %ld failed.", pos);
         read_lines = -1;
         goto out;
     }
     *last_pos = pos;
 
-    while (fgets(buffer, MAXLINE, fp) != NULL) {
+    while (gzgets(fp, buffer, MAXLINE) != NULL) {
         (*last_pos) += (long)strlen(buffer);
 
         if (do_decode_write_log_entry(buffer, stream) != 0) {
@@ -1124,7 +1125,7 @@ static int64_t do_read_log_file(const char *path, int64_t require_line, long pos
     }
 
 out:
-    fclose(fp);
+    gzclose(fp);
     return read_lines;
 }
 
@@ -1191,7 +1192,7 @@ static int do_show_all_logs(const struct container_log_config *conf, const strea
             ret = -1;
             goto out;
         }
-        if (util_file_exists(log_path)) {
+        if (container_log_file_exists(log_path)) {
             break;
         }
         index--;
@@ -1203,89 +1204,6 @@ out:
     return ret;
 }
 
-static int do_tail_find(FILE *fp, int64_t require_line, int64_t *get_line, long *get_pos)
-{
-#define SECTION_SIZE 4096
-    char buffer[SECTION_SIZE] = { 0 };
-    size_t read_size, i;
-    long len, pos, step_size;
-    int ret = -1;
-
-    if (fseek(fp, 0L, SEEK_END) != 0) {
-        SYSERROR("Fseek failed");
-        goto out;
-    }
-    len = ftell(fp);
-    if (len < 0) {
-        SYSERROR("Ftell failed");
-        goto out;
-    }
-    if (len < SECTION_SIZE) {
-        pos = len;
-        step_size = len;
-    } else {
-        step_size = SECTION_SIZE;
-        pos = len - step_size;
-    }
-    while (true) {
-        if (fseek(fp, pos, SEEK_SET) != 0) {
-            SYSERROR("Fseek failed");
-            goto out;
-        }
-        read_size = fread(buffer, sizeof(char), (size_t)step_size, fp);
-        for (i = read_size; i > 0; i--) {
-            if (buffer[i - 1] != '\n') {
-                continue;
-            }
-            (*get_line) += 1;
-            if ((*get_line) > require_line) {
-                (*get_pos) = pos + (long)i;
-                (*get_line) = require_line;
-                ret = 0;
-                goto out;
-            }
-        }
-        if (pos == 0) {
-            break;
-        }
-        if (pos < step_size) {
-            step_size = pos;
-            pos = 0;
-        } else {
-            pos -= step_size;
-        }
-    }
-
-    ret = 0;
-out:
-    return ret;
-}
-
-static int util_find_tail_position(const char *file_name, int64_t require_line, int64_t *get_line, long *pos)
-{
-    FILE *fp = NULL;
-    int ret = -1;
-
-    if (file_name == NULL) {
-        return 0;
-    }
-    if (get_line == NULL || pos == NULL) {
-        ERROR("Invalid Arguments");
-        return -1;
-    }
-
-    fp = util_fopen(file_name, "rb");
-    if (fp == NULL) {
-        SYSERROR("open file: %s failed.", file_name);
-        return -1;
-    }
-
-    ret = do_tail_find(fp, require_line, get_line, pos);
-
-    fclose(fp);
-    return ret;
-}
-
 static int do_tail_container_logs(int64_t require_line, const struct container_log_config *conf,
                                   const stream_func_wrapper *stream, struct last_log_file_position *last_pos)
 {
@@ -1303,7 +1221,7 @@ static int do_tail_container_logs(int64_t require_line, const struct container_l
         /* require empty logs */
         return 0;
     }
-    ret = util_find_tail_position(conf->path, left, &get_line, &pos);
+    ret = container_log_find_tail_position(conf->path, left, &get_line, &pos);
     if (ret != 0) {
         return -1;
     }
@@ -1325,7 +1243,7 @@ static int do_tail_container_logs(int64_t require_line, const struct container_l
             ERROR("Sprintf failed");
             goto out;
         }
-        ret = util_find_tail_position(log_path, left, &get_line, &pos);
+        ret = container_log_find_tail_position(log_path, left, &get_line, &pos);
         if (ret != 0) {
             if (errno == ENOENT) {
                 i--;
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 
 #include "callback.h"
+#include "image_api.h"
 #include "utils.h"
 #include "isula_libutils/log.h"
 
@@ -58,6 +59,10 @@ typedef struct isula_metrics {
 #define ISULA_CONT_CPU_STAT     ISULA_PREFIX "container_cpu_stat"
 #define ISULA_CONT_PIDS         ISULA_PREFIX "container_pids"
 #define DAEMON_CALLOC_TOTAL     ISULA_PREFIX "daemon_calloced_memory_total"
+#define IMAGE_BLOB_CACHE_REQ    ISULA_PREFIX "image_blob_cache_requests"
+#define IMAGE_BLOB_CACHE_BYTES  ISULA_PREFIX "image_blob_cache_bytes"
+#define IMAGE_BIG_DATA_CACHE_REQ    ISULA_PREFIX "image_big_data_cache_requests"
+#define IMAGE_BIG_DATA_CACHE_BYTES  ISULA_PREFIX "image_big_data_cache_bytes"
 
 /* metric help info */
 static const char g_isula_daemon_mem_desc[] = "is isula daemon memory occupied";
@@ -66,6 +71,10 @@ static const char g_cpu_stat_desc[] = "is containers's cpu stats";
 static const char g_req_count_desc[] = "is metrics server accepted request count";
 static const char g_cont_pids_desc[] = "is containers's pid count";
 static const char g_daemon_calloc_desc[] = "is isula deamon calloced total";
+static const char g_blob_cache_req_desc[] = "is image blob cache lookup and eviction count";
+static const char g_blob_cache_bytes_desc[] = "is image blob cache disk usage";
+static const char g_big_data_cache_req_desc[] = "is image big data cache lookup, eviction and invalidation count";
+static const char g_big_data_cache_bytes_desc[] = "is image big data cache memory usage";
 
 static unsigned long long g_mem_alloced_total;
 
@@ -290,6 +299,71 @@ static int metrics_daemon_alloced_mem_total(const char *name, char *buffer, int
     return len;
 }
 
+static int metrics_image_blob_cache_requests(const char *name, char *buffer, int size)
+{
+    struct im_cache_stats stats = { 0 };
+
+    im_get_blob_cache_stats(&stats);
+    if (!stats.enabled) {
+        return 0;
+    }
+
+    return snprintf(buffer, size,
+                    "%s{result=\"hit\"} %llu\n"
+                    "%s{result=\"miss\"} %llu\n"
+                    "%s{result=\"evict\"} %llu\n",
+                    name, (unsigned long long)stats.hits, name, (unsigned long long)stats.misses,
+                    name, (unsigned long long)stats.evictions);
+}
+
+static int metrics_image_blob_cache_bytes(const char *name, char *buffer, int size)
+{
+    struct im_cache_stats stats = { 0 };
+
+    im_get_blob_cache_stats(&stats);
+    if (!stats.enabled) {
+        return 0;
+    }
+
+    return snprintf(buffer, size,
+                    "%s{section=\"used\"} %lld\n"
+                    "%s{section=\"capacity\"} %lld\n",
+                    name, (long long)stats.size, name, (long long)stats.capacity);
+}
+
+static int metrics_image_big_data_cache_requests(const char *name, char *buffer, int size)
+{
+    struct im_cache_stats stats = { 0 };
+
+    im_get_big_data_cache_stats(&stats);
+    if (!stats.enabled) {
+        return 0;
+    }
+
+    return snprintf(buffer, size,
+                    "%s{result=\"hit\"} %llu\n"
+                    "%s{result=\"miss\"} %llu\n"
+                    "%s{result=\"evict\"} %llu\n"
+                    "%s{result=\"invalidate\"} %llu\n",
+                    name, (unsigned long long)stats.hits, name, (unsigned long long)stats.misses,
+                    name, (unsigned long long)stats.evictions, name, (unsigned long long)stats.invalidations);
+}
+
+static int metrics_image_big_data_cache_bytes(const char *name, char *buffer, int size)
+{
+    struct im_cache_stats stats = { 0 };
+
+    im_get_big_data_cache_stats(&stats);
+    if (!stats.enabled) {
+        return 0;
+    }
+
+    return snprintf(buffer, size,
+                    "%s{section=\"used\"} %lld\n"
+                    "%s{section=\"capacity\"} %lld\n",
+                    name, (long long)stats.size, name, (long long)stats.capacity);
+}
+
 static isula_metrics_t g_metrics[] = {
     {NULL, METRICS_REQUEST_COUNT, COUNTER, g_req_count_desc, metrics_http_req_count_info}, /* export default */
     {"sys", ISULA_DAEMON_MEM_STAT, GAUGE, g_isula_daemon_mem_desc, metrics_get_isulad_mem_stat},
@@ -297,6 +371,10 @@ static isula_metrics_t g_metrics[] = {
     {"cpu", ISULA_CONT_CPU_STAT, GAUGE, g_cpu_stat_desc, metrics_containers_cpu_stats},
     {"pids", ISULA_CONT_PIDS, GAUGE, g_cont_pids_desc, metrics_containers_pids},
     {"sys", DAEMON_CALLOC_TOTAL, COUNTER, g_daemon_calloc_desc, metrics_daemon_alloced_mem_total},
+    {"image", IMAGE_BLOB_CACHE_REQ, COUNTER, g_blob_cache_req_desc, metrics_image_blob_cache_requests},
+    {"image", IMAGE_BLOB_CACHE_BYTES, GAUGE, g_blob_cache_bytes_desc, metrics_image_blob_cache_bytes},
+    {"image", IMAGE_BIG_DATA_CACHE_REQ, COUNTER, g_big_data_cache_req_desc, metrics_image_big_data_cache_requests},
+    {"image", IMAGE_BIG_DATA_CACHE_BYTES, GAUGE, g_big_data_cache_bytes_desc, metrics_image_big_data_cache_bytes},
 };
 
 static int metrics_msg_get_by_type(const char *url, char **metrics, int *len)
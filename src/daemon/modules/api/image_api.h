@@ -42,6 +42,11 @@ extern "C" {
 #define IMAGE_TYPE_EMBEDDED "embedded"
 #define IMAGE_TYPE_EXTERNAL "external"
 
+// storage opt of container, mount upper layer of overlay rootfs with volatile
+#define STORAGE_OPT_VOLATILE "volatile"
+// storage opt of container, size of tmpfs holding upper and work dirs of overlay rootfs
+#define STORAGE_OPT_TMPFS_SIZE "tmpfs_size"
+
 typedef struct {
     char *image;
 } image_spec;
@@ -226,6 +231,17 @@ struct graphdriver_status {
     char *status;
 };
 
+struct im_cache_stats {
+    bool enabled;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    // only counted by caches of mutable data
+    uint64_t invalidations;
+    int64_t size;
+    int64_t capacity;
+};
+
 #ifdef ENABLE_IMAGE_SEARCH
 typedef struct {
     char *type;
@@ -363,6 +379,10 @@ void im_free_graphdriver_status(struct graphdriver_status *status);
 
 bool im_oci_image_exist(const char *name);
 
+void im_get_blob_cache_stats(struct im_cache_stats *stats);
+
+void im_get_big_data_cache_stats(struct im_cache_stats *stats);
+
 #ifdef ENABLE_IMAGE_SEARCH
 void free_im_search_request(im_search_request *request);
 
@@ -123,6 +123,8 @@ struct bim_type {
 #include "driver.h"
 #include "storage.h"
 #include "oci_image.h"
+#include "blob_cache.h"
+#include "big_data_cache.h"
 #endif
 
 #ifdef ENABLE_EMBEDDED_IMAGE
@@ -2089,6 +2091,59 @@ out:
 #endif
 }
 
+void im_get_blob_cache_stats(struct im_cache_stats *stats)
+{
+#ifdef ENABLE_OCI_IMAGE
+    struct blob_cache_stats bstats = { 0 };
+#endif
+
+    if (stats == NULL) {
+        ERROR("Invalid NULL param");
+        return;
+    }
+
+    (void)memset(stats, 0, sizeof(struct im_cache_stats));
+#ifdef ENABLE_OCI_IMAGE
+    if (!blob_cache_enabled()) {
+        return;
+    }
+    blob_cache_get_stats(&bstats);
+    stats->enabled = true;
+    stats->hits = bstats.hits;
+    stats->misses = bstats.misses;
+    stats->evictions = bstats.evictions;
+    stats->size = bstats.size;
+    stats->capacity = bstats.capacity;
+#endif
+}
+
+void im_get_big_data_cache_stats(struct im_cache_stats *stats)
+{
+#ifdef ENABLE_OCI_IMAGE
+    struct big_data_cache_stats cstats = { 0 };
+#endif
+
+    if (stats == NULL) {
+        ERROR("Invalid NULL param");
+        return;
+    }
+
+    (void)memset(stats, 0, sizeof(struct im_cache_stats));
+#ifdef ENABLE_OCI_IMAGE
+    if (!big_data_cache_enabled()) {
+        return;
+    }
+    big_data_cache_get_stats(&cstats);
+    stats->enabled = true;
+    stats->hits = cstats.hits;
+    stats->misses = cstats.misses;
+    stats->evictions = cstats.evictions;
+    stats->invalidations = cstats.invalidations;
+    stats->size = cstats.size;
+    stats->capacity = cstats.capacity;
+#endif
+}
+
 void im_free_graphdriver_status(struct graphdriver_status *status)
 {
 #ifdef ENABLE_OCI_IMAGE
@@ -0,0 +1,594 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide content addressed cache of compressed layer blobs
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "blob_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "isula_libutils/log.h"
+#include "constants.h"
+#include "lru.h"
+#include "sha256.h"
+#include "utils.h"
+#include "utils_file.h"
+#include "utils_verify.h"
+
+#define BLOB_CACHE_FILE_MODE 0600
+#define BLOB_CACHE_TMP_SUFFIX ".tmp"
+#define BLOB_CACHE_PIN_SUFFIX ".fetch"
+
+typedef struct {
+    int64_t size;
+    time_t mtime;
+    // blobs found on disk at start are checked against their digest on first fetch
+    bool verified;
+} blob_cache_entry;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    char *dir;
+    // digest -> blob_cache_entry
+    lru_t *entries;
+    // bytes of stores copying outside the lock, not in entries yet
+    int64_t inflight;
+    // makes names of tmp and pinned files unique
+    uint64_t seq;
+    uint64_t hits;
+    uint64_t misses;
+} blob_cache;
+
+// blob found on disk at start, added to the index in mtime order
+typedef struct {
+    char *digest;
+    blob_cache_entry *entry;
+} blob_cache_loaded_item;
+
+typedef struct {
+    blob_cache_loaded_item *items;
+    size_t len;
+    size_t cap;
+} blob_cache_loaded;
+
+static blob_cache *g_blob_cache;
+
+static void blob_cache_lock(void)
+{
+    if (pthread_mutex_lock(&g_blob_cache->mutex) != 0) {
+        ERROR("Failed to lock blob cache");
+    }
+}
+
+static void blob_cache_unlock(void)
+{
+    if (pthread_mutex_unlock(&g_blob_cache->mutex) != 0) {
+        ERROR("Failed to unlock blob cache");
+    }
+}
+
+// blob of sha256:xxx is stored as <dir>/sha256/xxx
+static int blob_cache_path(const char *digest, char *path, size_t len)
+{
+    int nret = 0;
+    const char *hex = NULL;
+
+    if (!util_valid_digest(digest)) {
+        ERROR("Invalid blob digest %s", digest);
+        return -1;
+    }
+    hex = digest + strlen(SHA256_PREFIX);
+
+    nret = snprintf(path, len, "%s/%s", g_blob_cache->dir, hex);
+    if (nret < 0 || (size_t)nret >= len) {
+        ERROR("Failed to sprintf blob cache path for %s", digest);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void remove_cached_blob(const char *digest)
+{
+    char path[PATH_MAX] = { 0 };
+
+    if (blob_cache_path(digest, path, sizeof(path)) == 0 && util_path_remove(path) != 0) {
+        SYSWARN("Failed to remove cached blob %s", path);
+    }
+}
+
+static void release_entry(const char *digest, void *value, bool evicted, void *context)
+{
+    blob_cache_entry *entry = (blob_cache_entry *)value;
+
+    // files are kept on exit, they are loaded again on next start
+    if (evicted) {
+        DEBUG("Evict blob %s from cache, size %ld", digest, (long)entry->size);
+        remove_cached_blob(digest);
+    }
+    free(entry);
+}
+
+static int insert_entry(const char *digest, blob_cache_entry *entry)
+{
+    int nret = lru_put(g_blob_cache->entries, digest, entry, entry->size);
+
+    if (nret != 0) {
+        if (nret > 0) {
+            DEBUG("Blob %s with size %ld exceed blob cache capacity, skip it", digest, (long)entry->size);
+        }
+        free(entry);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int loaded_mtime_cmp(const void *a, const void *b)
+{
+    const blob_cache_loaded_item *ia = (const blob_cache_loaded_item *)a;
+    const blob_cache_loaded_item *ib = (const blob_cache_loaded_item *)b;
+
+    if (ia->entry->mtime == ib->entry->mtime) {
+        return 0;
+    }
+    return ia->entry->mtime < ib->entry->mtime ? -1 : 1;
+}
+
+static int loaded_append(blob_cache_loaded *loaded, const char *digest, int64_t size, time_t mtime)
+{
+    size_t new_cap = 0;
+    blob_cache_entry *entry = NULL;
+
+    if (loaded->len == loaded->cap) {
+        new_cap = loaded->cap == 0 ? 16 : loaded->cap * 2;
+        if (util_mem_realloc((void **)&loaded->items, new_cap * sizeof(blob_cache_loaded_item), loaded->items,
+                             loaded->cap * sizeof(blob_cache_loaded_item)) != 0) {
+            ERROR("Out of memory");
+            return -1;
+        }
+        loaded->cap = new_cap;
+    }
+
+    entry = util_common_calloc_s(sizeof(blob_cache_entry));
+    if (entry == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    entry->size = size;
+    entry->mtime = mtime;
+    loaded->items[loaded->len].digest = util_strdup_s(digest);
+    loaded->items[loaded->len].entry = entry;
+    loaded->len++;
+
+    return 0;
+}
+
+static bool load_cached_blob_cb(const char *path_name, const struct dirent *sub_dir, void *context)
+{
+    int nret = 0;
+    char path[PATH_MAX] = { 0 };
+    char digest[PATH_MAX] = { 0 };
+    struct stat st = { 0 };
+
+    nret = snprintf(path, sizeof(path), "%s/%s", path_name, sub_dir->d_name);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to sprintf cached blob path for %s", sub_dir->d_name);
+        return true;
+    }
+
+    nret = snprintf(digest, sizeof(digest), "%s%s", SHA256_PREFIX, sub_dir->d_name);
+    if (nret < 0 || (size_t)nret >= sizeof(digest) || !util_valid_digest(digest)) {
+        // leftover of interrupted store or unknown file
+        WARN("Remove invalid blob cache file %s", path);
+        (void)util_path_remove(path);
+        return true;
+    }
+
+    if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        WARN("Remove invalid blob cache file %s", path);
+        (void)util_path_remove(path);
+        return true;
+    }
+
+    return loaded_append((blob_cache_loaded *)context, digest, (int64_t)st.st_size, st.st_mtime) == 0;
+}
+
+// mtime is refreshed on every hit, oldest blobs go first so they are evicted first.
+// capacity may be reduced since last start, blobs that do not fit are removed
+static void blob_cache_index_loaded(blob_cache_loaded *loaded)
+{
+    size_t i = 0;
+
+    if (loaded->len == 0) {
+        return;
+    }
+
+    qsort(loaded->items, loaded->len, sizeof(blob_cache_loaded_item), loaded_mtime_cmp);
+    for (i = 0; i < loaded->len; i++) {
+        if (insert_entry(loaded->items[i].digest, loaded->items[i].entry) != 0) {
+            remove_cached_blob(loaded->items[i].digest);
+        }
+        loaded->items[i].entry = NULL;
+    }
+}
+
+static void free_blob_cache_loaded(blob_cache_loaded *loaded)
+{
+    size_t i = 0;
+
+    for (i = 0; i < loaded->len; i++) {
+        free(loaded->items[i].digest);
+        free(loaded->items[i].entry);
+    }
+    free(loaded->items);
+}
+
+int blob_cache_init(const char *cache_dir, int64_t capacity)
+{
+    blob_cache_loaded loaded = { 0 };
+
+    if (cache_dir == NULL) {
+        ERROR("Invalid NULL blob cache dir");
+        return -1;
+    }
+
+    if (capacity <= 0) {
+        DEBUG("Blob cache disabled");
+        return 0;
+    }
+
+    if (g_blob_cache != NULL) {
+        ERROR("Blob cache already initialized");
+        return -1;
+    }
+
+    g_blob_cache = util_common_calloc_s(sizeof(blob_cache));
+    if (g_blob_cache == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+
+    if (pthread_mutex_init(&g_blob_cache->mutex, NULL) != 0) {
+        ERROR("Failed to init blob cache mutex");
+        free(g_blob_cache);
+        g_blob_cache = NULL;
+        return -1;
+    }
+    g_blob_cache->dir = util_path_join(cache_dir, "sha256");
+    if (g_blob_cache->dir == NULL) {
+        ERROR("Failed to join blob cache dir");
+        goto err_out;
+    }
+
+    g_blob_cache->entries = lru_new(capacity, release_entry, NULL);
+    if (g_blob_cache->entries == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+
+    if (util_mkdir_p(g_blob_cache->dir, TEMP_DIRECTORY_MODE) != 0) {
+        ERROR("Failed to create blob cache dir %s", g_blob_cache->dir);
+        goto err_out;
+    }
+
+    if (util_scan_subdirs(g_blob_cache->dir, load_cached_blob_cb, &loaded) != 0) {
+        ERROR("Failed to load blob cache from %s", g_blob_cache->dir);
+        goto err_out;
+    }
+    blob_cache_index_loaded(&loaded);
+    free_blob_cache_loaded(&loaded);
+
+    INFO("Blob cache %s initialized, %ld of %ld bytes used", g_blob_cache->dir,
+         (long)lru_size(g_blob_cache->entries), (long)lru_capacity(g_blob_cache->entries));
+    return 0;
+
+err_out:
+    free_blob_cache_loaded(&loaded);
+    blob_cache_exit();
+    return -1;
+}
+
+void blob_cache_exit(void)
+{
+    if (g_blob_cache == NULL) {
+        return;
+    }
+
+    lru_free(g_blob_cache->entries);
+    g_blob_cache->entries = NULL;
+    free(g_blob_cache->dir);
+    g_blob_cache->dir = NULL;
+    (void)pthread_mutex_destroy(&g_blob_cache->mutex);
+    free(g_blob_cache);
+    g_blob_cache = NULL;
+}
+
+bool blob_cache_enabled(void)
+{
+    return g_blob_cache != NULL;
+}
+
+// name of a private file in the cache dir for path, such as a store in progress or a pinned blob of a fetch.
+// such names are no valid digest, so leftovers of a crash are removed by load_cached_blob_cb on next start
+static int blob_cache_private_path(const char *path, const char *suffix, char *out, size_t len)
+{
+    int nret = snprintf(out, len, "%s%s.%lu", path, suffix, (unsigned long)g_blob_cache->seq++);
+
+    if (nret < 0 || (size_t)nret >= len) {
+        ERROR("Failed to sprintf blob cache private path for %s", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+// pin the cached blob with a hard link, so eviction by others while it is copied does not free the inode
+static int pin_cached_blob(const char *digest, char *pin, size_t len, bool *verified)
+{
+    char path[PATH_MAX] = { 0 };
+    blob_cache_entry *entry = NULL;
+
+    entry = (blob_cache_entry *)lru_get(g_blob_cache->entries, digest);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    if (blob_cache_path(digest, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    if (util_file_size(path) != entry->size) {
+        WARN("Cached blob %s changed on disk, drop it", digest);
+        remove_cached_blob(digest);
+        (void)lru_remove(g_blob_cache->entries, digest);
+        return -1;
+    }
+
+    if (blob_cache_private_path(path, BLOB_CACHE_PIN_SUFFIX, pin, len) != 0) {
+        return -1;
+    }
+
+    if (link(path, pin) != 0) {
+        SYSERROR("Failed to pin cached blob %s", path);
+        return -1;
+    }
+    *verified = entry->verified;
+
+    return 0;
+}
+
+// called with lock held, the entry may be replaced or evicted since the blob was pinned
+static void drop_corrupted_blob(const char *digest, const char *pin)
+{
+    char path[PATH_MAX] = { 0 };
+    struct stat path_st = { 0 };
+    struct stat pin_st = { 0 };
+
+    if (blob_cache_path(digest, path, sizeof(path)) != 0) {
+        return;
+    }
+
+    if (stat(path, &path_st) != 0 || stat(pin, &pin_st) != 0 || path_st.st_ino != pin_st.st_ino ||
+        path_st.st_dev != pin_st.st_dev) {
+        return;
+    }
+
+    remove_cached_blob(digest);
+    (void)lru_remove(g_blob_cache->entries, digest);
+}
+
+int blob_cache_fetch(const char *digest, const char *dst)
+{
+    int ret = -1;
+    bool verified = false;
+    char pin[PATH_MAX] = { 0 };
+    blob_cache_entry *entry = NULL;
+
+    if (digest == NULL || dst == NULL) {
+        ERROR("Invalid NULL param");
+        return -1;
+    }
+
+    if (g_blob_cache == NULL) {
+        return -1;
+    }
+
+    blob_cache_lock();
+    if (pin_cached_blob(digest, pin, sizeof(pin), &verified) != 0) {
+        g_blob_cache->misses++;
+        blob_cache_unlock();
+        return -1;
+    }
+    blob_cache_unlock();
+
+    // hashing and copying may take long for big blobs, they work on the pinned file without the lock
+    if (!verified && !sha256_valid_digest_file(pin, digest)) {
+        WARN("Cached blob %s is corrupted, drop it", digest);
+        blob_cache_lock();
+        drop_corrupted_blob(digest, pin);
+        g_blob_cache->misses++;
+        blob_cache_unlock();
+        goto out;
+    }
+
+    // never share the inode with consumer, a later write or chmod of dst must not change the cached blob.
+    // util_copy_file reflinks the file on btrfs and xfs, so it is as cheap as a hard link there
+    if (util_copy_file(pin, dst, BLOB_CACHE_FILE_MODE) != 0) {
+        ERROR("Failed to get cached blob %s to %s", digest, dst);
+        blob_cache_lock();
+        g_blob_cache->misses++;
+        blob_cache_unlock();
+        goto out;
+    }
+
+    // persist lru order across restart
+    if (utimes(pin, NULL) != 0) {
+        SYSWARN("Failed to update mtime of cached blob %s", digest);
+    }
+
+    blob_cache_lock();
+    // only store adds entries after start and stored blobs are verified, so any entry found is this blob or a
+    // verified one
+    entry = (blob_cache_entry *)lru_get(g_blob_cache->entries, digest);
+    if (entry != NULL) {
+        entry->verified = true;
+    }
+    g_blob_cache->hits++;
+    blob_cache_unlock();
+    ret = 0;
+
+out:
+    if (util_path_remove(pin) != 0) {
+        SYSWARN("Failed to remove pinned blob %s", pin);
+    }
+    return ret;
+}
+
+// make room and pick a private file to copy the blob into, returns 1 if the blob need not be stored
+static int reserve_store(const char *digest, int64_t size, char *path, size_t path_len, char *tmp_path,
+                         size_t tmp_len)
+{
+    if (lru_get(g_blob_cache->entries, digest) != NULL) {
+        return 1;
+    }
+
+    if (size > lru_capacity(g_blob_cache->entries)) {
+        DEBUG("Blob %s with size %ld exceed blob cache capacity, skip it", digest, (long)size);
+        return 1;
+    }
+
+    if (blob_cache_path(digest, path, path_len) != 0) {
+        return -1;
+    }
+
+    if (blob_cache_private_path(path, BLOB_CACHE_TMP_SUFFIX, tmp_path, tmp_len) != 0) {
+        return -1;
+    }
+
+    // make room on disk before copying, also for other stores still copying
+    lru_reserve(g_blob_cache->entries, g_blob_cache->inflight + size);
+    g_blob_cache->inflight += size;
+
+    return 0;
+}
+
+static int commit_store(const char *digest, int64_t size, const char *path, const char *tmp_path)
+{
+    blob_cache_entry *entry = NULL;
+
+    // stored by another puller meanwhile
+    if (lru_get(g_blob_cache->entries, digest) != NULL) {
+        (void)util_path_remove(tmp_path);
+        return 0;
+    }
+
+    if (rename(tmp_path, path) != 0) {
+        SYSERROR("Failed to rename %s to %s", tmp_path, path);
+        (void)util_path_remove(tmp_path);
+        return -1;
+    }
+
+    entry = util_common_calloc_s(sizeof(blob_cache_entry));
+    if (entry == NULL) {
+        ERROR("Out of memory");
+        (void)util_path_remove(path);
+        return -1;
+    }
+    entry->size = size;
+    entry->mtime = time(NULL);
+    // the caller stores blobs it has verified already
+    entry->verified = true;
+    if (insert_entry(digest, entry) != 0) {
+        (void)util_path_remove(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int blob_cache_store(const char *digest, const char *src)
+{
+    int ret = 0;
+    int nret = 0;
+    int64_t size = 0;
+    char path[PATH_MAX] = { 0 };
+    char tmp_path[PATH_MAX] = { 0 };
+
+    if (digest == NULL || src == NULL) {
+        ERROR("Invalid NULL param");
+        return -1;
+    }
+
+    if (g_blob_cache == NULL) {
+        return 0;
+    }
+
+    size = util_file_size(src);
+    if (size < 0) {
+        ERROR("Failed to get size of blob %s", src);
+        return -1;
+    }
+
+    blob_cache_lock();
+    nret = reserve_store(digest, size, path, sizeof(path), tmp_path, sizeof(tmp_path));
+    blob_cache_unlock();
+    if (nret != 0) {
+        return nret < 0 ? -1 : 0;
+    }
+
+    // copy without the lock, so fetches and stores of other blobs are not blocked by a big blob
+    if (util_copy_file(src, tmp_path, BLOB_CACHE_FILE_MODE) != 0) {
+        ERROR("Failed to add blob %s to cache", digest);
+        (void)util_path_remove(tmp_path);
+        ret = -1;
+    }
+
+    blob_cache_lock();
+    g_blob_cache->inflight -= size;
+    if (ret == 0) {
+        ret = commit_store(digest, size, path, tmp_path);
+    }
+    blob_cache_unlock();
+
+    return ret;
+}
+
+void blob_cache_get_stats(struct blob_cache_stats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    (void)memset(stats, 0, sizeof(struct blob_cache_stats));
+    if (g_blob_cache == NULL) {
+        return;
+    }
+
+    blob_cache_lock();
+    stats->hits = g_blob_cache->hits;
+    stats->misses = g_blob_cache->misses;
+    stats->evictions = lru_evictions(g_blob_cache->entries);
+    stats->size = lru_size(g_blob_cache->entries);
+    stats->capacity = lru_capacity(g_blob_cache->entries);
+    blob_cache_unlock();
+}
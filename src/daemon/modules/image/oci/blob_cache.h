@@ -0,0 +1,55 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide content addressed cache of compressed layer blobs
+ ******************************************************************************/
+#ifndef DAEMON_MODULES_IMAGE_OCI_BLOB_CACHE_H
+#define DAEMON_MODULES_IMAGE_OCI_BLOB_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+#define BLOB_CACHE_DIR_NAME "blob-cache"
+
+struct blob_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    int64_t size;
+    int64_t capacity;
+};
+
+// capacity <= 0 means cache disabled, every call below becomes a no-op
+int blob_cache_init(const char *cache_dir, int64_t capacity);
+
+void blob_cache_exit(void);
+
+bool blob_cache_enabled(void);
+
+// materialize cached blob of digest at dst, return 0 on hit.
+// blobs left from last run are checked against digest on first fetch and dropped if corrupted
+int blob_cache_fetch(const char *digest, const char *dst);
+
+// add blob file src with digest to the cache, src is left untouched and must be verified by caller
+int blob_cache_store(const char *digest, const char *src);
+
+void blob_cache_get_stats(struct blob_cache_stats *stats);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif // DAEMON_MODULES_IMAGE_OCI_BLOB_CACHE_H
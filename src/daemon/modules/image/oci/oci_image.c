@@ -17,6 +17,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
 #include "isula_libutils/log.h"
@@ -33,9 +34,11 @@
 #include "err_msg.h"
 #include "oci_common_operators.h"
 #include "utils_array.h"
+#include "utils_convert.h"
 #include "utils_file.h"
 #include "utils_string.h"
 #include "isulad_config.h"
+#include "blob_cache.h"
 #ifdef ENABLE_IMAGE_SEARCH
 #include "oci_search.h"
 #endif
@@ -95,6 +98,158 @@ static void free_oci_image_data(void)
                            g_oci_image_module_data.insecure_registries_len);
     g_oci_image_module_data.insecure_registries = NULL;
     g_oci_image_module_data.insecure_registries_len = 0;
+
+    g_oci_image_module_data.blob_cache_size = 0;
+    g_oci_image_module_data.layer_check_skip_unchanged = false;
+    g_oci_image_module_data.image_big_data_cache_size = 0;
+
+    free_json_map_string_int64(g_oci_image_module_data.rw_layer_pool);
+    g_oci_image_module_data.rw_layer_pool = NULL;
+
+    g_oci_image_module_data.layer_dedup = LAYER_DEDUP_OFF;
+    g_oci_image_module_data.layer_dedup_interval = 0;
+}
+
+static int oci_parse_rw_layer_pool(const char *val)
+{
+    int ret = 0;
+    size_t i;
+    char **items = NULL;
+
+    if (g_oci_image_module_data.rw_layer_pool == NULL) {
+        g_oci_image_module_data.rw_layer_pool = util_common_calloc_s(sizeof(json_map_string_int64));
+        if (g_oci_image_module_data.rw_layer_pool == NULL) {
+            ERROR("Out of memory");
+            return -1;
+        }
+    }
+
+    items = util_string_split(val, ',');
+    for (i = 0; i < util_array_len((const char **)items); i++) {
+        char *image = util_trim_space(items[i]);
+        char *count = strrchr(image, ':');
+        int converted = 0;
+
+        if (count == NULL || count == image) {
+            ERROR("Invalid writable layer pool item: '%s', expect <image>:<count>", image);
+            ret = -1;
+            goto out;
+        }
+        *count = '\0';
+        count++;
+        if (util_safe_int(count, &converted) != 0 || converted <= 0) {
+            ERROR("Invalid writable layer pool size: '%s' for image %s", count, image);
+            ret = -1;
+            goto out;
+        }
+        if (append_json_map_string_int64(g_oci_image_module_data.rw_layer_pool, image, converted) != 0) {
+            ERROR("Out of memory");
+            ret = -1;
+            goto out;
+        }
+    }
+
+out:
+    util_free_array(items);
+    return ret;
+}
+
+static int oci_parse_layer_dedup(const char *val)
+{
+    if (strcasecmp(val, "off") == 0) {
+        g_oci_image_module_data.layer_dedup = LAYER_DEDUP_OFF;
+    } else if (strcasecmp(val, "auto") == 0) {
+        g_oci_image_module_data.layer_dedup = LAYER_DEDUP_AUTO;
+    } else if (strcasecmp(val, "reflink") == 0) {
+        g_oci_image_module_data.layer_dedup = LAYER_DEDUP_REFLINK;
+    } else if (strcasecmp(val, "hardlink") == 0) {
+        g_oci_image_module_data.layer_dedup = LAYER_DEDUP_HARDLINK;
+    } else {
+        ERROR("Invalid layer dedup mode: '%s', expect off, auto, reflink or hardlink", val);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int oci_parse_module_opt(const char *opt)
+{
+    int ret = 0;
+    char *dup = NULL;
+    char *val = NULL;
+    int64_t converted = 0;
+
+    dup = util_strdup_s(opt);
+    val = strchr(dup, '=');
+    if (val == NULL) {
+        ERROR("Unable to parse key/value option: '%s'", opt);
+        ret = -1;
+        goto out;
+    }
+    *val = '\0';
+    val++;
+
+    if (strcasecmp(dup, OCI_BLOB_CACHE_SIZE_OPT) == 0) {
+        ret = util_parse_byte_size_string(val, &converted);
+        if (ret != 0 || converted < 0) {
+            ERROR("Invalid size: '%s' for %s", val, dup);
+            ret = -1;
+            goto out;
+        }
+        g_oci_image_module_data.blob_cache_size = converted;
+    } else if (strcasecmp(dup, OCI_IMAGE_BIG_DATA_CACHE_SIZE_OPT) == 0) {
+        ret = util_parse_byte_size_string(val, &converted);
+        if (ret != 0 || converted < 0) {
+            ERROR("Invalid size: '%s' for %s", val, dup);
+            ret = -1;
+            goto out;
+        }
+        g_oci_image_module_data.image_big_data_cache_size = converted;
+    } else if (strcasecmp(dup, OCI_RW_LAYER_POOL_OPT) == 0) {
+        ret = oci_parse_rw_layer_pool(val);
+    } else if (strcasecmp(dup, OCI_LAYER_DEDUP_OPT) == 0) {
+        ret = oci_parse_layer_dedup(val);
+    } else if (strcasecmp(dup, OCI_LAYER_DEDUP_INTERVAL_OPT) == 0) {
+        ret = util_time_str_to_nanoseconds(val, &converted);
+        if (ret != 0 || converted / Time_Second < OCI_MIN_LAYER_DEDUP_INTERVAL) {
+            ERROR("Invalid interval: '%s' for %s, at least %ds", val, dup, OCI_MIN_LAYER_DEDUP_INTERVAL);
+            ret = -1;
+            goto out;
+        }
+        g_oci_image_module_data.layer_dedup_interval = converted / Time_Second;
+    } else if (strcasecmp(dup, OCI_LAYER_CHECK_SKIP_UNCHANGED_OPT) == 0) {
+        if (util_str_to_bool(val, &g_oci_image_module_data.layer_check_skip_unchanged) != 0) {
+            ERROR("Invalid bool value: '%s' for %s", val, dup);
+            ret = -1;
+            goto out;
+        }
+    } else {
+        ERROR("Oci image: unknown option: '%s'", dup);
+        ret = -1;
+        goto out;
+    }
+
+out:
+    free(dup);
+    return ret;
+}
+
+static int oci_parse_module_opts(const isulad_daemon_configs *args)
+{
+    size_t i;
+
+    g_oci_image_module_data.layer_dedup_interval = OCI_DEFAULT_LAYER_DEDUP_INTERVAL;
+
+    for (i = 0; i < args->storage_opts_len; i++) {
+        if (args->storage_opts[i] == NULL || !util_has_prefix(args->storage_opts[i], OCI_MODULE_OPT_PREFIX)) {
+            continue;
+        }
+        if (oci_parse_module_opt(args->storage_opts[i]) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
 }
 
 static int oci_image_data_init(const isulad_daemon_configs *args)
@@ -117,6 +272,11 @@ static int oci_image_data_init(const isulad_daemon_configs *args)
 
     g_oci_image_module_data.insecure_skip_verify_enforce = args->insecure_skip_verify_enforce;
 
+    if (oci_parse_module_opts(args) != 0) {
+        ERROR("Failed to parse oci image options");
+        goto free_out;
+    }
+
     if (util_array_len((const char **)args->registry_mirrors) != args->registry_mirrors_len) {
         ERROR("registry_mirrors_len is not the length of registry_mirrors");
         goto free_out;
@@ -223,6 +383,7 @@ out:
 static int storage_module_init_helper(const isulad_daemon_configs *args)
 {
     int ret = 0;
+    size_t i;
     struct storage_module_init_options *storage_opts = NULL;
 
     storage_opts = util_common_calloc_s(sizeof(struct storage_module_init_options));
@@ -257,12 +418,23 @@ static int storage_module_init_helper(const isulad_daemon_configs *args)
     storage_opts->enable_remote_layer = args->storage_enable_remote_layer;
     storage_opts->remote_lock = &g_remote_lock;
 #endif
-
-    if (util_dup_array_of_strings((const char **)args->storage_opts, args->storage_opts_len, &storage_opts->driver_opts,
-                                  &storage_opts->driver_opts_len) != 0) {
-        ERROR("Failed to get storage storage opts");
-        ret = -1;
-        goto out;
+    storage_opts->integration_check_skip_unchanged = g_oci_image_module_data.layer_check_skip_unchanged;
+    storage_opts->image_big_data_cache_size = g_oci_image_module_data.image_big_data_cache_size;
+    storage_opts->rw_layer_pool = g_oci_image_module_data.rw_layer_pool;
+    storage_opts->layer_dedup = g_oci_image_module_data.layer_dedup;
+    storage_opts->layer_dedup_interval = g_oci_image_module_data.layer_dedup_interval;
+
+    for (i = 0; i < args->storage_opts_len; i++) {
+        // options of oci image module are not known by graph driver
+        if (args->storage_opts[i] == NULL || util_has_prefix(args->storage_opts[i], OCI_MODULE_OPT_PREFIX)) {
+            continue;
+        }
+        if (util_array_append(&storage_opts->driver_opts, args->storage_opts[i]) != 0) {
+            ERROR("Failed to get storage storage opts");
+            ret = -1;
+            goto out;
+        }
+        storage_opts->driver_opts_len++;
     }
 
 #ifndef LIB_ISULAD_IMG_SO
@@ -349,6 +521,30 @@ out:
     return ret;
 }
 
+static int oci_blob_cache_init(void)
+{
+    int ret = 0;
+    char *cache_dir = NULL;
+
+    if (g_oci_image_module_data.blob_cache_size == 0) {
+        return 0;
+    }
+
+    cache_dir = util_path_join(g_oci_image_module_data.root_dir, BLOB_CACHE_DIR_NAME);
+    if (cache_dir == NULL) {
+        ERROR("Failed to get blob cache dir");
+        return -1;
+    }
+
+    ret = blob_cache_init(cache_dir, g_oci_image_module_data.blob_cache_size);
+    if (ret != 0) {
+        ERROR("Failed to init blob cache in %s", cache_dir);
+    }
+
+    free(cache_dir);
+    return ret;
+}
+
 int oci_init(const isulad_daemon_configs *args)
 {
     int ret = 0;
@@ -375,6 +571,11 @@ int oci_init(const isulad_daemon_configs *args)
         goto out;
     }
 
+    ret = oci_blob_cache_init();
+    if (ret != 0) {
+        goto out;
+    }
+
 #ifdef ENABLE_REMOTE_LAYER_STORE
     g_enable_remote = args->storage_enable_remote_layer;
 #endif
@@ -392,6 +593,7 @@ out:
 void oci_exit(void)
 {
     storage_module_exit();
+    blob_cache_exit();
     free_oci_image_data();
 }
 
@@ -18,10 +18,12 @@
 #include <isula_libutils/container_config.h>
 #include <isula_libutils/imagetool_fs_info.h>
 #include <isula_libutils/isulad_daemon_configs.h>
+#include <isula_libutils/json_common.h>
 
 #include "image_api.h"
 #include "isula_libutils/oci_image_spec.h"
 #include "oci_common_operators.h"
+#include "storage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -37,11 +39,44 @@ struct oci_image_module_data {
 
     char **insecure_registries;
     size_t insecure_registries_len;
+
+    // capacity of compressed blob cache, 0 means disabled
+    int64_t blob_cache_size;
+
+    // trust layers whose metadata files are not changed since last clean shutdown when checking integrity,
+    // content under diff directories is not compared
+    bool layer_check_skip_unchanged;
+
+    // capacity of in memory cache of image big data items, 0 means disabled and is the default.
+    // watch isula_image_big_data_cache_requests to size it for the workload
+    int64_t image_big_data_cache_size;
+
+    // image name or id to number of idle writable layers kept for it
+    json_map_string_int64 *rw_layer_pool;
+
+    // how identical files across layers are deduplicated
+    layer_dedup_mode_t layer_dedup;
+    // seconds between two dedup passes
+    int64_t layer_dedup_interval;
 };
 
 #define LOAD_TMPDIR_PREFIX "oci-image-load-"
 #define REGISTRY_TMPDIR_PREFIX "registry-"
 
+// storage opts with this prefix are consumed by oci image module and not passed to graph driver
+#define OCI_MODULE_OPT_PREFIX "oci."
+#define OCI_BLOB_CACHE_SIZE_OPT "oci.blob_cache_size"
+#define OCI_LAYER_CHECK_SKIP_UNCHANGED_OPT "oci.layer_check_skip_unchanged"
+#define OCI_IMAGE_BIG_DATA_CACHE_SIZE_OPT "oci.image_big_data_cache_size"
+// comma separated <image>:<count>, count is the last field as image names may have tag or digest
+#define OCI_RW_LAYER_POOL_OPT "oci.rw_layer_pool"
+// off, auto, reflink or hardlink
+#define OCI_LAYER_DEDUP_OPT "oci.layer_dedup"
+#define OCI_LAYER_DEDUP_INTERVAL_OPT "oci.layer_dedup_interval"
+// a pass hashes every new layer, do not run it more often than needed
+#define OCI_DEFAULT_LAYER_DEDUP_INTERVAL 3600
+#define OCI_MIN_LAYER_DEDUP_INTERVAL 60
+
 struct oci_image_module_data *get_oci_image_data(void);
 
 int oci_init(const isulad_daemon_configs *args);
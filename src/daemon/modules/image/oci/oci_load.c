@@ -44,6 +44,7 @@
 #include "utils_verify.h"
 #include "oci_image.h"
 #include "isulad_config.h"
+#include "blob_cache.h"
 
 #define MANIFEST_BIG_DATA_KEY "manifest"
 #define OCI_SCHEMA_VERSION 2
@@ -354,6 +355,12 @@ static int oci_load_register_layers(load_image_t *desc)
             goto out;
         }
 
+        // only compressed layers can be reused by later pulls
+        if (strcmp(desc->layers[i]->compressed_digest, desc->layers[i]->diff_id) != 0 &&
+            blob_cache_store(desc->layers[i]->compressed_digest, desc->layers[i]->fpath) != 0) {
+            WARN("Failed to add layer %s to blob cache", desc->layers[i]->fpath);
+        }
+
         free(desc->layer_of_hold_refs);
         desc->layer_of_hold_refs = util_strdup_s(id);
         if (parent != NULL && storage_dec_hold_refs(parent) != 0) {
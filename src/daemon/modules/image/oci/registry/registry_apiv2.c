@@ -40,6 +40,8 @@
 #include "utils_file.h"
 #include "utils_string.h"
 #include "utils_verify.h"
+#include "blob_cache.h"
+#include "progress.h"
 
 #define DOCKER_API_VERSION_HEADER "Docker-Distribution-Api-Version: registry/2.0"
 #define MAX_ACCEPT_LEN 128
@@ -1113,6 +1115,24 @@ out:
     return ret;
 }
 
+static bool fetch_layer_from_blob_cache(pull_descriptor *desc, layer_blob *layer, const char *file)
+{
+    int64_t size = 0;
+
+    if (!blob_cache_enabled() || blob_cache_fetch(layer->digest, file) != 0) {
+        return false;
+    }
+
+    DEBUG("Got layer %s of %s from blob cache", layer->digest, desc->name);
+    size = util_file_size(file);
+    if (desc->progress_status_store != NULL &&
+        !progress_status_map_udpate(desc->progress_status_store, layer->digest, size, size)) {
+        WARN("Failed to update pull progress of layer %s", layer->digest);
+    }
+
+    return true;
+}
+
 int fetch_layer(pull_descriptor *desc, size_t index)
 {
     int ret = 0;
@@ -1145,12 +1165,21 @@ int fetch_layer(pull_descriptor *desc, size_t index)
         goto out;
     }
 
+    if (fetch_layer_from_blob_cache(desc, layer, file)) {
+        goto out;
+    }
+
     ret = fetch_data(desc, path, file, layer->media_type, layer->digest);
     if (ret != 0) {
         ERROR("registry: Get %s failed", path);
         goto out;
     }
 
+    // data is verified with digest in fetch_data, cache failure do not fail the pull
+    if (blob_cache_store(layer->digest, file) != 0) {
+        WARN("Failed to add layer %s to blob cache", layer->digest);
+    }
+
 out:
 
     return ret;
@@ -0,0 +1,247 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide in memory lru cache of image big data items
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "big_data_cache.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isula_libutils/log.h"
+#include "lru.h"
+#include "utils.h"
+
+typedef struct {
+    pthread_mutex_t mutex;
+    // "<id>/<key>" -> copy of data, image id never contains '/'
+    lru_t *entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+} big_data_cache;
+
+static big_data_cache *g_big_data_cache;
+
+static void release_data(const char *name, void *data, bool evicted, void *context)
+{
+    free(data);
+}
+
+static void big_data_cache_lock(void)
+{
+    if (pthread_mutex_lock(&g_big_data_cache->mutex) != 0) {
+        ERROR("Failed to lock big data cache");
+    }
+}
+
+static void big_data_cache_unlock(void)
+{
+    if (pthread_mutex_unlock(&g_big_data_cache->mutex) != 0) {
+        ERROR("Failed to unlock big data cache");
+    }
+}
+
+static char *entry_name(const char *id, const char *key)
+{
+    char *name = NULL;
+
+    if (asprintf(&name, "%s/%s", id, key) < 0) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    return name;
+}
+
+int big_data_cache_init(int64_t capacity)
+{
+    if (capacity <= 0) {
+        DEBUG("Image big data cache disabled");
+        return 0;
+    }
+
+    if (g_big_data_cache != NULL) {
+        ERROR("Image big data cache already initialized");
+        return -1;
+    }
+
+    g_big_data_cache = util_common_calloc_s(sizeof(big_data_cache));
+    if (g_big_data_cache == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+
+    if (pthread_mutex_init(&g_big_data_cache->mutex, NULL) != 0) {
+        ERROR("Failed to init big data cache mutex");
+        free(g_big_data_cache);
+        g_big_data_cache = NULL;
+        return -1;
+    }
+
+    g_big_data_cache->entries = lru_new(capacity, release_data, NULL);
+    if (g_big_data_cache->entries == NULL) {
+        ERROR("Out of memory");
+        big_data_cache_exit();
+        return -1;
+    }
+
+    return 0;
+}
+
+void big_data_cache_exit(void)
+{
+    if (g_big_data_cache == NULL) {
+        return;
+    }
+
+    INFO("Image big data cache: %lu hits, %lu misses, %lu evictions, %lu invalidations",
+         (unsigned long)g_big_data_cache->hits, (unsigned long)g_big_data_cache->misses,
+         (unsigned long)lru_evictions(g_big_data_cache->entries), (unsigned long)g_big_data_cache->invalidations);
+
+    lru_free(g_big_data_cache->entries);
+    g_big_data_cache->entries = NULL;
+    (void)pthread_mutex_destroy(&g_big_data_cache->mutex);
+    free(g_big_data_cache);
+    g_big_data_cache = NULL;
+}
+
+bool big_data_cache_enabled(void)
+{
+    return g_big_data_cache != NULL;
+}
+
+char *big_data_cache_get(const char *id, const char *key)
+{
+    char *name = NULL;
+    char *data = NULL;
+    const char *cached = NULL;
+
+    if (g_big_data_cache == NULL || id == NULL || key == NULL) {
+        return NULL;
+    }
+
+    name = entry_name(id, key);
+    if (name == NULL) {
+        return NULL;
+    }
+
+    big_data_cache_lock();
+    cached = (const char *)lru_get(g_big_data_cache->entries, name);
+    if (cached == NULL) {
+        g_big_data_cache->misses++;
+        goto out;
+    }
+    g_big_data_cache->hits++;
+    data = util_strdup_s(cached);
+
+out:
+    big_data_cache_unlock();
+    free(name);
+    return data;
+}
+
+void big_data_cache_put(const char *id, const char *key, const char *data)
+{
+    char *name = NULL;
+    char *copy = NULL;
+
+    if (g_big_data_cache == NULL || id == NULL || key == NULL || data == NULL) {
+        return;
+    }
+
+    name = entry_name(id, key);
+    if (name == NULL) {
+        return;
+    }
+    copy = util_strdup_s(data);
+
+    big_data_cache_lock();
+    // charge the name too, many images have tiny manifests. an existing entry was filled
+    // by another reader with the same content, too large data is not cached at all
+    if (lru_put(g_big_data_cache->entries, name, copy, (int64_t)(strlen(data) + strlen(name))) == 0) {
+        copy = NULL;
+    }
+    big_data_cache_unlock();
+
+    free(name);
+    free(copy);
+}
+
+static bool match_image_id(const char *name, void *data, void *arg)
+{
+    const char *id = (const char *)arg;
+    size_t len = strlen(id);
+
+    return strncmp(name, id, len) == 0 && name[len] == '/';
+}
+
+static bool count_invalidation(const char *name, void *data, void *arg)
+{
+    if (!match_image_id(name, data, arg)) {
+        return false;
+    }
+    g_big_data_cache->invalidations++;
+    return true;
+}
+
+void big_data_cache_invalidate(const char *id, const char *key)
+{
+    char *name = NULL;
+
+    if (g_big_data_cache == NULL || id == NULL) {
+        return;
+    }
+
+    if (key != NULL) {
+        name = entry_name(id, key);
+        if (name == NULL) {
+            return;
+        }
+        big_data_cache_lock();
+        if (lru_remove(g_big_data_cache->entries, name)) {
+            g_big_data_cache->invalidations++;
+        }
+        big_data_cache_unlock();
+        free(name);
+        return;
+    }
+
+    // delete of image is rare, a walk of the whole cache is fine
+    big_data_cache_lock();
+    lru_remove_if(g_big_data_cache->entries, count_invalidation, (void *)id);
+    big_data_cache_unlock();
+}
+
+void big_data_cache_get_stats(struct big_data_cache_stats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    (void)memset(stats, 0, sizeof(*stats));
+    if (g_big_data_cache == NULL) {
+        return;
+    }
+
+    big_data_cache_lock();
+    stats->hits = g_big_data_cache->hits;
+    stats->misses = g_big_data_cache->misses;
+    stats->evictions = lru_evictions(g_big_data_cache->entries);
+    stats->invalidations = g_big_data_cache->invalidations;
+    stats->size = lru_size(g_big_data_cache->entries);
+    stats->capacity = lru_capacity(g_big_data_cache->entries);
+    big_data_cache_unlock();
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide in memory lru cache of image big data items
+ ******************************************************************************/
+#ifndef DAEMON_MODULES_IMAGE_OCI_STORAGE_IMAGE_STORE_BIG_DATA_CACHE_H
+#define DAEMON_MODULES_IMAGE_OCI_STORAGE_IMAGE_STORE_BIG_DATA_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+struct big_data_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    int64_t size;
+    int64_t capacity;
+};
+
+// capacity <= 0 means cache disabled, every call below becomes a no-op
+int big_data_cache_init(int64_t capacity);
+
+void big_data_cache_exit(void);
+
+bool big_data_cache_enabled(void);
+
+// return a copy of cached data of key of image id, NULL on miss
+char *big_data_cache_get(const char *id, const char *key);
+
+// data is copied, items larger than the whole capacity are not cached
+void big_data_cache_put(const char *id, const char *key, const char *data);
+
+// drop key of image id, or all items of image id if key is NULL
+void big_data_cache_invalidate(const char *id, const char *key);
+
+void big_data_cache_get_stats(struct big_data_cache_stats *stats);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif // DAEMON_MODULES_IMAGE_OCI_STORAGE_IMAGE_STORE_BIG_DATA_CACHE_H
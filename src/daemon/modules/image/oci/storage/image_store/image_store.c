@@ -50,6 +50,7 @@
 #include "image_type.h"
 #include "linked_list.h"
 #include "utils_verify.h"
+#include "big_data_cache.h"
 #ifdef ENABLE_REMOTE_LAYER_STORE
 #include "ro_symlink_maintain.h"
 #endif
@@ -85,6 +86,8 @@ enum lock_type { SHARED = 0, EXCLUSIVE };
 
 image_store_t *g_image_store = NULL;
 
+static void refresh_image_summary(image_t *img);
+
 static inline bool image_store_lock(enum lock_type type)
 {
     int nret = 0;
@@ -151,6 +154,7 @@ void image_store_free(void)
 {
     free_image_store(g_image_store);
     g_image_store = NULL;
+    big_data_cache_exit();
 }
 
 static void image_store_field_kvfree(void *key, void *value)
@@ -246,6 +250,7 @@ static int remove_name(image_t *img, const char *name)
         util_free_array_by_len(img->simage->names, img->simage->names_len);
         img->simage->names = NULL;
         img->simage->names_len = 0;
+        refresh_image_summary(img);
 
         return 0;
     }
@@ -269,6 +274,7 @@ static int remove_name(image_t *img, const char *name)
     img->simage->names = tmp_names;
     img->simage->names_len = index;
     tmp_names = NULL;
+    refresh_image_summary(img);
 
     return 0;
 }
@@ -785,6 +791,8 @@ static int remove_image_from_memory(const char *id)
         break;
     }
 
+    big_data_cache_invalidate(id, NULL);
+
 out:
     free(digest);
     image_ref_dec(img);
@@ -935,6 +943,7 @@ static int image_store_append_image(const char *id, const char *searchable_diges
         ERROR("Out of memory");
         return -1;
     }
+    refresh_image_summary(img);
     linked_list_add_elem(item, img);
     linked_list_add_tail(&g_image_store->images_list, item);
     g_image_store->images_list_len++;
@@ -1390,6 +1399,7 @@ int image_store_set_big_data(const char *id, const char *key, const char *data)
         goto out;
     }
 
+    big_data_cache_invalidate(image_id, key);
     if (util_atomic_write_file(big_data_file, data, strlen(data), SECURE_CONFIG_FILE_MODE, true) != 0) {
         ERROR("Failed to save big data file: %s", big_data_file);
         ret = -1;
@@ -1413,6 +1423,7 @@ int image_store_set_big_data(const char *id, const char *key, const char *data)
     }
 
 out:
+    refresh_image_summary(img);
     image_ref_dec(img);
     image_store_unlock();
     return ret;
@@ -1539,6 +1550,7 @@ int image_store_add_name(const char *id, const char *name)
 out:
     util_free_array_by_len(names, names_len);
     util_free_array_by_len(unique_names, unique_names_len);
+    refresh_image_summary(img);
     image_ref_dec(img);
     image_store_unlock();
     return ret;
@@ -1622,6 +1634,7 @@ int image_store_set_names(const char *id, const char **names, size_t names_len)
 
 out:
     util_free_array_by_len(unique_names, unique_names_len);
+    refresh_image_summary(img);
     image_ref_dec(img);
     image_store_unlock();
     return ret;
@@ -1759,6 +1772,7 @@ int image_store_set_load_time(const char *id, const types_timestamp_t *time)
     }
 
 out:
+    refresh_image_summary(img);
     image_ref_dec(img);
     image_store_unlock();
     return ret;
@@ -1797,6 +1811,25 @@ out:
     return ret;
 }
 
+// must be called with image store locked, cache is filled under the same lock which excludes
+// image_store_set_big_data() and delete, so a stale file content is never cached
+static char *read_big_data_with_cache(const char *id, const char *key, const char *filename)
+{
+    char *content = NULL;
+
+    content = big_data_cache_get(id, key);
+    if (content != NULL) {
+        return content;
+    }
+
+    content = util_read_content_from_file(filename);
+    if (content != NULL) {
+        big_data_cache_put(id, key, content);
+    }
+
+    return content;
+}
+
 char *image_store_big_data(const char *id, const char *key)
 {
     int ret = 0;
@@ -1836,7 +1869,7 @@ char *image_store_big_data(const char *id, const char *key)
         goto out;
     }
 
-    content = util_read_content_from_file(filename);
+    content = read_big_data_with_cache(img->simage->id, key, filename);
 
 out:
     image_ref_dec(img);
@@ -2158,6 +2191,7 @@ int image_store_set_image_size(const char *id, uint64_t size)
     }
 
 out:
+    refresh_image_summary(img);
     image_ref_dec(img);
     image_store_unlock();
     return ret;
@@ -2248,6 +2282,11 @@ static int get_image_repo_digests(char ***old_repo_digests, char **image_tags, i
     map_t *digest_map = NULL;
 
     digest = util_strdup_s(img->simage->digest);
+    if (digest == NULL || strlen(digest) == 0) {
+        free(digest);
+        // caller holds the image store lock, try the recorded digest before locking again
+        digest = get_value_from_json_map_string_string(img->simage->big_data_digests, IMAGE_DIGEST_BIG_DATA_KEY);
+    }
     if (digest == NULL || strlen(digest) == 0) {
         img_digest = image_store_big_data_digest(img->simage->id, IMAGE_DIGEST_BIG_DATA_KEY);
         if (img_digest == NULL) {
@@ -2324,12 +2363,19 @@ out:
     return ret;
 }
 
-static int pack_oci_image_spec(const char *filename, imagetool_image *info)
+static int pack_oci_image_spec(const char *id, const char *key, const char *filename, imagetool_image *info)
 {
     int ret = 0;
+    char *content = NULL;
     parser_error err = NULL;
 
-    info->spec = oci_image_spec_parse_file(filename, NULL, &err);
+    content = read_big_data_with_cache(id, key, filename);
+    if (content == NULL) {
+        ERROR("Failed to read oci image spec file: %s", filename);
+        return -1;
+    }
+
+    info->spec = oci_image_spec_parse_data(content, NULL, &err);
     if (info->spec == NULL) {
         ERROR("Failed to parse oci image spec file: %s", err);
         ret = -1;
@@ -2337,6 +2383,7 @@ static int pack_oci_image_spec(const char *filename, imagetool_image *info)
     }
 
 out:
+    free(content);
     free(err);
     return ret;
 }
@@ -2483,7 +2530,7 @@ static imagetool_image *get_image_info(image_t *img)
         goto out;
     }
 
-    if (pack_oci_image_spec(config_file, info) != 0) {
+    if (pack_oci_image_spec(img->simage->id, sha256_key, config_file, info) != 0) {
         ERROR("Failed to pack oci image spec");
         ret = -1;
         goto out;
@@ -2501,7 +2548,16 @@ static imagetool_image *get_image_info(image_t *img)
     info->size = img->simage->size;
     info->top_layer = util_strdup_s(img->simage->layer);
 
-    if (pack_image_tags_and_repo_digest(img, info) != 0) {
+    if (img->summary != NULL) {
+        if (util_dup_array_of_strings((const char **)img->summary->repo_tags, img->summary->repo_tags_len,
+                                      &info->repo_tags, &info->repo_tags_len) != 0 ||
+            util_dup_array_of_strings((const char **)img->summary->repo_digests, img->summary->repo_digests_len,
+                                      &info->repo_digests, &info->repo_digests_len) != 0) {
+            ERROR("Out of memory");
+            ret = -1;
+            goto out;
+        }
+    } else if (pack_image_tags_and_repo_digest(img, info) != 0) {
         ERROR("Failed to pack image tags and repo digest");
         ret = -1;
         goto out;
@@ -2663,6 +2719,95 @@ out:
     return info;
 }
 
+static imagetool_image_summary *dup_image_summary(const imagetool_image_summary *src)
+{
+    int ret = 0;
+    imagetool_image_summary *dst = NULL;
+
+    dst = util_common_calloc_s(sizeof(imagetool_image_summary));
+    if (dst == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    dst->id = util_strdup_s(src->id);
+    dst->created = util_strdup_s(src->created);
+    dst->loaded = util_strdup_s(src->loaded);
+    dst->size = src->size;
+    dst->top_layer = util_strdup_s(src->top_layer);
+    dst->username = util_strdup_s(src->username);
+
+    if (src->uid != NULL) {
+        dst->uid = (imagetool_image_summary_uid *)util_common_calloc_s(sizeof(imagetool_image_summary_uid));
+        if (dst->uid == NULL) {
+            ERROR("Out of memory");
+            ret = -1;
+            goto out;
+        }
+        dst->uid->value = src->uid->value;
+    }
+
+    if (util_dup_array_of_strings((const char **)src->repo_tags, src->repo_tags_len, &dst->repo_tags,
+                                  &dst->repo_tags_len) != 0 ||
+        util_dup_array_of_strings((const char **)src->repo_digests, src->repo_digests_len, &dst->repo_digests,
+                                  &dst->repo_digests_len) != 0) {
+        ERROR("Out of memory");
+        ret = -1;
+        goto out;
+    }
+
+    if (src->labels != NULL) {
+        dst->labels = util_common_calloc_s(sizeof(json_map_string_string));
+        if (dst->labels == NULL || dup_json_map_string_string(src->labels, dst->labels) != 0) {
+            ERROR("Failed to dup image labels");
+            ret = -1;
+            goto out;
+        }
+    }
+
+out:
+    if (ret != 0) {
+        free_imagetool_image_summary(dst);
+        dst = NULL;
+    }
+    return dst;
+}
+
+// must be called with exclusive lock of image store, readers only copy img->summary
+static void refresh_image_summary(image_t *img)
+{
+    char *digest = NULL;
+
+    if (img == NULL) {
+        return;
+    }
+
+    free_imagetool_image_summary(img->summary);
+    img->summary = NULL;
+
+    // a missing manifest digest is computed and saved by image_store_big_data_digest(),
+    // which needs the lock we hold, leave it to the uncached path
+    digest = get_value_from_json_map_string_string(img->simage->big_data_digests, IMAGE_DIGEST_BIG_DATA_KEY);
+    if ((img->simage->digest == NULL || strlen(img->simage->digest) == 0) && digest == NULL) {
+        return;
+    }
+    free(digest);
+
+    img->summary = get_image_summary(img);
+    if (img->summary == NULL) {
+        WARN("Failed to summarize image %s, build it on request", img->simage->id);
+    }
+}
+
+static imagetool_image_summary *get_cached_image_summary(image_t *img)
+{
+    if (img->summary != NULL) {
+        return dup_image_summary(img->summary);
+    }
+
+    return get_image_summary(img);
+}
+
 imagetool_image *image_store_get_image(const char *id)
 {
     image_t *img = NULL;
@@ -2727,7 +2872,7 @@ imagetool_image_summary *image_store_get_image_summary(const char *id)
         goto unlock;
     }
 
-    img_summary = get_image_summary(img);
+    img_summary = get_cached_image_summary(img);
     if (img_summary == NULL) {
         ERROR("Failed to get summary of image %s", img->simage->id);
         goto unlock;
@@ -2774,7 +2919,7 @@ int image_store_get_all_images(imagetool_images_list *images_list)
     linked_list_for_each_safe(item, &(g_image_store->images_list), next) {
         imagetool_image_summary *imginfo = NULL;
         image_t *img = (image_t *)item->elem;
-        imginfo = get_image_summary(img);
+        imginfo = get_cached_image_summary(img);
         if (imginfo == NULL) {
             ERROR("Failed to get summary info of image: %s", img->simage->id);
             continue;
@@ -3735,6 +3880,13 @@ int image_store_init(struct storage_module_init_options *opts)
         goto out;
     }
 
+    ret = big_data_cache_init(opts->image_big_data_cache_size);
+    if (ret != 0) {
+        ERROR("Failed to init image big data cache");
+        ret = -1;
+        goto out;
+    }
+
     ret = image_store_load();
     if (ret != 0) {
         ERROR("Failed to load image store");
@@ -3750,6 +3902,7 @@ out:
     if (ret != 0) {
         free_image_store(g_image_store);
         g_image_store = NULL;
+        big_data_cache_exit();
     }
     free(root_dir);
     return ret;
@@ -156,6 +156,8 @@ void free_image_t(image_t *ptr)
     ptr->simage = NULL;
     free_oci_image_spec(ptr->spec);
     ptr->spec = NULL;
+    free_imagetool_image_summary(ptr->summary);
+    ptr->summary = NULL;
 
     free(ptr);
 }
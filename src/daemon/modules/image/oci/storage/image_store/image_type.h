@@ -22,6 +22,7 @@
 #include "isula_libutils/storage_image.h"
 #include "isula_libutils/log.h"
 #include "isula_libutils/oci_image_spec.h"
+#include "isula_libutils/imagetool_image_summary.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,9 @@ extern "C" {
 typedef struct _image_t_ {
     storage_image *simage;
     oci_image_spec *spec;
+    // pre-summarized form served to list and status, rebuilt under exclusive lock of image store
+    // whenever the image changes, NULL means it must be computed on request
+    imagetool_image_summary *summary;
     uint64_t refcnt;
 } image_t;
 
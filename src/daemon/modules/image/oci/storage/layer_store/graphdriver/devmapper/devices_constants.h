@@ -16,6 +16,10 @@
 #ifndef DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_GRAPHDRIVER_DEVMAPPER_DEVICES_CONSTANTS_H
 #define DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_GRAPHDRIVER_DEVMAPPER_DEVICES_CONSTANTS_H
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "map.h"
 #include "isula_libutils/image_devmapper_transaction.h"
 #include "isula_libutils/image_devmapper_deviceset_metadata.h"
@@ -41,6 +45,8 @@ extern "C" {
 
 typedef struct {
     map_t *map; // map string image_devmapper_device_info*   key string will be strdup  value ptr will not
+    // devices are looked up under the read lock of devset, so the map needs its own lock
+    pthread_mutex_t mutex;
 } metadata_store_t;
 
 struct device_set {
@@ -75,6 +81,22 @@ struct device_set {
     int64_t udev_wait_timeout;
 
     bool user_base_size;
+
+    // hash -> struct device_lock, serialize operations on one device. taken before devmapper_driver_rwlock
+    map_t *device_locks;
+    pthread_mutex_t device_locks_mutex;
+
+    // background worker for deferred deactivation and deletion, and for refilling spare devices
+    pthread_t worker;
+    bool worker_running;
+    bool worker_stop;
+    bool worker_kicked;
+    pthread_mutex_t worker_mutex;
+    pthread_cond_t worker_cond;
+    map_t *pending_deactivation; // hashes unmounted but not deactivated yet, protected by worker_mutex
+
+    uint32_t spare_devices; // number of pre-created snapshots of base device
+    char **spare_hashes; // protected by devmapper_driver_rwlock
 };
 
 #ifdef __cplusplus
@@ -41,6 +41,7 @@
 #include "map.h"
 #include "metadata_store.h"
 #include "utils_array.h"
+#include "utils_convert.h"
 #include "utils_file.h"
 #include "utils_fs.h"
 #include "utils_string.h"
@@ -50,6 +51,15 @@
 #define DM_LOG_FATAL 2
 #define DM_LOG_DEBUG 7
 #define CLEANUP_INTERVAL_SECONDS 60
+#define SPARE_DEVICE_PREFIX "spare-"
+#define SPARE_DEVICE_RANDOM_LEN 16
+#define MAX_SPARE_DEVICES 64
+
+struct device_lock {
+    pthread_mutex_t mutex;
+    // holders and waiters of mutex, the lock is dropped from devset when it reaches 0
+    uint64_t refs;
+};
 
 static char *util_trim_prefice_string(char *str, const char *prefix)
 {
@@ -167,6 +177,21 @@ static int handle_dm_mountopt(char *val, struct device_set *devset)
     return 0;
 }
 
+static int handle_dm_spare_devices(char *val, struct device_set *devset)
+{
+    unsigned int converted = 0;
+
+    if (util_safe_uint(val, &converted) != 0 || converted > MAX_SPARE_DEVICES) {
+        ERROR("Invalid dm.spare_devices value: '%s'", val);
+        isulad_set_error_message("Invalid dm.spare_devices value: '%s', it must be in range [0, %d]", val,
+                                 MAX_SPARE_DEVICES);
+        return -1;
+    }
+    devset->spare_devices = (uint32_t)converted;
+
+    return 0;
+}
+
 static int devmapper_option_exact(const char *name, char *val, struct device_set *devset)
 {
     size_t i = 0;
@@ -180,6 +205,7 @@ static int devmapper_option_exact(const char *name, char *val, struct device_set
         { "dm.mkfsarg",            handle_dm_mkfsarg        },
         { "dm.mountopt",           handle_dm_mountopt       },
         { "devicemapper.mountopt", handle_dm_mountopt       },
+        { "dm.spare_devices",      handle_dm_spare_devices  },
     };
 
     for (i = 0; i < sizeof(handler_jump_table) / sizeof(handler_jump_table[0]); i++) {
@@ -562,7 +588,8 @@ static image_devmapper_device_info *load_metadata(const struct device_set *devse
         goto out;
     }
 
-    if (!util_valid_str(info->hash)) {
+    // the file of a spare device claimed right before a crash still has the spare hash, the file name wins
+    if (!util_valid_str(info->hash) || (util_valid_str(hash) && strcmp(info->hash, hash) != 0)) {
         free(info->hash);
         info->hash = util_strdup_s(hash);
     }
@@ -738,7 +765,12 @@ static bool util_valid_device_hash(const char *hash)
         return true;
     }
 
-    return util_reg_match(patten, hash) == 0;
+    return util_reg_match(patten, hash) == 0 || util_reg_match("^" SPARE_DEVICE_PREFIX "[a-f0-9]{16}$", hash) == 0;
+}
+
+static bool is_spare_device_hash(const char *hash)
+{
+    return strncmp(hash, SPARE_DEVICE_PREFIX, strlen(SPARE_DEVICE_PREFIX)) == 0;
 }
 
 static int device_file_walk(struct device_set *devset)
@@ -807,6 +839,13 @@ static int device_file_walk(struct device_set *devset)
             ret = -1;
             goto out;
         }
+        if (is_spare_device_hash(entry->d_name) && !device_info->info->deleted &&
+            util_array_append(&devset->spare_hashes, entry->d_name) != 0) {
+            ERROR("Out of memory");
+            devmapper_device_info_ref_dec(device_info);
+            ret = -1;
+            goto out;
+        }
         devmapper_device_info_ref_dec(device_info);
     }
 
@@ -2161,6 +2200,7 @@ static int grow_fs(struct device_set *devset, image_devmapper_device_info *info)
     bool is_remove = false;
     char *mount_opt = NULL;
     char *dev_fname = NULL;
+    char *mount_point = NULL;
 
     if (activate_device_if_needed(devset, info, false) != 0) {
         ERROR("devmapper:error activating devmapper device %s", info->hash);
@@ -2168,9 +2208,17 @@ static int grow_fs(struct device_set *devset, image_devmapper_device_info *info)
         goto out;
     }
 
-    if (!util_dir_exists(FS_MOUNT_POINT)) {
-        if (util_mkdir_p(FS_MOUNT_POINT, DEFAULT_DEVICE_SET_MODE) != 0) {
-            ERROR("devmapper: mkdir %s failed", FS_MOUNT_POINT);
+    // devices may be grown in parallel, each one gets its own mount point
+    mount_point = util_path_join(FS_MOUNT_POINT, info->hash);
+    if (mount_point == NULL) {
+        ERROR("devmapper: join mount point for device %s failed", info->hash);
+        ret = -1;
+        goto out;
+    }
+
+    if (!util_dir_exists(mount_point)) {
+        if (util_mkdir_p(mount_point, DEFAULT_DEVICE_SET_MODE) != 0) {
+            ERROR("devmapper: mkdir %s failed", mount_point);
             ret = -1;
             goto out;
         }
@@ -2185,8 +2233,8 @@ static int grow_fs(struct device_set *devset, image_devmapper_device_info *info)
         goto out;
     }
 
-    if (util_mount(dev_fname, FS_MOUNT_POINT, devset->base_device_filesystem, mount_opt) != 0) {
-        ERROR("Error mounting '%s' on '%s' ", dev_fname, FS_MOUNT_POINT);
+    if (util_mount(dev_fname, mount_point, devset->base_device_filesystem, mount_opt) != 0) {
+        ERROR("Error mounting '%s' on '%s' ", dev_fname, mount_point);
         ret = -1;
         goto out;
     }
@@ -2204,15 +2252,16 @@ static int grow_fs(struct device_set *devset, image_devmapper_device_info *info)
     }
 
 clean_mount:
-    if (umount2(FS_MOUNT_POINT, MNT_DETACH) < 0 && errno != EINVAL) {
-        SYSWARN("Failed to umount directory %s", FS_MOUNT_POINT);
+    if (umount2(mount_point, MNT_DETACH) < 0 && errno != EINVAL) {
+        SYSWARN("Failed to umount directory %s", mount_point);
     }
 
 out:
     deactivate_device(devset, info);
-    if (is_remove && util_path_remove(FS_MOUNT_POINT) != 0) {
-        WARN("devmapper: remove path:%s failed", FS_MOUNT_POINT);
+    if (is_remove && util_path_remove(mount_point) != 0) {
+        WARN("devmapper: remove path:%s failed", mount_point);
     }
+    free(mount_point);
     free(dev_fname);
     free(mount_opt);
     return ret;
@@ -2488,90 +2537,465 @@ out:
     return ret;
 }
 
-static void cleanup_deleted_devices(struct graphdriver *driver)
+static void device_lock_kvfree(void *key, void *value)
 {
-    char **idsarray = NULL;
-    size_t ids_len = 0;
-    size_t i = 0;
+    struct device_lock *lock = (struct device_lock *)value;
+
+    free(key);
+    if (lock != NULL) {
+        (void)pthread_mutex_destroy(&lock->mutex);
+        free(lock);
+    }
+}
+
+// operations on different devices run in parallel, only pool transactions need write lock of devset
+static struct device_lock *device_lock_acquire(struct device_set *devset, const char *hash)
+{
+    struct device_lock *lock = NULL;
+
+    (void)pthread_mutex_lock(&devset->device_locks_mutex);
+    lock = map_search(devset->device_locks, (void *)hash);
+    if (lock == NULL) {
+        lock = util_common_calloc_s(sizeof(struct device_lock));
+        if (lock == NULL) {
+            ERROR("Out of memory");
+            goto unlock;
+        }
+        if (pthread_mutex_init(&lock->mutex, NULL) != 0) {
+            ERROR("devmapper: init lock of device %s failed", hash);
+            free(lock);
+            lock = NULL;
+            goto unlock;
+        }
+        if (!map_insert(devset->device_locks, (void *)hash, lock)) {
+            ERROR("devmapper: insert lock of device %s failed", hash);
+            (void)pthread_mutex_destroy(&lock->mutex);
+            free(lock);
+            lock = NULL;
+            goto unlock;
+        }
+    }
+    lock->refs++;
+
+unlock:
+    (void)pthread_mutex_unlock(&devset->device_locks_mutex);
+    if (lock != NULL) {
+        (void)pthread_mutex_lock(&lock->mutex);
+    }
+    return lock;
+}
+
+static void device_lock_release(struct device_set *devset, const char *hash, struct device_lock *lock)
+{
+    if (lock == NULL) {
+        return;
+    }
+
+    (void)pthread_mutex_unlock(&lock->mutex);
+
+    (void)pthread_mutex_lock(&devset->device_locks_mutex);
+    lock->refs--;
+    if (lock->refs == 0 && !map_remove(devset->device_locks, (void *)hash)) {
+        ERROR("devmapper: remove lock of device %s failed", hash);
+    }
+    (void)pthread_mutex_unlock(&devset->device_locks_mutex);
+}
+
+static void kick_worker(struct device_set *devset)
+{
+    (void)pthread_mutex_lock(&devset->worker_mutex);
+    devset->worker_kicked = true;
+    (void)pthread_cond_signal(&devset->worker_cond);
+    (void)pthread_mutex_unlock(&devset->worker_mutex);
+}
+
+static void queue_deactivation(struct device_set *devset, const char *hash)
+{
+    bool val = true;
+
+    (void)pthread_mutex_lock(&devset->worker_mutex);
+    if (!map_replace(devset->pending_deactivation, (void *)hash, (void *)&val)) {
+        ERROR("devmapper: queue deactivation of device %s failed", hash);
+    }
+    devset->worker_kicked = true;
+    (void)pthread_cond_signal(&devset->worker_cond);
+    (void)pthread_mutex_unlock(&devset->worker_mutex);
+}
+
+static void deactivate_pending_device(struct device_set *devset, const char *hash)
+{
+    struct dm_info dinfo = { 0 };
+    char *dm_name = NULL;
+    devmapper_device_info_t *device_info = NULL;
+    struct device_lock *lock = NULL;
+
+    lock = device_lock_acquire(devset, hash);
+    if (lock == NULL) {
+        return;
+    }
+
+    if (pthread_rwlock_rdlock(&devset->devmapper_driver_rwlock) != 0) {
+        ERROR("lock devmapper conf failed");
+        goto release;
+    }
+
+    device_info = lookup_device(devset, hash);
+    if (device_info == NULL) {
+        DEBUG("devmapper: device %s is gone, no need to deactivate", hash);
+        goto unlock;
+    }
+
+    dm_name = get_dm_name(devset, hash);
+    if (dm_name == NULL || dev_get_info(&dinfo, dm_name) != 0) {
+        ERROR("devmapper: get device info of %s failed", hash);
+        goto unlock;
+    }
+
+    if (dinfo.exists == 0 || dinfo.open_count > 0) {
+        // already removed, or mounted again before we got here
+        goto unlock;
+    }
+
+    if (deactivate_device(devset, device_info->info) != 0) {
+        WARN("devmapper: deactivate device %s failed", hash);
+    }
+
+unlock:
+    (void)pthread_rwlock_unlock(&devset->devmapper_driver_rwlock);
+release:
+    device_lock_release(devset, hash, lock);
+    devmapper_device_info_ref_dec(device_info);
+    free(dm_name);
+}
+
+static void deactivate_pending_devices(struct device_set *devset)
+{
+    map_t *pending = NULL;
+    map_itor *itor = NULL;
 
-    if (pthread_rwlock_wrlock(&(driver->rwlock)) != 0) {
-        ERROR("Lock to driver failed");
+    (void)pthread_mutex_lock(&devset->worker_mutex);
+    if (map_size(devset->pending_deactivation) == 0) {
+        (void)pthread_mutex_unlock(&devset->worker_mutex);
+        return;
+    }
+    pending = devset->pending_deactivation;
+    devset->pending_deactivation = map_new(MAP_STR_BOOL, MAP_DEFAULT_CMP_FUNC, MAP_DEFAULT_FREE_FUNC);
+    if (devset->pending_deactivation == NULL) {
+        // keep the queue and retry on next round
+        ERROR("Out of memory");
+        devset->pending_deactivation = pending;
+        (void)pthread_mutex_unlock(&devset->worker_mutex);
         return;
     }
+    (void)pthread_mutex_unlock(&devset->worker_mutex);
 
-    if (pthread_rwlock_wrlock(&(driver->devset->devmapper_driver_rwlock)) != 0) {
-        ERROR("Lock to deviceset failed");
-        goto unlock_driver;
+    itor = map_itor_new(pending);
+    if (itor == NULL) {
+        ERROR("Out of memory");
+        goto out;
     }
 
-    if (driver->devset->nr_deleted_devices == 0) {
+    for (; map_itor_valid(itor); map_itor_next(itor)) {
+        deactivate_pending_device(devset, (const char *)map_itor_key(itor));
+    }
+
+out:
+    map_itor_free(itor);
+    map_free(pending);
+}
+
+static char **list_deleted_devices(struct device_set *devset)
+{
+    char **hashes = NULL;
+    char **deleted = NULL;
+    size_t i = 0;
+
+    if (pthread_rwlock_rdlock(&devset->devmapper_driver_rwlock) != 0) {
+        ERROR("lock devmapper conf failed");
+        return NULL;
+    }
+
+    if (devset->nr_deleted_devices == 0) {
         DEBUG("devmapper: no devices to delete");
-        goto unlock_devset;
+        goto unlock;
     }
 
-    idsarray = metadata_store_list_hashes(driver->devset->meta_store);
-    if (idsarray == NULL) {
+    hashes = metadata_store_list_hashes(devset->meta_store);
+    if (hashes == NULL) {
         WARN("devmapper: get metadata store list failed");
-        goto unlock_devset;
+        goto unlock;
     }
 
-    ids_len = util_array_len((const char **)idsarray);
-    for (i = 0; i < ids_len; i++) {
+    for (i = 0; hashes[i] != NULL; i++) {
+        devmapper_device_info_t *device_info = lookup_device(devset, hashes[i]);
+
+        if (device_info != NULL && device_info->info->deleted && util_array_append(&deleted, hashes[i]) != 0) {
+            ERROR("Out of memory");
+        }
+        devmapper_device_info_ref_dec(device_info);
+    }
+
+unlock:
+    (void)pthread_rwlock_unlock(&devset->devmapper_driver_rwlock);
+    util_free_array(hashes);
+    return deleted;
+}
+
+static void cleanup_deleted_devices(struct device_set *devset)
+{
+    size_t i = 0;
+    char **deleted = NULL;
+
+    deleted = list_deleted_devices(devset);
+    for (i = 0; i < util_array_len((const char **)deleted); i++) {
         devmapper_device_info_t *device_info = NULL;
+        struct device_lock *lock = NULL;
 
-        device_info = lookup_device(driver->devset, idsarray[i]);
-        if (device_info == NULL || device_info->info == NULL) {
-            DEBUG("devmapper: no such device with hash(%s), just skip cleanup", idsarray[i]);
-            devmapper_device_info_ref_dec(device_info);
+        lock = device_lock_acquire(devset, deleted[i]);
+        if (lock == NULL) {
             continue;
         }
-
-        if (!device_info->info->deleted) {
-            devmapper_device_info_ref_dec(device_info);
-            device_info = NULL;
-            DEBUG("No need to delete device with hash(%s)", idsarray[i]);
+        if (pthread_rwlock_wrlock(&devset->devmapper_driver_rwlock) != 0) {
+            ERROR("lock devmapper conf failed");
+            device_lock_release(devset, deleted[i], lock);
             continue;
         }
 
+        // the same hash may have been deleted and added again in the meantime
+        device_info = lookup_device(devset, deleted[i]);
+        if (device_info != NULL && device_info->info->deleted && do_delete_device(devset, deleted[i], false) != 0) {
+            WARN("devmapper:Deletion of device: \"%s\" failed", deleted[i]);
+        }
         devmapper_device_info_ref_dec(device_info);
-        device_info = NULL;
 
-        if (do_delete_device(driver->devset, idsarray[i], false) != 0) {
-            WARN("devmapper:Deletion of device: \"%s\" failed", idsarray[i]);
+        (void)pthread_rwlock_unlock(&devset->devmapper_driver_rwlock);
+        device_lock_release(devset, deleted[i], lock);
+    }
+
+    util_free_array(deleted);
+}
+
+// spare devices are snapshots of base taken ahead of time, they are handed over to new first layers by rename
+static int create_spare_device(struct device_set *devset)
+{
+    int ret = -1;
+    int nret = 0;
+    char random[SPARE_DEVICE_RANDOM_LEN + 1] = { 0 };
+    char hash[sizeof(SPARE_DEVICE_PREFIX) + SPARE_DEVICE_RANDOM_LEN] = { 0 };
+    devmapper_device_info_t *base_info = NULL;
+
+    if (util_generate_random_str(random, SPARE_DEVICE_RANDOM_LEN) != 0) {
+        ERROR("devmapper: generate spare device hash failed");
+        return -1;
+    }
+
+    nret = snprintf(hash, sizeof(hash), "%s%s", SPARE_DEVICE_PREFIX, random);
+    if (nret < 0 || (size_t)nret >= sizeof(hash)) {
+        ERROR("devmapper: sprintf spare device hash failed");
+        return -1;
+    }
+
+    base_info = lookup_device(devset, "base");
+    if (base_info == NULL) {
+        ERROR("devmapper: lookup base device failed");
+        return -1;
+    }
+
+    if (take_snapshot(devset, hash, base_info->info, base_info->info->size) != 0) {
+        ERROR("devmapper: create spare device %s failed", hash);
+        goto out;
+    }
+
+    if (util_array_append(&devset->spare_hashes, hash) != 0) {
+        ERROR("Out of memory");
+        // it is loaded as spare again on next start
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    devmapper_device_info_ref_dec(base_info);
+    return ret;
+}
+
+static int drop_spare_device(struct device_set *devset)
+{
+    int ret = 0;
+    size_t len = util_array_len((const char **)devset->spare_hashes);
+    char *hash = devset->spare_hashes[len - 1];
+    devmapper_device_info_t *device_info = NULL;
+
+    devset->spare_hashes[len - 1] = NULL;
+    device_info = lookup_device(devset, hash);
+    // deleted by cleanup_deleted_devices later
+    if (device_info != NULL && mark_for_deferred_deletion(devset, device_info->info) != 0) {
+        ERROR("devmapper: mark spare device %s deleted failed", hash);
+        ret = -1;
+    }
+
+    devmapper_device_info_ref_dec(device_info);
+    free(hash);
+    return ret;
+}
+
+static void refill_spare_devices(struct device_set *devset)
+{
+    bool done = false;
+
+    while (!done) {
+        size_t len = 0;
+
+        // one device each time, so adding devices is not held off for long
+        if (pthread_rwlock_wrlock(&devset->devmapper_driver_rwlock) != 0) {
+            ERROR("lock devmapper conf failed");
+            return;
         }
+
+        len = util_array_len((const char **)devset->spare_hashes);
+        if (len == devset->spare_devices) {
+            done = true;
+        } else if (len > devset->spare_devices) {
+            done = (drop_spare_device(devset) != 0);
+        } else {
+            done = (create_spare_device(devset) != 0);
+        }
+
+        (void)pthread_rwlock_unlock(&devset->devmapper_driver_rwlock);
     }
+}
 
-unlock_devset:
-    if (pthread_rwlock_unlock(&(driver->devset->devmapper_driver_rwlock)) != 0) {
-        ERROR("unlock devmapper conf failed");
+// give a spare device to hash, it only renames the device in metadata, no pool message is needed.
+// rename of the metadata file is the single commit point, the content is rewritten afterwards
+static int claim_spare_device(struct device_set *devset, const char *hash, uint64_t size)
+{
+    int ret = -1;
+    size_t len = util_array_len((const char **)devset->spare_hashes);
+    char *spare_hash = NULL;
+    char *spare_file = NULL;
+    char *hash_file = NULL;
+    devmapper_device_info_t *spare_info = NULL;
+
+    if (len == 0) {
+        return -1;
+    }
+
+    spare_hash = devset->spare_hashes[len - 1];
+    devset->spare_hashes[len - 1] = NULL;
+
+    spare_info = lookup_device(devset, spare_hash);
+    if (spare_info == NULL || spare_info->info->deleted) {
+        WARN("devmapper: spare device %s is not usable", spare_hash);
+        goto out;
+    }
+
+    spare_file = metadata_file(devset, spare_hash);
+    hash_file = metadata_file(devset, hash);
+    if (spare_file == NULL || hash_file == NULL) {
+        ERROR("devmapper: get metadata file of spare device %s failed", spare_hash);
+        goto keep_spare;
     }
 
-unlock_driver:
-    if (pthread_rwlock_unlock(&(driver->rwlock)) != 0) {
-        ERROR("unlock driver failed");
+    // a crash after this leaves the spare hash in the file of hash, load_metadata takes the file name
+    if (rename(spare_file, hash_file) != 0) {
+        SYSERROR("devmapper: rename metadata of spare device %s to %s failed", spare_hash, hash);
+        goto keep_spare;
     }
 
-    util_free_array_by_len(idsarray, ids_len);
+    if (register_device(devset, spare_info->info->device_id, hash, size, spare_info->info->transaction_id) == NULL) {
+        ERROR("devmapper: register device %s from spare device %s failed", hash, spare_hash);
+        if (rename(hash_file, spare_file) != 0) {
+            // the device is owned by hash on next start and removed with the unfinished layer
+            SYSERROR("devmapper: give metadata back to spare device %s failed", spare_hash);
+            (void)metadata_store_remove(spare_hash, devset->meta_store);
+            goto out;
+        }
+        goto keep_spare;
+    }
+
+    if (!metadata_store_remove(spare_hash, devset->meta_store)) {
+        WARN("devmapper: remove metadata store of spare device %s failed", spare_hash);
+    }
+
+    DEBUG("devmapper: device %s takes over spare device %s", hash, spare_hash);
+    ret = 0;
+    goto out;
+
+keep_spare:
+    if (util_array_append(&devset->spare_hashes, spare_hash) != 0) {
+        ERROR("Out of memory");
+    }
+
+out:
+    devmapper_device_info_ref_dec(spare_info);
+    free(spare_hash);
+    free(spare_file);
+    free(hash_file);
+    return ret;
 }
 
-static void *cleanup_devices_cb(void *arg)
+static void *devset_worker(void *arg)
 {
-    struct graphdriver *driver = (struct graphdriver *)arg;
+    struct device_set *devset = (struct device_set *)arg;
 
-    if (pthread_detach(pthread_self()) != 0) {
-        ERROR("cleanup_deleted_devices: set thread detach failed");
-        return NULL;
+    prctl(PR_SET_NAME, "DevmapperWorker");
+
+    (void)pthread_mutex_lock(&devset->worker_mutex);
+    while (!devset->worker_stop) {
+        struct timespec deadline = { 0 };
+
+        devset->worker_kicked = false;
+        (void)pthread_mutex_unlock(&devset->worker_mutex);
+
+        deactivate_pending_devices(devset);
+        cleanup_deleted_devices(devset);
+        refill_spare_devices(devset);
+
+        (void)pthread_mutex_lock(&devset->worker_mutex);
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += CLEANUP_INTERVAL_SECONDS;
+        while (!devset->worker_kicked && !devset->worker_stop) {
+            if (pthread_cond_timedwait(&devset->worker_cond, &devset->worker_mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
     }
+    (void)pthread_mutex_unlock(&devset->worker_mutex);
 
-    if (driver == NULL) {
-        ERROR("cleanup_deleted_devices: invalid input param");
-        return NULL;
+    return NULL;
+}
+
+static int start_devset_worker(struct device_set *devset)
+{
+    int nret = 0;
+
+    devset->worker_stop = false;
+    // deleted devices left by last run are cleaned up at once
+    devset->worker_kicked = true;
+    nret = pthread_create(&devset->worker, NULL, devset_worker, devset);
+    if (nret != 0) {
+        errno = nret;
+        SYSERROR("devmapper: create worker thread failed");
+        return -1;
     }
+    devset->worker_running = true;
+
+    return 0;
+}
 
-    while (true) {
-        cleanup_deleted_devices(driver);
-        sleep(CLEANUP_INTERVAL_SECONDS);
+static void stop_devset_worker(struct device_set *devset)
+{
+    if (!devset->worker_running) {
+        return;
     }
+
+    (void)pthread_mutex_lock(&devset->worker_mutex);
+    devset->worker_stop = true;
+    (void)pthread_cond_signal(&devset->worker_cond);
+    (void)pthread_mutex_unlock(&devset->worker_mutex);
+
+    (void)pthread_join(devset->worker, NULL);
+    devset->worker_running = false;
 }
 
 static int init_metadata(struct device_set *devset, const char *pool_name)
@@ -2853,6 +3277,21 @@ static int devmapper_init_devset(const char *driver_home, const char **options,
         goto out;
     }
 
+    devset->device_locks = map_new(MAP_STR_PTR, MAP_DEFAULT_CMP_FUNC, device_lock_kvfree);
+    devset->pending_deactivation = map_new(MAP_STR_BOOL, MAP_DEFAULT_CMP_FUNC, MAP_DEFAULT_FREE_FUNC);
+    if (devset->device_locks == NULL || devset->pending_deactivation == NULL) {
+        ERROR("devmapper: failed to allocate device lock maps");
+        ret = -1;
+        goto out;
+    }
+
+    if (pthread_mutex_init(&devset->device_locks_mutex, NULL) != 0 ||
+        pthread_mutex_init(&devset->worker_mutex, NULL) != 0 || pthread_cond_init(&devset->worker_cond, NULL) != 0) {
+        ERROR("Failed to init devmapper worker locks");
+        ret = -1;
+        goto out;
+    }
+
 out:
     return ret;
 }
@@ -2860,7 +3299,6 @@ out:
 int device_set_init(struct graphdriver *driver, const char *driver_home, const char **options, size_t len)
 {
     int ret = 0;
-    pthread_t thread = 0;
 
     if (driver == NULL || driver_home == NULL || options == NULL) {
         ERROR("Invalid input params");
@@ -2888,8 +3326,8 @@ int device_set_init(struct graphdriver *driver, const char *driver_home, const c
         goto out;
     }
 
-    if (pthread_create(&thread, NULL, cleanup_devices_cb, driver) != 0) {
-        ERROR("devmapper: cleanup deleted devices thread failed");
+    if (start_devset_worker(driver->devset) != 0) {
+        ERROR("devmapper: start worker failed");
         ret = -1;
         goto out;
     }
@@ -2960,24 +3398,14 @@ static int grow_device_fs(struct device_set *devset, const char *hash, uint64_t
     return ret;
 }
 
-int add_device(const char *hash, const char *base_hash, struct device_set *devset,
-               const json_map_string_string *storage_opts)
+static int create_snapshot_device(struct device_set *devset, const char *hash, const char *base_hash,
+                                  const json_map_string_string *storage_opts, uint64_t *base_size, bool *spare_claimed)
 {
     int ret = 0;
     devmapper_device_info_t *base_device_info = NULL;
     devmapper_device_info_t *device_info = NULL;
     uint64_t size = 0;
 
-    if (devset == NULL || hash == NULL) {
-        ERROR("devmapper: invalid input params to add device");
-        return -1;
-    }
-
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
-        ERROR("lock devmapper conf failed");
-        return -1;
-    }
-
     base_device_info = lookup_device(devset, util_valid_str(base_hash) ? base_hash : "base");
     if (base_device_info == NULL) {
         ERROR("Lookup device %s failed, not found", util_valid_str(base_hash) ? base_hash : "base");
@@ -2992,7 +3420,14 @@ int add_device(const char *hash, const char *base_hash, struct device_set *devse
     }
 
     device_info = lookup_device(devset, hash);
-    if (device_info != NULL) {
+    if (device_info != NULL && device_info->info->deleted) {
+        // removed in deferred mode and not cleaned up yet, finish it now so the hash can be used again
+        if (do_delete_device(devset, hash, true) != 0) {
+            ERROR("devmapper: remove deleted device %s failed", hash);
+            ret = -1;
+            goto free_out;
+        }
+    } else if (device_info != NULL) {
         ERROR("devmapper: device %s already exists", hash);
         ret = -1;
         goto free_out;
@@ -3015,17 +3450,13 @@ int add_device(const char *hash, const char *base_hash, struct device_set *devse
         goto free_out;
     }
 
-    if (take_snapshot(devset, hash, base_device_info->info, size) != 0) {
-        ret = -1;
+    *base_size = base_device_info->info->size;
+    if (strcmp(base_device_info->info->hash, "base") == 0 && claim_spare_device(devset, hash, size) == 0) {
+        *spare_claimed = true;
         goto free_out;
     }
 
-    if (grow_device_fs(devset, hash, size, base_device_info->info->size) != 0) {
-        ERROR("Grow new deivce fs failed");
-        // Here, we need to delete device directly instead of deferred deleting, so that we can retry to add device with the same hash successfully.
-        if (do_delete_device(devset, hash, true) != 0) {
-            ERROR("devmapper: remove new snapshot device failed");
-        }
+    if (take_snapshot(devset, hash, base_device_info->info, size) != 0) {
         ret = -1;
         goto free_out;
     }
@@ -3033,9 +3464,76 @@ int add_device(const char *hash, const char *base_hash, struct device_set *devse
 free_out:
     devmapper_device_info_ref_dec(base_device_info);
     devmapper_device_info_ref_dec(device_info);
+    return ret;
+}
+
+int add_device(const char *hash, const char *base_hash, struct device_set *devset,
+               const json_map_string_string *storage_opts)
+{
+    int ret = 0;
+    uint64_t base_size = 0;
+    bool spare_claimed = false;
+    struct device_lock *lock = NULL;
+    devmapper_device_info_t *device_info = NULL;
+
+    if (devset == NULL || hash == NULL) {
+        ERROR("devmapper: invalid input params to add device");
+        return -1;
+    }
+
+    lock = device_lock_acquire(devset, hash);
+    if (lock == NULL) {
+        return -1;
+    }
+
+    // snapshot is a pool transaction, only this part is serialized with other devices
+    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+        ERROR("lock devmapper conf failed");
+        ret = -1;
+        goto release;
+    }
+    ret = create_snapshot_device(devset, hash, base_hash, storage_opts, &base_size, &spare_claimed);
     if (pthread_rwlock_unlock(&devset->devmapper_driver_rwlock)) {
         ERROR("unlock devmapper conf failed");
     }
+    if (ret != 0) {
+        goto release;
+    }
+
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
+        ERROR("lock devmapper conf failed");
+        ret = -1;
+        goto release;
+    }
+    device_info = lookup_device(devset, hash);
+    if (device_info != NULL) {
+        ret = grow_device_fs(devset, hash, device_info->info->size, base_size);
+    }
+    devmapper_device_info_ref_dec(device_info);
+    if (pthread_rwlock_unlock(&devset->devmapper_driver_rwlock)) {
+        ERROR("unlock devmapper conf failed");
+    }
+
+    if (ret != 0) {
+        ERROR("Grow new deivce fs failed");
+        if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+            ERROR("lock devmapper conf failed");
+            goto release;
+        }
+        // Here, we need to delete device directly instead of deferred deleting, so that we can retry to add device with the same hash successfully.
+        if (do_delete_device(devset, hash, true) != 0) {
+            ERROR("devmapper: remove new snapshot device failed");
+        }
+        if (pthread_rwlock_unlock(&devset->devmapper_driver_rwlock)) {
+            ERROR("unlock devmapper conf failed");
+        }
+    }
+
+release:
+    device_lock_release(devset, hash, lock);
+    if (spare_claimed) {
+        kick_worker(devset);
+    }
     return ret;
 }
 
@@ -3074,14 +3572,22 @@ int mount_device(const char *hash, const char *path, const struct driver_mount_o
     devmapper_device_info_t *device_info = NULL;
     char *dev_fname = NULL;
     char *options = NULL;
+    struct device_lock *lock = NULL;
 
     if (hash == NULL || path == NULL || devset == NULL) {
         ERROR("devmapper: invalid input params to mount device");
         return -1;
     }
 
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+    lock = device_lock_acquire(devset, hash);
+    if (lock == NULL) {
+        return -1;
+    }
+
+    // activating and mounting only touch this device, device lock is enough
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
+        device_lock_release(devset, hash, lock);
         return -1;
     }
 
@@ -3123,6 +3629,7 @@ free_out:
         ERROR("unlock devmapper conf failed");
         ret = -1;
     }
+    device_lock_release(devset, hash, lock);
     free(dev_fname);
     free(options);
     return ret;
@@ -3133,14 +3640,21 @@ int unmount_device(const char *hash, const char *mount_path, struct device_set *
 {
     int ret = 0;
     devmapper_device_info_t *device_info = NULL;
+    struct device_lock *lock = NULL;
 
     if (hash == NULL || mount_path == NULL || devset == NULL) {
         ERROR("devmapper: invalid input params to unmount device");
         return -1;
     }
 
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+    lock = device_lock_acquire(devset, hash);
+    if (lock == NULL) {
+        return -1;
+    }
+
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
+        device_lock_release(devset, hash, lock);
         return -1;
     }
 
@@ -3157,11 +3671,8 @@ int unmount_device(const char *hash, const char *mount_path, struct device_set *
         goto free_out;
     }
 
-    if (deactivate_device(devset, device_info->info) != 0) {
-        ERROR("devmapper: Error deactivating device");
-        ret = -1;
-        goto free_out;
-    }
+    // deactivation waits for udev, leave it to the worker; it is skipped if device is mounted again
+    queue_deactivation(devset, hash);
 
 free_out:
     devmapper_device_info_ref_dec(device_info);
@@ -3169,6 +3680,7 @@ free_out:
         ERROR("unlock devmapper conf failed");
         ret = -1;
     }
+    device_lock_release(devset, hash, lock);
     return ret;
 }
 
@@ -3182,7 +3694,7 @@ bool has_device(const char *hash, struct device_set *devset)
         return false;
     }
 
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
         return false;
     }
@@ -3193,7 +3705,8 @@ bool has_device(const char *hash, struct device_set *devset)
         goto free_out;
     }
 
-    res = true;
+    // marked for deferred deletion, it is gone for callers
+    res = !device_info->info->deleted;
 
 free_out:
     devmapper_device_info_ref_dec(device_info);
@@ -3204,28 +3717,57 @@ free_out:
 int delete_device(const char *hash, bool sync_delete, struct device_set *devset)
 {
     int ret = 0;
+    struct device_lock *lock = NULL;
+    devmapper_device_info_t *device_info = NULL;
 
     if (devset == NULL || hash == NULL) {
         ERROR("Invalid input params");
         return -1;
     }
 
+    lock = device_lock_acquire(devset, hash);
+    if (lock == NULL) {
+        return -1;
+    }
+
     if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
+        device_lock_release(devset, hash, lock);
         return -1;
     }
 
-    if (do_delete_device(devset, hash, sync_delete) != 0) {
-        ERROR("devmapper: do delete device: \"%s\" failed", hash);
+    if (sync_delete) {
+        if (do_delete_device(devset, hash, true) != 0) {
+            ERROR("devmapper: do delete device: \"%s\" failed", hash);
+            ret = -1;
+        }
+        goto free_out;
+    }
+
+    device_info = lookup_device(devset, hash);
+    if (device_info == NULL) {
+        ERROR("Delete device error with lookuping device with hash(%s) failed", hash);
+        ret = -1;
+        goto free_out;
+    }
+
+    // deactivating and deleting thin device are done by the worker
+    if (mark_for_deferred_deletion(devset, device_info->info) != 0) {
+        ERROR("devmapper: mark device with hash:%s deferred deletion failed", hash);
         ret = -1;
         goto free_out;
     }
 
 free_out:
+    devmapper_device_info_ref_dec(device_info);
     if (pthread_rwlock_unlock(&devset->devmapper_driver_rwlock)) {
         ERROR("unlock devmapper conf failed");
         ret = -1;
     }
+    device_lock_release(devset, hash, lock);
+    if (ret == 0 && !sync_delete) {
+        kick_worker(devset);
+    }
     return ret;
 }
 
@@ -3240,7 +3782,7 @@ int export_device_metadata(struct device_metadata *dev_metadata, const char *has
         return -1;
     }
 
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
         return -1;
     }
@@ -3303,7 +3845,7 @@ struct status *device_set_status(struct device_set *devset)
         return NULL;
     }
 
-    if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
+    if (pthread_rwlock_rdlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
         return NULL;
     }
@@ -3459,6 +4001,9 @@ int device_set_shutdown(struct device_set *devset, const char *home)
         return -1;
     }
 
+    // pending deactivations are covered by umount_deactivate_dev_all, deleted devices are cleaned up on next start
+    stop_devset_worker(devset);
+
     if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
         return -1;
@@ -3491,6 +4036,8 @@ int free_deviceset_with_lock(struct device_set *devset)
         return 0;
     }
 
+    stop_devset_worker(devset);
+
     if (pthread_rwlock_wrlock(&(devset->devmapper_driver_rwlock)) != 0) {
         ERROR("lock devmapper conf failed");
         return -1;
@@ -3512,6 +4059,12 @@ int free_deviceset_with_lock(struct device_set *devset)
     devset->metadata_trans = NULL;
     UTIL_FREE_AND_SET_NULL(devset->base_device_uuid);
     UTIL_FREE_AND_SET_NULL(devset->base_device_filesystem);
+    map_free(devset->device_locks);
+    devset->device_locks = NULL;
+    map_free(devset->pending_deactivation);
+    devset->pending_deactivation = NULL;
+    util_free_array(devset->spare_hashes);
+    devset->spare_hashes = NULL;
 
     free(devset);
 
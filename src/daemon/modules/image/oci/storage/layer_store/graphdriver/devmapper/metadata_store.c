@@ -74,6 +74,7 @@ void metadata_store_free(metadata_store_t *store)
     }
     map_free(store->map);
     store->map = NULL;
+    (void)pthread_mutex_destroy(&store->mutex);
     free(store);
 }
 
@@ -86,6 +87,11 @@ metadata_store_t *metadata_store_new(void)
         ERROR("Out of memory");
         return NULL;
     }
+    if (pthread_mutex_init(&store->mutex, NULL) != 0) {
+        ERROR("Failed to init metadata store mutex");
+        free(store);
+        return NULL;
+    }
     store->map = map_new(MAP_STR_PTR, MAP_DEFAULT_CMP_FUNC, metadata_store_map_kvfree);
     if (store->map == NULL) {
         ERROR("Out of memory");
@@ -151,10 +157,13 @@ bool metadata_store_add(const char *hash, image_devmapper_device_info *device, m
         goto out;
     }
 
+    (void)pthread_mutex_lock(&meta_store->mutex);
     if (!map_replace(meta_store->map, (void *)hash, (void *)device_info)) {
+        (void)pthread_mutex_unlock(&meta_store->mutex);
         ERROR("Failed to insert device %s to meta store", hash);
         goto out;
     }
+    (void)pthread_mutex_unlock(&meta_store->mutex);
 
     ret = true;
 out:
@@ -173,26 +182,31 @@ devmapper_device_info_t *metadata_store_get(const char *hash, metadata_store_t *
         return NULL;
     }
 
+    (void)pthread_mutex_lock(&meta_store->mutex);
     value = map_search(meta_store->map, (void *)hash);
     if (value != NULL) {
-        goto found;
+        // take the reference before a concurrent remove may drop the last one of the map
+        devmapper_device_info_ref_inc(value);
     }
+    (void)pthread_mutex_unlock(&meta_store->mutex);
 
-    return NULL;
-
-found:
-    devmapper_device_info_ref_inc(value);
     return value;
 }
 
 bool metadata_store_remove(const char *hash, metadata_store_t *meta_store)
 {
+    bool ret = false;
+
     if (hash == NULL || meta_store == NULL) {
         ERROR("Invalid input parameter, id is NULL");
         return false;
     }
 
-    return map_remove(meta_store->map, (void *)hash);
+    (void)pthread_mutex_lock(&meta_store->mutex);
+    ret = map_remove(meta_store->map, (void *)hash);
+    (void)pthread_mutex_unlock(&meta_store->mutex);
+
+    return ret;
 }
 
 char **metadata_store_list_hashes(metadata_store_t *meta_store)
@@ -205,6 +219,7 @@ char **metadata_store_list_hashes(metadata_store_t *meta_store)
         return NULL;
     }
 
+    (void)pthread_mutex_lock(&meta_store->mutex);
     if (map_size(meta_store->map) == 0) {
         DEBUG("Metadata store hash list is empty");
         ret = true;
@@ -227,6 +242,7 @@ char **metadata_store_list_hashes(metadata_store_t *meta_store)
     ret = true;
 unlock:
     map_itor_free(itor);
+    (void)pthread_mutex_unlock(&meta_store->mutex);
     if (!ret) {
         util_free_array(hashes_array);
         hashes_array = NULL;
@@ -23,6 +23,7 @@
 #include <dirent.h>
 #include <sys/mount.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <strings.h>
 
@@ -39,12 +40,14 @@
 #include "image_api.h"
 #include "utils_array.h"
 #include "utils_convert.h"
+#include "utils_dir_size.h"
 #include "utils_file.h"
 #include "utils_fs.h"
 #include "utils_string.h"
 #include "utils_timestamp.h"
 #include "selinux_label.h"
 #include "err_msg.h"
+#include "trash_reaper.h"
 #include "isulad_config.h"
 #ifdef ENABLE_REMOTE_LAYER_STORE
 #include "ro_symlink_maintain.h"
@@ -59,17 +62,52 @@ struct io_read_wrapper;
 #define OVERLAY_LAYER_LOWER "lower"
 #define OVERLAY_LAYER_LINK "link"
 #define OVERLAY_LAYER_EMPTY "empty"
+// marker of layers with volatile upper, holds boot id of the last volatile mount
+#define OVERLAY_LAYER_VOLATILE "volatile"
+// created by kernel in workdir on volatile mount, later mounts fail until it is removed
+#define OVERLAY_VOLATILE_INCOMPAT "work/work/incompat/volatile"
+#define OVERLAY_VOLATILE_OPTION "volatile"
+#define OVERLAY_VOLATILE_CHECK_DIR "volatile-check"
+#define BOOT_ID_PATH "/proc/sys/kernel/random/boot_id"
+// marker of layers living on tmpfs, holds tmpfs size in bytes
+#define OVERLAY_LAYER_TMPFS "tmpfs"
 
 #define OVERLAY_LAYER_MAX_DEPTH 128
 
+// cri stats walks diff dirs of all containers, keep most cpus for the workload
+#define OVERLAY_LAYER_USAGE_MAX_WORKERS 4
+
 #define QUOTA_SIZE_OPTION "overlay2.size"
 #define QUOTA_BASESIZE_OPTIONS "overlay2.basesize"
+// assign project id to layers without size limit, so their usage can be read from quota
+#define QUOTA_ACCOUNTING_OPTION "overlay2.quota_accounting"
 // MAX_LAYER_ID_LENGTH represents the number of random characters which can be used to create the unique link identifer
 // for every layer. If this value is too long then the page size limit for the mount command may be exceeded.
 // The idLength should be selected such that following equation is true (512 is a buffer for label metadata).
 // ((idLength + len(linkDir) + 1) * maxDepth) <= (pageSize - 512)
 #define MAX_LAYER_ID_LENGTH 26
 
+// set when kernel lacks fsopen or the lowerdir+ parameter (before 6.8), then mount(2) is used directly
+static bool g_fsmount_unsupported = false;
+
+// 0 if not checked yet, 1 if overlay accepts the volatile option, -1 if not
+static int g_volatile_support = 0;
+static pthread_mutex_t g_volatile_check_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void discard_dirty_volatile_layers(const char *driver_home);
+
+#ifdef ENABLE_USERNS_REMAP
+#define OVERLAY_IDMAP_CHECK_DIR "idmap-check"
+// idmapped clones of the layer dir and its lowers, laid out as driver home: <id> and l/<link id>
+#define OVERLAY_LAYER_IDMAPPED "idmapped"
+// user namespace of userns-remap, valid only if overlay can be mounted over layers idmapped with it.
+// layer directories are not chowned for remap then, layers are idmapped at mount time instead
+static int g_idmap_userns_fd = -1;
+// remapped root, overlay is mounted with it as fsuid/fsgid so its writes map through the idmapped upper
+static uid_t g_idmap_uid = 0;
+static gid_t g_idmap_gid = 0;
+#endif
+
 void free_driver_create_opts(struct driver_create_opts *opts)
 {
     if (opts == NULL) {
@@ -170,8 +208,21 @@ static int overlay2_parse_options(struct graphdriver *driver, const char **optio
                 goto out;
             }
             overlay_opts->skip_mount_home = converted_bool;
+        } else if (strcasecmp(dup, QUOTA_ACCOUNTING_OPTION) == 0) {
+            bool converted_bool = 0;
+            ret = util_str_to_bool(val, &converted_bool);
+            if (ret != 0) {
+                errno = -ret;
+                SYSERROR("Invalid bool: '%s'", val);
+                ret = -1;
+                goto out;
+            }
+            overlay_opts->quota_accounting = converted_bool;
         } else if (strcasecmp(dup, "overlay2.mountopt") == 0) {
             overlay_opts->mount_options = util_strdup_s(val);
+        } else if (strcasecmp(dup, OVERLAY_VOLATILE_RUNTIMES_OPTION) == 0) {
+            // applied when containers are created, see conf_is_volatile_rootfs_runtime
+            DEBUG("Rootfs of runtimes %s are mounted volatile", val);
         } else {
             ERROR("Overlay2: unknown option: '%s'", dup);
             ret = -1;
@@ -327,10 +378,275 @@ out:
     return ret;
 }
 
+static int mount_check_overlay(const char *check_dir, const char *merged_dir, const char *extra_opts)
+{
+    int nret;
+    size_t i;
+    char path[PATH_MAX] = { 0 };
+    char mount_data[PATH_MAX * 3] = { 0 };
+    const char *sub_dirs[] = { "lower", "upper", "work", "merged" };
+
+    for (i = 0; i < sizeof(sub_dirs) / sizeof(sub_dirs[0]); i++) {
+        nret = snprintf(path, sizeof(path), "%s/%s", check_dir, sub_dirs[i]);
+        if (nret < 0 || (size_t)nret >= sizeof(path) || util_mkdir_p(path, 0700) != 0) {
+            ERROR("Failed to create %s in %s", sub_dirs[i], check_dir);
+            return -1;
+        }
+    }
+
+    nret = snprintf(mount_data, sizeof(mount_data), "lowerdir=%s/lower,upperdir=%s/upper,workdir=%s/work%s%s",
+                    check_dir, check_dir, check_dir, extra_opts != NULL ? "," : "", extra_opts != NULL ? extra_opts : "");
+    if (nret < 0 || (size_t)nret >= sizeof(mount_data)) {
+        ERROR("Failed to sprintf check mount data");
+        return -1;
+    }
+
+    if (mount("overlay", merged_dir, "overlay", 0, mount_data) != 0) {
+        SYSWARN("Failed to mount check overlay with \"%s\"", mount_data);
+        return -1;
+    }
+
+    return 0;
+}
+
+#ifdef ENABLE_USERNS_REMAP
+// overlay itself can not be idmapped, but since 5.19 it can be mounted over idmapped layers. try a real one,
+// a root owned lower file has to show up as the remapped root and the upper has to stay writable
+static bool overlay_support_idmapped_layers(const char *check_dir, int userns_fd, uid_t host_uid, gid_t host_gid)
+{
+    int nret;
+    size_t i;
+    bool support = false;
+    bool unsupported = false;
+    struct stat st = { 0 };
+    char path[PATH_MAX] = { 0 };
+    char src[PATH_MAX] = { 0 };
+    char merged_dir[PATH_MAX] = { 0 };
+    const char *sub_dirs[] = { "lower", "upper/diff", "upper/work", "idmapped/lower", "idmapped/upper", "merged" };
+    const char *staged[] = { "lower", "upper" };
+    const char *mount_data = "lowerdir=idmapped/lower,upperdir=idmapped/upper/diff,workdir=idmapped/upper/work";
+
+    for (i = 0; i < sizeof(sub_dirs) / sizeof(sub_dirs[0]); i++) {
+        nret = snprintf(path, sizeof(path), "%s/%s", check_dir, sub_dirs[i]);
+        if (nret < 0 || (size_t)nret >= sizeof(path) || util_mkdir_p(path, 0700) != 0) {
+            ERROR("Failed to create %s in %s", sub_dirs[i], check_dir);
+            return false;
+        }
+    }
+
+    nret = snprintf(path, sizeof(path), "%s/lower/file", check_dir);
+    if (nret < 0 || (size_t)nret >= sizeof(path) || util_write_file(path, "idmap", strlen("idmap"), 0600) != 0) {
+        ERROR("Failed to create idmap check file in %s", check_dir);
+        return false;
+    }
+
+    for (i = 0; i < sizeof(staged) / sizeof(staged[0]); i++) {
+        nret = snprintf(src, sizeof(src), "%s/%s", check_dir, staged[i]);
+        if (nret < 0 || (size_t)nret >= sizeof(src)) {
+            ERROR("Failed to sprintf idmap check dir");
+            goto out;
+        }
+        nret = snprintf(path, sizeof(path), "%s/idmapped/%s", check_dir, staged[i]);
+        if (nret < 0 || (size_t)nret >= sizeof(path)) {
+            ERROR("Failed to sprintf idmap check dir");
+            goto out;
+        }
+        if (util_idmap_bind(src, path, userns_fd, &unsupported) != 0) {
+            goto out;
+        }
+    }
+
+    nret = snprintf(merged_dir, sizeof(merged_dir), "%s/merged", check_dir);
+    if (nret < 0 || (size_t)nret >= sizeof(merged_dir)) {
+        ERROR("Failed to sprintf check merged dir");
+        goto out;
+    }
+    if (util_mount_from_as(check_dir, "overlay", merged_dir, "overlay", mount_data, host_uid, host_gid) != 0) {
+        WARN("Failed to mount check overlay over idmapped layers");
+        goto out;
+    }
+
+    nret = snprintf(path, sizeof(path), "%s/file", merged_dir);
+    if (nret < 0 || (size_t)nret >= sizeof(path) || stat(path, &st) != 0) {
+        SYSWARN("Failed to stat idmap check file");
+    } else if (st.st_uid != host_uid) {
+        WARN("Idmap check file is owned by %u, expect %u", (unsigned int)st.st_uid, (unsigned int)host_uid);
+    } else if (util_check_readonly_fs(merged_dir)) {
+        // overlay falls back to read only if it can not write its workdir through the idmap
+        WARN("Check overlay over idmapped layers is read only");
+    } else {
+        support = true;
+    }
+
+    if (umount2(merged_dir, MNT_DETACH) != 0) {
+        SYSWARN("Failed to umount %s", merged_dir);
+    }
+
+out:
+    for (i = 0; i < sizeof(staged) / sizeof(staged[0]); i++) {
+        nret = snprintf(path, sizeof(path), "%s/idmapped/%s", check_dir, staged[i]);
+        if (nret >= 0 && (size_t)nret < sizeof(path) && util_detect_mounted(path) && umount2(path, MNT_DETACH) != 0) {
+            SYSWARN("Failed to umount %s", path);
+        }
+    }
+    return support;
+}
+
+static void driver_init_idmap(const char *driver_home)
+{
+    uid_t host_uid = 0;
+    gid_t host_gid = 0;
+    unsigned int size = 0;
+    char *userns_remap = conf_get_isulad_userns_remap();
+    char *check_dir = NULL;
+    int userns_fd = -1;
+
+    if (userns_remap == NULL) {
+        return;
+    }
+
+    if (util_parse_user_remap(userns_remap, &host_uid, &host_gid, &size) != 0) {
+        ERROR("Failed to split string '%s'.", userns_remap);
+        goto out;
+    }
+
+    userns_fd = util_create_userns_fd(host_uid, host_gid, size);
+    if (userns_fd < 0) {
+        goto out;
+    }
+
+    check_dir = util_path_join(driver_home, OVERLAY_IDMAP_CHECK_DIR);
+    if (check_dir == NULL) {
+        ERROR("Failed to join idmap check dir");
+        goto out;
+    }
+    (void)util_recursive_rmdir(check_dir, 0);
+    if (overlay_support_idmapped_layers(check_dir, userns_fd, host_uid, host_gid)) {
+        g_idmap_userns_fd = userns_fd;
+        g_idmap_uid = host_uid;
+        g_idmap_gid = host_gid;
+        userns_fd = -1;
+    }
+
+out:
+    if (g_idmap_userns_fd < 0) {
+        WARN("Overlay over idmapped layers is not supported, chown layer directories for user remap");
+    }
+    if (check_dir != NULL) {
+        (void)util_recursive_rmdir(check_dir, 0);
+    }
+    if (userns_fd >= 0) {
+        close(userns_fd);
+    }
+    free(check_dir);
+    free(userns_remap);
+}
+
+// layers created while chown was used have their diff owned by the remapped root, they keep working without idmap
+static bool layer_need_idmap(const char *layer_dir)
+{
+    struct stat st = { 0 };
+    char *diff_dir = NULL;
+    bool need = false;
+
+    if (g_idmap_userns_fd < 0) {
+        return false;
+    }
+
+    diff_dir = util_path_join(layer_dir, OVERLAY_LAYER_DIFF);
+    if (diff_dir == NULL) {
+        ERROR("Failed to join layer diff dir:%s", layer_dir);
+        return false;
+    }
+
+    if (stat(diff_dir, &st) != 0) {
+        SYSWARN("Failed to stat %s", diff_dir);
+    } else {
+        need = (st.st_uid == 0);
+    }
+
+    free(diff_dir);
+    return need;
+}
+
+static bool idmap_unstage_entry(const char *dir, const struct dirent *dirent, void *context)
+{
+    int nret;
+    bool *failed = (bool *)context;
+    char path[PATH_MAX] = { 0 };
+
+    nret = snprintf(path, sizeof(path), "%s/%s", dir, dirent->d_name);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to sprintf idmap stage path of %s", dirent->d_name);
+        *failed = true;
+        return true;
+    }
+
+    if (dirent->d_type == DT_LNK) {
+        if (unlink(path) != 0) {
+            SYSERROR("Failed to remove %s", path);
+            *failed = true;
+        }
+        return true;
+    }
+
+    if (umount2(path, MNT_DETACH) != 0 && errno != EINVAL) {
+        SYSERROR("Failed to umount %s", path);
+        *failed = true;
+        return true;
+    }
+
+    // never removed recursively, a stage dir still mounted would lead into the layer contents
+    if (rmdir(path) != 0) {
+        SYSERROR("Failed to remove %s", path);
+        *failed = true;
+    }
+    return true;
+}
+
+static int idmap_unstage_layer(const char *layer_dir)
+{
+    int ret = 0;
+    bool failed = false;
+    char *stage_dir = NULL;
+    char *link_dir = NULL;
+
+    stage_dir = util_path_join(layer_dir, OVERLAY_LAYER_IDMAPPED);
+    link_dir = util_path_join(stage_dir, OVERLAY_LINK_DIR);
+    if (stage_dir == NULL || link_dir == NULL) {
+        ERROR("Failed to join idmap stage dir of %s", layer_dir);
+        ret = -1;
+        goto out;
+    }
+
+    if (!util_dir_exists(stage_dir)) {
+        goto out;
+    }
+
+    // lowers first, then the emptied link dir and the layer clone
+    if ((util_dir_exists(link_dir) && util_scan_subdirs(link_dir, idmap_unstage_entry, &failed) != 0) ||
+        util_scan_subdirs(stage_dir, idmap_unstage_entry, &failed) != 0 || failed) {
+        ret = -1;
+        goto out;
+    }
+
+    if (rmdir(stage_dir) != 0) {
+        SYSERROR("Failed to remove %s", stage_dir);
+        ret = -1;
+    }
+
+out:
+    free(stage_dir);
+    free(link_dir);
+    return ret;
+}
+#endif
+
 int overlay2_init(struct graphdriver *driver, const char *driver_home, const char **options, size_t len)
 {
     int ret = 0;
     char *root_dir = NULL;
+    char *trash_dir = NULL;
 
     if (driver == NULL || driver_home == NULL) {
         ERROR("Invalid input arguments");
@@ -400,8 +716,23 @@ int overlay2_init(struct graphdriver *driver, const char *driver_home, const cha
         goto out;
     }
 
+#ifdef ENABLE_USERNS_REMAP
+    driver_init_idmap(driver_home);
+#endif
+
+    trash_dir = util_path_join(driver_home, TRASH_REAPER_DIR);
+    if (trash_dir == NULL || trash_reaper_init(trash_dir) != 0) {
+        WARN("Failed to start trash reaper, layers will be removed synchronously");
+    } else if (driver->support_quota && driver->quota_ctrl->clear_inherit(trash_dir) != 0) {
+        // layers with private project id are removed synchronously then
+        WARN("Failed to clear project inherit flag of trash dir %s", trash_dir);
+    }
+
+    discard_dirty_volatile_layers(driver_home);
+
 out:
     free(root_dir);
+    free(trash_dir);
     return ret;
 }
 
@@ -450,7 +781,7 @@ static int mk_diff_directory(const char *layer_dir)
     }
 
 #ifdef ENABLE_USERNS_REMAP
-    if (set_file_owner_for_userns_remap(diff_dir, userns_remap) != 0) {
+    if (g_idmap_userns_fd < 0 && set_file_owner_for_userns_remap(diff_dir, userns_remap) != 0) {
         ERROR("Unable to change directory %s owner for user remap.", diff_dir);
         ret = -1;
         goto out;
@@ -504,43 +835,84 @@ out:
     return ret;
 }
 
+static int write_layer_link(const char *layer_dir, const char *link_id)
+{
+    int ret = 0;
+    char *link_file = NULL;
+
+    link_file = util_path_join(layer_dir, OVERLAY_LAYER_LINK);
+    if (link_file == NULL) {
+        ERROR("Failed to get layer link file %s", layer_dir);
+        return -1;
+    }
+
+    ret = util_atomic_write_file(link_file, link_id, strlen(link_id), 0644, false);
+    if (ret) {
+        SYSERROR("Failed to write %s", link_file);
+        ret = -1;
+    }
+
+    free(link_file);
+    return ret;
+}
+
+static char *read_layer_link_file(const char *layer_dir)
+{
+    char *link_file = NULL;
+    char *link = NULL;
+
+    link_file = util_path_join(layer_dir, OVERLAY_LAYER_LINK);
+    if (link_file == NULL) {
+        ERROR("Failed to get link %s", layer_dir);
+        goto out;
+    }
+
+    link = util_read_text_file(link_file);
+out:
+    free(link_file);
+    return link;
+}
+
 static int mk_diff_symlink(const char *id, const char *layer_dir, const char *driver_home)
 {
     int ret = 0;
     char layer_id[MAX_LAYER_ID_LENGTH + 1] = { 0 };
-    char *link_file = NULL;
 
     ret = util_generate_random_str(layer_id, MAX_LAYER_ID_LENGTH);
     if (ret != 0) {
         ERROR("Failed to get layer symlink id %s", id);
-        ret = -1;
-        goto out;
+        return -1;
     }
 
     ret = do_diff_symlink(id, layer_id, driver_home);
     if (ret != 0) {
         ERROR("Failed to do symlink id %s", id);
-        ret = -1;
-        goto out;
+        return -1;
     }
 
-    link_file = util_path_join(layer_dir, OVERLAY_LAYER_LINK);
-    if (link_file == NULL) {
-        ERROR("Failed to get layer link file %s", layer_dir);
-        ret = -1;
-        goto out;
+    return write_layer_link(layer_dir, layer_id);
+}
+
+// keep the short link of a layer whose dir is made again, lower files of child layers refer to it
+static int reuse_diff_symlink(const char *id, const char *link_id, const char *layer_dir, const char *driver_home)
+{
+    int nret = 0;
+    char link_path[PATH_MAX] = { 0 };
+    struct stat st = { 0 };
+
+    nret = snprintf(link_path, PATH_MAX, "%s/%s/%s", driver_home, OVERLAY_LINK_DIR, link_id);
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        ERROR("Failed to get link path %s", link_id);
+        return -1;
     }
 
-    ret = util_atomic_write_file(link_file, layer_id, strlen(layer_id), 0644, false);
-    if (ret) {
-        SYSERROR("Failed to write %s", link_file);
-        ret = -1;
-        goto out;
+    // the symlink outlives the diff dir it points to, it is only missing if removed by hand
+    if (lstat(link_path, &st) != 0 && do_diff_symlink(id, (char *)link_id, driver_home) != 0) {
+        ERROR("Failed to do symlink id %s", id);
+        return -1;
     }
 
-out:
-    free(link_file);
-    return ret;
+    return write_layer_link(layer_dir, link_id);
 }
 
 static int mk_work_directory(const char *layer_dir)
@@ -565,7 +937,7 @@ static int mk_work_directory(const char *layer_dir)
     }
 
 #ifdef ENABLE_USERNS_REMAP
-    if (set_file_owner_for_userns_remap(work_dir, userns_remap) != 0) {
+    if (g_idmap_userns_fd < 0 && set_file_owner_for_userns_remap(work_dir, userns_remap) != 0) {
         ERROR("Unable to change directory %s owner for user remap.", work_dir);
         ret = -1;
         goto out;
@@ -602,7 +974,7 @@ static int mk_merged_directory(const char *layer_dir)
     }
 
 #ifdef ENABLE_USERNS_REMAP
-    if (set_file_owner_for_userns_remap(merged_dir, userns_remap) != 0) {
+    if (g_idmap_userns_fd < 0 && set_file_owner_for_userns_remap(merged_dir, userns_remap) != 0) {
         ERROR("Unable to change directory %s owner for user remap.", merged_dir);
         ret = -1;
         goto out;
@@ -640,55 +1012,395 @@ out:
     return ret;
 }
 
-const static int check_lower_depth(const char *lowers_str)
+static char *get_boot_id(void)
 {
-    int ret = 0;
-    char **lowers_arr = NULL;
-    size_t lowers_size = 0;
+    char *boot_id = NULL;
+    char *p = NULL;
 
-    lowers_arr = util_string_split(lowers_str, ':');
-    lowers_size = util_array_len((const char **)lowers_arr);
-    if (lowers_size > OVERLAY_LAYER_MAX_DEPTH) {
-        ERROR("Max depth exceeded %s", lowers_str);
-        ret = -1;
-        goto out;
+    boot_id = util_read_text_file(BOOT_ID_PATH);
+    if (boot_id == NULL) {
+        SYSERROR("Failed to read %s", BOOT_ID_PATH);
+        return NULL;
     }
 
-out:
-    util_free_array(lowers_arr);
-    return ret;
+    p = strchr(boot_id, '\n');
+    if (p != NULL) {
+        *p = '\0';
+    }
+
+    return boot_id;
 }
 
-static char *get_lower(const char *parent, const char *driver_home)
+// volatile, tmpfs and link files of a layer dir
+static bool layer_has_file(const char *layer_dir, const char *name)
 {
-    int nret = 0;
-    char *lower = NULL;
-    size_t lower_len = 0;
-    char *parent_dir = NULL;
-    char *parent_link_file = NULL;
-    char *parent_link = NULL;
-    char *parent_lower_file = NULL;
-    char *parent_lowers = NULL;
+    bool ret = false;
+    char *path = NULL;
 
-    parent_dir = util_path_join(driver_home, parent);
-    if (parent_dir == NULL) {
-        ERROR("Failed to get parent dir %s", parent);
-        goto out;
+    path = util_path_join(layer_dir, name);
+    if (path == NULL) {
+        ERROR("Failed to join layer file %s:%s", layer_dir, name);
+        return false;
     }
 
-    parent_link_file = util_path_join(parent_dir, OVERLAY_LAYER_LINK);
-    if (parent_link_file == NULL) {
-        ERROR("Failed to get parent link %s", parent_dir);
-        goto out;
-    }
+    ret = util_file_exists(path);
+    free(path);
+    return ret;
+}
 
-    parent_link = util_read_text_file(parent_link_file);
-    if (parent_link == NULL) {
-        ERROR("Failed to read parent link %s", parent_link_file);
-        goto out;
-    }
+static int get_volatile_storage_opt(const json_map_string_string *opts, bool *is_volatile)
+{
+    size_t i;
 
-    if (strlen(parent_link) >= (INT_MAX - strlen(OVERLAY_LINK_DIR) - 2)) {
+    *is_volatile = false;
+    for (i = 0; opts != NULL && i < opts->len; i++) {
+        if (strcasecmp(STORAGE_OPT_VOLATILE, opts->keys[i]) != 0) {
+            continue;
+        }
+        if (util_str_to_bool(opts->values[i], is_volatile) != 0) {
+            ERROR("Invalid volatile storage option: '%s'", opts->values[i]);
+            isulad_set_error_message("Invalid volatile storage option: '%s'", opts->values[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// volatile and tmpfs_size change how the upper is placed and mounted, others are quota options
+static bool is_upper_storage_opt(const char *key)
+{
+    return strcasecmp(STORAGE_OPT_VOLATILE, key) == 0 || strcasecmp(STORAGE_OPT_TMPFS_SIZE, key) == 0;
+}
+
+static bool has_quota_storage_opt(const json_map_string_string *opts)
+{
+    size_t i;
+
+    for (i = 0; opts != NULL && i < opts->len; i++) {
+        if (!is_upper_storage_opt(opts->keys[i])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int write_volatile_marker(const char *layer_dir, const char *boot_id)
+{
+    int ret = 0;
+    char *marker = NULL;
+
+    marker = util_path_join(layer_dir, OVERLAY_LAYER_VOLATILE);
+    if (marker == NULL) {
+        ERROR("Failed to join layer volatile file:%s", layer_dir);
+        return -1;
+    }
+
+    if (util_atomic_write_file(marker, boot_id, strlen(boot_id), 0600, false) != 0) {
+        SYSERROR("Failed to write %s", marker);
+        ret = -1;
+    }
+
+    free(marker);
+    return ret;
+}
+
+// the upper is left half written if the host went down while it was mounted volatile, start over with an empty one
+static int reset_volatile_upper(const char *layer_dir)
+{
+    int ret = 0;
+    char *diff_dir = NULL;
+    char *work_dir = NULL;
+
+    diff_dir = util_path_join(layer_dir, OVERLAY_LAYER_DIFF);
+    work_dir = util_path_join(layer_dir, OVERLAY_LAYER_WORK);
+    if (diff_dir == NULL || work_dir == NULL) {
+        ERROR("Failed to join layer upper dirs:%s", layer_dir);
+        ret = -1;
+        goto out;
+    }
+
+    WARN("Volatile layer %s was mounted when host went down, discard its upper", layer_dir);
+
+    if (trash_reaper_remove(diff_dir) != 0 || trash_reaper_remove(work_dir) != 0) {
+        ERROR("Failed to remove upper of volatile layer %s", layer_dir);
+        ret = -1;
+        goto out;
+    }
+
+    if (mk_diff_directory(layer_dir) != 0 || mk_work_directory(layer_dir) != 0) {
+        ret = -1;
+        goto out;
+    }
+
+out:
+    free(diff_dir);
+    free(work_dir);
+    return ret;
+}
+
+// the kernel leaves incompat/volatile in workdir once the upper was mounted volatile. if it is still there
+// after reboot, the upper is dirty. in the same boot only isulad went away, page cache is intact and the
+// dir is just removed before mounting again when remove_stale is set.
+static int check_volatile_upper(const char *layer_dir, const char *boot_id, bool remove_stale)
+{
+    int ret = 0;
+    char *incompat = NULL;
+    char *marker = NULL;
+    char *last_boot_id = NULL;
+    char *p = NULL;
+
+    incompat = util_path_join(layer_dir, OVERLAY_VOLATILE_INCOMPAT);
+    marker = util_path_join(layer_dir, OVERLAY_LAYER_VOLATILE);
+    if (incompat == NULL || marker == NULL) {
+        ERROR("Failed to join layer volatile path:%s", layer_dir);
+        ret = -1;
+        goto out;
+    }
+
+    if (!util_dir_exists(incompat)) {
+        goto out;
+    }
+
+    last_boot_id = util_read_text_file(marker);
+    if (last_boot_id != NULL) {
+        p = strchr(last_boot_id, '\n');
+        if (p != NULL) {
+            *p = '\0';
+        }
+    }
+
+    if (last_boot_id == NULL || strcmp(last_boot_id, boot_id) != 0) {
+        ret = reset_volatile_upper(layer_dir);
+        goto out;
+    }
+
+    if (remove_stale && util_recursive_rmdir(incompat, 0) != 0) {
+        ERROR("Failed to remove %s", incompat);
+        ret = -1;
+    }
+
+out:
+    free(incompat);
+    free(marker);
+    free(last_boot_id);
+    return ret;
+}
+
+// driver home also holds link, trash, dedup tmp and volatile check dirs. every layer has a link file,
+// so that is enough to tell the others apart without knowing all their names
+static bool is_layer_dir(const char *layer_dir, const char *name)
+{
+    if (strcmp(name, OVERLAY_LINK_DIR) == 0 || strcmp(name, TRASH_REAPER_DIR) == 0 ||
+        strcmp(name, OVERLAY_VOLATILE_CHECK_DIR) == 0) {
+        return false;
+    }
+
+    return layer_has_file(layer_dir, OVERLAY_LAYER_LINK);
+}
+
+static bool volatile_layer_walk_cb(const char *path_name, const struct dirent *sub_dir, void *context)
+{
+    char *layer_dir = NULL;
+
+    layer_dir = util_path_join(path_name, sub_dir->d_name);
+    if (layer_dir == NULL) {
+        ERROR("Failed to join layer dir:%s", sub_dir->d_name);
+        return true;
+    }
+
+    if (is_layer_dir(layer_dir, sub_dir->d_name) && layer_has_file(layer_dir, OVERLAY_LAYER_VOLATILE) &&
+        check_volatile_upper(layer_dir, (const char *)context, false) != 0) {
+        WARN("Failed to check volatile layer %s", layer_dir);
+    }
+
+    free(layer_dir);
+    return true;
+}
+
+static void discard_dirty_volatile_layers(const char *driver_home)
+{
+    char *boot_id = NULL;
+
+    boot_id = get_boot_id();
+    if (boot_id == NULL) {
+        return;
+    }
+
+    if (util_scan_subdirs(driver_home, volatile_layer_walk_cb, boot_id) != 0) {
+        WARN("Failed to scan volatile layers in %s", driver_home);
+    }
+
+    free(boot_id);
+}
+
+static bool overlay_support_volatile(const char *driver_home)
+{
+    bool supported = false;
+    char *check_dir = NULL;
+    char *merged_dir = NULL;
+
+    (void)pthread_mutex_lock(&g_volatile_check_lock);
+    if (g_volatile_support != 0) {
+        goto out;
+    }
+
+    // volatile is accepted since linux 5.10, try a real mount
+    g_volatile_support = -1;
+    check_dir = util_path_join(driver_home, OVERLAY_VOLATILE_CHECK_DIR);
+    merged_dir = util_path_join(check_dir, "merged");
+    if (check_dir == NULL || merged_dir == NULL) {
+        ERROR("Failed to join volatile check dir");
+        goto out;
+    }
+    (void)util_recursive_rmdir(check_dir, 0);
+    if (mount_check_overlay(check_dir, merged_dir, OVERLAY_VOLATILE_OPTION) == 0) {
+        g_volatile_support = 1;
+        if (umount2(merged_dir, MNT_DETACH) != 0) {
+            SYSWARN("Failed to umount %s", merged_dir);
+        }
+    } else {
+        WARN("Overlay volatile mount is not supported, mount volatile layers as usual");
+    }
+    (void)util_recursive_rmdir(check_dir, 0);
+
+out:
+    supported = (g_volatile_support == 1);
+    (void)pthread_mutex_unlock(&g_volatile_check_lock);
+    free(check_dir);
+    free(merged_dir);
+    return supported;
+}
+
+static int prepare_volatile_upper(const char *layer_dir)
+{
+    int ret = 0;
+    char *boot_id = NULL;
+
+    boot_id = get_boot_id();
+    if (boot_id == NULL) {
+        return -1;
+    }
+
+    if (check_volatile_upper(layer_dir, boot_id, true) != 0 || write_volatile_marker(layer_dir, boot_id) != 0) {
+        ret = -1;
+    }
+
+    free(boot_id);
+    return ret;
+}
+
+// mount options of the layer with volatile appended, custom options replace driver options as usual
+static struct driver_mount_opts *get_volatile_mount_opts(const struct graphdriver *driver,
+                                                         const struct driver_mount_opts *mount_opts)
+{
+    size_t i;
+    struct driver_mount_opts *opts = NULL;
+
+    opts = util_common_calloc_s(sizeof(struct driver_mount_opts));
+    if (opts == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    if (mount_opts != NULL && mount_opts->options_len != 0) {
+        for (i = 0; i < mount_opts->options_len; i++) {
+            if (util_array_append(&opts->options, mount_opts->options[i]) != 0) {
+                goto err_out;
+            }
+        }
+    } else if (driver->overlay_opts->mount_options != NULL) {
+        opts->options = util_string_split(driver->overlay_opts->mount_options, ',');
+        if (opts->options == NULL) {
+            goto err_out;
+        }
+    }
+
+    if (util_array_append(&opts->options, OVERLAY_VOLATILE_OPTION) != 0) {
+        goto err_out;
+    }
+    opts->options_len = util_array_len((const char **)opts->options);
+
+    if (mount_opts != NULL) {
+        opts->mount_label = util_strdup_s(mount_opts->mount_label);
+    }
+
+    return opts;
+
+err_out:
+    ERROR("Failed to make volatile mount options");
+    free_driver_mount_opts(opts);
+    return NULL;
+}
+
+static void clear_volatile_incompat(const char *layer_dir)
+{
+    char *incompat = NULL;
+
+    incompat = util_path_join(layer_dir, OVERLAY_VOLATILE_INCOMPAT);
+    if (incompat == NULL) {
+        ERROR("Failed to join layer volatile path:%s", layer_dir);
+        return;
+    }
+
+    // unmounted as expected, upper can be mounted again
+    if (util_dir_exists(incompat) && util_recursive_rmdir(incompat, 0) != 0) {
+        WARN("Failed to remove %s", incompat);
+    }
+
+    free(incompat);
+}
+
+const static int check_lower_depth(const char *lowers_str)
+{
+    int ret = 0;
+    char **lowers_arr = NULL;
+    size_t lowers_size = 0;
+
+    lowers_arr = util_string_split(lowers_str, ':');
+    lowers_size = util_array_len((const char **)lowers_arr);
+    if (lowers_size > OVERLAY_LAYER_MAX_DEPTH) {
+        ERROR("Max depth exceeded %s", lowers_str);
+        ret = -1;
+        goto out;
+    }
+
+out:
+    util_free_array(lowers_arr);
+    return ret;
+}
+
+static char *get_lower(const char *parent, const char *driver_home)
+{
+    int nret = 0;
+    char *lower = NULL;
+    size_t lower_len = 0;
+    char *parent_dir = NULL;
+    char *parent_link_file = NULL;
+    char *parent_link = NULL;
+    char *parent_lower_file = NULL;
+    char *parent_lowers = NULL;
+
+    parent_dir = util_path_join(driver_home, parent);
+    if (parent_dir == NULL) {
+        ERROR("Failed to get parent dir %s", parent);
+        goto out;
+    }
+
+    parent_link_file = util_path_join(parent_dir, OVERLAY_LAYER_LINK);
+    if (parent_link_file == NULL) {
+        ERROR("Failed to get parent link %s", parent_dir);
+        goto out;
+    }
+
+    parent_link = util_read_text_file(parent_link_file);
+    if (parent_link == NULL) {
+        ERROR("Failed to read parent link %s", parent_link_file);
+        goto out;
+    }
+
+    if (strlen(parent_link) >= (INT_MAX - strlen(OVERLAY_LINK_DIR) - 2)) {
         ERROR("parent link %s too large", parent_link_file);
         goto out;
     }
@@ -769,50 +1481,262 @@ out:
     return ret;
 }
 
+// lowers is NULL for layers without parent, a new short link is made if link_id is NULL
+static int mk_sub_directories_with_lowers(const char *id, const char *link_id, const char *lowers,
+                                          const char *layer_dir, const char *driver_home)
+{
+    if (mk_diff_directory(layer_dir) != 0) {
+        return -1;
+    }
+
+    if (link_id == NULL && mk_diff_symlink(id, layer_dir, driver_home) != 0) {
+        return -1;
+    }
+
+    if (link_id != NULL && reuse_diff_symlink(id, link_id, layer_dir, driver_home) != 0) {
+        return -1;
+    }
+
+    if (mk_work_directory(layer_dir) != 0) {
+        return -1;
+    }
+
+    if (mk_merged_directory(layer_dir) != 0) {
+        return -1;
+    }
+
+    if (lowers == NULL) {
+        return mk_empty_directory(layer_dir);
+    }
+
+    return write_lowers(layer_dir, lowers);
+}
+
 static int mk_sub_directories(const char *id, const char *parent, const char *layer_dir, const char *driver_home)
 {
     int ret = 0;
     char *lowers = NULL;
 
-    if (mk_diff_directory(layer_dir) != 0) {
+    if (parent != NULL) {
+        lowers = get_lower(parent, driver_home);
+        if (lowers == NULL) {
+            return -1;
+        }
+    }
+
+    ret = mk_sub_directories_with_lowers(id, NULL, lowers, layer_dir, driver_home);
+
+    free(lowers);
+    return ret;
+}
+
+static int get_tmpfs_storage_opt(const json_map_string_string *opts, int64_t *size)
+{
+    size_t i;
+
+    *size = 0;
+    for (i = 0; opts != NULL && i < opts->len; i++) {
+        if (strcasecmp(STORAGE_OPT_TMPFS_SIZE, opts->keys[i]) != 0) {
+            continue;
+        }
+        if (util_parse_byte_size_string(opts->values[i], size) != 0 || *size <= 0) {
+            ERROR("Invalid tmpfs size: '%s'", opts->values[i]);
+            isulad_set_error_message("Invalid tmpfs size: '%s'", opts->values[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int write_tmpfs_marker(const char *layer_dir, int64_t size)
+{
+    int ret = 0;
+    int nret = 0;
+    char *marker = NULL;
+    char buf[ISULAD_NUMSTRLEN64] = { 0 };
+
+    marker = util_path_join(layer_dir, OVERLAY_LAYER_TMPFS);
+    if (marker == NULL) {
+        ERROR("Failed to join layer tmpfs file:%s", layer_dir);
+        return -1;
+    }
+
+    nret = snprintf(buf, sizeof(buf), "%lld", (long long)size);
+    if (nret < 0 || (size_t)nret >= sizeof(buf)) {
+        ERROR("Failed to sprintf tmpfs size");
         ret = -1;
         goto out;
     }
 
-    if (mk_diff_symlink(id, layer_dir, driver_home) != 0) {
+    if (util_atomic_write_file(marker, buf, strlen(buf), 0600, false) != 0) {
+        SYSERROR("Failed to write %s", marker);
+        ret = -1;
+    }
+
+out:
+    free(marker);
+    return ret;
+}
+
+// pages of tmpfs are charged to the memory cgroup of the task writing them, so what the container
+// writes to its upper counts toward its own memory limit
+static int mount_tmpfs_layer(const char *id, const char *layer_dir, const char *driver_home, int64_t size,
+                             const char *link_id, const char *lowers)
+{
+    int nret = 0;
+    char mount_data[64] = { 0 };
+#ifdef ENABLE_USERNS_REMAP
+    char *userns_remap = NULL;
+#endif
+
+    nret = snprintf(mount_data, sizeof(mount_data), "size=%lld,mode=0700", (long long)size);
+    if (nret < 0 || (size_t)nret >= sizeof(mount_data)) {
+        ERROR("Failed to sprintf tmpfs mount data");
+        return -1;
+    }
+
+    if (mount("tmpfs", layer_dir, "tmpfs", 0, mount_data) != 0) {
+        SYSERROR("Failed to mount tmpfs on %s", layer_dir);
+        return -1;
+    }
+
+#ifdef ENABLE_USERNS_REMAP
+    userns_remap = conf_get_isulad_userns_remap();
+    nret = set_file_owner_for_userns_remap(layer_dir, userns_remap);
+    free(userns_remap);
+    if (nret != 0) {
+        ERROR("Unable to change directory %s owner for user remap.", layer_dir);
+        goto err_out;
+    }
+#endif
+
+    if (write_tmpfs_marker(layer_dir, size) != 0 ||
+        mk_sub_directories_with_lowers(id, link_id, lowers, layer_dir, driver_home) != 0) {
+        goto err_out;
+    }
+
+    return 0;
+
+err_out:
+    if (umount2(layer_dir, MNT_DETACH) != 0) {
+        SYSERROR("Failed to umount tmpfs on %s", layer_dir);
+    }
+    return -1;
+}
+
+// the link id is kept on disk below the mount, so a layer mounted again after reboot keeps its
+// short link. layers from before the link was kept get a new one here
+static char *get_tmpfs_layer_link(const char *id, const char *layer_dir)
+{
+    char *link_id = NULL;
+    char layer_id[MAX_LAYER_ID_LENGTH + 1] = { 0 };
+
+    link_id = read_layer_link_file(layer_dir);
+    if (link_id != NULL) {
+        return link_id;
+    }
+
+    if (util_generate_random_str(layer_id, MAX_LAYER_ID_LENGTH) != 0) {
+        ERROR("Failed to get layer symlink id %s", id);
+        return NULL;
+    }
+
+    if (write_layer_link(layer_dir, layer_id) != 0) {
+        return NULL;
+    }
+
+    return util_strdup_s(layer_id);
+}
+
+// only the marker, link and lower files are written to disk, below the mount. they are enough to
+// mount the layer again once the tmpfs is gone with a reboot
+static int create_tmpfs_layer(const char *id, const char *parent, const char *layer_dir, const char *driver_home,
+                              int64_t size)
+{
+    int ret = 0;
+    char *lowers = NULL;
+    char *link_id = NULL;
+
+    if (parent != NULL) {
+        lowers = get_lower(parent, driver_home);
+        if (lowers == NULL) {
+            return -1;
+        }
+    }
+
+    if (write_tmpfs_marker(layer_dir, size) != 0 || (lowers != NULL && write_lowers(layer_dir, lowers) != 0)) {
         ret = -1;
         goto out;
     }
 
-    if (mk_work_directory(layer_dir) != 0) {
+    link_id = get_tmpfs_layer_link(id, layer_dir);
+    if (link_id == NULL) {
         ret = -1;
         goto out;
     }
 
-    if (mk_merged_directory(layer_dir) != 0) {
+    ret = mount_tmpfs_layer(id, layer_dir, driver_home, size, link_id, lowers);
+
+out:
+    free(lowers);
+    free(link_id);
+    return ret;
+}
+
+static int ensure_tmpfs_layer_mounted(const char *id, const char *layer_dir, const char *driver_home)
+{
+    int ret = 0;
+    long long size = 0;
+    char *marker = NULL;
+    char *lower_file = NULL;
+    char *content = NULL;
+    char *lowers = NULL;
+    char *link_id = NULL;
+
+    if (!layer_has_file(layer_dir, OVERLAY_LAYER_TMPFS) || util_detect_mounted(layer_dir)) {
+        return 0;
+    }
+
+    marker = util_path_join(layer_dir, OVERLAY_LAYER_TMPFS);
+    lower_file = util_path_join(layer_dir, OVERLAY_LAYER_LOWER);
+    if (marker == NULL || lower_file == NULL) {
+        ERROR("Failed to join layer tmpfs files:%s", layer_dir);
         ret = -1;
         goto out;
     }
 
-    if (parent == NULL) {
-        if (mk_empty_directory(layer_dir) != 0) {
-            ret = -1;
-            goto out;
-        }
-    } else {
-        lowers = get_lower(parent, driver_home);
+    content = util_read_text_file(marker);
+    if (content == NULL || util_safe_llong(util_trim_space(content), &size) != 0 || size <= 0) {
+        ERROR("Invalid tmpfs size in %s", marker);
+        ret = -1;
+        goto out;
+    }
+
+    if (util_file_exists(lower_file)) {
+        lowers = util_read_text_file(lower_file);
         if (lowers == NULL) {
+            ERROR("Failed to read %s", lower_file);
             ret = -1;
             goto out;
         }
-        if (write_lowers(layer_dir, lowers) != 0) {
-            ret = -1;
-            goto out;
-        }
     }
 
+    link_id = get_tmpfs_layer_link(id, layer_dir);
+    if (link_id == NULL) {
+        ret = -1;
+        goto out;
+    }
+
+    WARN("Tmpfs of layer %s is gone, start over with an empty upper", layer_dir);
+    ret = mount_tmpfs_layer(id, layer_dir, driver_home, (int64_t)size, link_id, lowers);
+
 out:
+    free(marker);
+    free(lower_file);
+    free(content);
     free(lowers);
+    free(link_id);
     return ret;
 }
 
@@ -822,7 +1746,7 @@ static int set_layer_quota(const char *dir, const json_map_string_string *opts,
     size_t i = 0;
     uint64_t quota = 0;
 
-    for (i = 0; i < opts->len; i++) {
+    for (i = 0; opts != NULL && i < opts->len; i++) {
         if (strcasecmp("size", opts->keys[i]) == 0) {
             int64_t converted = 0;
             ret = util_parse_byte_size_string(opts->values[i], &converted);
@@ -835,6 +1759,8 @@ static int set_layer_quota(const char *dir, const json_map_string_string *opts,
             }
             quota = (uint64_t)converted;
             break;
+        } else if (is_upper_storage_opt(opts->keys[i])) {
+            continue;
         } else {
             ERROR("Unknown option %s", opts->keys[i]);
             isulad_set_error_message("Unknown storage option %s", opts->keys[i]);
@@ -850,11 +1776,12 @@ static int set_layer_quota(const char *dir, const json_map_string_string *opts,
         goto out;
     }
 
-    if (quota == 0) {
+    // layer without storage opts only gets a project id for accounting, never the default limit
+    if (quota == 0 && has_quota_storage_opt(opts)) {
         quota = driver->overlay_opts->default_quota;
     }
 
-    if (quota > 0) {
+    if (quota > 0 || driver->overlay_opts->quota_accounting) {
         ret = driver->quota_ctrl->set_quota(dir, driver->quota_ctrl, quota);
     }
 
@@ -950,6 +1877,8 @@ static int do_create(const char *id, const char *parent, const struct graphdrive
                      const struct driver_create_opts *create_opts)
 {
     int ret = 0;
+    bool is_volatile = false;
+    int64_t tmpfs_size = 0;
     char *layer_dir = NULL;
 #ifdef ENABLE_USERNS_REMAP
     char *userns_remap = conf_get_isulad_userns_remap();
@@ -967,6 +1896,12 @@ static int do_create(const char *id, const char *parent, const struct graphdrive
         goto out;
     }
 
+    if (get_volatile_storage_opt(create_opts->storage_opt, &is_volatile) != 0 ||
+        get_tmpfs_storage_opt(create_opts->storage_opt, &tmpfs_size) != 0) {
+        ret = -1;
+        goto out;
+    }
+
     if (util_mkdir_p(layer_dir, 0700) != 0) {
         ERROR("Unable to create layer directory %s.", layer_dir);
         ret = -1;
@@ -981,7 +1916,9 @@ static int do_create(const char *id, const char *parent, const struct graphdrive
     }
 #endif
 
-    if (create_opts->storage_opt != NULL && create_opts->storage_opt->len != 0) {
+    // size of tmpfs layer is limited by tmpfs itself
+    if (tmpfs_size == 0 && (has_quota_storage_opt(create_opts->storage_opt) ||
+                            (driver->support_quota && driver->overlay_opts->quota_accounting))) {
         if (set_layer_quota(layer_dir, create_opts->storage_opt, driver) != 0) {
             ERROR("Unable to set layer quota %s", layer_dir);
             ret = -1;
@@ -989,7 +1926,18 @@ static int do_create(const char *id, const char *parent, const struct graphdrive
         }
     }
 
-    if (mk_sub_directories(id, parent, layer_dir, driver->home) != 0) {
+    if (tmpfs_size > 0) {
+        if (create_tmpfs_layer(id, parent, layer_dir, driver->home, tmpfs_size) != 0) {
+            ret = -1;
+            goto err_out;
+        }
+    } else if (mk_sub_directories(id, parent, layer_dir, driver->home) != 0) {
+        ret = -1;
+        goto err_out;
+    }
+
+    // boot id is filled on mount
+    if (is_volatile && write_volatile_marker(layer_dir, "") != 0) {
         ret = -1;
         goto err_out;
     }
@@ -997,6 +1945,9 @@ static int do_create(const char *id, const char *parent, const struct graphdrive
     goto out;
 
 err_out:
+    if (tmpfs_size > 0 && util_detect_mounted(layer_dir) && umount2(layer_dir, MNT_DETACH) != 0) {
+        SYSERROR("Failed to umount tmpfs of layer %s", layer_dir);
+    }
     if (util_recursive_rmdir(layer_dir, 0)) {
         ERROR("Failed to delete layer path: %s", layer_dir);
     }
@@ -1064,7 +2015,7 @@ int overlay2_create_rw(const char *id, const char *parent, const struct graphdri
         return -1;
     }
 
-    if (create_opts->storage_opt != NULL && create_opts->storage_opt->len != 0 && !driver->support_quota) {
+    if (has_quota_storage_opt(create_opts->storage_opt) && !driver->support_quota) {
         ERROR("--storage-opt is supported only for overlay over xfs or ext4 with 'pquota' mount option");
         isulad_set_error_message(
             "--storage-opt is supported only for overlay over xfs or ext4 with 'pquota' mount option");
@@ -1105,23 +2056,6 @@ int overlay2_create_ro(const char *id, const char *parent, const struct graphdri
     return do_create(id, parent, driver, create_opts);
 }
 
-static char *read_layer_link_file(const char *layer_dir)
-{
-    char *link_file = NULL;
-    char *link = NULL;
-
-    link_file = util_path_join(layer_dir, OVERLAY_LAYER_LINK);
-    if (link_file == NULL) {
-        ERROR("Failed to get link %s", layer_dir);
-        goto out;
-    }
-
-    link = util_read_text_file(link_file);
-out:
-    free(link_file);
-    return link;
-}
-
 static char *read_layer_lower_file(const char *layer_dir)
 {
     char *lower_file = NULL;
@@ -1187,6 +2121,23 @@ int overlay2_rm_layer(const char *id, const struct graphdriver *driver)
         }
     }
 
+#ifdef ENABLE_USERNS_REMAP
+    // removing the layer dir must not walk into the lowers through their idmapped clones
+    if (idmap_unstage_layer(layer_dir) != 0) {
+        ERROR("Failed to umount idmapped layers of %s", id);
+        ret = -1;
+        goto out;
+    }
+#endif
+
+    // upper on tmpfs goes away with the umount, only the small layer dir is left on disk
+    if (layer_has_file(layer_dir, OVERLAY_LAYER_TMPFS) && util_detect_mounted(layer_dir) &&
+        umount2(layer_dir, MNT_DETACH) != 0) {
+        SYSERROR("Failed to umount tmpfs of layer %s", layer_dir);
+        ret = -1;
+        goto out;
+    }
+
 #ifdef ENABLE_REMOTE_LAYER_STORE
     if (!util_fileself_exists(layer_dir)) {
         WARN("layer direcotry is already removed, can't remove twice");
@@ -1208,14 +2159,14 @@ int overlay2_rm_layer(const char *id, const struct graphdriver *driver)
             goto out;
         }
     } else {
-        if (util_recursive_rmdir(layer_dir, 0) != 0) {
+        if (trash_reaper_remove(layer_dir) != 0) {
             SYSERROR("Failed to remove layer directory %s", layer_dir);
             ret = -1;
             goto out;
         }
     }
 #else
-    if (util_recursive_rmdir(layer_dir, 0) != 0) {
+    if (trash_reaper_remove(layer_dir) != 0) {
         SYSERROR("Failed to remove layer directory %s", layer_dir);
         ret = -1;
         goto out;
@@ -1675,18 +2626,275 @@ out:
     return ret;
 }
 
+static int append_fsmount_param(const char *key, const char *layer_dir, const char *sub_dir, char ***params)
+{
+    int ret = 0;
+    char *path = NULL;
+    char *param = NULL;
+
+    path = util_path_join(layer_dir, sub_dir);
+    if (path == NULL) {
+        ERROR("Failed to join layer %s dir:%s", sub_dir, layer_dir);
+        return -1;
+    }
+
+    param = util_string_append(path, key);
+    if (param == NULL || util_array_append(params, param) != 0) {
+        ERROR("Failed to append fsmount param %s%s", key, path);
+        ret = -1;
+    }
+
+    free(path);
+    free(param);
+    return ret;
+}
+
+static char **get_fsmount_params(const char *layer_dir, const char *driver_home)
+{
+    size_t i;
+    char *lowers_str = NULL;
+    char **lowers = NULL;
+    char **abs_lowers = NULL;
+    char **params = NULL;
+
+    lowers_str = read_layer_lower_file(layer_dir);
+    lowers = util_string_split(lowers_str, ':');
+    for (i = 0; i < util_array_len((const char **)lowers); i++) {
+        if (append_abs_lower_path(driver_home, lowers[i], &abs_lowers) != 0) {
+            goto err_out;
+        }
+    }
+
+    if (util_array_len((const char **)abs_lowers) == 0 && append_abs_empty_path(layer_dir, &abs_lowers) != 0) {
+        goto err_out;
+    }
+
+    // one lowerdir+ per layer, so layer depth is not limited by the page size of mount data
+    for (i = 0; i < util_array_len((const char **)abs_lowers); i++) {
+        char *param = util_string_append(abs_lowers[i], "lowerdir+=");
+        if (param == NULL || util_array_append(&params, param) != 0) {
+            ERROR("Failed to append lower param %s", abs_lowers[i]);
+            free(param);
+            goto err_out;
+        }
+        free(param);
+    }
+
+    if (append_fsmount_param("upperdir=", layer_dir, OVERLAY_LAYER_DIFF, &params) != 0 ||
+        append_fsmount_param("workdir=", layer_dir, OVERLAY_LAYER_WORK, &params) != 0) {
+        goto err_out;
+    }
+
+    goto out;
+
+err_out:
+    util_free_array(params);
+    params = NULL;
+
+out:
+    free(lowers_str);
+    util_free_array(lowers);
+    util_free_array(abs_lowers);
+    return params;
+}
+
+// try the new mount api, return 0 if layer is mounted, otherwise caller falls back to mount(2)
+static int fsmount_layer(const char *layer_dir, const char *merged_dir, const struct graphdriver *driver,
+                         const struct driver_mount_opts *mount_opts)
+{
+    int ret = -1;
+    bool unsupported = false;
+    char **params = NULL;
+    char *extra_opts = NULL;
+
+    if (g_fsmount_unsupported) {
+        return -1;
+    }
+
+    // selinux context may contain quoted commas, leave it to the mount data path
+    if (mount_opts != NULL && mount_opts->mount_label != NULL) {
+        return -1;
+    }
+
+    params = get_fsmount_params(layer_dir, driver->home);
+    if (params == NULL) {
+        return -1;
+    }
+
+    if (mount_opts != NULL && mount_opts->options_len != 0) {
+        extra_opts = util_string_join(",", (const char **)mount_opts->options, mount_opts->options_len);
+        if (extra_opts == NULL) {
+            ERROR("Failed to get custom mount opts");
+            goto out;
+        }
+    } else if (driver->overlay_opts->mount_options != NULL) {
+        extra_opts = util_strdup_s(driver->overlay_opts->mount_options);
+    }
+
+    ret = util_fsmount("overlay", "overlay", (const char **)params, util_array_len((const char **)params), extra_opts,
+                       merged_dir, &unsupported);
+    if (ret != 0 && unsupported) {
+        WARN("New mount api is not usable for overlay, fall back to mount(2)");
+        g_fsmount_unsupported = true;
+    }
+
+out:
+    util_free_array(params);
+    free(extra_opts);
+    return ret;
+}
+
+#ifdef ENABLE_USERNS_REMAP
+static int idmap_stage_dir(const char *src, const char *dst)
+{
+    bool unsupported = false;
+
+    // staged by an earlier mount of the layer
+    if (util_detect_mounted(dst)) {
+        return 0;
+    }
+
+    if (util_mkdir_p(dst, 0700) != 0) {
+        ERROR("Failed to create idmap stage dir %s", dst);
+        return -1;
+    }
+
+    if (util_idmap_bind(src, dst, g_idmap_userns_fd, &unsupported) != 0) {
+        ERROR("Failed to idmap %s on %s", src, dst);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int idmap_stage_lower(const char *driver_home, const char *stage_dir, const char *lower)
+{
+    int ret = -1;
+    struct stat st = { 0 };
+    char *abs_lower = NULL;
+    char *staged = NULL;
+
+    abs_lower = util_path_join(driver_home, lower);
+    staged = util_path_join(stage_dir, lower);
+    if (abs_lower == NULL || staged == NULL) {
+        ERROR("Failed to join idmap stage dir of lower %s", lower);
+        goto out;
+    }
+
+    if (lstat(staged, &st) == 0 && S_ISLNK(st.st_mode)) {
+        ret = 0;
+        goto out;
+    }
+
+    if (stat(abs_lower, &st) != 0) {
+        SYSERROR("Failed to stat lower %s", abs_lower);
+        goto out;
+    }
+
+    // lowers chowned for remap before idmap was usable show up right already, use them as they are
+    if (st.st_uid != 0) {
+        if (symlink(abs_lower, staged) != 0) {
+            SYSERROR("Failed to link %s to %s", staged, abs_lower);
+            goto out;
+        }
+        ret = 0;
+        goto out;
+    }
+
+    ret = idmap_stage_dir(abs_lower, staged);
+
+out:
+    free(abs_lower);
+    free(staged);
+    return ret;
+}
+
+// overlay can not be idmapped itself, so it is mounted over idmapped clones of the layer dir and its lowers
+static int idmap_mount_layer(const char *id, const char *layer_dir, const char *merged_dir,
+                             const struct graphdriver *driver, const struct driver_mount_opts *mount_opts)
+{
+    int ret = -1;
+    size_t i;
+    int page_size = getpagesize();
+    char *stage_dir = NULL;
+    char *stage_layer = NULL;
+    char *link_dir = NULL;
+    char *lowers_str = NULL;
+    char **lowers = NULL;
+    char *abs_lower_dir = NULL;
+    char *rel_lower_dir = NULL;
+    char *mount_data = NULL;
+
+    // checks the lowers as well
+    if (get_mount_opt_lower_dir(id, layer_dir, driver->home, &abs_lower_dir, &rel_lower_dir) != 0) {
+        ERROR("Failed to get mount opt lower dir");
+        goto out;
+    }
+
+    stage_dir = util_path_join(layer_dir, OVERLAY_LAYER_IDMAPPED);
+    stage_layer = util_path_join(stage_dir, id);
+    link_dir = util_path_join(stage_dir, OVERLAY_LINK_DIR);
+    if (stage_dir == NULL || stage_layer == NULL || link_dir == NULL) {
+        ERROR("Failed to join idmap stage dir of %s", layer_dir);
+        goto out;
+    }
+
+    if (util_mkdir_p(link_dir, 0700) != 0) {
+        ERROR("Failed to create idmap stage dir %s", link_dir);
+        goto out;
+    }
+
+    // upper and work must be on one mount, so the whole layer dir is cloned
+    if (idmap_stage_dir(layer_dir, stage_layer) != 0) {
+        goto out;
+    }
+
+    lowers_str = read_layer_lower_file(layer_dir);
+    lowers = util_string_split(lowers_str, ':');
+    for (i = 0; i < util_array_len((const char **)lowers); i++) {
+        if (idmap_stage_lower(driver->home, stage_dir, lowers[i]) != 0) {
+            goto out;
+        }
+    }
+
+    // the stage dir has the layout of driver home, so relative mount data keeps within the page size
+    mount_data = get_rel_mount_opt_data(id, rel_lower_dir, driver, mount_opts);
+    if (mount_data == NULL) {
+        ERROR("Failed to get rel mount opt data");
+        goto out;
+    }
+    if (strlen(mount_data) > page_size) {
+        ERROR("cannot mount layer, mount label too large %s", mount_data);
+        goto out;
+    }
+
+    if (util_mount_from_as(stage_dir, "overlay", merged_dir, "overlay", mount_data, g_idmap_uid, g_idmap_gid) != 0) {
+        ERROR("Failed to mount %s from %s with option \"%s\"", merged_dir, stage_dir, mount_data);
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    free(stage_dir);
+    free(stage_layer);
+    free(link_dir);
+    free(lowers_str);
+    util_free_array(lowers);
+    free(abs_lower_dir);
+    free(rel_lower_dir);
+    free(mount_data);
+    return ret;
+}
+#endif
+
 static char *do_mount_layer(const char *id, const char *layer_dir, const struct graphdriver *driver,
                             const struct driver_mount_opts *mount_opts)
 {
     char *merged_dir = NULL;
     char *mount_data = NULL;
     bool use_rel_mount = false;
-
-    mount_data = generate_mount_opt_data(id, layer_dir, driver, mount_opts, &use_rel_mount);
-    if (mount_data == NULL) {
-        ERROR("Failed to get mount data");
-        goto error_out;
-    }
+    struct driver_mount_opts *volatile_opts = NULL;
 
     merged_dir = util_path_join(layer_dir, OVERLAY_LAYER_MERGED);
     if (merged_dir == NULL) {
@@ -1694,6 +2902,41 @@ static char *do_mount_layer(const char *id, const char *layer_dir, const struct
         goto error_out;
     }
 
+    if (layer_has_file(layer_dir, OVERLAY_LAYER_VOLATILE) && !util_detect_mounted(merged_dir) &&
+        overlay_support_volatile(driver->home)) {
+        if (prepare_volatile_upper(layer_dir) != 0) {
+            ERROR("Failed to prepare volatile upper of %s", layer_dir);
+            goto error_out;
+        }
+        volatile_opts = get_volatile_mount_opts(driver, mount_opts);
+        if (volatile_opts == NULL) {
+            goto error_out;
+        }
+        mount_opts = volatile_opts;
+    }
+
+#ifdef ENABLE_USERNS_REMAP
+    // upper of the layer is not chowned, the remapped root can not write it unless it is idmapped
+    if (layer_need_idmap(layer_dir)) {
+        if (idmap_mount_layer(id, layer_dir, merged_dir, driver, mount_opts) == 0) {
+            goto out;
+        }
+        ERROR("Failed to mount layer %s over idmapped layers", id);
+        (void)idmap_unstage_layer(layer_dir);
+        goto error_out;
+    }
+#endif
+
+    if (fsmount_layer(layer_dir, merged_dir, driver, mount_opts) == 0) {
+        goto out;
+    }
+
+    mount_data = generate_mount_opt_data(id, layer_dir, driver, mount_opts, &use_rel_mount);
+    if (mount_data == NULL) {
+        ERROR("Failed to get mount data");
+        goto error_out;
+    }
+
     if (!use_rel_mount) {
         if (abs_mount(layer_dir, merged_dir, mount_data) != 0) {
             ERROR("Failed to mount %s with option \"%s\"", merged_dir, mount_data);
@@ -1714,6 +2957,7 @@ error_out:
 
 out:
     free(mount_data);
+    free_driver_mount_opts(volatile_opts);
     return merged_dir;
 }
 
@@ -1738,6 +2982,11 @@ char *overlay2_mount_layer(const char *id, const struct graphdriver *driver, con
         goto out;
     }
 
+    if (ensure_tmpfs_layer_mounted(id, layer_dir, driver->home) != 0) {
+        ERROR("Failed to mount tmpfs of layer %s", id);
+        goto out;
+    }
+
     merged_dir = do_mount_layer(id, layer_dir, driver, mount_opts);
     if (merged_dir == NULL) {
         ERROR("Failed to mount layer %s", id);
@@ -1780,9 +3029,20 @@ int overlay2_umount_layer(const char *id, const struct graphdriver *driver)
         goto out;
     }
 
-    if (umount2(merged_dir, MNT_DETACH) && errno != EINVAL) {
-        SYSERROR("Failed to umount the target: %s", merged_dir);
+    if (umount2(merged_dir, MNT_DETACH) != 0) {
+        if (errno != EINVAL) {
+            SYSERROR("Failed to umount the target: %s", merged_dir);
+        }
+    } else if (layer_has_file(layer_dir, OVERLAY_LAYER_VOLATILE)) {
+        clear_volatile_incompat(layer_dir);
+    }
+
+#ifdef ENABLE_USERNS_REMAP
+    // the idmapped layers are kept while merged is still mounted from an earlier mount
+    if (!util_detect_mounted(merged_dir) && idmap_unstage_layer(layer_dir) != 0) {
+        WARN("Failed to umount idmapped layers of %s", id);
     }
+#endif
 
 out:
     free(layer_dir);
@@ -2125,6 +3385,15 @@ int overlay2_clean_up(struct graphdriver *driver)
         goto out;
     }
 
+    trash_reaper_exit();
+
+#ifdef ENABLE_USERNS_REMAP
+    if (g_idmap_userns_fd >= 0) {
+        close(g_idmap_userns_fd);
+        g_idmap_userns_fd = -1;
+    }
+#endif
+
     if (umount(driver->home) != 0) {
         ret = -1;
         goto out;
@@ -2217,7 +3486,31 @@ out:
     return ret;
 }
 
-static int do_cal_layer_fs_info(const char *layer_diff, imagetool_fs_info *fs_info)
+static void cal_layer_usage(const char *layer_dir, const char *layer_diff, const struct graphdriver *driver,
+                            int64_t *total_size, int64_t *total_inodes)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    struct util_dir_size_opts walk_opts = { .workers = 1, .timeout_ms = 0, .dedup_hardlink = true };
+
+    // usage of layer with private project id is O(1) from quota, otherwise walk the diff directory
+    if (driver->support_quota && driver->quota_ctrl->get_usage != NULL &&
+        driver->quota_ctrl->get_usage(layer_dir, driver->quota_ctrl, total_size, total_inodes) == 0) {
+        return;
+    }
+
+    *total_size = 0;
+    *total_inodes = 0;
+    if (cpus > 1) {
+        walk_opts.workers = cpus > OVERLAY_LAYER_USAGE_MAX_WORKERS ? OVERLAY_LAYER_USAGE_MAX_WORKERS : (unsigned int)cpus;
+    }
+    // hard links are counted once, the same as the quota does
+    if (util_calculate_dir_size_parallel(layer_diff, &walk_opts, total_size, total_inodes) < 0) {
+        ERROR("Failed to calculate size of %s", layer_diff);
+    }
+}
+
+static int do_cal_layer_fs_info(const char *layer_dir, const char *layer_diff, const struct graphdriver *driver,
+                                imagetool_fs_info *fs_info)
 {
     int ret = 0;
     imagetool_fs_info_image_filesystems_element *fs_usage_tmp = NULL;
@@ -2241,7 +3534,7 @@ static int do_cal_layer_fs_info(const char *layer_diff, imagetool_fs_info *fs_in
     }
     fs_usage_tmp->fs_id->mountpoint = util_strdup_s(layer_diff);
 
-    util_calculate_dir_size(layer_diff, 0, &total_size, &total_inodes);
+    cal_layer_usage(layer_dir, layer_diff, driver, &total_size, &total_inodes);
 
     fs_usage_tmp->inodes_used = util_common_calloc_s(sizeof(imagetool_fs_info_image_filesystems_inodes_used));
     if (fs_usage_tmp->inodes_used == NULL) {
@@ -2303,7 +3596,7 @@ int overlay2_get_layer_fs_info(const char *id, const struct graphdriver *driver,
         goto out;
     }
 
-    if (do_cal_layer_fs_info(layer_diff, fs_info) != 0) {
+    if (do_cal_layer_fs_info(layer_dir, layer_diff, driver, fs_info) != 0) {
         ERROR("Failed to cal layer diff :%s fs info", layer_diff);
         ret = -1;
         goto out;
@@ -111,6 +111,56 @@ out:
     return ret;
 }
 
+static int clear_project_quota_inherit(const char *target)
+{
+    int ret = 0;
+    struct fsxattr fsxattr = { 0 };
+    DIR *dir = NULL;
+    int fd = -1;
+
+    if (target == NULL) {
+        return -1;
+    }
+
+    dir = opendir(target);
+    if (dir == NULL) {
+        ret = -1;
+        SYSERROR("opendir with path %s failed", target);
+        goto out;
+    }
+
+    fd = dirfd(dir);
+    if (fd < 0) {
+        ret = -1;
+        SYSERROR("open %s failed.", target);
+        goto out;
+    }
+
+    ret = ioctl(fd, FS_IOC_FSGETXATTR, &fsxattr);
+    if (ret != 0) {
+        SYSERROR("failed to get projid for %s", target);
+        goto out;
+    }
+
+    if ((fsxattr.fsx_xflags & FS_XFLAG_PROJINHERIT) == 0) {
+        goto out;
+    }
+
+    // rename into a directory with inherit flag fails with EXDEV if the project ids differ
+    fsxattr.fsx_xflags &= ~FS_XFLAG_PROJINHERIT;
+    ret = ioctl(fd, FS_IOC_FSSETXATTR, &fsxattr);
+    if (ret != 0) {
+        SYSERROR("failed to clear project inherit flag for %s", target);
+        goto out;
+    }
+
+out:
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    return ret;
+}
+
 static int ext4_set_project_quota(const char *backing_fs_blockdev, uint32_t project_id, uint64_t size)
 {
     int ret;
@@ -151,7 +201,8 @@ static int ext4_set_quota(const char *target, struct pquota_control *ctrl, uint6
 
     EVENT("Set directory %s project ID:%u quota size: %lu", target, project_id, size);
 
-    if (ext4_set_project_quota(ctrl->backing_fs_device, project_id, size) != 0) {
+    // size 0 only assigns the project id, so the usage of target can be accounted without limit
+    if (size > 0 && ext4_set_project_quota(ctrl->backing_fs_device, project_id, size) != 0) {
         ERROR("Failed to set project id %d to %s.", project_id, target);
         ret = -1;
         goto unlock;
@@ -163,6 +214,28 @@ out:
     return ret;
 }
 
+static int ext4_get_project_usage(const char *backing_fs_blockdev, uint32_t project_id, int64_t *bytes,
+                                  int64_t *inodes)
+{
+    int ret;
+    struct dqblk d = { 0 };
+
+    ret = quotactl(QCMD(Q_GETQUOTA, FS_PROJ_QUOTA), backing_fs_blockdev, project_id, (caddr_t)&d);
+    if (ret != 0) {
+        SYSERROR("Failed to get quota usage for projid %u on %s", project_id, backing_fs_blockdev);
+        return ret;
+    }
+
+    if ((d.dqb_valid & QIF_USAGE) != QIF_USAGE) {
+        ERROR("Quota usage for projid %u on %s is invalid", project_id, backing_fs_blockdev);
+        return -1;
+    }
+
+    *bytes = (int64_t)d.dqb_curspace;
+    *inodes = (int64_t)d.dqb_curinodes;
+    return 0;
+}
+
 static int xfs_set_project_quota(const char *backing_fs_blockdev, uint32_t project_id, uint64_t size)
 {
     int ret;
@@ -206,7 +279,8 @@ static int xfs_set_quota(const char *target, struct pquota_control *ctrl, uint64
 
     EVENT("Set directory %s project ID:%u quota size: %lu", target, project_id, size);
 
-    if (xfs_set_project_quota(ctrl->backing_fs_device, project_id, size) != 0) {
+    // size 0 only assigns the project id, so the usage of target can be accounted without limit
+    if (size > 0 && xfs_set_project_quota(ctrl->backing_fs_device, project_id, size) != 0) {
         ERROR("Failed to set project id %d to %s.", project_id, target);
         ret = -1;
         goto unlock;
@@ -218,6 +292,24 @@ out:
     return ret;
 }
 
+static int xfs_get_project_usage(const char *backing_fs_blockdev, uint32_t project_id, int64_t *bytes,
+                                 int64_t *inodes)
+{
+    int ret;
+    fs_disk_quota_t d = { 0 };
+
+    ret = quotactl(QCMD(Q_XGETQUOTA, FS_PROJ_QUOTA), backing_fs_blockdev, project_id, (caddr_t)&d);
+    if (ret != 0) {
+        SYSERROR("Failed to get quota usage for projid %u on %s", project_id, backing_fs_blockdev);
+        return ret;
+    }
+
+    // d_bcount is counted in 512 bytes basic blocks
+    *bytes = (int64_t)d.d_bcount * 512;
+    *inodes = (int64_t)d.d_icount;
+    return 0;
+}
+
 static int get_project_quota_id(const char *path, uint32_t *project_id)
 {
     int ret = 0;
@@ -251,6 +343,34 @@ out:
     return ret;
 }
 
+static int get_quota_usage(const char *target, struct pquota_control *ctrl, int64_t *bytes, int64_t *inodes)
+{
+    int ret = 0;
+    uint32_t project_id = 0;
+
+    if (target == NULL || ctrl == NULL || bytes == NULL || inodes == NULL) {
+        return -1;
+    }
+
+    if (get_project_quota_id(target, &project_id) != 0) {
+        return -1;
+    }
+
+    // directory without own project id shares the usage with others, caller should walk it instead
+    if (project_id <= ctrl->base_project_id) {
+        DEBUG("Directory %s has no private project id", target);
+        return -1;
+    }
+
+    if (strcmp(ctrl->backing_fs_type, "extfs") == 0) {
+        ret = ext4_get_project_usage(ctrl->backing_fs_device, project_id, bytes, inodes);
+    } else {
+        ret = xfs_get_project_usage(ctrl->backing_fs_device, project_id, bytes, inodes);
+    }
+
+    return ret;
+}
+
 static void get_next_project_id(const char *dirpath, struct pquota_control *ctrl)
 {
     int nret = 0;
@@ -389,6 +509,7 @@ struct pquota_control *project_quota_control_init(const char *home_dir, const ch
         ERROR("Failed to get mininal project id %s", home_dir);
         goto err_out;
     }
+    ctrl->base_project_id = min_project_id;
     min_project_id++;
     ctrl->next_project_id = min_project_id;
     get_next_project_id(home_dir, ctrl);
@@ -411,6 +532,8 @@ struct pquota_control *project_quota_control_init(const char *home_dir, const ch
     } else {
         ctrl->set_quota = xfs_set_quota;
     }
+    ctrl->get_usage = get_quota_usage;
+    ctrl->clear_inherit = clear_project_quota_inherit;
 
     return ctrl;
 
@@ -75,10 +75,17 @@ struct fsxattr {
 struct pquota_control {
     char *backing_fs_type;
     char *backing_fs_device;
+    // project id of the driver home, directories with it are not accounted separately
+    uint32_t base_project_id;
     uint32_t next_project_id;
     pthread_rwlock_t rwlock;
     // ops
+    // size 0 assigns a new project id to target without setting limit
     int (*set_quota)(const char *target, struct pquota_control *ctrl, uint64_t size);
+    // read usage of target from the quota of its project id, fail if target has no private one
+    int (*get_usage)(const char *target, struct pquota_control *ctrl, int64_t *bytes, int64_t *inodes);
+    // drop project inherit flag of target, so directories with other project ids can be renamed into it
+    int (*clear_inherit)(const char *target);
 };
 
 struct pquota_control *project_quota_control_init(const char *home_dir, const char *fs);
@@ -0,0 +1,270 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide background removal of graphdriver directories
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "trash_reaper.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "isula_libutils/log.h"
+#include "utils.h"
+#include "utils_array.h"
+#include "utils_file.h"
+#include "path.h"
+
+#define TRASH_RANDOM_LEN 16
+
+// ioprio definitions from linux/ioprio.h, which is not shipped by every libc
+#define TRASH_IOPRIO_CLASS_SHIFT 13
+#define TRASH_IOPRIO_CLASS_BE 2
+#define TRASH_IOPRIO_WHO_PROCESS 1
+// lowest priority of best effort class, idle class may starve the reaper forever on busy disks
+#define TRASH_IOPRIO_LEVEL 7
+
+struct trash_reaper {
+    char *dir;
+    pthread_t tid;
+    bool running;
+    bool stop;
+    // new entries were moved into trash since last scan
+    bool kicked;
+    // cross project rename was reported already
+    bool exdev_logged;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static struct trash_reaper g_reaper = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void trash_set_io_priority(void)
+{
+    int prio = (TRASH_IOPRIO_CLASS_BE << TRASH_IOPRIO_CLASS_SHIFT) | TRASH_IOPRIO_LEVEL;
+
+    // who 0 means the calling thread
+    if (syscall(SYS_ioprio_set, TRASH_IOPRIO_WHO_PROCESS, 0, prio) != 0) {
+        SYSWARN("Failed to lower io priority of trash reaper");
+    }
+}
+
+static bool trash_should_stop(void)
+{
+    bool stop = false;
+
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    stop = g_reaper.stop;
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+
+    return stop;
+}
+
+static void trash_reap_all(const char *trash_dir)
+{
+    size_t i;
+    char **entries = NULL;
+    char path[PATH_MAX] = { 0 };
+
+    if (util_list_all_subdir(trash_dir, &entries) != 0) {
+        ERROR("Failed to list trash dir %s", trash_dir);
+        return;
+    }
+
+    for (i = 0; i < util_array_len((const char **)entries); i++) {
+        int nret;
+
+        if (trash_should_stop()) {
+            break;
+        }
+
+        nret = snprintf(path, sizeof(path), "%s/%s", trash_dir, entries[i]);
+        if (nret < 0 || (size_t)nret >= sizeof(path)) {
+            ERROR("Failed to join trash path %s", entries[i]);
+            continue;
+        }
+
+        if (util_recursive_rmdir(path, 0) != 0) {
+            SYSERROR("Failed to reap %s", path);
+            continue;
+        }
+        DEBUG("Reaped trash %s", path);
+    }
+
+    util_free_array(entries);
+}
+
+static void *trash_reaper_routine(void *arg)
+{
+    const char *trash_dir = (const char *)arg;
+
+    prctl(PR_SET_NAME, "TrashReaper");
+    trash_set_io_priority();
+
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    while (!g_reaper.stop) {
+        g_reaper.kicked = false;
+        (void)pthread_mutex_unlock(&g_reaper.lock);
+
+        trash_reap_all(trash_dir);
+
+        (void)pthread_mutex_lock(&g_reaper.lock);
+        while (!g_reaper.kicked && !g_reaper.stop) {
+            (void)pthread_cond_wait(&g_reaper.cond, &g_reaper.lock);
+        }
+    }
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+
+    return NULL;
+}
+
+int trash_reaper_init(const char *trash_dir)
+{
+    int ret = 0;
+
+    if (trash_dir == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    if (util_mkdir_p(trash_dir, TEMP_DIRECTORY_MODE) != 0) {
+        ERROR("Unable to create trash directory %s", trash_dir);
+        return -1;
+    }
+
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    if (g_reaper.running) {
+        ERROR("Trash reaper is already running on %s", g_reaper.dir);
+        ret = -1;
+        goto unlock;
+    }
+
+    g_reaper.dir = util_strdup_s(trash_dir);
+    g_reaper.stop = false;
+    // reap leftovers of last run at once
+    g_reaper.kicked = true;
+    ret = pthread_create(&g_reaper.tid, NULL, trash_reaper_routine, g_reaper.dir);
+    if (ret != 0) {
+        errno = ret;
+        SYSERROR("Failed to create trash reaper thread");
+        free(g_reaper.dir);
+        g_reaper.dir = NULL;
+        ret = -1;
+        goto unlock;
+    }
+    g_reaper.running = true;
+
+unlock:
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+    return ret;
+}
+
+void trash_reaper_exit(void)
+{
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    if (!g_reaper.running) {
+        (void)pthread_mutex_unlock(&g_reaper.lock);
+        return;
+    }
+    g_reaper.stop = true;
+    (void)pthread_cond_broadcast(&g_reaper.cond);
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+
+    // the directory under removal is finished first, the rest is left for next start
+    (void)pthread_join(g_reaper.tid, NULL);
+
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    g_reaper.running = false;
+    free(g_reaper.dir);
+    g_reaper.dir = NULL;
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+}
+
+static int trash_move(const char *path)
+{
+    int nret;
+    char random[TRASH_RANDOM_LEN + 1] = { 0 };
+    char target[PATH_MAX] = { 0 };
+    char *base = NULL;
+
+    if (util_generate_random_str(random, TRASH_RANDOM_LEN) != 0) {
+        ERROR("Failed to generate random trash name");
+        return -1;
+    }
+
+    base = util_path_base(path);
+    if (base == NULL) {
+        ERROR("Failed to get base name of %s", path);
+        return -1;
+    }
+
+    // the same layer id may be removed again before the reaper gets to the old one
+    nret = snprintf(target, sizeof(target), "%s/%s-%s", g_reaper.dir, base, random);
+    free(base);
+    if (nret < 0 || (size_t)nret >= sizeof(target)) {
+        ERROR("Failed to join trash path for %s", path);
+        return -1;
+    }
+
+    if (rename(path, target) != 0) {
+        // EXDEV shows up for every layer whose project id differs from trash, report it only once
+        if (errno == EXDEV) {
+            if (!g_reaper.exdev_logged) {
+                INFO("Cannot move %s into trash across project ids, remove such directories synchronously", path);
+                g_reaper.exdev_logged = true;
+            }
+            return -1;
+        }
+        SYSWARN("Failed to move %s into trash", path);
+        return -1;
+    }
+
+    g_reaper.kicked = true;
+    (void)pthread_cond_signal(&g_reaper.cond);
+    return 0;
+}
+
+int trash_reaper_remove(const char *path)
+{
+    int ret = -1;
+
+    if (path == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    if (!util_fileself_exists(path)) {
+        return 0;
+    }
+
+    (void)pthread_mutex_lock(&g_reaper.lock);
+    if (g_reaper.running && !g_reaper.stop) {
+        ret = trash_move(path);
+    }
+    (void)pthread_mutex_unlock(&g_reaper.lock);
+
+    if (ret == 0) {
+        return 0;
+    }
+
+    return util_recursive_rmdir(path, 0);
+}
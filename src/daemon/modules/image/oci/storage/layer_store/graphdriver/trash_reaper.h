@@ -0,0 +1,40 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide background removal of graphdriver directories
+ ******************************************************************************/
+#ifndef DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_GRAPHDRIVER_TRASH_REAPER_H
+#define DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_GRAPHDRIVER_TRASH_REAPER_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRASH_REAPER_DIR "trash"
+
+// create trash_dir and start the reaper, leftovers of last run in trash_dir are reaped first
+int trash_reaper_init(const char *trash_dir);
+
+// stop the reaper, directories left in trash are reaped on next start
+void trash_reaper_exit(void);
+
+// move path into trash and return, the reaper deletes it later with low io priority.
+// path is removed synchronously if reaper is not running or it can not be renamed into trash
+int trash_reaper_remove(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,673 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide deduplication of identical files across layer diff directories
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "layer_dedup.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+#include <linux/fs.h>
+
+#include "isula_libutils/log.h"
+#include "constants.h"
+#include "sha256.h"
+#include "utils.h"
+#include "utils_file.h"
+
+// kernels limit length of one dedupe request, 16MB is accepted by all of them
+#define DEDUP_RANGE_CHUNK (16 * 1024 * 1024)
+#define DEDUP_TMP_NAME_LEN 16
+
+struct dedup_file {
+    char *path;
+    size_t dir;
+    bool is_new;
+    char *digest;
+
+    dev_t dev;
+    ino_t ino;
+    nlink_t nlink;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    off_t size;
+    blkcnt_t blocks;
+    struct timespec mtim;
+};
+
+struct dedup_ctx {
+    const struct layer_dedup_dir *dirs;
+    const char *tmp_dir;
+    layer_dedup_mode_t mode;
+    const struct layer_dedup_ops *ops;
+    struct layer_dedup_stats *stats;
+    // reflink is not supported by the filesystem, auto mode uses hardlinks for the rest of the pass
+    bool no_reflink;
+
+    struct dedup_file *files;
+    size_t files_len;
+    size_t files_cap;
+};
+
+enum dedup_result {
+    DEDUP_SKIPPED,
+    DEDUP_REFLINKED,
+    DEDUP_HARDLINKED,
+};
+
+static bool dedup_should_stop(const struct dedup_ctx *ctx)
+{
+    return ctx->ops != NULL && ctx->ops->should_stop != NULL && ctx->ops->should_stop();
+}
+
+static int append_file(struct dedup_ctx *ctx, const char *path, size_t dir, const struct stat *st)
+{
+    struct dedup_file *file = NULL;
+
+    if (ctx->files_len == ctx->files_cap) {
+        struct dedup_file *tmp = NULL;
+        size_t new_cap = ctx->files_cap == 0 ? 64 : ctx->files_cap * 2;
+
+        if (new_cap > SIZE_MAX / sizeof(struct dedup_file)) {
+            ERROR("Too many files to dedup");
+            return -1;
+        }
+        if (util_mem_realloc((void **)&tmp, new_cap * sizeof(struct dedup_file), ctx->files,
+                             ctx->files_cap * sizeof(struct dedup_file)) != 0) {
+            ERROR("Out of memory");
+            return -1;
+        }
+        ctx->files = tmp;
+        ctx->files_cap = new_cap;
+    }
+
+    file = &ctx->files[ctx->files_len];
+    file->path = util_strdup_s(path);
+    file->dir = dir;
+    file->is_new = ctx->dirs[dir].is_new;
+    file->digest = NULL;
+    file->dev = st->st_dev;
+    file->ino = st->st_ino;
+    file->nlink = st->st_nlink;
+    file->mode = st->st_mode;
+    file->uid = st->st_uid;
+    file->gid = st->st_gid;
+    file->size = st->st_size;
+    file->blocks = st->st_blocks;
+    file->mtim = st->st_mtim;
+    ctx->files_len++;
+
+    return 0;
+}
+
+static int walk_dir(struct dedup_ctx *ctx, const char *path, size_t dir)
+{
+    int ret = 0;
+    DIR *dp = NULL;
+    struct dirent *entry = NULL;
+    char sub[PATH_MAX] = { 0 };
+
+    dp = opendir(path);
+    if (dp == NULL) {
+        // layer was removed after it was collected
+        if (errno == ENOENT) {
+            return 0;
+        }
+        SYSERROR("Failed to open dir %s", path);
+        return -1;
+    }
+
+    while ((entry = readdir(dp)) != NULL) {
+        struct stat st;
+        int nret;
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (dedup_should_stop(ctx)) {
+            ret = -1;
+            break;
+        }
+
+        nret = snprintf(sub, sizeof(sub), "%s/%s", path, entry->d_name);
+        if (nret < 0 || (size_t)nret >= sizeof(sub)) {
+            WARN("Path %s/%s is too long, skip it", path, entry->d_name);
+            continue;
+        }
+        if (lstat(sub, &st) != 0) {
+            if (errno == ENOENT) {
+                continue;
+            }
+            SYSERROR("Failed to stat %s", sub);
+            ret = -1;
+            break;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (walk_dir(ctx, sub, dir) != 0) {
+                ret = -1;
+                break;
+            }
+            continue;
+        }
+        // whiteouts are char devices, symlinks and devices have no data worth sharing
+        if (!S_ISREG(st.st_mode)) {
+            continue;
+        }
+        ctx->stats->files_scanned++;
+        if (st.st_size < LAYER_DEDUP_MIN_FILE_SIZE) {
+            continue;
+        }
+        if (append_file(ctx, sub, dir, &st) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+
+    (void)closedir(dp);
+    return ret;
+}
+
+// files of old dirs are preferred as source, so linked files of previous passes are reused
+static int cmp_source_order(const struct dedup_file *a, const struct dedup_file *b)
+{
+    if (a->is_new != b->is_new) {
+        return a->is_new ? 1 : -1;
+    }
+    if (a->dir != b->dir) {
+        return a->dir < b->dir ? -1 : 1;
+    }
+    return strcmp(a->path, b->path);
+}
+
+static int cmp_by_size(const void *a, const void *b)
+{
+    const struct dedup_file *fa = (const struct dedup_file *)a;
+    const struct dedup_file *fb = (const struct dedup_file *)b;
+
+    if (fa->size != fb->size) {
+        return fa->size < fb->size ? -1 : 1;
+    }
+    return cmp_source_order(fa, fb);
+}
+
+static int cmp_by_digest(const void *a, const void *b)
+{
+    const struct dedup_file *fa = (const struct dedup_file *)a;
+    const struct dedup_file *fb = (const struct dedup_file *)b;
+    int nret;
+
+    // files failed to hash are put at the end and left alone
+    if (fa->digest == NULL || fb->digest == NULL) {
+        if (fa->digest == fb->digest) {
+            return cmp_source_order(fa, fb);
+        }
+        return fa->digest == NULL ? 1 : -1;
+    }
+    nret = strcmp(fa->digest, fb->digest);
+    if (nret != 0) {
+        return nret;
+    }
+    return cmp_source_order(fa, fb);
+}
+
+static inline bool same_inode(const struct dedup_file *a, const struct dedup_file *b)
+{
+    return a->dev == b->dev && a->ino == b->ino;
+}
+
+static bool reflink_unsupported(int err)
+{
+    // ext4 and filesystems without reflink return EOPNOTSUPP, old kernels refuse read only dst with EPERM
+    return err == EOPNOTSUPP || err == ENOTTY || err == EINVAL || err == EXDEV || err == EPERM || err == EBADF;
+}
+
+#ifdef FIDEDUPERANGE
+// return 0 if dst shares extents of src, 1 if it is not supported, -1 on other failures
+static int reflink_file(const struct dedup_file *src, const struct dedup_file *dst)
+{
+    int ret = -1;
+    int src_fd = -1;
+    int dst_fd = -1;
+    off_t offset = 0;
+    struct file_dedupe_range *range = NULL;
+
+    src_fd = open(src->path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (src_fd < 0) {
+        SYSWARN("Failed to open %s", src->path);
+        goto out;
+    }
+    // dst is opened read only, as binaries of lower layers may be executed by containers
+    dst_fd = open(dst->path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (dst_fd < 0) {
+        SYSWARN("Failed to open %s", dst->path);
+        goto out;
+    }
+
+    range = util_common_calloc_s(sizeof(struct file_dedupe_range) + sizeof(struct file_dedupe_range_info));
+    if (range == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+
+    // kernel compares the data before sharing it, so a file changed after hashing is never corrupted
+    while (offset < dst->size) {
+        off_t len = dst->size - offset;
+
+        (void)memset(range, 0, sizeof(struct file_dedupe_range) + sizeof(struct file_dedupe_range_info));
+        range->src_offset = (uint64_t)offset;
+        range->src_length = (uint64_t)(len > DEDUP_RANGE_CHUNK ? DEDUP_RANGE_CHUNK : len);
+        range->dest_count = 1;
+        range->info[0].dest_fd = dst_fd;
+        range->info[0].dest_offset = (uint64_t)offset;
+
+        if (ioctl(src_fd, FIDEDUPERANGE, range) != 0) {
+            if (reflink_unsupported(errno)) {
+                ret = 1;
+                goto out;
+            }
+            SYSWARN("Failed to dedupe %s with %s", dst->path, src->path);
+            goto out;
+        }
+        if (range->info[0].status < 0) {
+            if (reflink_unsupported(-range->info[0].status)) {
+                ret = 1;
+                goto out;
+            }
+            errno = -range->info[0].status;
+            SYSWARN("Failed to dedupe %s with %s", dst->path, src->path);
+            goto out;
+        }
+        if (range->info[0].status == FILE_DEDUPE_RANGE_DIFFERS || range->info[0].bytes_deduped == 0) {
+            WARN("Content of %s differs from %s, skip it", dst->path, src->path);
+            goto out;
+        }
+        offset += (off_t)range->info[0].bytes_deduped;
+    }
+    ret = 0;
+
+out:
+    free(range);
+    if (src_fd >= 0) {
+        close(src_fd);
+    }
+    if (dst_fd >= 0) {
+        close(dst_fd);
+    }
+    return ret;
+}
+#else
+static int reflink_file(const struct dedup_file *src, const struct dedup_file *dst)
+{
+    return 1;
+}
+#endif
+
+static ssize_t read_xattr_list(const char *path, char **list)
+{
+    ssize_t size;
+
+    *list = NULL;
+    size = llistxattr(path, NULL, 0);
+    if (size < 0 && errno == ENOTSUP) {
+        return 0;
+    }
+    if (size <= 0) {
+        return size;
+    }
+
+    *list = util_common_calloc_s((size_t)size + 1);
+    if (*list == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    size = llistxattr(path, *list, (size_t)size);
+    if (size < 0) {
+        free(*list);
+        *list = NULL;
+    }
+    return size;
+}
+
+static char *read_xattr(const char *path, const char *name, ssize_t *size)
+{
+    char *value = NULL;
+
+    *size = lgetxattr(path, name, NULL, 0);
+    if (*size <= 0) {
+        return NULL;
+    }
+
+    value = util_common_calloc_s((size_t)*size);
+    if (value == NULL) {
+        ERROR("Out of memory");
+        *size = -1;
+        return NULL;
+    }
+    *size = lgetxattr(path, name, value, (size_t)*size);
+    if (*size < 0) {
+        free(value);
+        return NULL;
+    }
+    return value;
+}
+
+// capabilities, acls and labels are attributes of the inode, which is shared by hardlinks
+static bool same_xattrs(const char *a, const char *b)
+{
+    bool ret = false;
+    char *list_a = NULL;
+    char *list_b = NULL;
+    ssize_t len_a = read_xattr_list(a, &list_a);
+    ssize_t len_b = read_xattr_list(b, &list_b);
+    const char *name = NULL;
+
+    if (len_a < 0 || len_a != len_b) {
+        goto out;
+    }
+
+    // names are unique, so lists of the same length holding the same names are the same set
+    for (name = list_a; len_a > 0 && name < list_a + len_a; name += strlen(name) + 1) {
+        ssize_t size_a = 0;
+        ssize_t size_b = 0;
+        char *value_a = read_xattr(a, name, &size_a);
+        char *value_b = read_xattr(b, name, &size_b);
+        bool same = size_a >= 0 && size_a == size_b && (size_a == 0 || memcmp(value_a, value_b, (size_t)size_a) == 0);
+
+        free(value_a);
+        free(value_b);
+        if (!same) {
+            goto out;
+        }
+    }
+    ret = true;
+
+out:
+    free(list_a);
+    free(list_b);
+    return ret;
+}
+
+static bool can_hardlink(const struct dedup_file *src, const struct dedup_file *dst)
+{
+    // dst with other links in its own layer is a hardlink entry of the layer tar
+    if (src->dev != dst->dev || dst->nlink != 1) {
+        return false;
+    }
+    // metadata is seen by containers through every path of the inode
+    if (src->mode != dst->mode || src->uid != dst->uid || src->gid != dst->gid ||
+        src->mtim.tv_sec != dst->mtim.tv_sec || src->mtim.tv_nsec != dst->mtim.tv_nsec) {
+        return false;
+    }
+    return same_xattrs(src->path, dst->path);
+}
+
+static int hardlink_file(const char *tmp_dir, const struct dedup_file *src, const struct dedup_file *dst)
+{
+    int ret = -1;
+    int nret;
+    struct stat st;
+    struct stat parent_st;
+    struct timespec times[2];
+    char *parent = NULL;
+    char random[DEDUP_TMP_NAME_LEN + 1] = { 0 };
+    char tmp[PATH_MAX] = { 0 };
+
+    // walk was done without lock, make sure both files are still the ones hashed
+    if (lstat(src->path, &st) != 0 || st.st_ino != src->ino || st.st_dev != src->dev) {
+        goto out;
+    }
+    if (lstat(dst->path, &st) != 0 || st.st_ino != dst->ino || st.st_dev != dst->dev || st.st_nlink != 1) {
+        goto out;
+    }
+
+    parent = util_path_dir(dst->path);
+    if (parent == NULL || stat(parent, &parent_st) != 0) {
+        SYSWARN("Failed to stat parent dir of %s", dst->path);
+        goto out;
+    }
+
+    if (util_generate_random_str(random, DEDUP_TMP_NAME_LEN) != 0) {
+        ERROR("Failed to generate random name");
+        goto out;
+    }
+    nret = snprintf(tmp, sizeof(tmp), "%s/%s", tmp_dir, random);
+    if (nret < 0 || (size_t)nret >= sizeof(tmp)) {
+        ERROR("Failed to join tmp path");
+        goto out;
+    }
+
+    if (link(src->path, tmp) != 0) {
+        SYSWARN("Failed to link %s", src->path);
+        goto out;
+    }
+    // rename is atomic, dst path always points to one of the identical files
+    if (rename(tmp, dst->path) != 0) {
+        SYSWARN("Failed to replace %s", dst->path);
+        (void)unlink(tmp);
+        goto out;
+    }
+
+    // keep mtime of parent dir seen by containers
+    times[0] = parent_st.st_atim;
+    times[1] = parent_st.st_mtim;
+    if (utimensat(AT_FDCWD, parent, times, AT_SYMLINK_NOFOLLOW) != 0) {
+        SYSWARN("Failed to restore times of %s", parent);
+    }
+    ret = 0;
+
+out:
+    free(parent);
+    return ret;
+}
+
+static enum dedup_result dedup_file(struct dedup_ctx *ctx, const struct dedup_file *src, const struct dedup_file *dst,
+                                    bool dst_layer_linked)
+{
+    int nret;
+    bool hardlink = ctx->mode == LAYER_DEDUP_HARDLINK || ctx->mode == LAYER_DEDUP_AUTO;
+
+    if (ctx->mode != LAYER_DEDUP_HARDLINK && !ctx->no_reflink) {
+        nret = reflink_file(src, dst);
+        if (nret == 0) {
+            ctx->stats->files_deduped++;
+            ctx->stats->bytes_saved += (uint64_t)dst->blocks * 512;
+            return DEDUP_REFLINKED;
+        }
+        if (nret < 0) {
+            return DEDUP_SKIPPED;
+        }
+        ctx->no_reflink = true;
+        WARN("Reflink is not supported for %s%s", dst->path,
+             ctx->mode == LAYER_DEDUP_AUTO ? ", fall back to hardlink" : "");
+    }
+
+    if (!hardlink) {
+        return DEDUP_SKIPPED;
+    }
+    if (dst_layer_linked || !ctx->dirs[dst->dir].allow_hardlink || !can_hardlink(src, dst)) {
+        return DEDUP_SKIPPED;
+    }
+
+    if (ctx->ops != NULL && ctx->ops->hold != NULL && !ctx->ops->hold(ctx->dirs[src->dir].id, ctx->dirs[dst->dir].id)) {
+        return DEDUP_SKIPPED;
+    }
+    nret = hardlink_file(ctx->tmp_dir, src, dst);
+    if (ctx->ops != NULL && ctx->ops->release != NULL) {
+        ctx->ops->release();
+    }
+    if (nret != 0) {
+        return DEDUP_SKIPPED;
+    }
+
+    ctx->stats->files_deduped++;
+    ctx->stats->bytes_saved += (uint64_t)dst->blocks * 512;
+    ctx->stats->page_cache_saved += (uint64_t)dst->size;
+    return DEDUP_HARDLINKED;
+}
+
+static bool dir_in(const size_t *dirs, size_t len, size_t dir)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (dirs[i] == dir) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// group holds identical files sorted in source order, the first one is kept and the others point to it
+static int dedup_group(struct dedup_ctx *ctx, const struct dedup_file *group, size_t len)
+{
+    size_t i;
+    size_t linked_len = 0;
+    size_t *linked = NULL;
+    const struct dedup_file *src = &group[0];
+
+    // layers holding a path of src inode, tar of a layer changes if two of its paths share one inode
+    linked = util_smart_calloc_s(sizeof(size_t), len);
+    if (linked == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    for (i = 0; i < len; i++) {
+        if (same_inode(&group[i], src) && !dir_in(linked, linked_len, group[i].dir)) {
+            linked[linked_len++] = group[i].dir;
+        }
+    }
+
+    for (i = 1; i < len; i++) {
+        const struct dedup_file *dst = &group[i];
+
+        if (dst->dir == src->dir || !dst->is_new || same_inode(dst, src)) {
+            continue;
+        }
+        if (dedup_should_stop(ctx)) {
+            free(linked);
+            return -1;
+        }
+        if (dedup_file(ctx, src, dst, dir_in(linked, linked_len, dst->dir)) == DEDUP_HARDLINKED) {
+            linked[linked_len++] = dst->dir;
+        }
+    }
+
+    free(linked);
+    return 0;
+}
+
+static int dedup_same_size(struct dedup_ctx *ctx, struct dedup_file *run, size_t len)
+{
+    size_t i;
+    size_t start;
+    bool has_new = false;
+    bool multi_dirs = false;
+
+    for (i = 0; i < len; i++) {
+        has_new = has_new || run[i].is_new;
+        multi_dirs = multi_dirs || run[i].dir != run[0].dir;
+    }
+    // only hash files which may be deduplicated
+    if (!has_new || !multi_dirs) {
+        return 0;
+    }
+
+    for (i = 0; i < len; i++) {
+        if (dedup_should_stop(ctx)) {
+            return -1;
+        }
+        run[i].digest = sha256_full_file_digest(run[i].path);
+        if (run[i].digest == NULL) {
+            WARN("Failed to hash %s, skip it", run[i].path);
+        }
+    }
+    qsort(run, len, sizeof(struct dedup_file), cmp_by_digest);
+
+    for (start = 0; start < len && run[start].digest != NULL; start = i) {
+        i = start + 1;
+        while (i < len && run[i].digest != NULL && strcmp(run[i].digest, run[start].digest) == 0) {
+            i++;
+        }
+        if (i - start > 1 && dedup_group(ctx, &run[start], i - start) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int layer_dedup_dirs(const struct layer_dedup_dir *dirs, size_t dirs_len, const char *tmp_dir,
+                     layer_dedup_mode_t mode, const struct layer_dedup_ops *ops, struct layer_dedup_stats *stats)
+{
+    int ret = -1;
+    size_t i;
+    size_t start;
+    struct dedup_ctx ctx = { 0 };
+
+    if ((dirs == NULL && dirs_len > 0) || tmp_dir == NULL || stats == NULL || mode == LAYER_DEDUP_OFF) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    ctx.dirs = dirs;
+    ctx.tmp_dir = tmp_dir;
+    ctx.mode = mode;
+    ctx.ops = ops;
+    ctx.stats = stats;
+
+    // links left by an interrupted pass are not used by any layer
+    if (util_recursive_rmdir(tmp_dir, 0) != 0 || util_mkdir_p(tmp_dir, TEMP_DIRECTORY_MODE) != 0) {
+        ERROR("Failed to prepare dedup tmp dir %s", tmp_dir);
+        return -1;
+    }
+
+    for (i = 0; i < dirs_len; i++) {
+        if (walk_dir(&ctx, dirs[i].dir, i) != 0) {
+            goto out;
+        }
+    }
+
+    if (ctx.files_len > 0) {
+        qsort(ctx.files, ctx.files_len, sizeof(struct dedup_file), cmp_by_size);
+    }
+    for (start = 0; start < ctx.files_len; start = i) {
+        i = start + 1;
+        while (i < ctx.files_len && ctx.files[i].size == ctx.files[start].size) {
+            i++;
+        }
+        if (i - start > 1 && dedup_same_size(&ctx, &ctx.files[start], i - start) != 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+
+out:
+    for (i = 0; i < ctx.files_len; i++) {
+        free(ctx.files[i].path);
+        free(ctx.files[i].digest);
+    }
+    free(ctx.files);
+    (void)util_recursive_rmdir(tmp_dir, 0);
+    return ret;
+}
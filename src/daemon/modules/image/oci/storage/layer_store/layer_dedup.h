@@ -0,0 +1,72 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide deduplication of identical files across layer diff directories
+ ******************************************************************************/
+#ifndef DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_LAYER_DEDUP_H
+#define DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_LAYER_DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// tmp dir under driver home, on the same filesystem as layer diff dirs
+#define LAYER_DEDUP_TMP_DIR "dedup"
+
+// files smaller than this are not worth hashing
+#define LAYER_DEDUP_MIN_FILE_SIZE (16 * 1024)
+
+struct layer_dedup_dir {
+    const char *id;
+    const char *dir;
+    // only files of new dirs are replaced, files of old dirs were checked by previous passes
+    bool is_new;
+    // files of lower layers of containers must keep their inode, so only reflink is allowed
+    bool allow_hardlink;
+};
+
+struct layer_dedup_stats {
+    uint64_t files_scanned;
+    uint64_t files_deduped;
+    // disk space given back to filesystem
+    uint64_t bytes_saved;
+    // size of files sharing one inode, which are cached only once
+    uint64_t page_cache_saved;
+};
+
+struct layer_dedup_ops {
+    // called before a file of dst layer is replaced by a hardlink, return false to skip it.
+    // both layers must be kept until release is called. reflinks keep the inode of dst file,
+    // so they are done without holding layers
+    bool (*hold)(const char *src_id, const char *dst_id);
+    void (*release)(void);
+    // return true to abort current pass
+    bool (*should_stop)(void);
+};
+
+// replace files of new dirs with reflinks or hardlinks of identical files in other dirs,
+// files are identical if they have the same size and sha256 digest. tmp_dir must be on
+// the same filesystem as dirs, hardlinks are created in it and renamed over duplicates
+int layer_dedup_dirs(const struct layer_dedup_dir *dirs, size_t dirs_len, const char *tmp_dir,
+                     layer_dedup_mode_t mode, const struct layer_dedup_ops *ops, struct layer_dedup_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DAEMON_MODULES_IMAGE_OCI_STORAGE_LAYER_STORE_LAYER_DEDUP_H
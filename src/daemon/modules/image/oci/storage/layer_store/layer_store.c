@@ -25,11 +25,14 @@
 #include <isula_libutils/json_common.h>
 #include <isula_libutils/log.h>
 #include <isula_libutils/storage_entry.h>
-#include <isula_libutils/go_crc64.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
+#include <time.h>
 
 #include "util_archive.h"
 #include "storage.h"
@@ -44,13 +47,18 @@
 #include "util_gzip.h"
 #include "http.h"
 #include "utils_base64.h"
+#include "utils_crc64.h"
+#include "buffer.h"
 #include "constants.h"
 #include "path.h"
+#include "layer_dedup.h"
+#include "trash_reaper.h"
 #ifdef ENABLE_REMOTE_LAYER_STORE
 #include "ro_symlink_maintain.h"
 #endif
 
 #define PAYLOAD_CRC_LEN 12
+#define LAYER_CHECK_STAMPS_FILE "check-stamps"
 
 typedef struct __layer_store_metadata_t {
     pthread_rwlock_t rwlock;
@@ -75,10 +83,34 @@ typedef struct {
 static layer_store_metadata g_metadata;
 static char *g_root_dir;
 static char *g_run_dir;
+// save stamps of layers on exit, and skip integration check of layers whose stamps are not changed
+static bool g_check_skip_unchanged;
+// layer id -> stamp saved at last clean shutdown
+static map_t *g_check_stamps;
 #ifdef ENABLE_REMOTE_LAYER_STORE
 static bool g_enable_remote_layer;
 #endif
 
+// deduplicate identical files of read only layers in background
+struct layer_dedup_worker {
+    layer_dedup_mode_t mode;
+    int64_t interval;
+    char *tmp_dir;
+    pthread_t tid;
+    bool running;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // ids of layers checked by previous passes, only used by the worker
+    map_t *checked;
+    struct layer_dedup_stats total;
+};
+
+static struct layer_dedup_worker g_dedup = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
 static inline char *tar_split_path(const char *id);
 static inline char *mountpoint_json_path(const char *id);
 static inline char *layer_json_path(const char *id);
@@ -141,6 +173,9 @@ void layer_store_cleanup(void)
 
     pthread_rwlock_destroy(&(g_metadata.rwlock));
 
+    map_free(g_check_stamps);
+    g_check_stamps = NULL;
+
     free(g_run_dir);
     g_run_dir = NULL;
     free(g_root_dir);
@@ -279,6 +314,9 @@ static bool init_from_conf(const struct storage_module_init_options *conf)
 #ifdef ENABLE_REMOTE_LAYER_STORE
     g_enable_remote_layer = conf->enable_remote_layer;
 #endif
+    g_check_skip_unchanged = conf->integration_check_skip_unchanged;
+    g_dedup.mode = conf->layer_dedup;
+    g_dedup.interval = conf->layer_dedup_interval;
 
     return true;
 free_out:
@@ -843,7 +881,7 @@ static int make_tar_split_file(const char *lid, const struct io_read_wrapper *di
     }
 
     // step 4: gzip tar split, and save file.
-    ret = util_gzip_z(save_fname, save_fname_gz, SECURE_CONFIG_FILE_MODE);
+    ret = util_gzip_z_parallel(save_fname, save_fname_gz, SECURE_CONFIG_FILE_MODE, NULL);
 
     // always remove tmp tar split file, even though gzip failed.
     // if remove failed, just log message
@@ -962,7 +1000,8 @@ static int layer_store_remove_layer(const char *id)
         return -1;
     }
 
-    ret = util_recursive_rmdir(rpath, 0);
+    // moved into trash of the driver when its reaper runs, removed in place otherwise
+    ret = trash_reaper_remove(rpath);
     free(rpath);
     return ret;
 }
@@ -1715,6 +1754,465 @@ unlock_out:
     return ret;
 }
 
+static char *check_stamps_path(void)
+{
+    char *result = NULL;
+    int nret = 0;
+
+    nret = asprintf(&result, "%s/%s", g_root_dir, LAYER_CHECK_STAMPS_FILE);
+    if (nret < 0 || nret > PATH_MAX) {
+        SYSERROR("Create check stamps path failed");
+        return NULL;
+    }
+
+    return result;
+}
+
+// image layers are never written after creation, a layer created or removed before a crash
+// gets a new stamp, so sizes and mtimes of its metadata files are enough to find it.
+// files under the diff directory are not covered, a layer whose content was changed or
+// damaged while its metadata stayed the same is trusted, the same as without integration check
+static char *layer_check_stamp(const char *id)
+{
+    char *tspath = NULL;
+    char *jpath = NULL;
+    char *stamp = NULL;
+    struct stat ts_st;
+    struct stat json_st;
+    int nret = 0;
+
+    tspath = tar_split_path(id);
+    jpath = layer_json_path(id);
+    if (tspath == NULL || jpath == NULL) {
+        goto out;
+    }
+
+    if (stat(tspath, &ts_st) != 0 || stat(jpath, &json_st) != 0) {
+        goto out;
+    }
+
+    nret = asprintf(&stamp, "%lld:%lld.%09ld:%lld:%lld.%09ld", (long long)ts_st.st_size, (long long)ts_st.st_mtim.tv_sec,
+                    ts_st.st_mtim.tv_nsec, (long long)json_st.st_size, (long long)json_st.st_mtim.tv_sec,
+                    json_st.st_mtim.tv_nsec);
+    if (nret < 0) {
+        ERROR("Sprintf check stamp of layer %s failed", id);
+        stamp = NULL;
+    }
+
+out:
+    free(tspath);
+    free(jpath);
+    return stamp;
+}
+
+static bool parse_check_stamp_cb(const char *line, void *context)
+{
+    map_t *stamps = (map_t *)context;
+    char *dup = NULL;
+    char *stamp = NULL;
+
+    dup = util_strdup_s(line);
+    stamp = strchr(dup, ' ');
+    if (stamp == NULL) {
+        WARN("Invalid check stamp line: %s, ignore it", line);
+        goto out;
+    }
+    *stamp = '\0';
+    stamp++;
+
+    if (!map_replace(stamps, (void *)dup, (void *)stamp)) {
+        WARN("Add check stamp of layer: %s failed, ignore it", dup);
+    }
+
+out:
+    free(dup);
+    return true;
+}
+
+// stamps are removed once read, only a clean shutdown of this run writes them again,
+// so stamps of an older shutdown are never trusted after a crash
+static void load_check_stamps(bool use_stamps)
+{
+    FILE *fp = NULL;
+    char *path = NULL;
+
+    path = check_stamps_path();
+    if (path == NULL) {
+        return;
+    }
+
+    if (!use_stamps) {
+        goto remove_out;
+    }
+
+    g_check_stamps = map_new(MAP_STR_STR, MAP_DEFAULT_CMP_FUNC, MAP_DEFAULT_FREE_FUNC);
+    if (g_check_stamps == NULL) {
+        ERROR("Out of memory");
+        goto remove_out;
+    }
+
+    fp = util_fopen(path, "r");
+    if (fp == NULL) {
+        if (errno != ENOENT) {
+            SYSWARN("Open check stamps file %s failed", path);
+        }
+        goto remove_out;
+    }
+
+    if (util_proc_file_line_by_line(fp, parse_check_stamp_cb, (void *)g_check_stamps) != 0) {
+        WARN("Load check stamps from %s failed, check all layers", path);
+        map_clear(g_check_stamps);
+    }
+    fclose(fp);
+
+remove_out:
+    if (util_path_remove(path) != 0) {
+        SYSWARN("Remove check stamps file %s failed", path);
+    }
+    free(path);
+}
+
+static void save_check_stamps(void)
+{
+    struct linked_list *item = NULL;
+    Buffer *buf = NULL;
+    char *path = NULL;
+
+    path = check_stamps_path();
+    if (path == NULL) {
+        return;
+    }
+
+    buf = buffer_alloc(PATH_MAX);
+    if (buf == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+
+    if (!layer_store_lock(false)) {
+        goto out;
+    }
+    linked_list_for_each(item, &(g_metadata.layers_list)) {
+        layer_t *l = (layer_t *)item->elem;
+        char *stamp = NULL;
+
+        // container layers are never checked
+        if (l->slayer == NULL || l->slayer->diff_digest == NULL) {
+            continue;
+        }
+        stamp = layer_check_stamp(l->slayer->id);
+        if (stamp == NULL) {
+            continue;
+        }
+        if (buffer_append(buf, l->slayer->id, strlen(l->slayer->id)) != 0 || buffer_append(buf, " ", 1) != 0 ||
+            buffer_append(buf, stamp, strlen(stamp)) != 0 || buffer_append(buf, "\n", 1) != 0) {
+            ERROR("Out of memory");
+            free(stamp);
+            layer_store_unlock();
+            goto out;
+        }
+        free(stamp);
+    }
+    layer_store_unlock();
+
+    if (util_atomic_write_file(path, buf->contents, buffer_strlen(buf), SECURE_CONFIG_FILE_MODE, true) != 0) {
+        ERROR("Save check stamps to %s failed", path);
+    }
+
+out:
+    buffer_free(buf);
+    free(path);
+}
+
+bool layer_store_unchanged_since_shutdown(const char *id)
+{
+    char *stamp = NULL;
+    const char *saved = NULL;
+    bool ret = false;
+
+    if (id == NULL || g_check_stamps == NULL) {
+        return false;
+    }
+
+    saved = map_search(g_check_stamps, (void *)id);
+    if (saved == NULL) {
+        return false;
+    }
+
+    stamp = layer_check_stamp(id);
+    ret = (stamp != NULL && strcmp(stamp, saved) == 0);
+    free(stamp);
+    return ret;
+}
+
+// layers in parent chain of container layers or mounted layers are lowers of overlay mounts,
+// changing their files under a mount is undefined behaviour of overlay. caller holds store lock
+static bool is_lower_of_mount(const char *id)
+{
+    struct linked_list *item = NULL;
+
+    linked_list_for_each(item, &(g_metadata.layers_list)) {
+        layer_t *l = (layer_t *)item->elem;
+        const char *cur = NULL;
+
+        if (!l->slayer->writable && (l->smount_point == NULL || l->smount_point->count <= 0)) {
+            continue;
+        }
+        cur = l->slayer->id;
+        while (cur != NULL) {
+            layer_t *tl = NULL;
+
+            if (strcmp(cur, id) == 0) {
+                return true;
+            }
+            tl = map_search(g_metadata.by_id, (void *)cur);
+            cur = tl != NULL ? tl->slayer->parent : NULL;
+        }
+    }
+
+    return false;
+}
+
+static bool dedup_hold_layers(const char *src_id, const char *dst_id)
+{
+    if (!layer_store_lock(false)) {
+        return false;
+    }
+
+    // layers created after the dirs were collected may use dst as lower
+    if (map_search(g_metadata.by_id, (void *)src_id) == NULL || map_search(g_metadata.by_id, (void *)dst_id) == NULL ||
+        is_lower_of_mount(dst_id)) {
+        layer_store_unlock();
+        return false;
+    }
+
+    return true;
+}
+
+static void dedup_release_layers(void)
+{
+    layer_store_unlock();
+}
+
+static bool dedup_should_stop(void)
+{
+    bool stop = false;
+
+    (void)pthread_mutex_lock(&g_dedup.lock);
+    stop = g_dedup.stop;
+    (void)pthread_mutex_unlock(&g_dedup.lock);
+
+    return stop;
+}
+
+static void free_dedup_dirs(struct layer_dedup_dir *dirs, size_t dirs_len)
+{
+    size_t i;
+
+    for (i = 0; i < dirs_len; i++) {
+        free((void *)dirs[i].id);
+        free((void *)dirs[i].dir);
+    }
+    free(dirs);
+}
+
+// diff dirs of complete read only layers, only overlay layers have them
+static int collect_dedup_dirs(struct layer_dedup_dir **dirs, size_t *dirs_len, size_t *new_len)
+{
+    int ret = -1;
+    size_t len = 0;
+    struct layer_dedup_dir *result = NULL;
+    struct linked_list *item = NULL;
+
+    if (!layer_store_lock(false)) {
+        return -1;
+    }
+
+    if (g_metadata.layers_list_len == 0) {
+        ret = 0;
+        goto unlock_out;
+    }
+    result = util_smart_calloc_s(sizeof(struct layer_dedup_dir), g_metadata.layers_list_len);
+    if (result == NULL) {
+        ERROR("Out of memory");
+        goto unlock_out;
+    }
+
+    linked_list_for_each(item, &(g_metadata.layers_list)) {
+        layer_t *l = (layer_t *)item->elem;
+        container_inspect_graph_driver *d_meta = NULL;
+
+        if (l->slayer->writable || l->slayer->incompelte) {
+            continue;
+        }
+        d_meta = graphdriver_get_metadata(l->slayer->id);
+        if (d_meta != NULL && d_meta->data != NULL && d_meta->data->upper_dir != NULL) {
+            result[len].id = util_strdup_s(l->slayer->id);
+            result[len].dir = util_strdup_s(d_meta->data->upper_dir);
+            result[len].is_new = g_dedup.checked == NULL || map_search(g_dedup.checked, (void *)l->slayer->id) == NULL;
+            result[len].allow_hardlink = !is_lower_of_mount(l->slayer->id);
+            *new_len += result[len].is_new ? 1 : 0;
+            len++;
+        }
+        free_container_inspect_graph_driver(d_meta);
+    }
+    ret = 0;
+
+unlock_out:
+    layer_store_unlock();
+    if (ret != 0) {
+        free(result);
+        return ret;
+    }
+    *dirs = result;
+    *dirs_len = len;
+    return 0;
+}
+
+static void layer_dedup_pass(void)
+{
+    size_t i;
+    size_t dirs_len = 0;
+    size_t new_len = 0;
+    bool checked_value = true;
+    map_t *checked = NULL;
+    struct layer_dedup_dir *dirs = NULL;
+    struct layer_dedup_stats stats = { 0 };
+    const struct layer_dedup_ops ops = {
+        .hold = dedup_hold_layers,
+        .release = dedup_release_layers,
+        .should_stop = dedup_should_stop,
+    };
+
+    if (collect_dedup_dirs(&dirs, &dirs_len, &new_len) != 0) {
+        ERROR("Failed to collect layers to dedup");
+        return;
+    }
+    if (new_len == 0) {
+        goto out;
+    }
+
+    if (layer_dedup_dirs(dirs, dirs_len, g_dedup.tmp_dir, g_dedup.mode, &ops, &stats) != 0) {
+        if (!dedup_should_stop()) {
+            ERROR("Failed to dedup files of layers");
+        }
+        goto out;
+    }
+
+    // rebuilt on each pass, so removed layers are dropped
+    checked = map_new(MAP_STR_BOOL, MAP_DEFAULT_CMP_FUNC, MAP_DEFAULT_FREE_FUNC);
+    if (checked == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+    for (i = 0; i < dirs_len; i++) {
+        if (!map_replace(checked, (void *)dirs[i].id, (void *)&checked_value)) {
+            ERROR("Failed to record dedup of layer %s", dirs[i].id);
+            map_free(checked);
+            goto out;
+        }
+    }
+    map_free(g_dedup.checked);
+    g_dedup.checked = checked;
+
+    g_dedup.total.files_scanned += stats.files_scanned;
+    g_dedup.total.files_deduped += stats.files_deduped;
+    g_dedup.total.bytes_saved += stats.bytes_saved;
+    g_dedup.total.page_cache_saved += stats.page_cache_saved;
+    INFO("Layer dedup: %zu new layers, %" PRIu64 " files scanned, %" PRIu64 " files deduplicated, saved %" PRIu64
+         " bytes of disk and %" PRIu64 " bytes of page cache, %" PRIu64 " bytes of disk and %" PRIu64
+         " bytes of page cache since start", new_len, stats.files_scanned, stats.files_deduped, stats.bytes_saved,
+         stats.page_cache_saved, g_dedup.total.bytes_saved, g_dedup.total.page_cache_saved);
+
+out:
+    free_dedup_dirs(dirs, dirs_len);
+}
+
+static void *layer_dedup_routine(void *arg)
+{
+    struct timespec deadline = { 0 };
+
+    prctl(PR_SET_NAME, "LayerDedup");
+
+    (void)pthread_mutex_lock(&g_dedup.lock);
+    while (!g_dedup.stop) {
+        // first pass waits for one interval too, so it does not compete with daemon start
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += g_dedup.interval;
+        while (!g_dedup.stop) {
+            if (pthread_cond_timedwait(&g_dedup.cond, &g_dedup.lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (g_dedup.stop) {
+            break;
+        }
+        (void)pthread_mutex_unlock(&g_dedup.lock);
+
+        layer_dedup_pass();
+
+        (void)pthread_mutex_lock(&g_dedup.lock);
+    }
+    (void)pthread_mutex_unlock(&g_dedup.lock);
+
+    return NULL;
+}
+
+static void layer_dedup_start(const struct storage_module_init_options *conf)
+{
+    int nret;
+
+    if (g_dedup.mode == LAYER_DEDUP_OFF) {
+        return;
+    }
+#ifdef ENABLE_REMOTE_LAYER_STORE
+    // read only layers may live in shared remote store
+    if (g_enable_remote_layer) {
+        WARN("Layer dedup is not supported with remote layer store");
+        return;
+    }
+#endif
+
+    nret = asprintf(&g_dedup.tmp_dir, "%s/%s/%s", conf->storage_root, conf->driver_name, LAYER_DEDUP_TMP_DIR);
+    if (nret < 0 || nret > PATH_MAX) {
+        SYSERROR("Create dedup tmp path failed");
+        g_dedup.tmp_dir = NULL;
+        return;
+    }
+
+    g_dedup.stop = false;
+    nret = pthread_create(&g_dedup.tid, NULL, layer_dedup_routine, NULL);
+    if (nret != 0) {
+        errno = nret;
+        SYSERROR("Failed to create layer dedup thread");
+        free(g_dedup.tmp_dir);
+        g_dedup.tmp_dir = NULL;
+        return;
+    }
+    g_dedup.running = true;
+}
+
+static void layer_dedup_stop(void)
+{
+    if (!g_dedup.running) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&g_dedup.lock);
+    g_dedup.stop = true;
+    (void)pthread_cond_broadcast(&g_dedup.cond);
+    (void)pthread_mutex_unlock(&g_dedup.lock);
+
+    // pass in progress is aborted between two files
+    (void)pthread_join(g_dedup.tid, NULL);
+    g_dedup.running = false;
+
+    map_free(g_dedup.checked);
+    g_dedup.checked = NULL;
+    free(g_dedup.tmp_dir);
+    g_dedup.tmp_dir = NULL;
+}
+
 int layer_store_init(const struct storage_module_init_options *conf)
 {
     int nret = 0;
@@ -1776,6 +2274,12 @@ int layer_store_init(const struct storage_module_init_options *conf)
         goto free_out;
     }
 
+    if (g_check_skip_unchanged) {
+        load_check_stamps(conf->integration_check);
+    }
+
+    layer_dedup_start(conf);
+
     DEBUG("Init layer store success");
     return 0;
 free_out:
@@ -1785,6 +2289,10 @@ free_out:
 
 void layer_store_exit(void)
 {
+    layer_dedup_stop();
+    if (g_check_skip_unchanged) {
+        save_check_stamps();
+    }
     graphdriver_cleanup();
 }
 
@@ -1814,61 +2322,6 @@ static uint64_t payload_to_crc(char *payload)
     return crc;
 }
 
-static int file_crc64(char *file, uint64_t *crc, uint64_t policy)
-{
-#define BLKSIZE 32768
-    int ret = 0;
-    const isula_crc_table_t *ctab = NULL;
-    int fd = 0;
-    void *buffer = NULL;
-    ssize_t size = 0;
-
-    fd = util_open(file, O_RDONLY, 0);
-    if (fd < 0) {
-        SYSERROR("Open file: %s, failed", file);
-        return -1;
-    }
-
-    ctab = new_isula_crc_table(policy);
-    if (ctab == NULL || !ctab->inited) {
-        ERROR("create crc table failed");
-        ret = -1;
-        goto out;
-    }
-
-    buffer = util_common_calloc_s(BLKSIZE);
-    if (buffer == NULL) {
-        ERROR("out of memory");
-        ret = -1;
-        goto out;
-    }
-
-    *crc = 0;
-    while (true) {
-        size = util_read_nointr(fd, buffer, BLKSIZE);
-        if (size < 0) {
-            SYSERROR("read file %s failed", file);
-            ret = -1;
-            break;
-        } else if (size == 0) {
-            break;
-        }
-
-        if (!isula_crc_update(ctab, crc, buffer, (size_t)size)) {
-            ERROR("crc update failed");
-            ret = -1;
-            break;
-        }
-    }
-
-out:
-
-    close(fd);
-    free(buffer);
-
-    return ret;
-}
-
 static int valid_crc64(storage_entry *entry, char *rootfs)
 {
     int ret = 0;
@@ -1904,7 +2357,7 @@ static int valid_crc64(storage_entry *entry, char *rootfs)
             goto out;
         }
 
-        ret = file_crc64(file, &crc, ISO_POLY);
+        ret = util_file_crc64_iso(file, &crc);
         if (ret != 0) {
             ERROR("calc crc of file %s failed", file);
             ret = -1;
@@ -70,6 +70,8 @@ void free_layer_opts(struct layer_opts *opts);
 int layer_store_get_layer_fs_info(const char *layer_id, imagetool_fs_info *fs_info);
 
 int layer_store_check(const char *id);
+// layer is not changed since stamps were saved on last clean shutdown, only works with oci.layer_check_skip_unchanged
+bool layer_store_unchanged_since_shutdown(const char *id);
 
 container_inspect_graph_driver *layer_store_get_metadata_by_layer_id(const char *id);
 
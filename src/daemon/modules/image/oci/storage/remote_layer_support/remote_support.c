@@ -15,19 +15,49 @@
 
 #include "remote_support.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
+#include <sys/inotify.h>
+#include <sys/prctl.h>
+#include <unistd.h>
 
 #include "isula_libutils/log.h"
 #include "utils.h"
 
+// safety rescan in case of missed events, e.g. inotify queue overflow
+#define REMOTE_RESCAN_INTERVAL_MS (60 * 1000)
+// used when the remote dirs can not be watched
+#define REMOTE_POLL_INTERVAL_MS (5 * 1000)
+// wait for a burst of events to settle before refreshing
+#define REMOTE_EVENT_SETTLE_MS 100
+#define REMOTE_EVENT_SETTLE_MAX_ROUNDS 20
+// layer contents may land after its dir shows up, refresh once more after events
+#define REMOTE_FOLLOWUP_MS 1000
+#define REMOTE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR)
+#define REMOTE_WATCH_DIRS 3
+#define REMOTE_EVENT_BUFFER_SIZE 8192
+
 struct supporters {
     struct remote_image_data *image_data;
     struct remote_layer_data *layer_data;
     struct remote_overlay_data *overlay_data;
     pthread_rwlock_t *remote_lock;
+
+    int inotify_fd;
+    int watches[REMOTE_WATCH_DIRS];
+    // written by remote_stop_refresh_thread() to wake up and stop the thread
+    int stop_pipe[2];
+    pthread_t thread;
+    bool started;
 };
 
-static struct supporters supporters;
+static struct supporters supporters = {
+    .inotify_fd = -1,
+    .watches = { -1, -1, -1 },
+    .stop_pipe = { -1, -1 },
+};
 
 static inline bool remote_refresh_lock(pthread_rwlock_t *remote_lock, bool writable)
 {
@@ -58,33 +88,179 @@ static inline void remote_refresh_unlock(pthread_rwlock_t *remote_lock)
     }
 }
 
+static void remote_do_refresh(struct supporters *refresh_supporters)
+{
+    DEBUG("remote refresh start\n");
+
+    if (!remote_refresh_lock(refresh_supporters->remote_lock, true)) {
+        WARN("Failed to lock remote store failed, try to refresh later");
+        return;
+    }
+    remote_overlay_refresh(refresh_supporters->overlay_data);
+    remote_layer_refresh(refresh_supporters->layer_data);
+    remote_image_refresh(refresh_supporters->image_data);
+    remote_refresh_unlock(refresh_supporters->remote_lock);
+
+    DEBUG("remote refresh end\n");
+}
+
+// watch remote dirs not watched yet, return true if all of them are watched
+static bool remote_add_watches(struct supporters *refresh_supporters)
+{
+    size_t i;
+    bool all_watched = true;
+    const char *dirs[REMOTE_WATCH_DIRS] = { refresh_supporters->overlay_data->overlay_ro,
+                                            refresh_supporters->layer_data->layer_ro,
+                                            refresh_supporters->image_data->image_home };
+
+    if (refresh_supporters->inotify_fd < 0) {
+        return false;
+    }
+
+    for (i = 0; i < REMOTE_WATCH_DIRS; i++) {
+        if (refresh_supporters->watches[i] >= 0) {
+            continue;
+        }
+        refresh_supporters->watches[i] = inotify_add_watch(refresh_supporters->inotify_fd, dirs[i], REMOTE_WATCH_MASK);
+        if (refresh_supporters->watches[i] < 0) {
+            SYSWARN("Failed to watch remote dir %s, fall back to polling it", dirs[i]);
+            all_watched = false;
+        }
+    }
+
+    return all_watched;
+}
+
+// drain pending events, return true if any event arrived
+static bool remote_drain_events(struct supporters *refresh_supporters)
+{
+    char buffer[REMOTE_EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event = NULL;
+    bool got = false;
+    ssize_t len = 0;
+    ssize_t offset = 0;
+    size_t i;
+
+    while (true) {
+        len = read(refresh_supporters->inotify_fd, buffer, sizeof(buffer));
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        got = true;
+
+        for (offset = 0; offset < len; offset += (ssize_t)(sizeof(struct inotify_event) + event->len)) {
+            event = (const struct inotify_event *)(buffer + offset);
+            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                WARN("Remote dir events overflow, rescan all");
+            }
+            if ((event->mask & IN_IGNORED) == 0) {
+                continue;
+            }
+            // watched dir is gone, watch it again when it is back
+            for (i = 0; i < REMOTE_WATCH_DIRS; i++) {
+                if (refresh_supporters->watches[i] == event->wd) {
+                    refresh_supporters->watches[i] = -1;
+                }
+            }
+        }
+    }
+
+    return got;
+}
+
+static void remote_settle_events(struct supporters *refresh_supporters)
+{
+    int i;
+    struct pollfd pfd = { .fd = refresh_supporters->inotify_fd, .events = POLLIN };
+
+    for (i = 0; i < REMOTE_EVENT_SETTLE_MAX_ROUNDS; i++) {
+        if (poll(&pfd, 1, REMOTE_EVENT_SETTLE_MS) <= 0) {
+            return;
+        }
+        (void)remote_drain_events(refresh_supporters);
+    }
+}
+
 static void *remote_refresh_ro_symbol_link(void *arg)
 {
     struct supporters *refresh_supporters = (struct supporters *)arg;
+    struct pollfd pfds[2];
+    bool followup = false;
+    bool all_watched = false;
+    int timeout = 0;
+    int nret = 0;
+
     prctl(PR_SET_NAME, "RoLayerRefresh");
 
     while (true) {
-        util_usleep_nointerupt(5 * 1000 * 1000);
-        DEBUG("remote refresh start\n");
+        all_watched = remote_add_watches(refresh_supporters);
+        if (followup) {
+            timeout = REMOTE_FOLLOWUP_MS;
+        } else {
+            timeout = all_watched ? REMOTE_RESCAN_INTERVAL_MS : REMOTE_POLL_INTERVAL_MS;
+        }
+
+        pfds[0].fd = refresh_supporters->stop_pipe[0];
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        pfds[1].fd = refresh_supporters->inotify_fd;
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+
+        nret = poll(pfds, refresh_supporters->inotify_fd >= 0 ? 2 : 1, timeout);
+        if (nret < 0) {
+            if (errno != EINTR) {
+                SYSERROR("Failed to wait remote dir events");
+                util_usleep_nointerupt(1000 * 1000);
+            }
+            continue;
+        }
+
+        if ((pfds[0].revents & POLLIN) != 0) {
+            break;
+        }
 
-        if (!remote_refresh_lock(supporters.remote_lock, true)) {
-            WARN("Failed to lock remote store failed, try to lock after 5 seconds");
+        if (nret == 0) {
+            followup = false;
+            remote_do_refresh(refresh_supporters);
             continue;
         }
-        remote_overlay_refresh(refresh_supporters->overlay_data);
-        remote_layer_refresh(refresh_supporters->layer_data);
-        remote_image_refresh(refresh_supporters->image_data);
-        remote_refresh_unlock(supporters.remote_lock);
 
-        DEBUG("remote refresh end\n");
+        if (remote_drain_events(refresh_supporters)) {
+            remote_settle_events(refresh_supporters);
+            remote_do_refresh(refresh_supporters);
+            followup = true;
+        }
     }
+
     return NULL;
 }
 
+static void remote_close_fds(void)
+{
+    if (supporters.inotify_fd >= 0) {
+        close(supporters.inotify_fd);
+        supporters.inotify_fd = -1;
+    }
+    if (supporters.stop_pipe[0] >= 0) {
+        close(supporters.stop_pipe[0]);
+        supporters.stop_pipe[0] = -1;
+    }
+    if (supporters.stop_pipe[1] >= 0) {
+        close(supporters.stop_pipe[1]);
+        supporters.stop_pipe[1] = -1;
+    }
+    supporters.watches[0] = -1;
+    supporters.watches[1] = -1;
+    supporters.watches[2] = -1;
+}
+
 int remote_start_refresh_thread(pthread_rwlock_t *remote_lock)
 {
     int res = 0;
-    pthread_t a_thread;
     maintain_context ctx = get_maintain_context();
 
     if (remote_lock == NULL) {
@@ -92,6 +268,11 @@ int remote_start_refresh_thread(pthread_rwlock_t *remote_lock)
         return -1;
     }
 
+    if (supporters.started) {
+        ERROR("Remote refresh thread already started");
+        return -1;
+    }
+
     supporters.image_data = remote_image_create(ctx.image_home, NULL);
     if (supporters.image_data == NULL) {
         goto free_out;
@@ -109,27 +290,67 @@ int remote_start_refresh_thread(pthread_rwlock_t *remote_lock)
 
     supporters.remote_lock = remote_lock;
 
-    res = pthread_create(&a_thread, NULL, remote_refresh_ro_symbol_link, (void *)&supporters);
-    if (res != 0) {
-        CRIT("Thread creation failed");
+    if (pipe2(supporters.stop_pipe, O_CLOEXEC) != 0) {
+        SYSERROR("Failed to create pipe for remote refresh thread");
         goto free_out;
     }
 
-    if (pthread_detach(a_thread) != 0) {
-        SYSERROR("Failed to detach 0x%lx", a_thread);
+    supporters.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (supporters.inotify_fd < 0) {
+        SYSWARN("Failed to init inotify, poll remote dirs every %d ms", REMOTE_POLL_INTERVAL_MS);
+    }
+    (void)remote_add_watches(&supporters);
+
+    // pick up layers added before the watches are in place
+    remote_do_refresh(&supporters);
+
+    res = pthread_create(&supporters.thread, NULL, remote_refresh_ro_symbol_link, (void *)&supporters);
+    if (res != 0) {
+        CRIT("Thread creation failed");
         goto free_out;
     }
+    supporters.started = true;
 
     return 0;
 
 free_out:
+    remote_close_fds();
     remote_image_destroy(supporters.image_data);
+    supporters.image_data = NULL;
     remote_layer_destroy(supporters.layer_data);
+    supporters.layer_data = NULL;
     remote_overlay_destroy(supporters.overlay_data);
+    supporters.overlay_data = NULL;
 
     return -1;
 }
 
+void remote_stop_refresh_thread(void)
+{
+    char c = 0;
+
+    if (!supporters.started) {
+        return;
+    }
+
+    if (util_write_nointr(supporters.stop_pipe[1], &c, sizeof(c)) != sizeof(c)) {
+        SYSERROR("Failed to wake up remote refresh thread");
+        return;
+    }
+    if (pthread_join(supporters.thread, NULL) != 0) {
+        ERROR("Failed to join remote refresh thread");
+    }
+    supporters.started = false;
+
+    remote_close_fds();
+    remote_image_destroy(supporters.image_data);
+    supporters.image_data = NULL;
+    remote_layer_destroy(supporters.layer_data);
+    supporters.layer_data = NULL;
+    remote_overlay_destroy(supporters.overlay_data);
+    supporters.overlay_data = NULL;
+}
+
 // this function calculate map_a - map_b => diff_list
 // diff_list contains keys inside map_a but not inside map_b
 static char **map_diff(const map_t *map_a, const map_t *map_b)
@@ -65,9 +65,11 @@ void remote_overlay_refresh(struct remote_overlay_data *data);
 
 bool remote_overlay_layer_valid(const char *layer_id);
 
-// start refresh remote
+// start refresh remote, driven by inotify events of remote dirs with a slow rescan
 int remote_start_refresh_thread(pthread_rwlock_t *remote_lock);
 
+void remote_stop_refresh_thread(void);
+
 // extra map utils
 char **remote_deleted_layers(const map_t *old, const map_t *new_l);
 
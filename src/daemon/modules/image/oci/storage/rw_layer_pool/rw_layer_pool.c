@@ -0,0 +1,608 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide pool of pre-created container writable layers
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "rw_layer_pool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <isula_libutils/log.h>
+
+#include "utils.h"
+#include "utils_array.h"
+#include "utils_file.h"
+#include "layer_store.h"
+#include "image_store.h"
+
+#define RW_LAYER_ID_LEN 64
+// images pulled or retagged after start are picked up by the next rescan
+#define RW_LAYER_POOL_RESCAN_INTERVAL 30
+
+struct rw_pool_entry {
+    // image name or id as configured
+    char *image;
+    size_t size;
+
+    // resolved image, NULL if the image does not exist yet
+    char *image_id;
+    char *top_layer;
+
+    // idle layers on top of top_layer
+    char **layers;
+    size_t layers_len;
+};
+
+struct rw_layer_pool {
+    struct rw_pool_entry *entries;
+    size_t entries_len;
+
+    // holds a file named after each idle layer, so the pool never takes over layers of others
+    char *stamp_dir;
+
+    pthread_rwlock_t *storage_lock;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // a layer was taken since the last refill pass
+    bool kick;
+    bool exit;
+    bool started;
+    pthread_t refill_tid;
+};
+
+static struct rw_layer_pool g_rw_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void free_rw_pool_entry(struct rw_pool_entry *entry)
+{
+    free(entry->image);
+    entry->image = NULL;
+    free(entry->image_id);
+    entry->image_id = NULL;
+    free(entry->top_layer);
+    entry->top_layer = NULL;
+    util_free_array_by_len(entry->layers, entry->layers_len);
+    entry->layers = NULL;
+    entry->layers_len = 0;
+}
+
+static void free_rw_pool_entries(void)
+{
+    size_t i;
+
+    for (i = 0; i < g_rw_pool.entries_len; i++) {
+        free_rw_pool_entry(&g_rw_pool.entries[i]);
+    }
+    free(g_rw_pool.entries);
+    g_rw_pool.entries = NULL;
+    g_rw_pool.entries_len = 0;
+}
+
+static char *stamp_path(const char *layer_id)
+{
+    if (g_rw_pool.stamp_dir == NULL) {
+        return NULL;
+    }
+    return util_path_join(g_rw_pool.stamp_dir, layer_id);
+}
+
+// the parent is recorded only to make the stamp readable by hand
+static int write_stamp(const char *layer_id, const char *parent)
+{
+    int ret = 0;
+    char *path = NULL;
+
+    path = stamp_path(layer_id);
+    if (path == NULL) {
+        ERROR("Failed to join stamp path of layer %s", layer_id);
+        return -1;
+    }
+
+    if (util_write_file(path, parent, strlen(parent), 0600) != 0) {
+        ERROR("Failed to write stamp of idle writable layer %s", layer_id);
+        ret = -1;
+    }
+
+    free(path);
+    return ret;
+}
+
+static void remove_stamp(const char *layer_id)
+{
+    char *path = NULL;
+
+    path = stamp_path(layer_id);
+    if (path == NULL) {
+        return;
+    }
+
+    if (util_path_remove(path) != 0) {
+        SYSWARN("Failed to remove stamp of layer %s", layer_id);
+    }
+    free(path);
+}
+
+static void remove_layers(char **layers, size_t layers_len)
+{
+    size_t i;
+
+    for (i = 0; i < layers_len; i++) {
+        if (layer_store_delete(layers[i]) != 0) {
+            ERROR("Failed to remove idle writable layer %s", layers[i]);
+            continue;
+        }
+        remove_stamp(layers[i]);
+    }
+}
+
+// move idle layers of the entry to the end of layers to be removed
+static int take_entry_layers(struct rw_pool_entry *entry, char ***layers, size_t *layers_len)
+{
+    char **merged = NULL;
+
+    merged = util_smart_calloc_s(sizeof(char *), *layers_len + entry->layers_len + 1);
+    if (merged == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    if (*layers_len > 0) {
+        (void)memcpy(merged, *layers, *layers_len * sizeof(char *));
+    }
+    if (entry->layers_len > 0) {
+        (void)memcpy(merged + *layers_len, entry->layers, entry->layers_len * sizeof(char *));
+    }
+    free(*layers);
+    *layers = merged;
+    *layers_len += entry->layers_len;
+
+    free(entry->layers);
+    entry->layers = NULL;
+    entry->layers_len = 0;
+
+    return 0;
+}
+
+// resolve image of the entry again, layers on top of an old top layer are moved out for removal
+static void resolve_entry(struct rw_pool_entry *entry, char ***stale, size_t *stale_len)
+{
+    char *image_id = NULL;
+    char *top_layer = NULL;
+
+    image_id = image_store_lookup(entry->image);
+    if (image_id != NULL) {
+        top_layer = image_store_top_layer(image_id);
+    }
+    if (top_layer == NULL) {
+        free(image_id);
+        image_id = NULL;
+    }
+
+    if (image_id != NULL && entry->image_id != NULL && strcmp(image_id, entry->image_id) == 0 &&
+        strcmp(top_layer, entry->top_layer) == 0) {
+        free(image_id);
+        free(top_layer);
+        return;
+    }
+
+    if (entry->layers_len > 0) {
+        INFO("Image %s of writable layer pool changed, drop %zu idle layers", entry->image, entry->layers_len);
+        if (take_entry_layers(entry, stale, stale_len) != 0) {
+            // keep the old image, try again in next pass
+            free(image_id);
+            free(top_layer);
+            return;
+        }
+    }
+
+    free(entry->image_id);
+    entry->image_id = image_id;
+    free(entry->top_layer);
+    entry->top_layer = top_layer;
+}
+
+static char *generate_rw_layer_id(void)
+{
+    char *id = NULL;
+
+    id = util_smart_calloc_s(sizeof(char), RW_LAYER_ID_LEN + 1);
+    if (id == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    if (util_generate_random_str(id, RW_LAYER_ID_LEN) != 0) {
+        ERROR("Generate random str failed");
+        free(id);
+        return NULL;
+    }
+
+    return id;
+}
+
+static char *create_rw_layer(const char *top_layer)
+{
+    char *id = NULL;
+    struct layer_store_mount_opts mount_opts = { 0 };
+    struct layer_opts opts = {
+        .parent = (char *)top_layer,
+        .writable = true,
+        .opts = &mount_opts,
+    };
+
+    id = generate_rw_layer_id();
+    if (id == NULL) {
+        return NULL;
+    }
+
+    // stamp first, a crash in between leaves a stamp without layer, which is cleaned on next start
+    if (write_stamp(id, top_layer) != 0) {
+        free(id);
+        return NULL;
+    }
+
+    if (layer_store_create(id, &opts, NULL, NULL) != 0) {
+        ERROR("Failed to create idle writable layer on top of %s", top_layer);
+        remove_stamp(id);
+        free(id);
+        return NULL;
+    }
+
+    return id;
+}
+
+// create at most one layer for the first entry in need, return true if one was created
+static bool refill_once(void)
+{
+    size_t i;
+    bool created = false;
+    char **stale = NULL;
+    size_t stale_len = 0;
+    struct rw_pool_entry *target = NULL;
+    char *top_layer = NULL;
+    char *id = NULL;
+
+    // image delete holds storage lock for write, so images of the pool can not go away below us
+    if (pthread_rwlock_rdlock(g_rw_pool.storage_lock) != 0) {
+        ERROR("Failed to lock storage for writable layer pool");
+        return false;
+    }
+
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    for (i = 0; i < g_rw_pool.entries_len; i++) {
+        struct rw_pool_entry *entry = &g_rw_pool.entries[i];
+
+        resolve_entry(entry, &stale, &stale_len);
+        if (target == NULL && entry->top_layer != NULL && entry->layers_len < entry->size) {
+            target = entry;
+            top_layer = util_strdup_s(entry->top_layer);
+        }
+    }
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+    remove_layers(stale, stale_len);
+
+    if (target == NULL) {
+        goto out;
+    }
+
+    id = create_rw_layer(top_layer);
+    if (id == NULL) {
+        goto out;
+    }
+
+    // entries only change in this thread or with storage lock held for write
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    if (util_array_append(&target->layers, id) != 0) {
+        (void)pthread_mutex_unlock(&g_rw_pool.lock);
+        ERROR("Out of memory");
+        remove_layers(&id, 1);
+        goto out;
+    }
+    target->layers_len++;
+    created = true;
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+out:
+    (void)pthread_rwlock_unlock(g_rw_pool.storage_lock);
+    util_free_array_by_len(stale, stale_len);
+    free(top_layer);
+    free(id);
+    return created;
+}
+
+static void *rw_layer_pool_refill(void *arg)
+{
+    prctl(PR_SET_NAME, "RWLayerPool");
+
+    for (;;) {
+        struct timespec deadline = { 0 };
+
+        (void)pthread_mutex_lock(&g_rw_pool.lock);
+        g_rw_pool.kick = false;
+        if (g_rw_pool.exit) {
+            (void)pthread_mutex_unlock(&g_rw_pool.lock);
+            break;
+        }
+        (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+        if (refill_once()) {
+            continue;
+        }
+
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += RW_LAYER_POOL_RESCAN_INTERVAL;
+        (void)pthread_mutex_lock(&g_rw_pool.lock);
+        while (!g_rw_pool.kick && !g_rw_pool.exit) {
+            if (pthread_cond_timedwait(&g_rw_pool.cond, &g_rw_pool.lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        (void)pthread_mutex_unlock(&g_rw_pool.lock);
+    }
+
+    return NULL;
+}
+
+int rw_layer_pool_init(const json_map_string_int64 *conf, const char *stamp_dir, pthread_rwlock_t *storage_lock)
+{
+    size_t i;
+
+    if (stamp_dir == NULL || storage_lock == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    g_rw_pool.storage_lock = storage_lock;
+    g_rw_pool.exit = false;
+    g_rw_pool.kick = false;
+    free(g_rw_pool.stamp_dir);
+    g_rw_pool.stamp_dir = util_strdup_s(stamp_dir);
+
+    if (conf == NULL || conf->len == 0) {
+        return 0;
+    }
+
+    if (util_mkdir_p(stamp_dir, 0700) != 0) {
+        ERROR("Failed to create writable layer pool dir %s", stamp_dir);
+        return -1;
+    }
+
+    g_rw_pool.entries = util_smart_calloc_s(sizeof(struct rw_pool_entry), conf->len);
+    if (g_rw_pool.entries == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+
+    // images are resolved on adopt and by the refill thread, integrity check may still remove some
+    for (i = 0; i < conf->len; i++) {
+        struct rw_pool_entry *entry = &g_rw_pool.entries[g_rw_pool.entries_len];
+
+        if (conf->keys[i] == NULL || conf->values[i] <= 0) {
+            continue;
+        }
+        entry->image = util_strdup_s(conf->keys[i]);
+        entry->size = (size_t)conf->values[i];
+        g_rw_pool.entries_len++;
+        INFO("Keep %zu idle writable layers for image %s", entry->size, entry->image);
+    }
+
+    return 0;
+}
+
+bool rw_layer_pool_enabled(void)
+{
+    return g_rw_pool.entries_len > 0;
+}
+
+bool rw_layer_pool_owns(const char *layer_id)
+{
+    bool ret = false;
+    char *path = NULL;
+
+    if (layer_id == NULL) {
+        return false;
+    }
+
+    path = stamp_path(layer_id);
+    if (path == NULL) {
+        return false;
+    }
+
+    ret = util_file_exists(path);
+    free(path);
+    return ret;
+}
+
+bool rw_layer_pool_adopt(const char *layer_id, const char *parent)
+{
+    size_t i;
+    bool adopted = false;
+    char *id = NULL;
+
+    if (layer_id == NULL || parent == NULL || !rw_layer_pool_owns(layer_id)) {
+        return false;
+    }
+
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    for (i = 0; i < g_rw_pool.entries_len; i++) {
+        struct rw_pool_entry *entry = &g_rw_pool.entries[i];
+
+        if (entry->image_id == NULL) {
+            resolve_entry(entry, NULL, NULL);
+        }
+        if (entry->top_layer == NULL || strcmp(entry->top_layer, parent) != 0 || entry->layers_len >= entry->size) {
+            continue;
+        }
+        if (util_array_append(&entry->layers, layer_id) != 0) {
+            ERROR("Out of memory");
+            break;
+        }
+        entry->layers_len++;
+        adopted = true;
+        break;
+    }
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+    if (!adopted) {
+        WARN("Remove idle writable layer %s not wanted by the pool any more", layer_id);
+        id = (char *)layer_id;
+        remove_layers(&id, 1);
+    }
+
+    return adopted;
+}
+
+// stamps left by a crash before the layer was created
+static void remove_orphan_stamps(void)
+{
+    size_t i, j, k;
+    bool found = false;
+    char **names = NULL;
+
+    if (util_list_all_entries(g_rw_pool.stamp_dir, &names) != 0) {
+        WARN("Failed to list writable layer pool dir %s", g_rw_pool.stamp_dir);
+        return;
+    }
+
+    for (i = 0; names != NULL && names[i] != NULL; i++) {
+        found = false;
+        for (j = 0; j < g_rw_pool.entries_len && !found; j++) {
+            for (k = 0; k < g_rw_pool.entries[j].layers_len && !found; k++) {
+                found = strcmp(g_rw_pool.entries[j].layers[k], names[i]) == 0;
+            }
+        }
+        if (!found) {
+            DEBUG("Remove orphan stamp of writable layer pool %s", names[i]);
+            remove_stamp(names[i]);
+        }
+    }
+
+    util_free_array(names);
+}
+
+int rw_layer_pool_start(void)
+{
+    int nret = 0;
+
+    if (g_rw_pool.entries_len == 0) {
+        return 0;
+    }
+
+    remove_orphan_stamps();
+
+    nret = pthread_create(&g_rw_pool.refill_tid, NULL, rw_layer_pool_refill, NULL);
+    if (nret != 0) {
+        errno = nret;
+        SYSERROR("Failed to start writable layer pool thread");
+        return -1;
+    }
+    g_rw_pool.started = true;
+
+    return 0;
+}
+
+// idle layers stay on disk, they are taken over again on next start
+void rw_layer_pool_exit(void)
+{
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    g_rw_pool.exit = true;
+    (void)pthread_cond_broadcast(&g_rw_pool.cond);
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+    if (g_rw_pool.started) {
+        (void)pthread_join(g_rw_pool.refill_tid, NULL);
+        g_rw_pool.started = false;
+    }
+
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    free_rw_pool_entries();
+    free(g_rw_pool.stamp_dir);
+    g_rw_pool.stamp_dir = NULL;
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+}
+
+char *rw_layer_pool_take(const char *image_id)
+{
+    size_t i;
+    bool pooled = false;
+    char *id = NULL;
+
+    if (image_id == NULL) {
+        return NULL;
+    }
+
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    for (i = 0; i < g_rw_pool.entries_len && id == NULL; i++) {
+        struct rw_pool_entry *entry = &g_rw_pool.entries[i];
+
+        if (entry->image_id == NULL || strcmp(entry->image_id, image_id) != 0) {
+            continue;
+        }
+        pooled = true;
+        if (entry->layers_len > 0) {
+            entry->layers_len--;
+            id = entry->layers[entry->layers_len];
+            entry->layers[entry->layers_len] = NULL;
+        }
+    }
+    if (pooled) {
+        g_rw_pool.kick = true;
+        (void)pthread_cond_signal(&g_rw_pool.cond);
+    }
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+    // the layer belongs to the container from now on
+    if (id != NULL) {
+        remove_stamp(id);
+    }
+
+    return id;
+}
+
+void rw_layer_pool_drain(const char *image_id)
+{
+    size_t i;
+    char **layers = NULL;
+    size_t layers_len = 0;
+
+    if (image_id == NULL) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&g_rw_pool.lock);
+    for (i = 0; i < g_rw_pool.entries_len; i++) {
+        struct rw_pool_entry *entry = &g_rw_pool.entries[i];
+
+        if (entry->image_id == NULL || strcmp(entry->image_id, image_id) != 0) {
+            continue;
+        }
+        if (take_entry_layers(entry, &layers, &layers_len) != 0) {
+            continue;
+        }
+        // resolved again by refill thread, the image may come back with another pull
+        free(entry->image_id);
+        entry->image_id = NULL;
+        free(entry->top_layer);
+        entry->top_layer = NULL;
+    }
+    (void)pthread_mutex_unlock(&g_rw_pool.lock);
+
+    remove_layers(layers, layers_len);
+    util_free_array_by_len(layers, layers_len);
+}
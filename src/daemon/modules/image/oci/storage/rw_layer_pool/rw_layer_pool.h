@@ -0,0 +1,60 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide pool of pre-created container writable layers
+ ******************************************************************************/
+#ifndef DAEMON_MODULES_IMAGE_OCI_STORAGE_RW_LAYER_POOL_RW_LAYER_POOL_H
+#define DAEMON_MODULES_IMAGE_OCI_STORAGE_RW_LAYER_POOL_RW_LAYER_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <isula_libutils/json_common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// dir of stamps under storage root
+#define RW_LAYER_POOL_DIR "rw_layer_pool"
+
+// conf maps image name or id to the number of idle writable layers kept for it, idle layers are
+// stamped in stamp_dir. storage_lock is held for read while layers are created or removed in background
+int rw_layer_pool_init(const json_map_string_int64 *conf, const char *stamp_dir, pthread_rwlock_t *storage_lock);
+
+// true if any image is configured to keep idle writable layers
+bool rw_layer_pool_enabled(void);
+
+// true if the layer is an idle layer created by the pool, also for layers left by last run
+bool rw_layer_pool_owns(const char *layer_id);
+
+// take over an idle layer of the pool left by last run. it is removed if not wanted any more and
+// false is returned, layers not owned by the pool are not touched
+bool rw_layer_pool_adopt(const char *layer_id, const char *parent);
+
+// start refilling the pool in background
+int rw_layer_pool_start(void);
+
+void rw_layer_pool_exit(void);
+
+// return id of an idle writable layer on top of the image, NULL if there is none.
+// caller holds storage lock for write
+char *rw_layer_pool_take(const char *image_id);
+
+// remove idle layers of the image before it is deleted, caller holds storage lock for write
+void rw_layer_pool_drain(const char *image_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DAEMON_MODULES_IMAGE_OCI_STORAGE_RW_LAYER_POOL_RW_LAYER_POOL_H
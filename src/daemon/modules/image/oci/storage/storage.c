@@ -25,6 +25,7 @@
 #include <isula_libutils/storage_rootfs.h>
 #include <isula_libutils/auto_cleanup.h>
 #include <pthread.h>
+#include <sys/prctl.h>
 
 #include "io_wrapper.h"
 #include "utils.h"
@@ -36,6 +37,7 @@
 #include "layer_store.h"
 #include "image_store.h"
 #include "rootfs_store.h"
+#include "rw_layer_pool.h"
 #include "err_msg.h"
 #include "constants.h"
 #include "utils_array.h"
@@ -47,6 +49,8 @@
 #include "remote_support.h"
 #endif
 
+#define LAYER_CHECK_MAX_WORKERS 8
+
 static pthread_rwlock_t g_storage_rwlock;
 static char *g_storage_run_root;
 
@@ -796,6 +800,9 @@ static int do_storage_img_delete(const char *img_id, bool commit)
         goto out;
     }
 
+    // idle writable layers of the pool hold the top layer of the image
+    rw_layer_pool_drain(image_info->id);
+
     if (image_store_delete(image_info->id) != 0) {
         ERROR("Failed to delete img %s", img_id);
         ret = -1;
@@ -1082,6 +1089,10 @@ void free_storage_module_init_options(struct storage_module_init_options *opts)
 
 void storage_module_exit()
 {
+    rw_layer_pool_exit();
+#ifdef ENABLE_REMOTE_LAYER_STORE
+    remote_stop_refresh_thread();
+#endif
     free(g_storage_run_root);
     g_storage_run_root = NULL;
     layer_store_exit();
@@ -1133,11 +1144,26 @@ out:
     return ret;
 }
 
+// layers of the pool are created without mount label and storage opts, only plain containers can use them
+static char *take_pooled_rw_layer(const char *image_id, const char *mount_label,
+                                  const json_map_string_string *storage_opts)
+{
+    if (mount_label != NULL && strlen(mount_label) != 0) {
+        return NULL;
+    }
+    if (storage_opts != NULL && storage_opts->len != 0) {
+        return NULL;
+    }
+
+    return rw_layer_pool_take(image_id);
+}
+
 int storage_rootfs_create(const char *container_id, const char *image, const char *mount_label,
                           json_map_string_string *storage_opts, char **mountpoint)
 {
     int ret = 0;
     char *rootfs_id = NULL;
+    char *layer_id = NULL;
     imagetool_image_summary *image_summary = NULL;
     struct layer *layer_info = NULL;
 
@@ -1160,21 +1186,27 @@ int storage_rootfs_create(const char *container_id, const char *image, const cha
         goto unlock_out;
     }
 
-    // note: we use container id as the layer id of the container
-    if (do_create_container_rw_layer(container_id, image_summary->top_layer, mount_label, storage_opts) != 0) {
-        ERROR("Failed to do create rootfs layer");
-        ret = -1;
-        goto unlock_out;
+    layer_id = take_pooled_rw_layer(image_summary->id, mount_label, storage_opts);
+    if (layer_id != NULL) {
+        DEBUG("Use idle writable layer %s for container %s", layer_id, container_id);
+    } else {
+        // note: we use container id as the layer id of the container
+        if (do_create_container_rw_layer(container_id, image_summary->top_layer, mount_label, storage_opts) != 0) {
+            ERROR("Failed to do create rootfs layer");
+            ret = -1;
+            goto unlock_out;
+        }
+        layer_id = util_strdup_s(container_id);
     }
 
-    rootfs_id = rootfs_store_create(container_id, NULL, 0, image_summary->id, container_id, NULL, NULL);
+    rootfs_id = rootfs_store_create(container_id, NULL, 0, image_summary->id, layer_id, NULL, NULL);
     if (rootfs_id == NULL) {
         ERROR("Failed to create rootfs");
         ret = -1;
         goto remove_layer;
     }
 
-    layer_info = layer_store_lookup(container_id);
+    layer_info = layer_store_lookup(layer_id);
     if (layer_info == NULL) {
         ERROR("Failed to get created rootfs layer info");
         ret = -1;
@@ -1188,14 +1220,15 @@ int storage_rootfs_create(const char *container_id, const char *image, const cha
     goto unlock_out;
 
 remove_layer:
-    if (layer_store_delete(container_id) != 0) {
-        ERROR("Failed to delete layer %s due rootfs create fail", container_id);
+    if (layer_store_delete(layer_id) != 0) {
+        ERROR("Failed to delete layer %s due rootfs create fail", layer_id);
     }
 
 unlock_out:
     storage_unlock(&g_storage_rwlock);
 out:
     free(rootfs_id);
+    free(layer_id);
     free_imagetool_image_summary(image_summary);
     free_layer(layer_info);
     return ret;
@@ -1477,80 +1510,207 @@ out:
     return ret;
 }
 
-static int do_check_layers_list(const char *path, struct linked_list *layer_ids, map_t *checked_layers)
+struct layer_check_jobs {
+    char **ids;
+    size_t len;
+    // result of layer_store_check for each id
+    int *results;
+    size_t next;
+    pthread_mutex_t lock;
+};
+
+static void *layer_check_worker(void *arg)
+{
+    struct layer_check_jobs *jobs = (struct layer_check_jobs *)arg;
+
+    prctl(PR_SET_NAME, "LayerCheck");
+
+    for (;;) {
+        size_t i;
+
+        (void)pthread_mutex_lock(&jobs->lock);
+        i = jobs->next++;
+        (void)pthread_mutex_unlock(&jobs->lock);
+        if (i >= jobs->len) {
+            break;
+        }
+
+        DEBUG("Try to check layer: %s", jobs->ids[i]);
+        jobs->results[i] = layer_store_check(jobs->ids[i]);
+    }
+
+    return NULL;
+}
+
+static size_t layer_check_workers(size_t jobs)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = cpus <= 0 ? 1 : (size_t)cpus;
+
+    if (workers > LAYER_CHECK_MAX_WORKERS) {
+        workers = LAYER_CHECK_MAX_WORKERS;
+    }
+    return workers > jobs ? jobs : workers;
+}
+
+// check layers on a worker pool, the caller is one of the workers
+static void check_layers_parallel(struct layer_check_jobs *jobs)
+{
+    size_t i;
+    size_t started = 0;
+    size_t workers = layer_check_workers(jobs->len);
+    pthread_t *tids = NULL;
+
+    if (workers > 1) {
+        tids = util_smart_calloc_s(sizeof(pthread_t), workers - 1);
+        if (tids == NULL) {
+            ERROR("Out of memory, check layers serially");
+        }
+    }
+
+    for (i = 0; tids != NULL && i < workers - 1; i++) {
+        if (pthread_create(&tids[i], NULL, layer_check_worker, jobs) != 0) {
+            WARN("Failed to create layer check worker, go on with %zu workers", started + 1);
+            break;
+        }
+        started++;
+    }
+
+    (void)layer_check_worker(jobs);
+
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(tids[i], NULL);
+    }
+    free(tids);
+}
+
+static int add_layer_check_job(const char *lid, struct layer_check_jobs *jobs, map_t *pending, map_t *checked_layers,
+                               int fd)
+{
+    bool default_value = true;
+
+    if (map_search(checked_layers, (void *)lid) != NULL) {
+        INFO("Layer: %s checked, skip", lid);
+        return 0;
+    }
+    if (map_search(pending, (void *)lid) != NULL) {
+        return 0;
+    }
+
+    if (layer_store_unchanged_since_shutdown(lid)) {
+        INFO("Layer: %s not changed since last shutdown, skip", lid);
+        return do_add_checked_layer(lid, fd, checked_layers);
+    }
+
+    if (!map_replace(pending, (void *)lid, (void *)&default_value) || util_array_append(&jobs->ids, lid) != 0) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    jobs->len++;
+
+    return 0;
+}
+
+// check layers of all images once, valid layers are added into checked_layers
+static int do_check_layers_list(const char *path, struct linked_list **image_layers, size_t images_len,
+                                map_t *checked_layers)
 {
     struct linked_list *iter = NULL;
-    struct linked_list *next = NULL;
-    char *tmp_id = NULL;
+    struct layer_check_jobs jobs = { 0 };
+    map_t *pending = NULL;
+    size_t i;
     int ret = 0;
     int fd = -1;
-    int nret;
 
     fd = util_open(path, O_WRONLY | O_CREAT | O_APPEND, SECURE_CONFIG_FILE_MODE);
     if (fd == -1) {
         return -1;
     }
 
-    linked_list_for_each_safe(iter, layer_ids, next) {
-        tmp_id = (char *)iter->elem;
-        DEBUG("Try to check layer: %s", tmp_id);
-        if (map_search(checked_layers, (void *)tmp_id) != NULL) {
-            INFO("Layer: %s checked, skip", tmp_id);
+    pending = map_new(MAP_STR_BOOL, MAP_DEFAULT_CMP_FUNC, MAP_DEFAULT_FREE_FUNC);
+    if (pending == NULL) {
+        ERROR("Out of memory");
+        ret = -1;
+        goto out;
+    }
+
+    for (i = 0; i < images_len; i++) {
+        if (image_layers[i] == NULL) {
             continue;
         }
-        nret = layer_store_check(tmp_id);
-        if (nret != 0) {
-            ERROR("Layer: %s check failed", tmp_id);
-            // this layer is invalid
-            ret = -1;
-            goto out;
+        linked_list_for_each(iter, image_layers[i]) {
+            if (add_layer_check_job((const char *)iter->elem, &jobs, pending, checked_layers, fd) != 0) {
+                ret = -1;
+                goto out;
+            }
         }
-        DEBUG("Layer: %s is integration", tmp_id);
+    }
 
-        nret = do_add_checked_layer(tmp_id, fd, checked_layers);
-        if (nret != 0) {
+    if (jobs.len == 0) {
+        goto out;
+    }
+
+    jobs.results = util_smart_calloc_s(sizeof(int), jobs.len);
+    if (jobs.results == NULL) {
+        ERROR("Out of memory");
+        ret = -1;
+        goto out;
+    }
+    (void)pthread_mutex_init(&jobs.lock, NULL);
+    check_layers_parallel(&jobs);
+    (void)pthread_mutex_destroy(&jobs.lock);
+
+    for (i = 0; i < jobs.len; i++) {
+        if (jobs.results[i] != 0) {
+            ERROR("Layer: %s check failed", jobs.ids[i]);
+            continue;
+        }
+        DEBUG("Layer: %s is integration", jobs.ids[i]);
+        if (do_add_checked_layer(jobs.ids[i], fd, checked_layers) != 0) {
             ret = -1;
             goto out;
         }
-
-        linked_list_del(iter);
-        free(iter->elem);
-        iter->elem = NULL;
-        free(iter);
     }
 
 out:
+    map_free(pending);
+    util_free_array(jobs.ids);
+    free(jobs.results);
     close(fd);
     return ret;
 }
 
-static int do_storage_check_image(const char *path, const char *id, map_t *checked_layers)
+static struct linked_list *get_image_layers_by_id(const char *id)
 {
-    int ret = -1;
     imagetool_image *img = NULL;
     struct linked_list *layer_ids = NULL;
 
-    if (id == NULL) {
-        ERROR("Invalid input arguments");
-        return -1;
-    }
-
     img = image_store_get_image(id);
     if (img == NULL) {
-        goto out;
+        return NULL;
     }
     layer_ids = get_image_layers(img->top_layer);
+
+    free_imagetool_image(img);
+    return layer_ids;
+}
+
+// image is valid only if all layers belong to it are checked
+static bool image_layers_checked(const struct linked_list *layer_ids, map_t *checked_layers)
+{
+    struct linked_list *iter = NULL;
+
     if (layer_ids == NULL) {
-        goto out;
+        return false;
     }
 
-    // check for all layers belong to the image
-    ret = do_check_layers_list(path, layer_ids, checked_layers);
+    linked_list_for_each(iter, layer_ids) {
+        if (map_search(checked_layers, iter->elem) == NULL) {
+            return false;
+        }
+    }
 
-out:
-    free_imagetool_image(img);
-    free_layers_linked_list(layer_ids);
-    return ret;
+    return true;
 }
 
 static bool is_rootfs_layer(const char *layer_id, const struct rootfs_list *all_rootfs)
@@ -1579,6 +1739,7 @@ static bool do_storage_integration_check(const char *path, map_t *checked_layers
     bool ret = false;
     int nret = 0;
     imagetool_images_list *all_images = NULL;
+    struct linked_list **image_layers = NULL;
     size_t i = 0;
     size_t j = 0;
 
@@ -1603,9 +1764,24 @@ static bool do_storage_integration_check(const char *path, map_t *checked_layers
         goto out;
     }
 
+    if (all_images->images_len > 0) {
+        image_layers = util_smart_calloc_s(sizeof(struct linked_list *), all_images->images_len);
+        if (image_layers == NULL) {
+            ERROR("Out of memory");
+            goto out;
+        }
+    }
     for (i = 0; i < all_images->images_len; i++) {
-        nret = do_storage_check_image(path, all_images->images[i]->id, checked_layers);
-        if (nret == 0) {
+        image_layers[i] = get_image_layers_by_id(all_images->images[i]->id);
+    }
+
+    // layers shared by images are checked once
+    if (do_check_layers_list(path, image_layers, all_images->images_len, checked_layers) != 0) {
+        ERROR("Failed to check layers of images");
+    }
+
+    for (i = 0; i < all_images->images_len; i++) {
+        if (image_layers_checked(image_layers[i], checked_layers)) {
             continue;
         }
         // invalid image
@@ -1642,6 +1818,10 @@ static bool do_storage_integration_check(const char *path, map_t *checked_layers
 
     ret = true;
 out:
+    for (i = 0; image_layers != NULL && i < all_images->images_len; i++) {
+        free_layers_linked_list(image_layers[i]);
+    }
+    free(image_layers);
     free_imagetool_images_list(all_images);
     free_rootfs_list(all_rootfs);
     return ret;
@@ -1686,6 +1866,12 @@ static void delete_unchecked_layers(map_t *checked_layers)
             continue;
         }
 
+        // idle layers of the pool have no rootfs yet, they are adopted or removed by the pool later
+        if (rw_layer_pool_owns(all_layers->layers[i]->id)) {
+            DEBUG("ignore idle writable layer: %s", all_layers->layers[i]->id);
+            continue;
+        }
+
         ERROR("Delete unchecked layer: %s due to no related image", all_layers->layers[i]->id);
         if (layer_store_delete(all_layers->layers[i]->id) != 0) {
             ERROR("Failed to delete unchecked layer %s", all_layers->layers[i]->id);
@@ -1738,6 +1924,54 @@ out:
     return ret;
 }
 
+// give idle layers of the pool left by last run back to the pool, which removes those it does not
+// want any more. other writable layers without rootfs are left alone
+static void restore_idle_rw_layers(void)
+{
+    size_t i;
+    struct layer_list *all_layers = NULL;
+    struct rootfs_list *all_rootfs = NULL;
+
+    if (!storage_lock(&g_storage_rwlock, true)) {
+        ERROR("Failed to lock storage, not allowed to restore idle writable layers");
+        return;
+    }
+
+    all_layers = util_common_calloc_s(sizeof(struct layer_list));
+    all_rootfs = util_common_calloc_s(sizeof(struct rootfs_list));
+    if (all_layers == NULL || all_rootfs == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+
+    if (layer_store_list(all_layers) != 0) {
+        ERROR("Failed to get all layers info");
+        goto out;
+    }
+
+    if (rootfs_store_get_all_rootfs(all_rootfs) != 0) {
+        ERROR("Failed to get all container rootfs information");
+        goto out;
+    }
+
+    for (i = 0; i < all_layers->layers_len; i++) {
+        const struct layer *l = all_layers->layers[i];
+
+        if (!l->writable || is_rootfs_layer(l->id, all_rootfs) || !rw_layer_pool_owns(l->id)) {
+            continue;
+        }
+
+        if (rw_layer_pool_adopt(l->id, l->parent)) {
+            DEBUG("Restore idle writable layer: %s", l->id);
+        }
+    }
+
+out:
+    storage_unlock(&g_storage_rwlock);
+    free_layer_list(all_layers);
+    free_rootfs_list(all_rootfs);
+}
+
 container_inspect_graph_driver *storage_get_metadata_by_container_id(const char *id)
 {
     storage_rootfs *rootfs_info = NULL;
@@ -1873,6 +2107,7 @@ out:
 int storage_module_init(struct storage_module_init_options *opts)
 {
     int ret = 0;
+    char *rw_layer_pool_dir = NULL;
 
     if (check_module_init_opt(opts) != 0) {
         ret = -1;
@@ -1929,12 +2164,37 @@ int storage_module_init(struct storage_module_init_options *opts)
         goto out;
     }
 
+    rw_layer_pool_dir = util_path_join(opts->storage_root, RW_LAYER_POOL_DIR);
+    if (rw_layer_pool_dir == NULL) {
+        ERROR("Failed to join writable layer pool dir");
+        ret = -1;
+        goto out;
+    }
+
+    // before integration check, which needs to know idle layers of the pool
+    if (rw_layer_pool_init(opts->rw_layer_pool, rw_layer_pool_dir, &g_storage_rwlock) != 0) {
+        ERROR("Failed to init writable layer pool");
+        ret = -1;
+        goto out;
+    }
+
     if (opts->integration_check && !storage_integration_check()) {
         ERROR("do integration check failed");
         ret = -1;
+        goto out;
+    }
+
+    if (rw_layer_pool_enabled()) {
+        restore_idle_rw_layers();
+    }
+
+    if (rw_layer_pool_start() != 0) {
+        ERROR("Failed to start writable layer pool");
+        ret = -1;
     }
 
 out:
+    free(rw_layer_pool_dir);
     return ret;
 }
 
@@ -58,6 +58,14 @@ struct rootfs_list {
     size_t rootfs_len;
 };
 
+typedef enum {
+    LAYER_DEDUP_OFF = 0,
+    // reflink if filesystem supports it, otherwise hardlink
+    LAYER_DEDUP_AUTO,
+    LAYER_DEDUP_REFLINK,
+    LAYER_DEDUP_HARDLINK,
+} layer_dedup_mode_t;
+
 struct storage_module_init_options {
     // storage_run_root is the filesystem path under which we can store run-time info
     // e.g. /var/run/isulad/storage
@@ -73,6 +81,16 @@ struct storage_module_init_options {
     char **driver_opts;
     size_t driver_opts_len;
     bool integration_check;
+    // skip integration check of layers not changed since last clean shutdown
+    bool integration_check_skip_unchanged;
+    // capacity of in memory cache of image config and manifest, 0 means disabled
+    int64_t image_big_data_cache_size;
+    // image name or id to number of idle writable layers kept for it, not owned
+    const json_map_string_int64 *rw_layer_pool;
+    // replace identical files across layers with reflinks or hardlinks in background
+    layer_dedup_mode_t layer_dedup;
+    // seconds between two dedup passes
+    int64_t layer_dedup_interval;
 #ifdef ENABLE_REMOTE_LAYER_STORE
     bool enable_remote_layer;
     pthread_rwlock_t *remote_lock;
@@ -33,6 +33,7 @@
 #include "utils.h"
 #include "util_gzip.h"
 #include "utils_file.h"
+#include "log_compress.h"
 
 typedef int (*log_save_t)(const void *buf, size_t count);
 static log_save_t g_save_log_op = NULL;
@@ -47,40 +48,22 @@ static mode_t g_log_mode = S_IRUSR | S_IWUSR;
 
 static int log_file_open();
 
-static int file_rotate_gz(const char *file_name, int i)
+static int gzip_log_file(const char *filename)
 {
-    int ret = 0;
-    char from_path[PATH_MAX] = { 0 };
-    char to_path[PATH_MAX] = { 0 };
-
-    ret = snprintf(from_path, PATH_MAX, "%s.%d.gz", file_name, (i - 1));
-    if (ret < 0 || (size_t)ret >= PATH_MAX) {
-        ERROR("sprint zip file name failed");
-        return -1;
-    }
-
-    ret = snprintf(to_path, PATH_MAX, "%s.%d.gz", file_name, i);
-    if (ret < 0 || (size_t)ret >= PATH_MAX) {
-        ERROR("sprint zip file name failed");
-        return -1;
-    }
-
-    if (rename(from_path, to_path) < 0 && errno != ENOENT) {
-        SYSWARN("Rename file: %s failed", from_path);
-        return -1;
-    }
-
-    return 0;
+    return gzip(filename, strlen(filename));
 }
 
-static int file_rotate_me(const char *file_name)
+// rotated log files are compressed in background, the writer never waits for it
+static log_compressor g_log_compressor = LOG_COMPRESSOR_INITIALIZER(gzip_log_file);
+
+static int file_rotate_me(const char *file_name, int max_files)
 {
-    int ret = 0;
     char tmp_path[PATH_MAX] = { 0 };
+    char gz_path[PATH_MAX] = { 0 };
 
-    ret = snprintf(tmp_path, PATH_MAX, "%s.1", file_name);
-    if (ret < 0 || (size_t)ret >= PATH_MAX) {
-        ERROR("Out of memory");
+    if (log_rotated_file_name(tmp_path, file_name, 1, "") != 0 ||
+        log_rotated_file_name(gz_path, file_name, 1, LOG_COMPRESS_SUFFIX) != 0) {
+        ERROR("sprint rotated file name failed");
         return -1;
     }
 
@@ -94,29 +77,32 @@ static int file_rotate_me(const char *file_name)
         return -1;
     }
 
-    if (gzip(tmp_path, sizeof(tmp_path))) {
-        WARN("Gzip file failed");
-        return -2;
-    }
+    // left if there are at most two log files
+    (void)unlink(gz_path);
+    log_compressor_notify(&g_log_compressor, file_name, (unsigned int)max_files - 1);
 
     return 0;
 }
 
 static int file_rotate(const char *file_name, int max_files)
 {
-    int i = 0;
+    int ret = 0;
 
     if (file_name == NULL || max_files < 2) {
         return 0;
     }
 
-    for (i = max_files - 1; i > 1; i--) {
-        if (file_rotate_gz(file_name, i)) {
-            return -1;
-        }
+    (void)pthread_mutex_lock(&g_log_compressor.mutex);
+    if (log_rotate_old_files(file_name, (unsigned int)max_files - 1) != 0) {
+        SYSWARN("Rotate old log files of %s failed", file_name);
+        ret = -1;
+        goto out;
     }
 
-    return file_rotate_me(file_name);
+    ret = file_rotate_me(file_name, max_files);
+out:
+    (void)pthread_mutex_unlock(&g_log_compressor.mutex);
+    return ret;
 }
 
 /* get driver */
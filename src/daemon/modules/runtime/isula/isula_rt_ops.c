@@ -26,11 +26,17 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -56,12 +62,17 @@
 #include "utils_file.h"
 #include "console.h"
 #include "shim_constants.h"
+#include "cgroup.h"
+#include "mainloop.h"
+#include "map.h"
 
 #define SHIM_BINARY "isulad-shim"
 #define RESIZE_FIFO_NAME "resize_fifo"
 #define SHIM_LOG_SIZE ((BUFSIZ - 100) / 2)
 #define RESIZE_DATA_SIZE 100
 #define PID_WAIT_TIME 120
+// interval to check shim alive, if pidfd is not supported by kernel
+#define SHIM_CHECK_INTERVAL_MS 100
 #define ATTACH_WAIT_TIME 120
 #define RUNTIME_LOG_LINE_NUM 3
 
@@ -79,6 +90,8 @@ typedef struct {
     int *exit_code;
     char *timeout;
     int shim_exit_code;
+    // isulad-shim compresses rotated json-file logs
+    bool log_compress;
 } shim_create_args;
 
 static void copy_process(shim_client_process_state *p, defs_process *dp)
@@ -125,6 +138,21 @@ static void copy_annotations(shim_client_process_state *p, json_map_string_strin
     }
 }
 
+static bool log_compress_enabled(const json_map_string_string *anno)
+{
+    size_t i;
+
+    if (anno == NULL) {
+        return false;
+    }
+    for (i = 0; i < anno->len; i++) {
+        if (strcmp(anno->keys[i], CONTAINER_LOG_CONFIG_KEY_COMPRESS) == 0) {
+            return strcmp(anno->values[i], "true") == 0;
+        }
+    }
+    return false;
+}
+
 static int file_write_int(const char *fname, int val)
 {
     int nret;
@@ -401,31 +429,324 @@ out:
     return ret;
 }
 
-static bool shim_alive(const char *workdir)
+static int pidfd_open_nointr(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static int pidfd_send_signal_nointr(int pidfd, int sig)
+{
+#ifdef SYS_pidfd_send_signal
+    return (int)syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * pidfds of shim and container init process, opened when they are created. a pidfd refers to the
+ * process itself, so unlike kill with a pid it never reaches another process that reuses the pid.
+ * a dup of each pidfd is watched in the pidfd monitor loop, which drops the entry once the process exits.
+ */
+typedef struct {
+    int pidfd;
+    // 0 if not checked, such as shim whose pid file is trusted
+    unsigned long long start_time;
+    // tells a monitor event of an old entry from the current one of the same pid
+    uint64_t gen;
+} tracked_pid_t;
+
+typedef struct {
+    pid_t pid;
+    uint64_t gen;
+} tracked_pid_event_t;
+
+static pthread_mutex_t g_tracked_pids_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_pidfd_monitor_once = PTHREAD_ONCE_INIT;
+static struct epoll_descr g_pidfd_monitor_descr;
+static bool g_pidfd_monitor_running;
+// pid -> tracked_pid_t
+static map_t *g_tracked_pids;
+static uint64_t g_tracked_pids_gen;
+
+static void tracked_pid_kvfree(void *key, void *value)
+{
+    tracked_pid_t *tp = (tracked_pid_t *)value;
+
+    free(key);
+    if (tp != NULL && tp->pidfd >= 0) {
+        close(tp->pidfd);
+    }
+    free(tp);
+}
+
+static void *pidfd_monitor(void *arg)
+{
+    int ret = 0;
+
+    ret = pthread_detach(pthread_self());
+    if (ret != 0) {
+        CRIT("Set thread detach fail");
+        return NULL;
+    }
+
+    prctl(PR_SET_NAME, "PidfdMonitor");
+
+    // epoll_loop returns when the last handler is removed, wait for the next one then
+    while (epoll_loop(&g_pidfd_monitor_descr, -1) == 0) {
+    }
+    SYSERROR("Pidfd monitor loop returned an error");
+
+    return NULL;
+}
+
+static void pidfd_monitor_init(void)
+{
+    pthread_t monitor_thread;
+
+    g_tracked_pids = map_new(MAP_INT_PTR, MAP_DEFAULT_CMP_FUNC, tracked_pid_kvfree);
+    if (g_tracked_pids == NULL) {
+        ERROR("Out of memory");
+        return;
+    }
+
+    if (epoll_loop_open(&g_pidfd_monitor_descr) != 0) {
+        ERROR("Failed to create pidfd monitor loop");
+        return;
+    }
+
+    if (pthread_create(&monitor_thread, NULL, pidfd_monitor, NULL) != 0) {
+        ERROR("Create pidfd monitor thread failed");
+        epoll_loop_close(&g_pidfd_monitor_descr);
+        return;
+    }
+    g_pidfd_monitor_running = true;
+}
+
+static int tracked_pid_exit_cb(int fd, uint32_t events, void *cbdata, struct epoll_descr *descr)
+{
+    tracked_pid_event_t *ev = (tracked_pid_event_t *)cbdata;
+    tracked_pid_t *tp = NULL;
+
+    if (pthread_mutex_lock(&g_tracked_pids_lock) != 0) {
+        ERROR("Failed to lock tracked pids");
+        return EPOLL_LOOP_HANDLE_CONTINUE;
+    }
+    tp = (tracked_pid_t *)map_search(g_tracked_pids, &ev->pid);
+    if (tp != NULL && tp->gen == ev->gen) {
+        (void)map_remove(g_tracked_pids, &ev->pid);
+    }
+    epoll_loop_del_handler(&g_pidfd_monitor_descr, fd);
+    (void)pthread_mutex_unlock(&g_tracked_pids_lock);
+
+    close(fd);
+    free(ev);
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
+// called with g_tracked_pids_lock held, the dup of pidfd is owned by the monitor loop
+static int tracked_pid_add_monitor(pid_t pid, const tracked_pid_t *tp)
+{
+    int fd = -1;
+    tracked_pid_event_t *ev = NULL;
+
+    ev = util_common_calloc_s(sizeof(tracked_pid_event_t));
+    if (ev == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    ev->pid = pid;
+    ev->gen = tp->gen;
+
+    fd = fcntl(tp->pidfd, F_DUPFD_CLOEXEC, 0);
+    if (fd < 0) {
+        SYSERROR("Failed to dup pidfd of %d", pid);
+        free(ev);
+        return -1;
+    }
+
+    if (epoll_loop_add_handler(&g_pidfd_monitor_descr, fd, tracked_pid_exit_cb, ev) != 0) {
+        ERROR("Failed to add pidfd of %d to monitor loop", pid);
+        close(fd);
+        free(ev);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * open pidfd of a process just created and keep it until the process exits.
+ * return -1 with errno ESRCH if process has exited, or ENOSYS if pidfd is not supported by kernel.
+ */
+static int track_pid(pid_t pid, unsigned long long start_time)
+{
+    int ret = -1;
+    int pidfd = -1;
+    tracked_pid_t *tp = NULL;
+
+    (void)pthread_once(&g_pidfd_monitor_once, pidfd_monitor_init);
+    if (!g_pidfd_monitor_running) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    pidfd = pidfd_open_nointr(pid);
+    if (pidfd < 0) {
+        if (errno != ESRCH && errno != ENOSYS) {
+            SYSWARN("failed to open pidfd of %d", pid);
+        }
+        return -1;
+    }
+
+    tp = util_common_calloc_s(sizeof(tracked_pid_t));
+    if (tp == NULL) {
+        ERROR("Out of memory");
+        close(pidfd);
+        errno = ENOMEM;
+        return -1;
+    }
+    tp->pidfd = pidfd;
+    tp->start_time = start_time;
+
+    if (pthread_mutex_lock(&g_tracked_pids_lock) != 0) {
+        ERROR("Failed to lock tracked pids");
+        tracked_pid_kvfree(NULL, tp);
+        return -1;
+    }
+    tp->gen = ++g_tracked_pids_gen;
+    // an old entry of a reused pid whose exit is not handled by monitor loop yet
+    if (map_search(g_tracked_pids, &pid) != NULL) {
+        (void)map_remove(g_tracked_pids, &pid);
+    }
+    if (!map_insert(g_tracked_pids, &pid, tp)) {
+        ERROR("Failed to track pid %d", pid);
+        tracked_pid_kvfree(NULL, tp);
+        goto out;
+    }
+    if (tracked_pid_add_monitor(pid, tp) != 0) {
+        (void)map_remove(g_tracked_pids, &pid);
+        goto out;
+    }
+    ret = 0;
+
+out:
+    (void)pthread_mutex_unlock(&g_tracked_pids_lock);
+    return ret;
+}
+
+// called with g_tracked_pids_lock held
+static tracked_pid_t *find_tracked_pid(pid_t pid, unsigned long long start_time)
+{
+    tracked_pid_t *tp = NULL;
+
+    if (g_tracked_pids == NULL) {
+        return NULL;
+    }
+
+    tp = (tracked_pid_t *)map_search(g_tracked_pids, &pid);
+    if (tp == NULL || (start_time != 0 && tp->start_time != 0 && tp->start_time != start_time)) {
+        return NULL;
+    }
+
+    return tp;
+}
+
+// return 1 if process is alive, 0 if it has exited, -1 if it is not tracked
+static int tracked_pid_alive(pid_t pid, unsigned long long start_time)
+{
+    int ret = -1;
+    tracked_pid_t *tp = NULL;
+
+    if (pthread_mutex_lock(&g_tracked_pids_lock) != 0) {
+        ERROR("Failed to lock tracked pids");
+        return -1;
+    }
+    tp = find_tracked_pid(pid, start_time);
+    if (tp != NULL) {
+        // pidfd becomes readable when process exits
+        struct pollfd pfd = { .fd = tp->pidfd, .events = POLLIN };
+        ret = (poll(&pfd, 1, 0) == 0) ? 1 : 0;
+    }
+    (void)pthread_mutex_unlock(&g_tracked_pids_lock);
+
+    return ret;
+}
+
+// return 0 if signal is sent, -1 with errno ESRCH if process has exited, 1 if it is not tracked
+static int tracked_pid_kill(pid_t pid, unsigned long long start_time, int sig)
+{
+    int ret = 1;
+    tracked_pid_t *tp = NULL;
+
+    if (pthread_mutex_lock(&g_tracked_pids_lock) != 0) {
+        ERROR("Failed to lock tracked pids");
+        return 1;
+    }
+    tp = find_tracked_pid(pid, start_time);
+    if (tp != NULL) {
+        ret = pidfd_send_signal_nointr(tp->pidfd, sig);
+    }
+    (void)pthread_mutex_unlock(&g_tracked_pids_lock);
+
+    return ret;
+}
+
+static int read_shim_pid(const char *workdir)
 {
     int pid = 0;
     char fpid[PATH_MAX] = { 0 };
-    int ret = 0;
     int nret = 0;
 
     nret = snprintf(fpid, sizeof(fpid), "%s/shim-pid", workdir);
     if (nret < 0 || (size_t)nret >= sizeof(fpid)) {
         ERROR("failed make shim-pid full path");
-        return false;
+        return -1;
     }
 
     file_read_int(fpid, &pid);
-
     if (pid <= 0) {
         ERROR("failed read shim-pid file %s", fpid);
+        return -1;
+    }
+
+    return pid;
+}
+
+static bool shim_alive(const char *workdir)
+{
+    int pid = 0;
+    int ret = 0;
+
+    pid = read_shim_pid(workdir);
+    if (pid <= 0) {
         return false;
     }
 
-    ret = kill(pid, 0);
-    if (ret != 0) {
-        SYSINFO("kill 0 shim-pid with error.");
+    ret = tracked_pid_alive(pid, 0);
+    if (ret < 0) {
+        // shim created before isulad restarted, track it from now on
+        if (track_pid(pid, 0) != 0) {
+            if (errno == ESRCH) {
+                return false;
+            }
+            // no pidfd support, pid file of shim is trusted
+            ret = kill(pid, 0);
+            if (ret != 0) {
+                SYSINFO("kill 0 shim-pid with error.");
+            }
+            return ret == 0;
+        }
+        ret = tracked_pid_alive(pid, 0);
     }
-    return ret == 0;
+
+    return ret == 1;
 }
 
 typedef struct {
@@ -723,6 +1044,73 @@ out:
     return ret;
 }
 
+// processes of vm based runtimes are not in a host cgroup, their stats come from runtime
+static bool runtime_stats_from_cgroup(const char *runtime)
+{
+    const char *cmd = NULL;
+    const char *name = NULL;
+
+    get_runtime_cmd(runtime, &cmd);
+    if (cmd == NULL) {
+        return false;
+    }
+
+    name = strrchr(cmd, '/');
+    name = name != NULL ? name + 1 : cmd;
+    return strncmp(name, "kata", strlen("kata")) != 0 && strcmp(name, "runsc") != 0;
+}
+
+static void transform_stats_info_from_cgroup(const cgroup_metrics_t *metrics,
+                                             struct runtime_container_resources_stats_info *info)
+{
+    info->pids_current = metrics->cgpids_metrics.pid_current;
+    info->cpu_use_nanos = metrics->cgcpu_metrics.cpu_use_nanos;
+    info->cpu_system_use = metrics->cgcpu_metrics.cpu_system_use;
+    info->mem_used = metrics->cgmem_metrics.mem_used;
+    info->mem_limit = metrics->cgmem_metrics.mem_limit;
+    info->inactive_file_total = metrics->cgmem_metrics.total_inactive_file;
+    info->rss_bytes = metrics->cgmem_metrics.total_rss;
+    info->page_faults = metrics->cgmem_metrics.total_pgfault;
+    info->major_page_faults = metrics->cgmem_metrics.total_pgmajfault;
+    info->swap_used = metrics->cgmem_metrics.swap_used;
+    info->swap_limit = metrics->cgmem_metrics.swap_limit;
+    info->blkio_read = metrics->cgblkio_metrics.blkio_read;
+    info->blkio_write = metrics->cgblkio_metrics.blkio_write;
+}
+
+// read stats from cgroup of container init process, instead of forking runtime events --stats
+static int cgroup_call_stats(const char *workdir, struct runtime_container_resources_stats_info *info)
+{
+    int pid = 0;
+    char fname[PATH_MAX] = { 0 };
+    cgroup_metrics_t metrics = { 0 };
+    __isula_auto_free char *cgroup_path = NULL;
+
+    int nret = snprintf(fname, sizeof(fname), "%s/pid", workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(fname)) {
+        ERROR("failed make pid full path");
+        return -1;
+    }
+
+    file_read_int(fname, &pid);
+    if (pid <= 0) {
+        return -1;
+    }
+
+    cgroup_path = common_get_process_cgroup_path(pid, "memory");
+    // process exited, or not in a container cgroup
+    if (cgroup_path == NULL || strcmp(cgroup_path, "/") == 0) {
+        return -1;
+    }
+
+    if (common_get_cgroup_metrics(cgroup_path, &metrics) != 0) {
+        return -1;
+    }
+
+    transform_stats_info_from_cgroup(&metrics, info);
+    return 0;
+}
+
 // Used to call runtime commands that do not need to handle the return value
 static int runtime_call_simple(const char *workdir, const char *runtime, const char *subcmd, const char **opts,
                                size_t opts_len, const char *id, handle_output_callback_t cb)
@@ -852,6 +1240,23 @@ static int get_engine_routine_log_info(char **engine_log_path, char **log_level)
     return 0;
 }
 
+// shim writes container process pid to notify fifo, without it isulad falls back to poll pid file
+static void create_notify_fifo(const char *workdir)
+{
+    char fname[PATH_MAX] = { 0 };
+    int nret = 0;
+
+    nret = snprintf(fname, sizeof(fname), "%s/%s", workdir, SHIM_NOTIFY_FIFO);
+    if (nret < 0 || (size_t)nret >= sizeof(fname)) {
+        ERROR("failed make notify fifo full path");
+        return;
+    }
+
+    if (mknod(fname, S_IFIFO | LOG_FIFO_MODE, (dev_t)0) != 0 && errno != EEXIST) {
+        SYSWARN("failed to create notify fifo %s", fname);
+    }
+}
+
 /*
     exit_code records the exit code of the container, obtained by reading the stdout of isulad-shim;
     shim_exit_code records the exit code of isulad-shim, obtained through waitpid;
@@ -859,6 +1264,7 @@ static int get_engine_routine_log_info(char **engine_log_path, char **log_level)
 static int shim_create(shim_create_args *args)
 {
     pid_t pid = 0;
+    pid_t shim_pid = 0;
     int shim_stderr_pipe[2] = { -1, -1 };
     int shim_stdout_pipe[2] = { -1, -1 };
     // used to accept exec error msg
@@ -896,6 +1302,8 @@ static int shim_create(shim_create_args *args)
         return -1;
     }
 
+    create_notify_fifo(args->workdir);
+
     if (pipe2(shim_stderr_pipe, O_CLOEXEC) != 0) {
         ERROR("Failed to create pipe for shim stderr");
         return -1;
@@ -999,6 +1407,11 @@ realexec:
             exit(EXIT_FAILURE);
         }
 
+        if (args->log_compress && setenv(SHIIM_LOG_COMPRESS_ENV, "gzip", 1) != 0) {
+            (void)dprintf(exec_err_pipe[1], "%s: failed to set SHIIM_LOG_COMPRESS_ENV env for process %d", args->id, getpid());
+            exit(EXIT_FAILURE);
+        }
+
         execvp(SHIM_BINARY, (char * const *)params);
         (void)dprintf(exec_err_pipe[1], "run process: %s failed: %s", SHIM_BINARY, strerror(errno));
         exit(EXIT_FAILURE);
@@ -1032,6 +1445,14 @@ realexec:
         goto out;
     }
 
+    // background shim is a grandchild that is not waited, track it by pidfd from now on
+    if (!args->fg) {
+        shim_pid = read_shim_pid(args->workdir);
+        if (shim_pid > 0 && track_pid(shim_pid, 0) != 0 && errno != ENOSYS) {
+            SYSWARN("failed to track shim %d", shim_pid);
+        }
+    }
+
     // exit_code is NULL when command is create.
     if (args->exit_code == NULL) {
         goto out;
@@ -1066,19 +1487,156 @@ out:
     return ret;
 }
 
+// pidfd of shim, -1 if shim is dead or pidfd is not supported
+static int open_shim_pidfd(const char *workdir)
+{
+    int pid = 0;
+    int fd = -1;
+    char fpid[PATH_MAX] = { 0 };
+
+    int nret = snprintf(fpid, sizeof(fpid), "%s/shim-pid", workdir);
+    if (nret < 0 || (size_t)nret >= sizeof(fpid)) {
+        ERROR("failed make shim-pid full path");
+        return -1;
+    }
+
+    file_read_int(fpid, &pid);
+    if (pid <= 0) {
+        return -1;
+    }
+
+    fd = pidfd_open_nointr(pid);
+    if (fd < 0 && errno != ESRCH && errno != ENOSYS) {
+        SYSWARN("failed to open pidfd of shim %d", pid);
+    }
+    return fd;
+}
+
+static int open_notify_fifo(const char *workdir)
+{
+    char fname[PATH_MAX] = { 0 };
+
+    int nret = snprintf(fname, sizeof(fname), "%s/%s", workdir, SHIM_NOTIFY_FIFO);
+    if (nret < 0 || (size_t)nret >= sizeof(fname)) {
+        ERROR("failed make notify fifo full path");
+        return -1;
+    }
+
+    if (!util_file_exists(fname)) {
+        return -1;
+    }
+
+    return util_open(fname, O_RDONLY | O_NONBLOCK, 0);
+}
+
+static int64_t elapsed_ms(const struct timespec *beg)
+{
+    struct timespec now = { 0 };
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        return -1;
+    }
+
+    return (int64_t)(now.tv_sec - beg->tv_sec) * 1000 + (now.tv_nsec - beg->tv_nsec) / 1000000;
+}
+
+/*
+ * wait until shim writes container process pid to notify fifo, or shim exits. pidfd of shim
+ * is readable when shim exits, and unlike kill 0 it is not fooled by pid reuse.
+ * return 1 if pid is read, 0 if shim exited, -1 on timeout or error.
+ */
+static int wait_notify_pid(const char *workdir, int fifo_fd, int *pid)
+{
+    int ret = -1;
+    int shim_fd = -1;
+    int64_t elapsed = 0;
+    struct timespec beg = { 0 };
+
+    shim_fd = open_shim_pidfd(workdir);
+
+    if (clock_gettime(CLOCK_MONOTONIC, &beg) != 0) {
+        ERROR("failed get time");
+        goto out;
+    }
+
+    while ((elapsed = elapsed_ms(&beg)) >= 0 && elapsed <= PID_WAIT_TIME * 1000) {
+        struct pollfd fds[2] = { { .fd = fifo_fd, .events = POLLIN }, { .fd = shim_fd, .events = POLLIN } };
+        int timeout = shim_fd >= 0 ? (int)(PID_WAIT_TIME * 1000 - elapsed) : SHIM_CHECK_INTERVAL_MS;
+        int nfds = poll(fds, shim_fd >= 0 ? 2 : 1, timeout);
+
+        if (nfds < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            SYSERROR("failed to poll notify fifo");
+            goto out;
+        }
+        if (fds[0].revents & POLLIN) {
+            ssize_t nread = util_read_nointr(fifo_fd, pid, sizeof(*pid));
+            if (nread == (ssize_t)sizeof(*pid) && *pid > 0) {
+                ret = 1;
+                goto out;
+            }
+            ERROR("invalid pid from notify fifo %s", workdir);
+            goto out;
+        }
+        // writer of fifo closed or shim exited
+        if ((fds[0].revents & POLLHUP) || (shim_fd >= 0 && fds[1].revents != 0) ||
+            (shim_fd < 0 && !shim_alive(workdir))) {
+            ret = 0;
+            goto out;
+        }
+    }
+    ERROR("wait container process pid timeout %s", workdir);
+
+out:
+    if (shim_fd >= 0) {
+        close(shim_fd);
+    }
+    return ret;
+}
+
 static int get_container_process_pid(const char *workdir)
 {
     char fname[PATH_MAX] = { 0 };
     int pid = 0;
+    int nret = 0;
+    int fifo_fd = -1;
     struct timespec beg = { 0 };
     struct timespec end = { 0 };
 
-    int nret = snprintf(fname, sizeof(fname), "%s/pid", workdir);
+    nret = snprintf(fname, sizeof(fname), "%s/pid", workdir);
     if (nret < 0 || (size_t)nret >= sizeof(fname)) {
         ERROR("failed make pid full path");
         return -1;
     }
 
+    file_read_int(fname, &pid);
+    if (pid > 0) {
+        return pid;
+    }
+
+    fifo_fd = open_notify_fifo(workdir);
+    if (fifo_fd >= 0) {
+        nret = wait_notify_pid(workdir, fifo_fd, &pid);
+        close(fifo_fd);
+        if (nret < 0) {
+            return -1;
+        }
+        if (nret > 0) {
+            return pid;
+        }
+        // shim exited, it may be after runtime wrote the pid file, same as below
+        file_read_int(fname, &pid);
+        if (pid > 0) {
+            DEBUG("Process exit and isulad-shim exit");
+            return pid;
+        }
+        ERROR("failed read pid from dead shim %s", workdir);
+        return -1;
+    }
+
+    // no notify fifo, poll the pid file
     if (clock_gettime(CLOCK_MONOTONIC, &beg) != 0) {
         ERROR("failed get time");
         return -1;
@@ -1096,7 +1654,7 @@ static int get_container_process_pid(const char *workdir)
         file_read_int(fname, &pid);
         if (pid == 0) {
             if (shim_alive(workdir)) {
-                util_usleep_nointerupt(100000);
+                util_usleep_nointerupt(SHIM_CHECK_INTERVAL_MS * 1000);
                 continue;
             }
             // If isulad does not read the container process pid, but isulad-shim reads the pid,
@@ -1133,7 +1691,9 @@ static void shim_kill_force(const char *workdir)
         goto out;
     }
 
-    kill(pid, SIGKILL);
+    if (tracked_pid_kill(pid, 0, SIGKILL) > 0) {
+        kill(pid, SIGKILL);
+    }
 
 out:
     INFO("kill shim force %s", workdir);
@@ -1205,6 +1765,7 @@ int rt_isula_create(const char *id, const char *runtime, const rt_create_params_
     args.runtime_cmd = cmd;
     args.exit_code = NULL;
     args.timeout = NULL;
+    args.log_compress = log_compress_enabled(config->annotations);
     ret = shim_create(&args);
     if (ret != 0) {
         runtime_call_delete_force(workdir, runtime, id);
@@ -1274,6 +1835,11 @@ int rt_isula_start(const char *id, const char *runtime, const rt_start_params_t
     pid_info->ppid = shim_pid;
     pid_info->pstart_time = p_proc->start_time;
 
+    // signals to init process go through its pidfd, see rt_isula_kill
+    if (track_pid(proc->pid, proc->start_time) != 0 && errno != ENOSYS) {
+        SYSWARN("%s: failed to track init process %d", id, (int)proc->pid);
+    }
+
     if (runtime_call_simple(workdir, runtime, "start", NULL, 0, id, NULL) != 0) {
         ERROR("call runtime start id failed");
         goto out;
@@ -1456,6 +2022,132 @@ static int preparation_exec(const char *id, const char *runtime, const char *wor
     return 0;
 }
 
+static int get_attach_socketfd(const char *attach_socket, int *socket_fd)
+{
+    struct sockaddr_un addr = { 0 };
+    __isula_auto_close int tmp_socket = -1;
+
+    if (strlen(attach_socket) >= sizeof(addr.sun_path)) {
+        SYSERROR("Invalid attach socket path: %s", attach_socket);
+        return -1;
+    }
+
+    tmp_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (tmp_socket < 0) {
+        SYSERROR("Failed to create attach socket");
+        return -1;
+    }
+
+    if (isula_set_non_block(tmp_socket) < 0) {
+        SYSERROR("Failed to set socket non block");
+        return -1;
+    }
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)strcpy(addr.sun_path, attach_socket);
+
+    if (connect(tmp_socket, (void *)&addr, sizeof(addr)) < 0) {
+        SYSERROR("Failed to connect attach socket: %s", attach_socket);
+        return -1;
+    }
+    *socket_fd = isula_transfer_fd(tmp_socket);
+    return 0;
+}
+
+static int read_with_timeout(int fd, void *buf, size_t len, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    size_t done = 0;
+    ssize_t nread = 0;
+    int nret = 0;
+
+    while (done < len) {
+        nret = poll(&pfd, 1, timeout_ms);
+        if (nret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nret <= 0) {
+            return -1;
+        }
+
+        nread = util_read_nointr(fd, (char *)buf + done, len - done);
+        if (nread < 0 && errno == EAGAIN) {
+            continue;
+        }
+        if (nread <= 0) {
+            return -1;
+        }
+        done += (size_t)nread;
+    }
+
+    return 0;
+}
+
+static bool exec_by_container_shim(const rt_exec_params_t *params)
+{
+    // terminal exec needs console socket of runtime, which is served by a new isulad-shim
+    return fg_exec(params) && params->spec != NULL && !params->spec->terminal;
+}
+
+// exec_with_container_shim sends exec request to the shim of container, so exec does not fork
+// isulad and start a new isulad-shim. returns 1 if the request is not accepted by the shim,
+// for example kata-runtime or the shim is started by an old isulad.
+static int exec_with_container_shim(const char *id, const rt_exec_params_t *params, const char *workdir,
+                                    shim_create_args *args)
+{
+    __isula_auto_close int socket_fd = -1;
+    char attach_socket[PATH_MAX] = { 0 };
+    char buf[BUFSIZ] = { 0 };
+    int status = -1;
+    // shim exit code and exit code of exec process
+    int result[2] = { 0 };
+    int timeout_ms = -1;
+    int len = 0;
+
+    len = snprintf(attach_socket, sizeof(attach_socket), "%s/%s/%s", params->state, id, ATTACH_SOCKET);
+    if (len < 0 || (size_t)len >= sizeof(attach_socket) || !util_file_exists(attach_socket)) {
+        return 1;
+    }
+
+    len = snprintf(buf, sizeof(buf), "%s %s %" PRId64, SHIM_EXEC_REQUEST, workdir,
+                   params->timeout > 0 ? params->timeout : 0);
+    if (len < 0 || (size_t)len >= sizeof(buf)) {
+        ERROR("Failed to make exec request");
+        return 1;
+    }
+
+    if (get_attach_socketfd(attach_socket, &socket_fd) != 0) {
+        return 1;
+    }
+
+    if (isula_file_write_nointr(socket_fd, buf, len) != len) {
+        SYSERROR("Failed to write exec request to shim of %s", id);
+        return 1;
+    }
+
+    if (read_with_timeout(socket_fd, &status, sizeof(status), ATTACH_WAIT_TIME * 1000) != 0 || status != 0) {
+        DEBUG("Shim of %s does not accept exec request, start a new shim", id);
+        return 1;
+    }
+
+    // the shim kills exec process on timeout, wait some more time for its reply
+    if (params->timeout > 0 && params->timeout < INT_MAX / 1000 - ATTACH_WAIT_TIME) {
+        timeout_ms = (int)(params->timeout + ATTACH_WAIT_TIME) * 1000;
+    }
+    if (read_with_timeout(socket_fd, result, sizeof(result), timeout_ms) != 0) {
+        ERROR("Failed to read exec result from shim of %s", id);
+        return -1;
+    }
+
+    args->shim_exit_code = result[0];
+    if (result[0] != 0) {
+        return -1;
+    }
+    *args->exit_code = result[1];
+    return 0;
+}
+
 int rt_isula_exec(const char *id, const char *runtime, const rt_exec_params_t *params, int *exit_code)
 {
     const char *cmd = NULL;
@@ -1519,7 +2211,13 @@ int rt_isula_exec(const char *id, const char *runtime, const rt_exec_params_t *p
     args.runtime_cmd = cmd;
     args.exit_code = exit_code;
     args.timeout = timeout;
-    ret = shim_create(&args);
+    ret = 1;
+    if (exec_by_container_shim(params)) {
+        ret = exec_with_container_shim(id, params, workdir, &args);
+    }
+    if (ret > 0) {
+        ret = shim_create(&args);
+    }
     if (ret != 0) {
         if (args.shim_exit_code == SHIM_EXIT_TIMEOUT) {
             isulad_set_error_message("Exec container error;exec timeout");
@@ -1624,39 +2322,6 @@ static int get_container_attach_statuscode(const char *workdir, int attach_shim_
     return -1;
 }
 
-static int get_attach_socketfd(const char *attach_socket, int *socket_fd)
-{
-    struct sockaddr_un addr = { 0 };
-    __isula_auto_close int tmp_socket = -1;
-
-    if (strlen(attach_socket) >= sizeof(addr.sun_path)) {
-        SYSERROR("Invalid attach socket path: %s", attach_socket);
-        return -1;
-    }
-
-    tmp_socket = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (tmp_socket < 0) {
-        SYSERROR("Failed to create attach socket");
-        return -1;
-    }
-
-    if (isula_set_non_block(tmp_socket) < 0) {
-        SYSERROR("Failed to set socket non block");
-        return -1;
-    }
-
-    (void)memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
-    (void)strcpy(addr.sun_path, attach_socket);
-
-    if (connect(tmp_socket, (void *)&addr, sizeof(addr)) < 0) {
-        SYSERROR("Failed to connect attach socket: %s", attach_socket);
-        return -1;
-    }
-    *socket_fd = isula_transfer_fd(tmp_socket);
-    return 0;
-}
-
 int rt_isula_attach(const char *id, const char *runtime, const rt_attach_params_t *params)
 {
     int ret = 0;
@@ -2049,6 +2714,11 @@ int rt_isula_resources_stats(const char *id, const char *runtime, const rt_stats
         goto out;
     }
 
+    if (runtime_stats_from_cgroup(runtime) && cgroup_call_stats(workdir, rs_stats) == 0) {
+        ret = 0;
+        goto out;
+    }
+
     ret = runtime_call_stats(workdir, runtime, id, rs_stats);
 
 out:
@@ -2128,12 +2798,22 @@ int rt_isula_exec_resize(const char *id, const char *runtime, const rt_exec_resi
 
 int rt_isula_kill(const char *id, const char *runtime, const rt_kill_params_t *params)
 {
+    int ret = 0;
+    bool exited = false;
+
     if (id == NULL || runtime == NULL || params == NULL || params->pid < 0) {
         ERROR("Invalid arguments not allowed");
         return -1;
     }
 
-    if (util_process_alive(params->pid, params->start_time) == false) {
+    // a pidfd never reaches another process reusing the pid, unlike the alive check and kill below
+    ret = tracked_pid_kill(params->pid, params->start_time, (int)params->signal);
+    if (ret == 0) {
+        return 0;
+    }
+    exited = (ret < 0 && errno == ESRCH) || util_process_alive(params->pid, params->start_time) == false;
+
+    if (exited) {
         if (params->signal == params->stop_signal || params->signal == SIGKILL) {
             WARN("Process %d is not alive", params->pid);
             return 0;
@@ -2142,7 +2822,7 @@ int rt_isula_kill(const char *id, const char *runtime, const rt_kill_params_t *p
             return -1;
         }
     } else {
-        int ret = kill(params->pid, (int)params->signal);
+        ret = kill(params->pid, (int)params->signal);
         if (ret < 0) {
             SYSERROR("Can not kill process (pid=%d) with signal %u", params->pid, params->signal);
             return -1;
@@ -818,7 +818,8 @@ static bool is_storage_opts_valid(const json_map_string_string *storage_opts)
     size_t i;
 
     for (i = 0; i < storage_opts->len; i++) {
-        if (strcmp(storage_opts->keys[i], "size") != 0) {
+        if (strcmp(storage_opts->keys[i], "size") != 0 && strcmp(storage_opts->keys[i], STORAGE_OPT_VOLATILE) != 0 &&
+            strcmp(storage_opts->keys[i], STORAGE_OPT_TMPFS_SIZE) != 0) {
             // Only check key here, check value by image driver
             ERROR("Unknown storage option: %s", storage_opts->keys[i]);
             isulad_set_error_message("Unknown storage option: %s", storage_opts->keys[i]);
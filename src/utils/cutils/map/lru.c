@@ -0,0 +1,222 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide size bounded lru index of string keys
+ ******************************************************************************/
+#include "lru.h"
+
+#include <stdlib.h>
+
+#include "isula_libutils/log.h"
+#include "linked_list.h"
+#include "map.h"
+#include "utils.h"
+
+typedef struct {
+    char *key;
+    void *value;
+    int64_t size;
+    // node of lru->list, head side is least recently used
+    struct linked_list node;
+} lru_item;
+
+struct _lru_t {
+    int64_t capacity;
+    int64_t size;
+    uint64_t evictions;
+    // key -> lru_item, map keeps its own copy of the key
+    map_t *items;
+    struct linked_list list;
+    lru_release_func release;
+    void *context;
+};
+
+static void items_kvfree(void *key, void *value)
+{
+    lru_item *item = (lru_item *)value;
+
+    free(key);
+    if (item != NULL) {
+        free(item->key);
+        free(item);
+    }
+}
+
+lru_t *lru_new(int64_t capacity, lru_release_func release, void *context)
+{
+    lru_t *lru = NULL;
+
+    lru = util_common_calloc_s(sizeof(lru_t));
+    if (lru == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+
+    lru->items = map_new(MAP_STR_PTR, MAP_DEFAULT_CMP_FUNC, items_kvfree);
+    if (lru->items == NULL) {
+        ERROR("Out of memory");
+        free(lru);
+        return NULL;
+    }
+    linked_list_init(&lru->list);
+    lru->capacity = capacity;
+    lru->release = release;
+    lru->context = context;
+
+    return lru;
+}
+
+static void drop_item(lru_t *lru, lru_item *item, bool evicted)
+{
+    linked_list_del(&item->node);
+    lru->size -= item->size;
+    if (evicted) {
+        lru->evictions++;
+    }
+    if (lru->release != NULL) {
+        lru->release(item->key, item->value, evicted, lru->context);
+    }
+    // the key of map is a copy, item->key is still valid here and freed with item
+    if (!map_remove(lru->items, item->key)) {
+        ERROR("Failed to remove %s from lru", item->key);
+    }
+}
+
+void lru_free(lru_t *lru)
+{
+    if (lru == NULL) {
+        return;
+    }
+
+    while (!linked_list_empty(&lru->list)) {
+        drop_item(lru, (lru_item *)linked_list_first_elem(&lru->list), false);
+    }
+    map_free(lru->items);
+    lru->items = NULL;
+    free(lru);
+}
+
+void *lru_get(lru_t *lru, const char *key)
+{
+    lru_item *item = NULL;
+
+    if (lru == NULL || key == NULL) {
+        return NULL;
+    }
+
+    item = (lru_item *)map_search(lru->items, (void *)key);
+    if (item == NULL) {
+        return NULL;
+    }
+
+    linked_list_del(&item->node);
+    linked_list_add_tail(&lru->list, &item->node);
+    return item->value;
+}
+
+void lru_reserve(lru_t *lru, int64_t need)
+{
+    if (lru == NULL) {
+        return;
+    }
+
+    while (lru->size + need > lru->capacity && !linked_list_empty(&lru->list)) {
+        drop_item(lru, (lru_item *)linked_list_first_elem(&lru->list), true);
+    }
+}
+
+int lru_put(lru_t *lru, const char *key, void *value, int64_t size)
+{
+    lru_item *item = NULL;
+
+    if (lru == NULL || key == NULL || value == NULL || size < 0) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    if (size > lru->capacity || map_search(lru->items, (void *)key) != NULL) {
+        return 1;
+    }
+
+    item = util_common_calloc_s(sizeof(lru_item));
+    if (item == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    item->key = util_strdup_s(key);
+    item->size = size;
+    linked_list_add_elem(&item->node, item);
+
+    lru_reserve(lru, size);
+    if (!map_insert(lru->items, (void *)key, item)) {
+        ERROR("Failed to insert %s to lru", key);
+        free(item->key);
+        free(item);
+        return -1;
+    }
+    // value is owned by lru only after insertion succeeds
+    item->value = value;
+    linked_list_add_tail(&lru->list, &item->node);
+    lru->size += size;
+
+    return 0;
+}
+
+bool lru_remove(lru_t *lru, const char *key)
+{
+    lru_item *item = NULL;
+
+    if (lru == NULL || key == NULL) {
+        return false;
+    }
+
+    item = (lru_item *)map_search(lru->items, (void *)key);
+    if (item == NULL) {
+        return false;
+    }
+
+    drop_item(lru, item, false);
+    return true;
+}
+
+void lru_remove_if(lru_t *lru, lru_match_func match, void *arg)
+{
+    struct linked_list *it = NULL;
+    struct linked_list *next = NULL;
+    lru_item *item = NULL;
+
+    if (lru == NULL || match == NULL) {
+        return;
+    }
+
+    linked_list_for_each_safe(it, &lru->list, next) {
+        item = (lru_item *)it->elem;
+        if (match(item->key, item->value, arg)) {
+            drop_item(lru, item, false);
+        }
+    }
+}
+
+int64_t lru_size(const lru_t *lru)
+{
+    return lru == NULL ? 0 : lru->size;
+}
+
+int64_t lru_capacity(const lru_t *lru)
+{
+    return lru == NULL ? 0 : lru->capacity;
+}
+
+uint64_t lru_evictions(const lru_t *lru)
+{
+    return lru == NULL ? 0 : lru->evictions;
+}
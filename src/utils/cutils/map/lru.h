@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide size bounded lru index of string keys
+ ******************************************************************************/
+#ifndef UTILS_CUTILS_MAP_LRU_H
+#define UTILS_CUTILS_MAP_LRU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+// not thread safe, callers serialize all calls on one lru with their own lock
+typedef struct _lru_t lru_t;
+
+/* function called when value leaves lru, evicted is true if it was pushed out to make room */
+typedef void (*lru_release_func)(const char *key, void *value, bool evicted, void *context);
+
+/* function to select items in lru_remove_if */
+typedef bool (*lru_match_func)(const char *key, void *value, void *arg);
+
+lru_t *lru_new(int64_t capacity, lru_release_func release, void *context);
+
+/* release all items and free lru */
+void lru_free(lru_t *lru);
+
+/* return value of key and mark it most recently used, NULL if not found */
+void *lru_get(lru_t *lru, const char *key);
+
+/* add non NULL value owned by lru afterwards, size is charged against capacity and least recently
+ * used items are evicted to make room. return 1 and keep value with caller if key exists or size
+ * exceeds capacity, -1 on error */
+int lru_put(lru_t *lru, const char *key, void *value, int64_t size);
+
+/* release item of key, return false if not found */
+bool lru_remove(lru_t *lru, const char *key);
+
+/* release every item matched */
+void lru_remove_if(lru_t *lru, lru_match_func match, void *arg);
+
+/* evict least recently used items until need more bytes fit capacity */
+void lru_reserve(lru_t *lru, int64_t need);
+
+int64_t lru_size(const lru_t *lru);
+
+int64_t lru_capacity(const lru_t *lru);
+
+uint64_t lru_evictions(const lru_t *lru);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif // UTILS_CUTILS_MAP_LRU_H
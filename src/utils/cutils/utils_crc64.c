@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide slice-by-16 crc64 with iso polynomial
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "utils_crc64.h"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "isula_libutils/log.h"
+#include "utils.h"
+#include "utils_file.h"
+
+// reversed form of x^64 + x^4 + x^3 + x + 1
+#define CRC64_ISO_POLY 0xD800000000000000ULL
+#define CRC64_SLICES 16
+#define CRC64_READ_SIZE (256 * 1024)
+
+static uint64_t g_crc64_table[CRC64_SLICES][256];
+static pthread_once_t g_crc64_once = PTHREAD_ONCE_INIT;
+
+static void crc64_make_table(void)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < 256; i++) {
+        uint64_t crc = i;
+
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ CRC64_ISO_POLY : crc >> 1;
+        }
+        g_crc64_table[0][i] = crc;
+    }
+
+    // table k gives the crc of byte i followed by k zero bytes
+    for (i = 0; i < 256; i++) {
+        for (j = 1; j < CRC64_SLICES; j++) {
+            uint64_t prev = g_crc64_table[j - 1][i];
+
+            g_crc64_table[j][i] = (prev >> 8) ^ g_crc64_table[0][prev & 0xff];
+        }
+    }
+}
+
+static inline uint64_t crc64_load_le(const unsigned char *p)
+{
+    uint64_t v;
+
+    (void)memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+uint64_t util_crc64_iso_update(uint64_t crc, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t (*t)[256] = g_crc64_table;
+
+    if (data == NULL || len == 0) {
+        return crc;
+    }
+
+    (void)pthread_once(&g_crc64_once, crc64_make_table);
+
+    crc = ~crc;
+    while (len >= CRC64_SLICES) {
+        uint64_t a = crc64_load_le(p) ^ crc;
+        uint64_t b = crc64_load_le(p + 8);
+
+        crc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][(a >> 24) & 0xff] ^
+              t[11][(a >> 32) & 0xff] ^ t[10][(a >> 40) & 0xff] ^ t[9][(a >> 48) & 0xff] ^ t[8][a >> 56] ^
+              t[7][b & 0xff] ^ t[6][(b >> 8) & 0xff] ^ t[5][(b >> 16) & 0xff] ^ t[4][(b >> 24) & 0xff] ^
+              t[3][(b >> 32) & 0xff] ^ t[2][(b >> 40) & 0xff] ^ t[1][(b >> 48) & 0xff] ^ t[0][b >> 56];
+        p += CRC64_SLICES;
+        len -= CRC64_SLICES;
+    }
+
+    while (len > 0) {
+        crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+        p++;
+        len--;
+    }
+
+    return ~crc;
+}
+
+int util_file_crc64_iso(const char *file, uint64_t *crc)
+{
+    int ret = 0;
+    int fd = -1;
+    ssize_t size = 0;
+    void *buffer = NULL;
+    uint64_t sum = 0;
+
+    if (file == NULL || crc == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    fd = util_open(file, O_RDONLY, 0);
+    if (fd < 0) {
+        SYSERROR("Open file: %s, failed", file);
+        return -1;
+    }
+
+    buffer = util_common_calloc_s(CRC64_READ_SIZE);
+    if (buffer == NULL) {
+        ERROR("Out of memory");
+        ret = -1;
+        goto out;
+    }
+
+    // files are read once from start to end
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    while (true) {
+        size = util_read_nointr(fd, buffer, CRC64_READ_SIZE);
+        if (size < 0) {
+            SYSERROR("Read file %s failed", file);
+            ret = -1;
+            goto out;
+        } else if (size == 0) {
+            break;
+        }
+        sum = util_crc64_iso_update(sum, buffer, (size_t)size);
+    }
+
+    *crc = sum;
+
+out:
+    close(fd);
+    free(buffer);
+    return ret;
+}
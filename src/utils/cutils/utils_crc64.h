@@ -0,0 +1,35 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide slice-by-16 crc64 with iso polynomial
+ ******************************************************************************/
+#ifndef UTILS_CUTILS_UTILS_CRC64_H
+#define UTILS_CUTILS_UTILS_CRC64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// same result as isula_crc_update with ISO_POLY and go hash/crc64 with crc64.ISO, start with crc 0
+uint64_t util_crc64_iso_update(uint64_t crc, const void *data, size_t len);
+
+// crc64 of the whole file content
+int util_file_crc64_iso(const char *file, uint64_t *crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTILS_CUTILS_UTILS_CRC64_H
@@ -0,0 +1,638 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide parallel directory size calculation
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include "utils_dir_size.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isula_libutils/log.h"
+#include "utils.h"
+#include "rb_tree.h"
+
+// large getdents64 buffer, so that one syscall returns hundreds of entries
+#define DU_DENTS_BUF_SIZE (64 * 1024)
+#define DU_MAX_WORKERS 16
+#define DU_INODE_SHARDS 16
+#define DU_IDLE_WAIT_NSEC (1000 * 1000)
+
+struct du_linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct du_item {
+    char *path;
+    int depth;
+};
+
+// owner pushes and pops at tail, thieves take the oldest directories from head
+struct du_queue {
+    pthread_mutex_t lock;
+    struct du_item *items;
+    size_t head;
+    size_t tail;
+    size_t cap;
+};
+
+struct du_inode_key {
+    dev_t dev;
+    ino_t ino;
+};
+
+struct du_inode_set {
+    pthread_mutex_t lock;
+    rb_tree_t *tree;
+};
+
+struct du_walker {
+    struct du_queue *queues;
+    size_t workers;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    // directories queued or being read, walking finished when it drops to zero
+    size_t pending;
+    bool stop;
+    bool timeout;
+    // CLOCK_MONOTONIC nanoseconds, 0 means no deadline
+    uint64_t deadline;
+    bool dedup;
+    struct du_inode_set inodes[DU_INODE_SHARDS];
+};
+
+struct du_worker {
+    struct du_walker *walker;
+    size_t id;
+    char *buf;
+    int64_t size;
+    int64_t inodes;
+};
+
+static uint64_t du_now_nanos(void)
+{
+    struct timespec ts = { 0 };
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int du_inode_cmp(const void *first, const void *last)
+{
+    const struct du_inode_key *a = (const struct du_inode_key *)first;
+    const struct du_inode_key *b = (const struct du_inode_key *)last;
+
+    if (a->ino != b->ino) {
+        return a->ino < b->ino ? -1 : 1;
+    }
+    if (a->dev != b->dev) {
+        return a->dev < b->dev ? -1 : 1;
+    }
+    return 0;
+}
+
+static void du_inode_free(void *key, void *value)
+{
+    // value points to key itself
+    (void)value;
+    free(key);
+}
+
+// return true if the inode is seen for the first time
+static bool du_inode_first_seen(struct du_walker *walker, dev_t dev, ino_t ino)
+{
+    bool first = false;
+    struct du_inode_key *key = NULL;
+    struct du_inode_key search = { .dev = dev, .ino = ino };
+    struct du_inode_set *set = &walker->inodes[ino % DU_INODE_SHARDS];
+
+    (void)pthread_mutex_lock(&set->lock);
+    if (rbtree_search(set->tree, &search) != NULL) {
+        goto unlock;
+    }
+
+    // count it anyway if we can not remember it
+    first = true;
+    key = util_common_calloc_s(sizeof(struct du_inode_key));
+    if (key == NULL) {
+        ERROR("Out of memory");
+        goto unlock;
+    }
+    *key = search;
+    if (!rbtree_insert(set->tree, key, key)) {
+        free(key);
+    }
+
+unlock:
+    (void)pthread_mutex_unlock(&set->lock);
+    return first;
+}
+
+static bool du_queue_push(struct du_queue *q, struct du_item item)
+{
+    bool ret = true;
+
+    (void)pthread_mutex_lock(&q->lock);
+    if (q->tail == q->cap && q->head > 0) {
+        (void)memmove(q->items, q->items + q->head, (q->tail - q->head) * sizeof(struct du_item));
+        q->tail -= q->head;
+        q->head = 0;
+    }
+    if (q->tail == q->cap) {
+        size_t new_cap = q->cap == 0 ? 64 : q->cap * 2;
+        struct du_item *items = NULL;
+
+        if (util_mem_realloc((void **)&items, new_cap * sizeof(struct du_item), q->items,
+                             q->cap * sizeof(struct du_item)) != 0) {
+            ERROR("Out of memory");
+            ret = false;
+            goto unlock;
+        }
+        q->items = items;
+        q->cap = new_cap;
+    }
+    q->items[q->tail++] = item;
+
+unlock:
+    (void)pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static bool du_queue_take(struct du_queue *q, bool steal, struct du_item *item)
+{
+    bool ret = false;
+
+    (void)pthread_mutex_lock(&q->lock);
+    if (q->head == q->tail) {
+        goto unlock;
+    }
+    if (steal) {
+        *item = q->items[q->head++];
+    } else {
+        *item = q->items[--q->tail];
+    }
+    if (q->head == q->tail) {
+        q->head = 0;
+        q->tail = 0;
+    }
+    ret = true;
+
+unlock:
+    (void)pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static bool du_take_work(struct du_worker *worker, struct du_item *item)
+{
+    size_t i;
+    struct du_walker *walker = worker->walker;
+
+    if (du_queue_take(&walker->queues[worker->id], false, item)) {
+        return true;
+    }
+
+    for (i = 1; i < walker->workers; i++) {
+        if (du_queue_take(&walker->queues[(worker->id + i) % walker->workers], true, item)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool du_should_stop(struct du_walker *walker)
+{
+    bool stop = false;
+
+    // only deadline stops the walk
+    if (walker->deadline == 0) {
+        return false;
+    }
+
+    (void)pthread_mutex_lock(&walker->lock);
+    if (!walker->stop && walker->deadline != 0 && du_now_nanos() >= walker->deadline) {
+        walker->stop = true;
+        walker->timeout = true;
+        (void)pthread_cond_broadcast(&walker->cond);
+    }
+    stop = walker->stop;
+    (void)pthread_mutex_unlock(&walker->lock);
+
+    return stop;
+}
+
+static void du_add_subdir(struct du_worker *worker, const char *dirpath, const char *name, int depth)
+{
+    int nret;
+    char fname[PATH_MAX] = { 0 };
+    struct du_item item = { 0 };
+    struct du_walker *walker = worker->walker;
+
+    if (depth + 1 > MAX_PATH_DEPTH) {
+        ERROR("Reach max path depth: %s/%s", dirpath, name);
+        return;
+    }
+
+    nret = snprintf(fname, PATH_MAX, "%s/%s", dirpath, name);
+    if (nret < 0 || (size_t)nret >= PATH_MAX) {
+        ERROR("Pathname too long");
+        return;
+    }
+
+    item.path = util_strdup_s(fname);
+    item.depth = depth;
+
+    (void)pthread_mutex_lock(&walker->lock);
+    walker->pending++;
+    (void)pthread_mutex_unlock(&walker->lock);
+
+    if (!du_queue_push(&walker->queues[worker->id], item)) {
+        free(item.path);
+        (void)pthread_mutex_lock(&walker->lock);
+        walker->pending--;
+        (void)pthread_mutex_unlock(&walker->lock);
+        return;
+    }
+
+    (void)pthread_cond_signal(&walker->cond);
+}
+
+// stat only the fields we need, statx skips the attributes that are expensive on some filesystems
+static int du_stat_entry(int dirfd, const char *name, bool want_link, mode_t *mode, int64_t *size, dev_t *dev,
+                         ino_t *ino, nlink_t *nlink)
+{
+#ifdef STATX_SIZE
+    // shared by all workers, set once statx is found missing
+    static bool statx_unsupported = false;
+    struct statx stx = { 0 };
+    unsigned int mask = STATX_TYPE | STATX_SIZE;
+
+    if (want_link) {
+        mask |= STATX_NLINK | STATX_INO;
+    }
+
+    if (!__atomic_load_n(&statx_unsupported, __ATOMIC_RELAXED)) {
+        if (statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC | AT_NO_AUTOMOUNT, mask, &stx) == 0) {
+            *mode = stx.stx_mode;
+            *size = (int64_t)stx.stx_size;
+            *dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+            *ino = (ino_t)stx.stx_ino;
+            *nlink = (nlink_t)stx.stx_nlink;
+            return 0;
+        }
+        if (errno != ENOSYS) {
+            return -1;
+        }
+        __atomic_store_n(&statx_unsupported, true, __ATOMIC_RELAXED);
+    }
+#endif
+    struct stat st = { 0 };
+
+    if (fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return -1;
+    }
+    *mode = st.st_mode;
+    *size = (int64_t)st.st_size;
+    *dev = st.st_dev;
+    *ino = st.st_ino;
+    *nlink = st.st_nlink;
+    return 0;
+}
+
+static void du_account_entry(struct du_worker *worker, int dirfd, const char *dirpath,
+                             const struct du_linux_dirent64 *dent, int depth)
+{
+    mode_t mode = 0;
+    int64_t size = 0;
+    dev_t dev = 0;
+    ino_t ino = 0;
+    nlink_t nlink = 0;
+    struct du_walker *walker = worker->walker;
+
+    // directories are accounted when they are read, no stat needed here
+    if (dent->d_type == DT_DIR) {
+        du_add_subdir(worker, dirpath, dent->d_name, depth + 1);
+        return;
+    }
+
+    if (du_stat_entry(dirfd, dent->d_name, walker->dedup, &mode, &size, &dev, &ino, &nlink) != 0) {
+        SYSERROR("Failed to stat %s/%s", dirpath, dent->d_name);
+        return;
+    }
+
+    if (S_ISDIR(mode)) {
+        du_add_subdir(worker, dirpath, dent->d_name, depth + 1);
+        return;
+    }
+
+    if (walker->dedup && nlink > 1 && !du_inode_first_seen(walker, dev, ino)) {
+        return;
+    }
+
+    worker->size += size;
+    worker->inodes++;
+}
+
+static void du_walk_dir(struct du_worker *worker, const struct du_item *item)
+{
+    int fd = -1;
+    long nread = 0;
+    long off = 0;
+    struct stat st = { 0 };
+
+    fd = open(item->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        SYSERROR("Failed to open %s", item->path);
+        return;
+    }
+
+    // directory itself is counted as util_calculate_dir_size does
+    if (fstat(fd, &st) == 0) {
+        worker->size += (int64_t)st.st_size;
+        worker->inodes++;
+    }
+
+    for (;;) {
+        nread = syscall(SYS_getdents64, fd, worker->buf, DU_DENTS_BUF_SIZE);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread < 0) {
+            SYSERROR("Failed to read directory %s", item->path);
+            break;
+        }
+        if (nread == 0) {
+            break;
+        }
+
+        for (off = 0; off < nread;) {
+            const struct du_linux_dirent64 *dent = (const struct du_linux_dirent64 *)(worker->buf + off);
+
+            off += dent->d_reclen;
+            if (strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0) {
+                continue;
+            }
+            du_account_entry(worker, fd, item->path, dent, item->depth);
+        }
+
+        if (du_should_stop(worker->walker)) {
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+static void du_finish_item(struct du_walker *walker)
+{
+    (void)pthread_mutex_lock(&walker->lock);
+    walker->pending--;
+    if (walker->pending == 0) {
+        (void)pthread_cond_broadcast(&walker->cond);
+    }
+    (void)pthread_mutex_unlock(&walker->lock);
+}
+
+// wait for new work, return false if walking is finished or stopped
+static bool du_wait_work(struct du_walker *walker)
+{
+    bool more = false;
+    struct timespec ts = { 0 };
+
+    (void)pthread_mutex_lock(&walker->lock);
+    if (walker->pending == 0 || walker->stop) {
+        goto unlock;
+    }
+
+    // wakeups may be lost between the failed steal and here, so never sleep long
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += DU_IDLE_WAIT_NSEC;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    (void)pthread_cond_timedwait(&walker->cond, &walker->lock, &ts);
+    more = (walker->pending != 0 && !walker->stop);
+
+unlock:
+    (void)pthread_mutex_unlock(&walker->lock);
+    return more;
+}
+
+static void *du_worker_routine(void *arg)
+{
+    struct du_worker *worker = (struct du_worker *)arg;
+    struct du_item item = { 0 };
+
+    for (;;) {
+        if (du_should_stop(worker->walker)) {
+            break;
+        }
+        if (!du_take_work(worker, &item)) {
+            if (!du_wait_work(worker->walker)) {
+                break;
+            }
+            continue;
+        }
+        du_walk_dir(worker, &item);
+        free(item.path);
+        item.path = NULL;
+        du_finish_item(worker->walker);
+    }
+
+    return NULL;
+}
+
+static size_t du_default_workers(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus <= 0) {
+        return 1;
+    }
+    return cpus > DU_MAX_WORKERS ? DU_MAX_WORKERS : (size_t)cpus;
+}
+
+static int du_walker_init(struct du_walker *walker, const struct util_dir_size_opts *opts)
+{
+    size_t i;
+
+    walker->workers = du_default_workers();
+    if (opts != NULL && opts->workers > 0) {
+        walker->workers = opts->workers > DU_MAX_WORKERS ? DU_MAX_WORKERS : opts->workers;
+    }
+    if (opts != NULL && opts->timeout_ms > 0) {
+        walker->deadline = du_now_nanos() + opts->timeout_ms * 1000000ULL;
+    }
+    walker->dedup = (opts != NULL && opts->dedup_hardlink);
+
+    (void)pthread_mutex_init(&walker->lock, NULL);
+    (void)pthread_cond_init(&walker->cond, NULL);
+
+    for (i = 0; i < DU_INODE_SHARDS; i++) {
+        (void)pthread_mutex_init(&walker->inodes[i].lock, NULL);
+        if (!walker->dedup) {
+            continue;
+        }
+        walker->inodes[i].tree = rbtree_new(du_inode_cmp, du_inode_free);
+        if (walker->inodes[i].tree == NULL) {
+            ERROR("Out of memory");
+            return -1;
+        }
+    }
+
+    walker->queues = util_common_calloc_s(walker->workers * sizeof(struct du_queue));
+    if (walker->queues == NULL) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    for (i = 0; i < walker->workers; i++) {
+        (void)pthread_mutex_init(&walker->queues[i].lock, NULL);
+    }
+
+    return 0;
+}
+
+static void du_walker_destroy(struct du_walker *walker)
+{
+    size_t i;
+    struct du_item item = { 0 };
+
+    for (i = 0; walker->queues != NULL && i < walker->workers; i++) {
+        // leftovers of a stopped walk
+        while (du_queue_take(&walker->queues[i], false, &item)) {
+            free(item.path);
+        }
+        free(walker->queues[i].items);
+        (void)pthread_mutex_destroy(&walker->queues[i].lock);
+    }
+    free(walker->queues);
+    walker->queues = NULL;
+
+    for (i = 0; i < DU_INODE_SHARDS; i++) {
+        rbtree_free(walker->inodes[i].tree);
+        walker->inodes[i].tree = NULL;
+        (void)pthread_mutex_destroy(&walker->inodes[i].lock);
+    }
+
+    (void)pthread_cond_destroy(&walker->cond);
+    (void)pthread_mutex_destroy(&walker->lock);
+}
+
+int util_calculate_dir_size_parallel(const char *dirpath, const struct util_dir_size_opts *opts, int64_t *total_size,
+                                     int64_t *total_inode)
+{
+    int ret = -1;
+    size_t i;
+    size_t started = 0;
+    int64_t size_sum = 0;
+    int64_t inode_sum = 0;
+    pthread_t *tids = NULL;
+    struct du_worker *workers = NULL;
+    struct du_walker walker = { 0 };
+    struct du_item root = { 0 };
+
+    if (dirpath == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+
+    if (!util_dir_exists(dirpath)) {
+        ERROR("dir not exists: %s", dirpath);
+        return -1;
+    }
+
+    if (du_walker_init(&walker, opts) != 0) {
+        goto out;
+    }
+
+    workers = util_common_calloc_s(walker.workers * sizeof(struct du_worker));
+    tids = util_common_calloc_s(walker.workers * sizeof(pthread_t));
+    if (workers == NULL || tids == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+    for (i = 0; i < walker.workers; i++) {
+        workers[i].walker = &walker;
+        workers[i].id = i;
+        workers[i].buf = util_common_calloc_s(DU_DENTS_BUF_SIZE);
+        if (workers[i].buf == NULL) {
+            ERROR("Out of memory");
+            goto out;
+        }
+    }
+
+    root.path = util_strdup_s(dirpath);
+    root.depth = 0;
+    walker.pending = 1;
+    if (!du_queue_push(&walker.queues[0], root)) {
+        free(root.path);
+        goto out;
+    }
+
+    // the caller is worker 0, fewer helpers only make the walk slower
+    for (i = 1; i < walker.workers; i++) {
+        if (pthread_create(&tids[i], NULL, du_worker_routine, &workers[i]) != 0) {
+            SYSWARN("Failed to create dir size worker, continue with %zu workers", i);
+            break;
+        }
+        started++;
+    }
+
+    (void)du_worker_routine(&workers[0]);
+
+    for (i = 1; i <= started; i++) {
+        (void)pthread_join(tids[i], NULL);
+    }
+
+    for (i = 0; i < walker.workers; i++) {
+        size_sum += workers[i].size;
+        inode_sum += workers[i].inodes;
+    }
+
+    if (total_size != NULL) {
+        *total_size = size_sum;
+    }
+    if (total_inode != NULL) {
+        *total_inode = inode_sum;
+    }
+
+    ret = walker.timeout ? 1 : 0;
+    if (walker.timeout) {
+        WARN("Calculating size of %s reached deadline, result is partial", dirpath);
+    }
+
+out:
+    for (i = 0; workers != NULL && i < walker.workers; i++) {
+        free(workers[i].buf);
+    }
+    free(workers);
+    free(tids);
+    du_walker_destroy(&walker);
+    return ret;
+}
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: provide parallel directory size calculation
+ ******************************************************************************/
+#ifndef UTILS_CUTILS_UTILS_DIR_SIZE_H
+#define UTILS_CUTILS_UTILS_DIR_SIZE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct util_dir_size_opts {
+    // number of walking threads including the caller, 0 means decided by online cpus
+    unsigned int workers;
+    // stop walking after timeout_ms, 0 means no deadline
+    uint64_t timeout_ms;
+    // count inodes with multiple hard links only once
+    bool dedup_hardlink;
+};
+
+// same accounting as util_calculate_dir_size: sizes and counts of dirpath and all entries under it.
+// return 0 when the whole tree is walked, 1 when deadline is reached and totals are partial, -1 on error
+int util_calculate_dir_size_parallel(const char *dirpath, const struct util_dir_size_opts *opts, int64_t *total_size,
+                                     int64_t *total_inode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UTILS_CUTILS_UTILS_DIR_SIZE_H
@@ -24,6 +24,8 @@
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
 #include <linux/fs.h>
 #include <regex.h>
 #include <dirent.h>
@@ -1158,6 +1160,90 @@ char *verify_file_and_get_real_path(const char *file)
     return util_strdup_s(resolved_path);
 }
 
+// largest length of one copy_file_range or sendfile call, kernel copies less if file is shorter
+#define KERNEL_COPY_CHUNK (1024 * 1024 * 1024)
+
+// errors meaning the kernel can not copy between these fds, data is copied in user space then.
+// both calls move file offsets, so the fallback continues where they stopped
+static bool kernel_copy_unsupported(int err)
+{
+    return err == ENOSYS || err == EXDEV || err == EINVAL || err == EOPNOTSUPP || err == ENOTSUP || err == EBADF ||
+           err == EPERM;
+}
+
+// return 0 if all data is copied, 1 if the rest should be copied by another way, -1 on failure
+static int copy_by_copy_file_range(int src_fd, int dst_fd)
+{
+#ifdef SYS_copy_file_range
+    bool copied = false;
+
+    while (true) {
+        ssize_t len = syscall(SYS_copy_file_range, src_fd, NULL, dst_fd, NULL, (size_t)KERNEL_COPY_CHUNK, 0);
+        if (len > 0) {
+            copied = true;
+            continue;
+        }
+        if (len == 0) {
+            // files of pseudo filesystems report size 0, make sure it is the real end with read
+            return copied ? 0 : 1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (kernel_copy_unsupported(errno)) {
+            return 1;
+        }
+        SYSERROR("Copy file range failed");
+        return -1;
+    }
+#else
+    return 1;
+#endif
+}
+
+static int copy_by_sendfile(int src_fd, int dst_fd)
+{
+    bool copied = false;
+
+    while (true) {
+        ssize_t len = sendfile(dst_fd, src_fd, NULL, (size_t)KERNEL_COPY_CHUNK);
+        if (len > 0) {
+            copied = true;
+            continue;
+        }
+        if (len == 0) {
+            return copied ? 0 : 1;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (kernel_copy_unsupported(errno)) {
+            return 1;
+        }
+        SYSERROR("Sendfile failed");
+        return -1;
+    }
+}
+
+// copy data without passing it through user space, dst_fd must be empty
+static int copy_file_in_kernel(int src_fd, int dst_fd)
+{
+    int ret;
+
+#ifdef FICLONE
+    // shares extents on btrfs and xfs, blocks are copied on later writes
+    if (ioctl(dst_fd, FICLONE, src_fd) == 0) {
+        return 0;
+    }
+#endif
+
+    ret = copy_by_copy_file_range(src_fd, dst_fd);
+    if (ret != 1) {
+        return ret;
+    }
+    return copy_by_sendfile(src_fd, dst_fd);
+}
+
 int util_copy_file(const char *src_file, const char *dst_file, mode_t mode)
 {
 #define BUFSIZE 4096
@@ -1189,6 +1275,13 @@ int util_copy_file(const char *src_file, const char *dst_file, mode_t mode)
         ret = -1;
         goto free_out;
     }
+
+    ret = copy_file_in_kernel(src_fd, dst_fd);
+    if (ret <= 0) {
+        goto free_out;
+    }
+    ret = 0;
+
     while (true) {
         ssize_t len = util_read_nointr(src_fd, buf, BUFSIZE);
         if (len < 0) {
@@ -28,6 +28,13 @@
 #include <dirent.h>
 #include <stdint.h>
 #include <sys/mount.h>
+#include <sys/syscall.h>
+#include <sys/fsuid.h>
+#include <linux/capability.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
 
 #include "isula_libutils/log.h"
 #include "utils.h"
@@ -80,6 +87,58 @@
 // BRO_FLAGS is the combination of bind and read only
 #define BRO_FLAGS (MS_BIND | MS_RDONLY)
 
+// new mount api, old libc and kernel headers do not provide them
+#ifndef SYS_move_mount
+#define SYS_move_mount 429
+#endif
+
+#ifndef SYS_fsopen
+#define SYS_fsopen 430
+#endif
+
+#ifndef SYS_fsconfig
+#define SYS_fsconfig 431
+#endif
+
+#ifndef SYS_fsmount
+#define SYS_fsmount 432
+#endif
+
+#ifndef SYS_open_tree
+#define SYS_open_tree 428
+#endif
+
+#ifndef SYS_mount_setattr
+#define SYS_mount_setattr 442
+#endif
+
+#define UTIL_FSOPEN_CLOEXEC 0x00000001
+#define UTIL_FSCONFIG_SET_FLAG 0
+#define UTIL_FSCONFIG_SET_STRING 1
+#define UTIL_FSCONFIG_CMD_CREATE 6
+#define UTIL_FSMOUNT_CLOEXEC 0x00000001
+#define UTIL_MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#define UTIL_OPEN_TREE_CLONE 1
+#define UTIL_OPEN_TREE_CLOEXEC O_CLOEXEC
+#define UTIL_MOUNT_ATTR_IDMAP 0x00100000
+
+#define UTIL_MOUNT_ATTR_RDONLY 0x00000001
+#define UTIL_MOUNT_ATTR_NOSUID 0x00000002
+#define UTIL_MOUNT_ATTR_NODEV 0x00000004
+#define UTIL_MOUNT_ATTR_NOEXEC 0x00000008
+#define UTIL_MOUNT_ATTR_RELATIME 0x00000000
+#define UTIL_MOUNT_ATTR_NOATIME 0x00000010
+#define UTIL_MOUNT_ATTR_STRICTATIME 0x00000020
+#define UTIL_MOUNT_ATTR_NODIRATIME 0x00000080
+
+// struct mount_attr of linux/mount.h
+struct util_mount_attr {
+    uint64_t attr_set;
+    uint64_t attr_clr;
+    uint64_t propagation;
+    uint64_t userns_fd;
+};
+
 struct fs_element {
     const char *fs_name;
     uint32_t fs_magic;
@@ -114,6 +173,23 @@ struct mount_option_element {
     unsigned long flag;
 };
 
+struct mount_attr_element {
+    unsigned long flag;
+    unsigned int attr;
+};
+
+// mount flags which fsmount can apply to the new mount
+static struct mount_attr_element const g_mount_attrs[] = {
+    { MS_RDONLY, UTIL_MOUNT_ATTR_RDONLY },
+    { MS_NOSUID, UTIL_MOUNT_ATTR_NOSUID },
+    { MS_NODEV, UTIL_MOUNT_ATTR_NODEV },
+    { MS_NOEXEC, UTIL_MOUNT_ATTR_NOEXEC },
+    { MS_RELATIME, UTIL_MOUNT_ATTR_RELATIME },
+    { MS_NOATIME, UTIL_MOUNT_ATTR_NOATIME },
+    { MS_STRICTATIME, UTIL_MOUNT_ATTR_STRICTATIME },
+    { MS_NODIRATIME, UTIL_MOUNT_ATTR_NODIRATIME },
+};
+
 static struct mount_option_element const g_mount_options[] = {
     { "defaults", false, 0 },
     { "ro", false, MS_RDONLY },
@@ -584,7 +660,39 @@ out:
     return ret;
 }
 
-int util_mount_from(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts)
+// setfsuid to nonzero drops file capabilities from the effective set, raise them again for the mount
+static int set_fsid_keep_caps(uid_t uid, gid_t gid)
+{
+    struct __user_cap_header_struct header = { .version = _LINUX_CAPABILITY_VERSION_3, .pid = 0 };
+    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+    size_t i;
+
+    (void)setfsgid(gid);
+    (void)setfsuid(uid);
+    // both return the previous value, so read them back to see if they are set
+    if ((gid_t)setfsgid((gid_t)-1) != gid || (uid_t)setfsuid((uid_t)-1) != uid) {
+        ERROR("Failed to set fsuid %u fsgid %u", (unsigned int)uid, (unsigned int)gid);
+        return -1;
+    }
+
+    (void)memset(data, 0, sizeof(data));
+    if (syscall(SYS_capget, &header, data) != 0) {
+        SYSERROR("Failed to get capabilities");
+        return -1;
+    }
+    for (i = 0; i < _LINUX_CAPABILITY_U32S_3; i++) {
+        data[i].effective = data[i].permitted;
+    }
+    if (syscall(SYS_capset, &header, data) != 0) {
+        SYSERROR("Failed to raise capabilities");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int do_mount_from(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts,
+                         bool set_fsid, uid_t uid, gid_t gid)
 {
     int ret = 0;
     pid_t pid = -1;
@@ -615,6 +723,11 @@ int util_mount_from(const char *base, const char *src, const char *dst, const ch
             goto child_out;
         }
 
+        if (set_fsid && set_fsid_keep_caps(uid, gid) != 0) {
+            ret = -1;
+            goto child_out;
+        }
+
         ret = util_mount_from_handler(src, dst, mtype, mntopts);
 
 child_out:
@@ -634,6 +747,17 @@ cleanup:
     return ret;
 }
 
+int util_mount_from(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts)
+{
+    return do_mount_from(base, src, dst, mtype, mntopts, false, 0, 0);
+}
+
+int util_mount_from_as(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts,
+                       uid_t uid, gid_t gid)
+{
+    return do_mount_from(base, src, dst, mtype, mntopts, true, uid, gid);
+}
+
 bool util_check_readonly_fs(const char *path)
 {
     int i;
@@ -663,3 +787,296 @@ bool util_check_readonly_fs(const char *path)
 
     return (fsbuf.f_flags & ST_RDONLY) != 0;
 }
+
+static int mntflags_to_mount_attr(unsigned long mntflags, unsigned int *attr)
+{
+    size_t i;
+    unsigned long left = mntflags;
+
+    for (i = 0; i < sizeof(g_mount_attrs) / sizeof(g_mount_attrs[0]); i++) {
+        if ((mntflags & g_mount_attrs[i].flag) != 0) {
+            *attr |= g_mount_attrs[i].attr;
+            left &= ~g_mount_attrs[i].flag;
+        }
+    }
+
+    return left == 0 ? 0 : -1;
+}
+
+static void log_fs_context_errors(int fsfd)
+{
+    char buf[BUFSIZ] = { 0 };
+    ssize_t nread;
+
+    // messages of fs context are readable from the fd, each one prefixed by "e ", "w " or "i "
+    for (;;) {
+        nread = read(fsfd, buf, sizeof(buf) - 1);
+        if (nread <= 0) {
+            break;
+        }
+        buf[nread] = '\0';
+        ERROR("Fs context: %s", buf);
+    }
+}
+
+static int fsconfig_param(int fsfd, const char *param)
+{
+    int ret = 0;
+    char *key = NULL;
+    char *value = NULL;
+
+    key = util_strdup_s(param);
+    value = strchr(key, '=');
+    if (value == NULL) {
+        ret = (int)syscall(SYS_fsconfig, fsfd, UTIL_FSCONFIG_SET_FLAG, key, NULL, 0);
+    } else {
+        *value = '\0';
+        value++;
+        ret = (int)syscall(SYS_fsconfig, fsfd, UTIL_FSCONFIG_SET_STRING, key, value, 0);
+    }
+
+    free(key);
+    return ret;
+}
+
+int util_fsmount(const char *fstype, const char *source, const char **params, size_t params_len, const char *mntopts,
+                 const char *dst, bool *unsupported)
+{
+    int ret = -1;
+    int fsfd = -1;
+    int mntfd = -1;
+    size_t i;
+    unsigned long mntflags = 0L;
+    unsigned int attr = 0;
+    char *mntdata = NULL;
+    char **data_opts = NULL;
+
+    if (fstype == NULL || dst == NULL || unsupported == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+    *unsupported = false;
+
+    if (util_parse_mntopts(mntopts, &mntflags, &mntdata) != 0) {
+        ERROR("Failed to parse mount options:%s", mntopts);
+        goto out;
+    }
+
+    // flags such as propagation need extra calls, left to util_mount
+    if (mntflags_to_mount_attr(mntflags, &attr) != 0) {
+        DEBUG("Mount flags 0x%lx can not be applied by fsmount", mntflags);
+        goto out;
+    }
+
+    if (util_detect_mounted(dst)) {
+        WARN("mount dst %s had been mounted, skip mount", dst);
+        ret = 0;
+        goto out;
+    }
+
+    fsfd = (int)syscall(SYS_fsopen, fstype, UTIL_FSOPEN_CLOEXEC);
+    if (fsfd < 0) {
+        *unsupported = (errno == ENOSYS);
+        SYSWARN("Failed to open fs context of %s", fstype);
+        goto out;
+    }
+
+    if (source != NULL && syscall(SYS_fsconfig, fsfd, UTIL_FSCONFIG_SET_STRING, "source", source, 0) != 0) {
+        SYSERROR("Failed to set source %s of %s", source, fstype);
+        goto out;
+    }
+
+    for (i = 0; i < params_len; i++) {
+        if (fsconfig_param(fsfd, params[i]) != 0) {
+            // unknown parameter, such as lowerdir+ on kernel before 6.8
+            *unsupported = (errno == EINVAL);
+            SYSWARN("Failed to set param %s of %s", params[i], fstype);
+            goto out;
+        }
+    }
+
+    if (mntdata != NULL) {
+        data_opts = util_string_split(mntdata, ',');
+        if (data_opts == NULL) {
+            ERROR("Out of memory");
+            goto out;
+        }
+    }
+    for (i = 0; i < util_array_len((const char **)data_opts); i++) {
+        if (fsconfig_param(fsfd, data_opts[i]) != 0) {
+            SYSERROR("Failed to set option %s of %s", data_opts[i], fstype);
+            log_fs_context_errors(fsfd);
+            goto out;
+        }
+    }
+
+    if (syscall(SYS_fsconfig, fsfd, UTIL_FSCONFIG_CMD_CREATE, NULL, NULL, 0) != 0) {
+        SYSERROR("Failed to create %s superblock for %s", fstype, dst);
+        log_fs_context_errors(fsfd);
+        goto out;
+    }
+
+    mntfd = (int)syscall(SYS_fsmount, fsfd, UTIL_FSMOUNT_CLOEXEC, attr);
+    if (mntfd < 0) {
+        SYSERROR("Failed to fsmount %s for %s", fstype, dst);
+        goto out;
+    }
+
+    if (syscall(SYS_move_mount, mntfd, "", AT_FDCWD, dst, UTIL_MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+        SYSERROR("Failed to move %s mount to %s", fstype, dst);
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    if (mntfd >= 0) {
+        close(mntfd);
+    }
+    if (fsfd >= 0) {
+        close(fsfd);
+    }
+    util_free_array(data_opts);
+    free(mntdata);
+    return ret;
+}
+
+static int write_id_map(pid_t pid, const char *file, unsigned int host_id, unsigned int size)
+{
+    int nret;
+    char path[PATH_MAX] = { 0 };
+    char map[UINT_LEN * 3 + 3] = { 0 };
+
+    nret = snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+    if (nret < 0 || (size_t)nret >= sizeof(path)) {
+        ERROR("Failed to sprintf %s path", file);
+        return -1;
+    }
+
+    nret = snprintf(map, sizeof(map), "0 %u %u", host_id, size);
+    if (nret < 0 || (size_t)nret >= sizeof(map)) {
+        ERROR("Failed to sprintf id map");
+        return -1;
+    }
+
+    // the whole map must be written by one write
+    if (util_write_file(path, map, strlen(map), 0) != 0) {
+        SYSERROR("Failed to write %s of %d", file, pid);
+        return -1;
+    }
+
+    return 0;
+}
+
+int util_create_userns_fd(unsigned int host_uid, unsigned int host_gid, unsigned int size)
+{
+    int fd = -1;
+    int sync_pipe[2] = { -1, -1 };
+    char c = 0;
+    char ns_path[PATH_MAX] = { 0 };
+    pid_t pid;
+    int nret;
+
+    if (size == 0) {
+        ERROR("Invalid id map size");
+        return -1;
+    }
+
+    if (pipe2(sync_pipe, O_CLOEXEC) != 0) {
+        SYSERROR("Failed to create sync pipe");
+        return -1;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        SYSERROR("Failed to fork");
+        goto out;
+    }
+
+    if (pid == 0) {
+        // only async signal safe calls here, the child is killed once its namespace is opened
+        close(sync_pipe[0]);
+        c = (unshare(CLONE_NEWUSER) == 0) ? 1 : 0;
+        if (write(sync_pipe[1], &c, 1) != 1 || c == 0) {
+            _exit(EXIT_FAILURE);
+        }
+        for (;;) {
+            pause();
+        }
+    }
+
+    close(sync_pipe[1]);
+    sync_pipe[1] = -1;
+    if (util_read_nointr(sync_pipe[0], &c, 1) != 1 || c == 0) {
+        ERROR("Failed to create user namespace");
+        goto kill;
+    }
+
+    if (write_id_map(pid, "uid_map", host_uid, size) != 0 || write_id_map(pid, "gid_map", host_gid, size) != 0) {
+        goto kill;
+    }
+
+    nret = snprintf(ns_path, sizeof(ns_path), "/proc/%d/ns/user", pid);
+    if (nret < 0 || (size_t)nret >= sizeof(ns_path)) {
+        ERROR("Failed to sprintf user namespace path");
+        goto kill;
+    }
+
+    fd = open(ns_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        SYSERROR("Failed to open %s", ns_path);
+    }
+
+kill:
+    (void)kill(pid, SIGKILL);
+    (void)waitpid(pid, NULL, 0);
+
+out:
+    if (sync_pipe[0] >= 0) {
+        close(sync_pipe[0]);
+    }
+    if (sync_pipe[1] >= 0) {
+        close(sync_pipe[1]);
+    }
+    return fd;
+}
+
+int util_idmap_bind(const char *src, const char *dst, int userns_fd, bool *unsupported)
+{
+    int ret = -1;
+    int treefd = -1;
+    struct util_mount_attr attr = { 0 };
+
+    if (src == NULL || dst == NULL || userns_fd < 0 || unsupported == NULL) {
+        ERROR("Invalid input arguments");
+        return -1;
+    }
+    *unsupported = false;
+
+    treefd = (int)syscall(SYS_open_tree, AT_FDCWD, src, UTIL_OPEN_TREE_CLONE | UTIL_OPEN_TREE_CLOEXEC);
+    if (treefd < 0) {
+        *unsupported = (errno == ENOSYS);
+        SYSWARN("Failed to clone mount %s", src);
+        return -1;
+    }
+
+    attr.attr_set = UTIL_MOUNT_ATTR_IDMAP;
+    attr.userns_fd = (uint64_t)userns_fd;
+    if (syscall(SYS_mount_setattr, treefd, "", AT_EMPTY_PATH, &attr, sizeof(attr)) != 0) {
+        // EINVAL when the filesystem can not be idmapped, EPERM when it is not mounted in initial user namespace
+        *unsupported = (errno == ENOSYS || errno == EINVAL || errno == EPERM);
+        SYSWARN("Failed to set idmap for %s", src);
+        goto out;
+    }
+
+    if (syscall(SYS_move_mount, treefd, "", AT_FDCWD, dst, UTIL_MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+        SYSERROR("Failed to move idmapped mount of %s to %s", src, dst);
+        goto out;
+    }
+
+    ret = 0;
+
+out:
+    close(treefd);
+    return ret;
+}
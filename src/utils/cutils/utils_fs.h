@@ -17,6 +17,8 @@
 #define UTILS_CUTILS_UTILS_FS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,9 +35,23 @@ int util_force_mount(const char *src, const char *dst, const char *mtype, const
 bool util_detect_mounted(const char *path);
 int util_ensure_mounted_as(const char *dst, const char *mntopts);
 int util_mount_from(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts);
+// as util_mount_from, but mount with fsuid uid and fsgid gid. overlay writes its upper layer with the creds of the
+// mounter, which have to map through the idmap when the upper layer is idmapped
+int util_mount_from_as(const char *base, const char *src, const char *dst, const char *mtype, const char *mntopts,
+                       uid_t uid, gid_t gid);
 typedef int (*mount_info_call_back_t)(const char *, const char *);
 bool util_deal_with_mount_info(mount_info_call_back_t cb, const char *);
 bool util_check_readonly_fs(const char *path);
+// mount a new fstype filesystem on dst with fsopen/fsconfig/fsmount/move_mount. params are "key=value" or "key"
+// and may repeat a key, so there is no page size limit as mount data has. mntopts are the same as util_mount.
+// *unsupported is set on failure if the kernel lacks the api or a param, caller should fall back to util_mount
+int util_fsmount(const char *fstype, const char *source, const char **params, size_t params_len, const char *mntopts,
+                 const char *dst, bool *unsupported);
+// return a user namespace fd which maps 0 to host_uid/host_gid with size ids, -1 on failure
+int util_create_userns_fd(unsigned int host_uid, unsigned int host_gid, unsigned int size);
+// mount an idmapped clone of src on dst, so files owned by id N on disk show up as N in userns_fd under dst.
+// src is not changed. *unsupported is set on failure if the kernel or filesystem of src can not idmap
+int util_idmap_bind(const char *src, const char *dst, int userns_fd, bool *unsupported);
 #ifdef __cplusplus
 }
 #endif
@@ -15,9 +15,10 @@
 #define _GNU_SOURCE /* See feature_test_macros(7) */
 #include "util_gzip.h"
 #include <zlib.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 
 #include "utils.h"
 #include "isula_libutils/log.h"
@@ -25,6 +26,55 @@
 
 #define BLKSIZE 32768
 
+// parallel compression: input is split into blocks which are deflated independently, each block
+// uses last 32KB of input before it as dictionary, so ratio is close to a single deflate stream
+#define GZ_BLOCK_SIZE (128 * 1024)
+#define GZ_DICT_SIZE 32768
+#define GZ_DEFAULT_MAX_THREADS 8
+#define GZ_MAX_THREADS 64
+#define GZ_MEM_LEVEL 8
+// deflate with sync flush appends an empty stored block
+#define GZ_FLUSH_MARGIN 16
+
+// magic, deflate, no flags, no mtime, no extra flags, unix
+static const unsigned char g_gz_header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+
+enum gz_job_state {
+    GZ_JOB_FREE,
+    GZ_JOB_READY,
+    GZ_JOB_BUSY,
+    GZ_JOB_DONE,
+};
+
+struct gz_job {
+    enum gz_job_state state;
+    uint64_t seq;
+    bool last;
+    unsigned char *in;
+    size_t in_len;
+    unsigned char dict[GZ_DICT_SIZE];
+    size_t dict_len;
+    unsigned char *out;
+    size_t out_cap;
+    size_t out_len;
+    uLong crc;
+    int ret;
+};
+
+struct gz_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct gz_job *jobs;
+    size_t jobs_len;
+    int level;
+    bool exit;
+};
+
+struct gz_dict {
+    unsigned char data[GZ_DICT_SIZE];
+    size_t len;
+};
+
 // Compress
 int util_gzip_z(const char *srcfile, const char *dstfile, const mode_t mode)
 {
@@ -162,69 +212,465 @@ out:
     return ret;
 }
 
-/*
- * compress file.
- * param filename:      archive file to compres.
- * return:              zero if compress success, non-zero if not.
- */
-int gzip(const char *filename, size_t len)
+static ssize_t gz_read_block(int fd, unsigned char *buf, size_t len)
 {
-    int pipefd[2] = { -1, -1 };
-    int status = 0;
-    pid_t pid = 0;
+    size_t total = 0;
 
-    if (filename == NULL) {
+    while (total < len) {
+        ssize_t n = util_read_nointr(fd, buf + total, len - total);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+
+    return (ssize_t)total;
+}
+
+// give job the dictionary of input before it, then move dictionary to the end of job input
+static void gz_prepare_dict(struct gz_job *job, struct gz_dict *dict)
+{
+    size_t keep;
+
+    (void)memcpy(job->dict, dict->data, dict->len);
+    job->dict_len = dict->len;
+
+    if (job->in_len >= GZ_DICT_SIZE) {
+        (void)memcpy(dict->data, job->in + job->in_len - GZ_DICT_SIZE, GZ_DICT_SIZE);
+        dict->len = GZ_DICT_SIZE;
+        return;
+    }
+    keep = dict->len + job->in_len > GZ_DICT_SIZE ? GZ_DICT_SIZE - job->in_len : dict->len;
+    (void)memmove(dict->data, dict->data + dict->len - keep, keep);
+    (void)memcpy(dict->data + keep, job->in, job->in_len);
+    dict->len = keep + job->in_len;
+}
+
+static int gz_compress_block(z_stream *strm, struct gz_job *job)
+{
+    int nret;
+    size_t bound;
+
+    if (deflateReset(strm) != Z_OK) {
+        ERROR("Reset deflate stream failed");
         return -1;
     }
-    if (len == 0) {
+    if (job->dict_len > 0 && deflateSetDictionary(strm, job->dict, (uInt)job->dict_len) != Z_OK) {
+        ERROR("Set deflate dictionary failed");
         return -1;
     }
 
-    if (pipe2(pipefd, O_CLOEXEC) != 0) {
-        ERROR("Failed to create pipe\n");
+    bound = deflateBound(strm, (uLong)job->in_len) + GZ_FLUSH_MARGIN;
+    if (bound > job->out_cap) {
+        free(job->out);
+        job->out_cap = 0;
+        job->out = util_common_calloc_s(bound);
+        if (job->out == NULL) {
+            ERROR("Out of memory");
+            return -1;
+        }
+        job->out_cap = bound;
+    }
+
+    strm->next_in = job->in;
+    strm->avail_in = (uInt)job->in_len;
+    strm->next_out = job->out;
+    strm->avail_out = (uInt)job->out_cap;
+    // sync flush ends the block on a byte boundary, so blocks can be concatenated
+    nret = deflate(strm, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (nret != (job->last ? Z_STREAM_END : Z_OK) || strm->avail_in != 0 || strm->avail_out == 0) {
+        ERROR("Deflate block failed: %d", nret);
         return -1;
     }
+    job->out_len = job->out_cap - strm->avail_out;
+    job->crc = crc32(0L, job->in, (uInt)job->in_len);
+
+    return 0;
+}
 
-    pid = fork();
-    if (pid == -1) {
-        ERROR("Failed to fork()\n");
-        close(pipefd[0]);
-        close(pipefd[1]);
+static int gz_write_job(int dstfd, const struct gz_job *job, uLong *crc, uLong *total)
+{
+    if (util_write_nointr_in_total(dstfd, (const char *)job->out, job->out_len) != (ssize_t)job->out_len) {
+        SYSERROR("Write compressed data failed");
         return -1;
     }
+    *crc = crc32_combine(*crc, job->crc, (z_off_t)job->in_len);
+    *total += (uLong)job->in_len;
+    return 0;
+}
+
+static int gz_deflate_init(z_stream *strm, int level)
+{
+    // negative window bits for raw deflate, gzip header and trailer are written by us
+    if (deflateInit2(strm, level, Z_DEFLATED, -MAX_WBITS, GZ_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        ERROR("Init deflate stream failed");
+        return -1;
+    }
+    return 0;
+}
+
+static int gz_compress_serial(int srcfd, int dstfd, int level, uLong *crc, uLong *total)
+{
+    int ret = -1;
+    z_stream strm = { 0 };
+    struct gz_job *job = NULL;
+    struct gz_dict *dict = NULL;
+
+    job = util_common_calloc_s(sizeof(struct gz_job));
+    dict = util_common_calloc_s(sizeof(struct gz_dict));
+    if (job == NULL || dict == NULL) {
+        ERROR("Out of memory");
+        goto out_free;
+    }
+    job->in = util_common_calloc_s(GZ_BLOCK_SIZE);
+    if (job->in == NULL) {
+        ERROR("Out of memory");
+        goto out_free;
+    }
+    if (gz_deflate_init(&strm, level) != 0) {
+        goto out_free;
+    }
+
+    while (!job->last) {
+        ssize_t n = gz_read_block(srcfd, job->in, GZ_BLOCK_SIZE);
+        if (n < 0) {
+            SYSERROR("Read file failed");
+            goto out;
+        }
+        job->in_len = (size_t)n;
+        job->last = job->in_len < GZ_BLOCK_SIZE;
+        gz_prepare_dict(job, dict);
+        if (gz_compress_block(&strm, job) != 0 || gz_write_job(dstfd, job, crc, total) != 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+
+out:
+    (void)deflateEnd(&strm);
+out_free:
+    if (job != NULL) {
+        free(job->in);
+        free(job->out);
+    }
+    free(job);
+    free(dict);
+    return ret;
+}
+
+// ready job of the lowest sequence, so blocks are finished in the order they are written
+static struct gz_job *gz_next_ready_job(struct gz_pool *pool)
+{
+    size_t i;
+    struct gz_job *next = NULL;
+
+    for (i = 0; i < pool->jobs_len; i++) {
+        struct gz_job *job = &pool->jobs[i];
+        if (job->state == GZ_JOB_READY && (next == NULL || job->seq < next->seq)) {
+            next = job;
+        }
+    }
+
+    return next;
+}
+
+static void *gz_worker(void *arg)
+{
+    struct gz_pool *pool = (struct gz_pool *)arg;
+    z_stream strm = { 0 };
+    bool inited = gz_deflate_init(&strm, pool->level) == 0;
+
+    (void)pthread_mutex_lock(&pool->lock);
+    while (true) {
+        struct gz_job *job = NULL;
+
+        while (!pool->exit && (job = gz_next_ready_job(pool)) == NULL) {
+            (void)pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+        if (pool->exit) {
+            break;
+        }
+        job->state = GZ_JOB_BUSY;
+        (void)pthread_mutex_unlock(&pool->lock);
+
+        job->ret = inited ? gz_compress_block(&strm, job) : -1;
+
+        (void)pthread_mutex_lock(&pool->lock);
+        job->state = GZ_JOB_DONE;
+        (void)pthread_cond_broadcast(&pool->cond);
+    }
+    (void)pthread_mutex_unlock(&pool->lock);
+
+    if (inited) {
+        (void)deflateEnd(&strm);
+    }
+    return NULL;
+}
+
+static void gz_free_jobs(struct gz_pool *pool)
+{
+    size_t i;
+
+    for (i = 0; i < pool->jobs_len; i++) {
+        free(pool->jobs[i].in);
+        free(pool->jobs[i].out);
+    }
+    free(pool->jobs);
+    pool->jobs = NULL;
+}
+
+// reads and writes on calling thread, at most 2 blocks per thread are in flight
+static int gz_compress_parallel(int srcfd, int dstfd, int level, unsigned int threads, uLong *crc, uLong *total)
+{
+    int ret = -1;
+    size_t i;
+    size_t started = 0;
+    bool eof = false;
+    uint64_t next_read = 0;
+    uint64_t next_write = 0;
+    pthread_t *tids = NULL;
+    struct gz_dict *dict = NULL;
+    struct gz_pool pool = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+        .level = level,
+    };
+
+    pool.jobs_len = (size_t)threads * 2;
+    pool.jobs = util_smart_calloc_s(sizeof(struct gz_job), pool.jobs_len);
+    tids = util_smart_calloc_s(sizeof(pthread_t), threads);
+    dict = util_common_calloc_s(sizeof(struct gz_dict));
+    if (pool.jobs == NULL || tids == NULL || dict == NULL) {
+        ERROR("Out of memory");
+        goto out;
+    }
+    for (i = 0; i < pool.jobs_len; i++) {
+        pool.jobs[i].in = util_common_calloc_s(GZ_BLOCK_SIZE);
+        if (pool.jobs[i].in == NULL) {
+            ERROR("Out of memory");
+            goto out;
+        }
+    }
+
+    for (started = 0; started < threads; started++) {
+        if (pthread_create(&tids[started], NULL, gz_worker, &pool) != 0) {
+            SYSWARN("Failed to create gzip worker, use %zu workers", started);
+            break;
+        }
+    }
+    if (started == 0) {
+        goto out;
+    }
 
-    if (pid == 0) {
-        // child process, dup2 pipefd[1] to stderr
-        close(pipefd[0]);
-        dup2(pipefd[1], 2);
-        dup2(pipefd[1], 2);
+    while (!eof || next_write < next_read) {
+        struct gz_job *job = NULL;
 
-        if (!util_valid_cmd_arg(filename)) {
-            fprintf(stderr, "Invalid filename: %s\n", filename);
-            exit(EXIT_FAILURE);
+        if (!eof && next_read - next_write < pool.jobs_len) {
+            // slot was written out, workers do not touch free jobs
+            ssize_t n;
+
+            job = &pool.jobs[next_read % pool.jobs_len];
+            n = gz_read_block(srcfd, job->in, GZ_BLOCK_SIZE);
+            if (n < 0) {
+                SYSERROR("Read file failed");
+                goto stop;
+            }
+            job->in_len = (size_t)n;
+            job->last = job->in_len < GZ_BLOCK_SIZE;
+            job->seq = next_read;
+            gz_prepare_dict(job, dict);
+            eof = job->last;
+
+            (void)pthread_mutex_lock(&pool.lock);
+            job->state = GZ_JOB_READY;
+            (void)pthread_cond_broadcast(&pool.cond);
+            (void)pthread_mutex_unlock(&pool.lock);
+            next_read++;
+            continue;
         }
 
-        execlp("gzip", "gzip", "-f", filename, NULL);
+        job = &pool.jobs[next_write % pool.jobs_len];
+        (void)pthread_mutex_lock(&pool.lock);
+        while (job->state != GZ_JOB_DONE) {
+            (void)pthread_cond_wait(&pool.cond, &pool.lock);
+        }
+        (void)pthread_mutex_unlock(&pool.lock);
 
-        fprintf(stderr, "Failed to exec gzip");
-        exit(EXIT_FAILURE);
+        if (job->ret != 0 || gz_write_job(dstfd, job, crc, total) != 0) {
+            goto stop;
+        }
+        // workers scan states under the lock
+        (void)pthread_mutex_lock(&pool.lock);
+        job->state = GZ_JOB_FREE;
+        (void)pthread_mutex_unlock(&pool.lock);
+        next_write++;
+    }
+    ret = 0;
+
+stop:
+    (void)pthread_mutex_lock(&pool.lock);
+    pool.exit = true;
+    (void)pthread_cond_broadcast(&pool.cond);
+    (void)pthread_mutex_unlock(&pool.lock);
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(tids[i], NULL);
+    }
+
+out:
+    if (pool.jobs != NULL) {
+        gz_free_jobs(&pool);
     }
+    free(tids);
+    free(dict);
+    return ret;
+}
+
+static unsigned int gz_threads(const struct util_gzip_options *opts)
+{
+    long cpus;
+
+    if (opts != NULL && opts->threads > 0) {
+        return opts->threads > GZ_MAX_THREADS ? GZ_MAX_THREADS : opts->threads;
+    }
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 0) {
+        return 1;
+    }
+    return cpus > GZ_DEFAULT_MAX_THREADS ? GZ_DEFAULT_MAX_THREADS : (unsigned int)cpus;
+}
+
+static int gz_write_trailer(int dstfd, uLong crc, uLong total)
+{
+    unsigned char trailer[8];
+    size_t i;
 
-    ssize_t size_read = 0;
-    char buffer[BUFSIZ + 1] = { 0 };
+    // crc32 and input size modulo 2^32, both little endian
+    for (i = 0; i < 4; i++) {
+        trailer[i] = (unsigned char)((crc >> (8 * i)) & 0xff);
+        trailer[4 + i] = (unsigned char)((total >> (8 * i)) & 0xff);
+    }
+    if (util_write_nointr_in_total(dstfd, (const char *)trailer, sizeof(trailer)) != (ssize_t)sizeof(trailer)) {
+        SYSERROR("Write gzip trailer failed");
+        return -1;
+    }
+    return 0;
+}
 
-    close(pipefd[1]);
+int util_gzip_z_parallel(const char *srcfile, const char *dstfile, const mode_t mode,
+                         const struct util_gzip_options *opts)
+{
+    int ret = -1;
+    int srcfd = -1;
+    int dstfd = -1;
+    int level = UTIL_GZIP_DEFAULT_LEVEL;
+    unsigned int threads = 0;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    uLong total = 0;
+    struct stat st;
 
-    if (waitpid(pid, &status, 0) != pid) {
-        close(pipefd[0]);
+    if (srcfile == NULL || dstfile == NULL) {
         return -1;
     }
+    if (opts != NULL) {
+        level = opts->level;
+    }
+    if (level != UTIL_GZIP_DEFAULT_LEVEL && (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)) {
+        ERROR("Invalid gzip level %d", level);
+        return -1;
+    }
+    threads = gz_threads(opts);
 
-    size_read = util_read_nointr(pipefd[0], buffer, BUFSIZ);
-    close(pipefd[0]);
+    srcfd = util_open(srcfile, O_RDONLY, SECURE_CONFIG_FILE_MODE);
+    if (srcfd < 0) {
+        SYSERROR("Open src file: %s, failed", srcfile);
+        return -1;
+    }
+    if (fstat(srcfd, &st) != 0) {
+        SYSERROR("Stat src file: %s, failed", srcfile);
+        goto out;
+    }
 
-    if (size_read) {
-        ERROR("Received error:\n%s", buffer);
+    dstfd = util_open(dstfile, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (dstfd < 0) {
+        SYSERROR("Open dst file: %s, failed", dstfile);
+        goto out;
     }
-    return status;
+    if (util_write_nointr_in_total(dstfd, (const char *)g_gz_header, sizeof(g_gz_header)) !=
+        (ssize_t)sizeof(g_gz_header)) {
+        SYSERROR("Write gzip header failed");
+        goto out;
+    }
+
+    // threads do not pay off for a single block
+    if (threads <= 1 || st.st_size <= GZ_BLOCK_SIZE) {
+        ret = gz_compress_serial(srcfd, dstfd, level, &crc, &total);
+    } else {
+        ret = gz_compress_parallel(srcfd, dstfd, level, threads, &crc, &total);
+    }
+    if (ret != 0 || gz_write_trailer(dstfd, crc, total) != 0) {
+        ret = -1;
+        goto out;
+    }
+
+    if (chmod(dstfile, mode) != 0) {
+        SYSERROR("Change mode of %s failed", dstfile);
+        ret = -1;
+    }
+
+out:
+    close(srcfd);
+    if (dstfd >= 0) {
+        close(dstfd);
+        if (ret != 0 && util_path_remove(dstfile) != 0) {
+            SYSERROR("Remove file %s failed", dstfile);
+        }
+    }
+    return ret;
+}
+
+/*
+ * compress file to file.gz with the mode of file and remove file, like gzip -f.
+ * only the link of filename is removed, rotated logs are compressed through a hard link.
+ * param filename:      file to compress.
+ * return:              zero if compress success, non-zero if not.
+ */
+int gzip(const char *filename, size_t len)
+{
+    int nret;
+    struct stat st;
+    char gz_file[PATH_MAX] = { 0 };
+
+    if (filename == NULL) {
+        return -1;
+    }
+    if (len == 0) {
+        return -1;
+    }
+
+    if (stat(filename, &st) != 0) {
+        SYSERROR("Stat %s failed", filename);
+        return -1;
+    }
+
+    nret = snprintf(gz_file, sizeof(gz_file), "%s.gz", filename);
+    if (nret < 0 || (size_t)nret >= sizeof(gz_file)) {
+        ERROR("Failed to sprintf gzip file name of %s", filename);
+        return -1;
+    }
+
+    // same as gzip -f, keep mode and replace the original file
+    if (util_gzip_z_parallel(filename, gz_file, st.st_mode & 07777, NULL) != 0) {
+        ERROR("Gzip %s failed", filename);
+        return -1;
+    }
+    if (unlink(filename) != 0) {
+        SYSERROR("Remove %s failed", filename);
+        return -1;
+    }
+
+    return 0;
 }
@@ -22,15 +22,31 @@
 extern "C" {
 #endif
 
+// zlib default level, same as Z_DEFAULT_COMPRESSION
+#define UTIL_GZIP_DEFAULT_LEVEL (-1)
+
+struct util_gzip_options {
+    // number of compress threads, 0 means number of online cpus, at most 8
+    unsigned int threads;
+    // UTIL_GZIP_DEFAULT_LEVEL or 0 to 9
+    int level;
+};
+
 // Compress
 int util_gzip_z(const char *srcfile, const char *dstfile, const mode_t mode);
 
+// Compress blocks of srcfile on several threads like pigz, dstfile is a standard gzip file
+// and its content does not depend on number of threads. opts is NULL for defaults
+int util_gzip_z_parallel(const char *srcfile, const char *dstfile, const mode_t mode,
+                         const struct util_gzip_options *opts);
+
 // Decompress
 int util_gzip_d(const char *srcfile, const FILE *destfp);
 
 /*
- * compress file.
- * param filename:      archive file to compres.
+ * compress file to file.gz with the mode of file and remove file, like gzip -f.
+ * only the link of filename is removed, rotated logs are compressed through a hard link.
+ * param filename:      file to compress.
  * return:              zero if compress success, non-zero if not.
  */
 int gzip(const char *filename, size_t len);
@@ -15,6 +15,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include "daemon_arguments.h"
@@ -87,3 +90,45 @@ TEST(CgroupCpuUnitTest, test_sysinfo_cgroup_controller_cpurt_mnt_path)
     ASSERT_EQ(sysinfo_get_cpurt_mnt_path(), nullptr);
     MOCK_CLEAR(util_common_calloc_s);
 }
+
+TEST(CgroupCpuUnitTest, test_common_get_process_cgroup_metrics)
+{
+    cgroup_metrics_t metrics = { 0 };
+
+    ASSERT_EQ(cgroup_ops_init(), 0);
+    ASSERT_EQ(common_get_process_cgroup_path(-1, "memory"), nullptr);
+
+    char *path = common_get_process_cgroup_path(getpid(), "memory");
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(path[0], '/');
+    ASSERT_EQ(common_get_cgroup_metrics(path, &metrics), 0);
+    ASSERT_GT(metrics.cgmem_metrics.mem_used, 0U);
+    free(path);
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+// stats of 500 containers read from cgroup files, against 500 fork and exec which
+// runtime events --stats costs at least
+TEST(CgroupCpuUnitTest, DISABLED_benchmark_container_stats_500)
+{
+    const int containers = 500;
+    ASSERT_EQ(cgroup_ops_init(), 0);
+    char *path = common_get_process_cgroup_path(getpid(), "memory");
+    ASSERT_NE(path, nullptr);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < containers; i++) {
+        cgroup_metrics_t metrics = { 0 };
+        ASSERT_EQ(common_get_cgroup_metrics(path, &metrics), 0);
+    }
+    auto cgroup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    free(path);
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < containers; i++) {
+        ASSERT_EQ(system("true"), 0);
+    }
+    auto exec_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+
+    std::cout << "cgroup files: " << cgroup_ms.count() << "ms, fork and exec: " << exec_ms.count() << "ms" << std::endl;
+}
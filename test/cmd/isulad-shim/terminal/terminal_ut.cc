@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Description: terminal unit test
+ * Author: agent
+ * Create: 2026-10-19
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <zlib.h>
+#include <gtest/gtest.h>
+
+#include <isula_libutils/logger_json_file.h>
+#include "terminal.h"
+#include "process.h"
+#include "common.h"
+#include "log_compress.h"
+
+class TerminalUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/shim-terminal-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        m_path = m_dir + "/console.log";
+        m_terminal = {};
+        m_terminal.log_path = (char *)m_path.c_str();
+        m_terminal.fd = -1;
+        m_terminal.log_maxfile = 3;
+        ASSERT_EQ(pthread_rwlock_init(&m_terminal.log_terminal_rwlock, NULL), 0);
+    }
+
+    void TearDown() override
+    {
+        if (m_terminal.fd >= 0) {
+            close(m_terminal.fd);
+        }
+        (void)pthread_rwlock_destroy(&m_terminal.log_terminal_rwlock);
+        for (int i = 0; i < 3; i++) {
+            (void)unlink(LogFile(i).c_str());
+            (void)unlink((LogFile(i) + LOG_COMPRESS_SUFFIX).c_str());
+        }
+        (void)rmdir(m_dir.c_str());
+    }
+
+    std::string LogFile(int i)
+    {
+        return i == 0 ? m_path : m_path + "." + std::to_string(i);
+    }
+
+    static off_t FileSize(const std::string &path)
+    {
+        struct stat st;
+
+        if (stat(path.c_str(), &st) != 0) {
+            return -1;
+        }
+        return st.st_size;
+    }
+
+    static std::string ReadCompressed(const std::string &path)
+    {
+        std::string content;
+        char buf[4096];
+        int n;
+        gzFile gz = gzopen(path.c_str(), "r");
+
+        if (gz == nullptr) {
+            return content;
+        }
+        while ((n = gzread(gz, buf, sizeof(buf))) > 0) {
+            content.append(buf, n);
+        }
+        gzclose(gz);
+        return content;
+    }
+
+    std::vector<logger_json_file *> ParseLines(const std::string &path)
+    {
+        std::ifstream in(path);
+        std::stringstream content;
+
+        content << in.rdbuf();
+        return ParseContent(content.str());
+    }
+
+    std::vector<logger_json_file *> ParseContent(const std::string &content)
+    {
+        std::vector<logger_json_file *> entries;
+        std::istringstream in(content);
+        std::string line;
+        struct parser_context ctx = { OPT_GEN_SIMPLIFY, stderr };
+
+        while (std::getline(in, line)) {
+            parser_error err = nullptr;
+            logger_json_file *entry = logger_json_file_parse_data(line.c_str(), &ctx, &err);
+            free(err);
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    std::string m_dir;
+    std::string m_path;
+    log_terminal m_terminal;
+};
+
+TEST_F(TerminalUnitTest, test_log_lines_encode)
+{
+    std::string out = "plain\nquote \" backslash \\ tab \t cr \r ctl \x01 esc \x1b utf8 \xe4\xbd\xa0\npartial";
+    std::string err = "e1\ne2\n";
+
+    m_terminal.log_maxsize = 1024 * 1024;
+    ASSERT_EQ(shim_create_container_log_file(&m_terminal), SHIM_OK);
+    shim_write_container_log_file(&m_terminal, STDID_OUT, (char *)out.c_str(), out.size());
+    shim_write_container_log_file(&m_terminal, STDID_ERR, (char *)err.c_str(), err.size());
+    // partial line is flushed when output is closed
+    shim_write_container_log_file(&m_terminal, STDID_OUT, nullptr, 0);
+
+    std::vector<logger_json_file *> entries = ParseLines(m_path);
+    ASSERT_EQ(entries.size(), 5U);
+    const char *expect_log[] = { "plain\n", "quote \" backslash \\ tab \t cr \r ctl \x01 esc \x1b utf8 \xe4\xbd\xa0\n", "e1\n", "e2\n",
+                                 "partial"
+                               };
+    const char *expect_stream[] = { "stdout", "stdout", "stderr", "stderr", "stdout" };
+    for (size_t i = 0; i < entries.size(); i++) {
+        ASSERT_NE(entries[i], nullptr);
+        ASSERT_EQ(std::string((char *)entries[i]->log, entries[i]->log_len), expect_log[i]);
+        ASSERT_STREQ(entries[i]->stream, expect_stream[i]);
+        ASSERT_NE(entries[i]->time, nullptr);
+        ASSERT_EQ(strlen(entries[i]->time), strlen("2006-01-02T15:04:05.999999999Z"));
+        free_logger_json_file(entries[i]);
+    }
+    ASSERT_EQ(m_terminal.log_size, FileSize(m_path));
+
+    // control characters are escaped with uppercase hex like yajl does
+    std::ifstream in(m_path);
+    std::stringstream raw;
+    raw << in.rdbuf();
+    ASSERT_NE(raw.str().find("ctl \\u0001 esc \\u001B utf8"), std::string::npos);
+}
+
+TEST_F(TerminalUnitTest, test_log_rotate)
+{
+    std::string chunk;
+
+    for (int i = 0; chunk.size() < 16 * 1024 - 100; i++) {
+        chunk += "line " + std::to_string(i) + " of a chunk written by the container\n";
+    }
+
+    m_terminal.log_maxsize = 64 * 1024;
+    ASSERT_EQ(shim_create_container_log_file(&m_terminal), SHIM_OK);
+    for (int i = 0; i < 20; i++) {
+        shim_write_container_log_file(&m_terminal, STDID_OUT, (char *)chunk.c_str(), chunk.size());
+    }
+
+    for (int i = 0; i < 3; i++) {
+        off_t size = FileSize(LogFile(i));
+        ASSERT_GT(size, 0);
+        ASSERT_LE(size, 64 * 1024);
+        for (auto entry : ParseLines(LogFile(i))) {
+            ASSERT_NE(entry, nullptr);
+            free_logger_json_file(entry);
+        }
+    }
+    ASSERT_EQ(m_terminal.log_size, FileSize(m_path));
+}
+
+TEST_F(TerminalUnitTest, test_log_rotate_compress)
+{
+    std::string chunk;
+    std::string gz1 = LogFile(1) + LOG_COMPRESS_SUFFIX;
+    std::string gz2 = LogFile(2) + LOG_COMPRESS_SUFFIX;
+
+    for (int i = 0; chunk.size() < 16 * 1024 - 100; i++) {
+        chunk += "line " + std::to_string(i) + " of a chunk written by the container\n";
+    }
+
+    m_terminal.log_maxsize = 64 * 1024;
+    m_terminal.log_compress = true;
+    ASSERT_EQ(shim_create_container_log_file(&m_terminal), SHIM_OK);
+    for (int i = 0; i < 20; i++) {
+        shim_write_container_log_file(&m_terminal, STDID_OUT, (char *)chunk.c_str(), chunk.size());
+    }
+
+    // rotated files are compressed in background
+    for (int i = 0; i < 1000; i++) {
+        if (FileSize(gz1) > 0 && FileSize(gz2) > 0 && FileSize(LogFile(1)) < 0 && FileSize(LogFile(2)) < 0) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_LT(FileSize(LogFile(1)), 0);
+    ASSERT_LT(FileSize(LogFile(2)), 0);
+    ASSERT_LT(FileSize(m_path + ".compress"), 0);
+    ASSERT_LT(FileSize(m_path + ".compress" + LOG_COMPRESS_SUFFIX), 0);
+
+    for (auto &gz : { gz1, gz2 }) {
+        std::string content = ReadCompressed(gz);
+        ASSERT_GT(content.size(), 0U);
+        ASSERT_LE(content.size(), 64U * 1024);
+        ASSERT_LT(FileSize(gz), (off_t)content.size());
+        for (auto entry : ParseContent(content)) {
+            ASSERT_NE(entry, nullptr);
+            free_logger_json_file(entry);
+        }
+    }
+    ASSERT_EQ(m_terminal.log_size, FileSize(m_path));
+}
+
+TEST_F(TerminalUnitTest, test_log_lines_per_second)
+{
+    const int total_lines = 500000;
+    int written = 0;
+    std::string line = "2026-10-19 12:00:00.000 INFO  [worker-3] handled request id=1234567890 in 12ms\n";
+    std::string chunk;
+    int lines = 0;
+
+    while (chunk.size() + line.size() <= 16 * 1024) {
+        chunk += line;
+        lines++;
+    }
+
+    m_terminal.log_maxsize = 1024 * 1024 * 1024;
+    ASSERT_EQ(shim_create_container_log_file(&m_terminal), SHIM_OK);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (; written < total_lines; written += lines) {
+        shim_write_container_log_file(&m_terminal, STDID_OUT, (char *)chunk.c_str(), chunk.size());
+    }
+    auto cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+
+    std::cout << "json-file log: " << written << " lines of " << line.size() << " bytes in "
+              << cost.count() / 1000 << "ms, " << (long long)written * 1000000 / (cost.count() + 1)
+              << " lines/s" << std::endl;
+    ASSERT_EQ(m_terminal.log_size, FileSize(m_path));
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Description: lru unit test
+ * Author: agent
+ * Create: 2026-10-19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "lru.h"
+
+struct release_record {
+    std::vector<std::string> released;
+    std::vector<std::string> evicted;
+};
+
+static void record_release(const char *key, void *value, bool evicted, void *context)
+{
+    struct release_record *record = (struct release_record *)context;
+
+    record->released.push_back(key);
+    if (evicted) {
+        record->evicted.push_back(key);
+    }
+    free(value);
+}
+
+static bool match_prefix(const char *key, void *value, void *arg)
+{
+    return strncmp(key, (const char *)arg, strlen((const char *)arg)) == 0;
+}
+
+TEST(map_lru_ut, test_lru_put_get)
+{
+    struct release_record record;
+    lru_t *lru = lru_new(10, record_release, &record);
+    char *value = strdup("a");
+
+    ASSERT_NE(lru, nullptr);
+    ASSERT_EQ(lru_get(lru, "a"), nullptr);
+    ASSERT_EQ(lru_put(lru, "a", value, 4), 0);
+    ASSERT_EQ(lru_get(lru, "a"), value);
+    ASSERT_EQ(lru_size(lru), 4);
+    ASSERT_EQ(lru_capacity(lru), 10);
+
+    // existing key and too large item stay with caller
+    value = strdup("b");
+    ASSERT_EQ(lru_put(lru, "a", value, 1), 1);
+    ASSERT_EQ(lru_put(lru, "b", value, 11), 1);
+    free(value);
+    ASSERT_EQ(lru_size(lru), 4);
+
+    ASSERT_TRUE(lru_remove(lru, "a"));
+    ASSERT_FALSE(lru_remove(lru, "a"));
+    ASSERT_EQ(lru_size(lru), 0);
+    ASSERT_EQ(record.released.size(), 1);
+    ASSERT_TRUE(record.evicted.empty());
+
+    lru_free(lru);
+}
+
+TEST(map_lru_ut, test_lru_evict)
+{
+    struct release_record record;
+    lru_t *lru = lru_new(10, record_release, &record);
+
+    ASSERT_NE(lru, nullptr);
+    ASSERT_EQ(lru_put(lru, "a", strdup("a"), 4), 0);
+    ASSERT_EQ(lru_put(lru, "b", strdup("b"), 4), 0);
+    // touch a, so b becomes the least recently used one
+    ASSERT_NE(lru_get(lru, "a"), nullptr);
+    ASSERT_EQ(lru_put(lru, "c", strdup("c"), 4), 0);
+
+    ASSERT_EQ(lru_get(lru, "b"), nullptr);
+    ASSERT_NE(lru_get(lru, "a"), nullptr);
+    ASSERT_EQ(lru_evictions(lru), 1);
+    ASSERT_EQ(lru_size(lru), 8);
+    ASSERT_EQ(record.evicted, std::vector<std::string>({ "b" }));
+
+    // c is the least recently used one now
+    lru_reserve(lru, 4);
+    ASSERT_EQ(lru_get(lru, "c"), nullptr);
+    ASSERT_EQ(lru_size(lru), 4);
+    ASSERT_EQ(lru_evictions(lru), 2);
+
+    lru_free(lru);
+    ASSERT_EQ(record.released.size(), 3);
+    ASSERT_EQ(record.evicted.size(), 2);
+}
+
+TEST(map_lru_ut, test_lru_remove_if)
+{
+    struct release_record record;
+    lru_t *lru = lru_new(100, record_release, &record);
+
+    ASSERT_NE(lru, nullptr);
+    ASSERT_EQ(lru_put(lru, "x/1", strdup("1"), 1), 0);
+    ASSERT_EQ(lru_put(lru, "y/1", strdup("1"), 1), 0);
+    ASSERT_EQ(lru_put(lru, "x/2", strdup("2"), 1), 0);
+
+    lru_remove_if(lru, match_prefix, (void *)"x/");
+    ASSERT_EQ(lru_get(lru, "x/1"), nullptr);
+    ASSERT_EQ(lru_get(lru, "x/2"), nullptr);
+    ASSERT_NE(lru_get(lru, "y/1"), nullptr);
+    ASSERT_EQ(lru_size(lru), 1);
+    ASSERT_EQ(lru_evictions(lru), 0);
+
+    lru_free(lru);
+}
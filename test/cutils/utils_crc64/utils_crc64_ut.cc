@@ -0,0 +1,152 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: utils crc64 unit test
+ *******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "utils_crc64.h"
+#include "utils.h"
+#include "utils_file.h"
+
+// bit by bit reference, same as go hash/crc64 with crc64.ISO
+static uint64_t ReferenceCrc64(uint64_t crc, const unsigned char *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xD800000000000000ULL : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+TEST(utils_crc64, test_util_crc64_iso_update)
+{
+    const std::string check = "123456789";
+    std::vector<unsigned char> data(4099);
+
+    ASSERT_EQ(util_crc64_iso_update(0, check.c_str(), check.size()), 0xB90956C775A41001ULL);
+    ASSERT_EQ(util_crc64_iso_update(0, nullptr, 10), 0ULL);
+    ASSERT_EQ(util_crc64_iso_update(0x1234, check.c_str(), 0), 0x1234ULL);
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (unsigned char)(i * 131 + 7);
+    }
+    // lengths around the 16 bytes stride and unaligned starts
+    for (size_t off = 0; off < 16; off++) {
+        for (size_t len : { (size_t)1, (size_t)15, (size_t)16, (size_t)17, (size_t)33, (size_t)4000 }) {
+            ASSERT_EQ(util_crc64_iso_update(0, data.data() + off, len), ReferenceCrc64(0, data.data() + off, len));
+        }
+    }
+
+    // update in pieces
+    uint64_t crc = util_crc64_iso_update(0, data.data(), 100);
+    crc = util_crc64_iso_update(crc, data.data() + 100, data.size() - 100);
+    ASSERT_EQ(crc, ReferenceCrc64(0, data.data(), data.size()));
+}
+
+TEST(utils_crc64, test_util_file_crc64_iso)
+{
+    char tmpl[] = "/tmp/utils-crc64-ut-XXXXXX";
+    std::string content(600 * 1024, 'a');
+    uint64_t crc = 0;
+
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    std::string file = std::string(tmpl) + "/file";
+    std::string empty = std::string(tmpl) + "/empty";
+    for (size_t i = 0; i < content.size(); i++) {
+        content[i] = (char)(i % 251);
+    }
+    ASSERT_EQ(util_write_file(file.c_str(), content.c_str(), content.size(), 0600), 0);
+    FILE *fp = fopen(empty.c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    fclose(fp);
+
+    ASSERT_EQ(util_file_crc64_iso(file.c_str(), &crc), 0);
+    ASSERT_EQ(crc, ReferenceCrc64(0, (const unsigned char *)content.c_str(), content.size()));
+    ASSERT_EQ(util_file_crc64_iso(empty.c_str(), &crc), 0);
+    ASSERT_EQ(crc, 0ULL);
+    ASSERT_NE(util_file_crc64_iso((std::string(tmpl) + "/not_exist").c_str(), &crc), 0);
+    ASSERT_NE(util_file_crc64_iso(nullptr, &crc), 0);
+
+    ASSERT_EQ(util_recursive_rmdir(tmpl, 0), 0);
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST(utils_crc64, DISABLED_benchmark_256m)
+{
+    std::vector<unsigned char> data(256 * 1024 * 1024, 0x5a);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t fast = util_crc64_iso_update(0, data.data(), data.size());
+    auto fast_done = std::chrono::steady_clock::now();
+    uint64_t reference = ReferenceCrc64(0, data.data(), data.size());
+    auto reference_done = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(fast, reference);
+    printf("crc64 of 256MB, slice-by-16: %ld ms, bitwise: %ld ms\n",
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(fast_done - start).count(),
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(reference_done - fast_done).count());
+}
+
+// startup layer check shape: one tar-split file per layer, serial loop against a pool of at most 8 workers
+TEST(utils_crc64, DISABLED_benchmark_2000_layers)
+{
+    char tmpl[] = "/tmp/utils-crc64-bench-XXXXXX";
+    const size_t layers = 2000;
+    std::string content(512 * 1024, 'b');
+    std::vector<std::string> files;
+    std::vector<uint64_t> serial(layers);
+    std::vector<uint64_t> parallel(layers);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next { 0 };
+    size_t workers = std::min<size_t>(std::max<unsigned>(std::thread::hardware_concurrency(), 1U), 8);
+
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    for (size_t i = 0; i < layers; i++) {
+        files.push_back(std::string(tmpl) + "/" + std::to_string(i) + ".tar-split.gz");
+        content[0] = (char)i;
+        ASSERT_EQ(util_write_file(files[i].c_str(), content.c_str(), content.size(), 0600), 0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < layers; i++) {
+        ASSERT_EQ(util_file_crc64_iso(files[i].c_str(), &serial[i]), 0);
+    }
+    auto serial_done = std::chrono::steady_clock::now();
+    for (size_t w = 0; w < workers; w++) {
+        threads.emplace_back([&]() {
+            for (size_t i = next++; i < layers; i = next++) {
+                (void)util_file_crc64_iso(files[i].c_str(), &parallel[i]);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    auto parallel_done = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(serial, parallel);
+    printf("crc64 of %zu layers, serial: %ld ms, %zu workers: %ld ms\n", layers,
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(serial_done - start).count(), workers,
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(parallel_done - serial_done).count());
+    ASSERT_EQ(util_recursive_rmdir(tmpl, 0), 0);
+}
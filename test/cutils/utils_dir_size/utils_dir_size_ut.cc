@@ -0,0 +1,148 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: utils dir size unit test
+ *******************************************************************************/
+
+#include <string>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "utils_dir_size.h"
+#include "utils.h"
+#include "utils_file.h"
+
+class UtilsDirSizeUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/utils-dir-size-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    // spread files over dirs_per_level^2 directories with files_per_dir files of 1 byte
+    void MakeTree(size_t dirs_per_level, size_t files_per_dir)
+    {
+        for (size_t i = 0; i < dirs_per_level; i++) {
+            for (size_t j = 0; j < dirs_per_level; j++) {
+                std::string dir = m_dir + "/" + std::to_string(i) + "/" + std::to_string(j);
+                ASSERT_EQ(util_mkdir_p(dir.c_str(), 0700), 0);
+                for (size_t k = 0; k < files_per_dir; k++) {
+                    std::string file = dir + "/" + std::to_string(k);
+                    ASSERT_EQ(util_write_file(file.c_str(), "x", 1, 0600), 0);
+                }
+            }
+        }
+    }
+
+    std::string m_dir;
+};
+
+TEST_F(UtilsDirSizeUnitTest, test_same_as_serial_walk)
+{
+    int64_t serial_size = 0;
+    int64_t serial_inodes = 0;
+    int64_t size = 0;
+    int64_t inodes = 0;
+    struct util_dir_size_opts opts = { 4, 0, false };
+
+    MakeTree(4, 10);
+    ASSERT_EQ(symlink("0", (m_dir + "/link").c_str()), 0);
+
+    util_calculate_dir_size(m_dir.c_str(), 0, &serial_size, &serial_inodes);
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &size, &inodes), 0);
+    ASSERT_EQ(size, serial_size);
+    ASSERT_EQ(inodes, serial_inodes);
+    // files, symlink, root and 4 + 4 * 4 directories
+    ASSERT_EQ(inodes, 4 * 4 * 10 + 1 + 1 + 4 + 4 * 4);
+
+    opts.workers = 1;
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &size, &inodes), 0);
+    ASSERT_EQ(inodes, serial_inodes);
+}
+
+TEST_F(UtilsDirSizeUnitTest, test_dedup_hardlink)
+{
+    int64_t size = 0;
+    int64_t dup_size = 0;
+    int64_t inodes = 0;
+    struct util_dir_size_opts opts = { 2, 0, true };
+    std::string file = m_dir + "/file";
+
+    ASSERT_EQ(util_write_file(file.c_str(), "0123456789", 10, 0600), 0);
+    ASSERT_EQ(util_mkdir_p((m_dir + "/sub").c_str(), 0700), 0);
+    ASSERT_EQ(link(file.c_str(), (m_dir + "/sub/link").c_str()), 0);
+
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &size, &inodes), 0);
+    ASSERT_EQ(inodes, 3);
+
+    opts.dedup_hardlink = false;
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &dup_size, &inodes), 0);
+    ASSERT_EQ(dup_size, size + 10);
+    ASSERT_EQ(inodes, 4);
+}
+
+TEST_F(UtilsDirSizeUnitTest, test_invalid)
+{
+    int64_t size = 0;
+    int64_t inodes = 0;
+
+    ASSERT_EQ(util_calculate_dir_size_parallel(nullptr, nullptr, &size, &inodes), -1);
+    ASSERT_EQ(util_calculate_dir_size_parallel((m_dir + "/not_exist").c_str(), nullptr, &size, &inodes), -1);
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), nullptr, &size, &inodes), 0);
+    ASSERT_EQ(inodes, 1);
+}
+
+TEST_F(UtilsDirSizeUnitTest, test_default_workers)
+{
+    int64_t serial_size = 0;
+    int64_t serial_inodes = 0;
+    int64_t size = 0;
+    int64_t inodes = 0;
+    struct util_dir_size_opts opts = { 0, 0, true };
+
+    MakeTree(8, 50);
+
+    util_calculate_dir_size(m_dir.c_str(), 0, &serial_size, &serial_inodes);
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &size, &inodes), 0);
+    ASSERT_EQ(size, serial_size);
+    ASSERT_EQ(inodes, serial_inodes);
+}
+
+TEST_F(UtilsDirSizeUnitTest, test_deadline)
+{
+    int ret;
+    int64_t full_size = 0;
+    int64_t full_inodes = 0;
+    int64_t size = 0;
+    int64_t inodes = 0;
+    struct util_dir_size_opts opts = { 1, 0, false };
+
+    MakeTree(16, 100);
+    ASSERT_EQ(util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &full_size, &full_inodes), 0);
+
+    // the walk may finish within the deadline on fast disks, totals are never over counted
+    opts.timeout_ms = 1;
+    ret = util_calculate_dir_size_parallel(m_dir.c_str(), &opts, &size, &inodes);
+    ASSERT_TRUE(ret == 0 || ret == 1);
+    ASSERT_LE(size, full_size);
+    ASSERT_LE(inodes, full_inodes);
+    if (ret == 0) {
+        ASSERT_EQ(inodes, full_inodes);
+    }
+}
@@ -17,11 +17,15 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <chrono>
+#include <string>
 #include <gtest/gtest.h>
 #include "mock.h"
 #include "utils_file.h"
 #include "constants.h"
 #include "map.h"
+#include "utils.h"
+#include "utils_array.h"
 
 #define FILE_PERMISSION_TEST 0755
 
@@ -165,6 +169,33 @@ TEST(utils_file, test_util_copy_file)
     ASSERT_EQ(util_path_remove(path.c_str()), 0);
 }
 
+TEST(utils_file, test_util_copy_file_large)
+{
+    char tmpl[] = "/tmp/utils-file-copy-XXXXXX";
+    std::string content;
+    char *copied = NULL;
+
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    std::string src = std::string(tmpl) + "/src";
+    std::string dst = std::string(tmpl) + "/dst";
+    // not a multiple of page size, so the tail is copied by a short call
+    for (size_t i = 0; content.size() < 3 * 1024 * 1024 + 123; i++) {
+        content += std::to_string(i) + "\n";
+    }
+    ASSERT_EQ(util_write_file(src.c_str(), content.c_str(), content.size(), 0600), 0);
+    // existing content of dst is dropped
+    ASSERT_EQ(util_write_file(dst.c_str(), "old", 3, 0600), 0);
+
+    ASSERT_EQ(util_copy_file(src.c_str(), dst.c_str(), 0600), 0);
+    copied = util_read_text_file(dst.c_str());
+    ASSERT_NE(copied, nullptr);
+    ASSERT_EQ(strlen(copied), content.size());
+    ASSERT_EQ(content.compare(copied), 0);
+    free(copied);
+
+    ASSERT_EQ(util_recursive_rmdir(tmpl, 0), 0);
+}
+
 TEST(utils_file, test_utils_calculate_dir_size_without_hardlink)
 {
     std::string path = "/tmp/test";
@@ -229,4 +260,66 @@ TEST(utils_file, test_util_copy_dir_recursive)
     ASSERT_EQ(util_recursive_remove_path(src), 0);
 }
 
+static void CopyTreeByReadWrite(const std::string &src, const std::string &dst)
+{
+    char **entries = NULL;
+    char buf[4096];
+
+    ASSERT_EQ(util_mkdir_p(dst.c_str(), FILE_PERMISSION_TEST), 0);
+    ASSERT_EQ(util_list_all_entries(src.c_str(), &entries), 0);
+    for (size_t i = 0; i < util_array_len((const char **)entries); i++) {
+        std::string from = src + "/" + entries[i];
+        std::string to = dst + "/" + entries[i];
+        if (util_dir_exists(from.c_str())) {
+            CopyTreeByReadWrite(from, to);
+            continue;
+        }
+        int in = util_open(from.c_str(), O_RDONLY, 0);
+        int out = util_open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        ssize_t len;
+        while ((len = util_read_nointr(in, buf, sizeof(buf))) > 0) {
+            ASSERT_EQ(util_write_nointr(out, buf, (size_t)len), len);
+        }
+        close(in);
+        close(out);
+    }
+    util_free_array(entries);
+}
 
+// benchmark of volume copy-up, run with --gtest_also_run_disabled_tests on the filesystem holding volumes,
+// e.g. TMPDIR=/var/lib/isulad; drop page cache before it to measure cold copies
+TEST(utils_file, DISABLED_benchmark_copy_5g_volume_seed_tree)
+{
+    const char *tmpdir = getenv("TMPDIR");
+    std::string tmpl = std::string(tmpdir != NULL ? tmpdir : "/tmp") + "/utils-file-seed-XXXXXX";
+    // 5GB in 64 dirs of 10 files of 8MB
+    std::string block(8 * 1024 * 1024, 's');
+
+    ASSERT_NE(mkdtemp(&tmpl[0]), nullptr);
+    std::string seed = tmpl + "/seed";
+    for (int d = 0; d < 64; d++) {
+        std::string dir = seed + "/" + std::to_string(d);
+        ASSERT_EQ(util_mkdir_p(dir.c_str(), FILE_PERMISSION_TEST), 0);
+        for (int f = 0; f < 10; f++) {
+            block[0] = (char)f;
+            std::string file = dir + "/" + std::to_string(f);
+            ASSERT_EQ(util_write_file(file.c_str(), block.c_str(), block.size(), 0600), 0);
+        }
+    }
+    sync();
+
+    std::string kernel_dst = tmpl + "/kernel";
+    std::string user_dst = tmpl + "/user";
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(util_copy_dir_recursive((char *)kernel_dst.c_str(), (char *)seed.c_str()), 0);
+    sync();
+    auto kernel_done = std::chrono::steady_clock::now();
+    CopyTreeByReadWrite(seed, user_dst);
+    sync();
+    auto user_done = std::chrono::steady_clock::now();
+
+    printf("copy 5GB seed tree, util_copy_dir_recursive: %ld ms, read/write loop: %ld ms\n",
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(kernel_done - start).count(),
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(user_done - kernel_done).count());
+    ASSERT_EQ(util_recursive_rmdir(tmpl.c_str(), 0), 0);
+}
@@ -13,8 +13,20 @@
  * Description: utils namespace unit test
  *******************************************************************************/
 
+#include <functional>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 #include "utils_fs.h"
+#include "utils_file.h"
+
+#define REMAP_ID 100000
+#define REMAP_SIZE 65536
 
 int good_cb(const char *mp, const char *pattern)
 {
@@ -40,3 +52,173 @@ TEST(utils_fs, test_util_deal_with_mount_info)
     ASSERT_EQ(util_deal_with_mount_info(good_check_cb, spattern.c_str()), true);
     ASSERT_EQ(util_deal_with_mount_info(good_check_cb, nullptr), false);
 }
+
+TEST(utils_fs, test_util_fsmount)
+{
+    bool unsupported = true;
+    const char *params[] = { "size=1m" };
+
+    ASSERT_EQ(util_fsmount(nullptr, nullptr, params, 1, nullptr, "/tmp", &unsupported), -1);
+    ASSERT_EQ(util_fsmount("tmpfs", "tmpfs", params, 1, nullptr, nullptr, &unsupported), -1);
+    // propagation flags can not be applied by fsmount, but it is not a kernel limitation
+    ASSERT_EQ(util_fsmount("tmpfs", "tmpfs", params, 1, "rprivate", "/tmp", &unsupported), -1);
+    ASSERT_FALSE(unsupported);
+}
+
+TEST(utils_fs, test_util_idmap_bind)
+{
+    bool unsupported = true;
+
+    ASSERT_EQ(util_create_userns_fd(REMAP_ID, REMAP_ID, 0), -1);
+    ASSERT_EQ(util_idmap_bind(nullptr, "/tmp", 0, &unsupported), -1);
+    ASSERT_EQ(util_idmap_bind("/tmp", nullptr, 0, &unsupported), -1);
+    ASSERT_EQ(util_idmap_bind("/tmp", "/tmp", -1, &unsupported), -1);
+    ASSERT_EQ(util_idmap_bind("/tmp", "/tmp", 0, nullptr), -1);
+}
+
+// run fn in a child as root of the user namespace, which is how a remapped container sees the files
+static bool RunAsUsernsRoot(int userns_fd, const std::function<bool()> &fn)
+{
+    int status = 0;
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        if (setns(userns_fd, CLONE_NEWUSER) != 0 || setresgid(0, 0, 0) != 0 || setresuid(0, 0, 0) != 0) {
+            _exit(2);
+        }
+        _exit(fn() ? 0 : 1);
+    }
+    if (waitpid(pid, &status, 0) != pid) {
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static uid_t OwnerOf(const std::string &path)
+{
+    struct stat st = { 0 };
+
+    if (stat(path.c_str(), &st) != 0) {
+        return (uid_t)-1;
+    }
+    return st.st_uid;
+}
+
+class IdmapOwnerUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/utils_fs_idmap_XXXXXX";
+
+        // idmapped mounts need root in the initial user namespace
+        if (geteuid() != 0) {
+            return;
+        }
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        // the remapped root is an unprivileged user on the host and has to reach the mounts below
+        ASSERT_EQ(chmod(tmpl, 0755), 0);
+        m_userns_fd = util_create_userns_fd(REMAP_ID, REMAP_ID, REMAP_SIZE);
+        ASSERT_GE(m_userns_fd, 0);
+    }
+
+    void TearDown() override
+    {
+        for (auto it = m_mounts.rbegin(); it != m_mounts.rend(); ++it) {
+            ASSERT_EQ(umount2(it->c_str(), MNT_DETACH), 0);
+        }
+        if (m_userns_fd >= 0) {
+            close(m_userns_fd);
+        }
+        if (!m_dir.empty()) {
+            ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+        }
+    }
+
+    std::string Mkdir(const std::string &sub)
+    {
+        std::string path = m_dir + "/" + sub;
+
+        EXPECT_EQ(util_mkdir_p(path.c_str(), 0755), 0);
+        return path;
+    }
+
+    // false if the kernel can not idmap the test dir, the test is skipped then
+    bool IdmapBind(const std::string &src, const std::string &dst)
+    {
+        bool unsupported = false;
+
+        if (util_idmap_bind(src.c_str(), dst.c_str(), m_userns_fd, &unsupported) != 0) {
+            EXPECT_TRUE(unsupported);
+            return false;
+        }
+        m_mounts.push_back(dst);
+        return true;
+    }
+
+    std::string m_dir;
+    int m_userns_fd { -1 };
+    std::vector<std::string> m_mounts;
+};
+
+TEST_F(IdmapOwnerUnitTest, test_idmap_bind_owner)
+{
+    if (m_dir.empty()) {
+        return;
+    }
+    std::string src = Mkdir("src");
+    std::string dst = Mkdir("dst");
+    ASSERT_EQ(util_write_file((src + "/file").c_str(), "idmap", 5, 0644), 0);
+    if (!IdmapBind(src, dst)) {
+        return;
+    }
+
+    ASSERT_EQ(OwnerOf(src + "/file"), 0U);
+    ASSERT_EQ(OwnerOf(dst + "/file"), (uid_t)REMAP_ID);
+    ASSERT_TRUE(RunAsUsernsRoot(m_userns_fd, [&dst]() {
+        return OwnerOf(dst + "/file") == 0;
+    }));
+}
+
+// how overlay2 mounts layers for userns-remap: overlay over idmapped clones of lower and upper
+TEST_F(IdmapOwnerUnitTest, test_overlay_over_idmapped_layers)
+{
+    if (m_dir.empty()) {
+        return;
+    }
+    std::string lower = Mkdir("lower");
+    std::string upper = Mkdir("upper");
+    (void)Mkdir("upper/diff");
+    (void)Mkdir("upper/work");
+    std::string staged_lower = Mkdir("idmapped/lower");
+    std::string staged_upper = Mkdir("idmapped/upper");
+    std::string merged = Mkdir("merged");
+    ASSERT_EQ(util_write_file((lower + "/file").c_str(), "idmap", 5, 0644), 0);
+    if (!IdmapBind(lower, staged_lower) || !IdmapBind(upper, staged_upper)) {
+        return;
+    }
+
+    // the mounter has to be the remapped root, overlay writes upper with its creds
+    std::string data = "lowerdir=idmapped/lower,upperdir=idmapped/upper/diff,workdir=idmapped/upper/work";
+    if (util_mount_from_as(m_dir.c_str(), "overlay", merged.c_str(), "overlay", data.c_str(), REMAP_ID,
+                           REMAP_ID) != 0) {
+        // overlay over idmapped layers needs kernel 5.19
+        return;
+    }
+    m_mounts.push_back(merged);
+
+    ASSERT_FALSE(util_check_readonly_fs(merged.c_str()));
+    ASSERT_EQ(OwnerOf(merged + "/file"), (uid_t)REMAP_ID);
+    ASSERT_TRUE(RunAsUsernsRoot(m_userns_fd, [&merged]() {
+        return OwnerOf(merged + "/file") == 0 &&
+               util_write_file((merged + "/file").c_str(), "copy up", 7, 0644) == 0 &&
+               util_write_file((merged + "/new").c_str(), "idmap", 5, 0644) == 0 &&
+               OwnerOf(merged + "/new") == 0;
+    }));
+    // copied up and written by the container root, stored as root on disk
+    ASSERT_EQ(OwnerOf(upper + "/diff/file"), 0U);
+    ASSERT_EQ(OwnerOf(upper + "/diff/new"), 0U);
+}
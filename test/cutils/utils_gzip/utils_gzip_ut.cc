@@ -0,0 +1,193 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: gzip utils unit test
+ *******************************************************************************/
+
+#include <chrono>
+#include <string>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+#include "util_gzip.h"
+#include "utils.h"
+#include "utils_file.h"
+
+class UtilsGzipUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/utils-gzip-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    // half text, half pseudo random bytes, so both matches and literals are compressed
+    static std::string MakeContent(size_t len)
+    {
+        std::string content;
+        unsigned int seed = 1;
+
+        content.reserve(len);
+        while (content.size() < len) {
+            if ((content.size() / 4096) % 2 == 0) {
+                content += "layer " + std::to_string(content.size() % 1000) + " tar split entry\n";
+            } else {
+                seed = seed * 1103515245 + 12345;
+                content.push_back((char)(seed >> 16));
+            }
+        }
+        content.resize(len);
+        return content;
+    }
+
+    std::string WriteFile(const std::string &name, const std::string &content)
+    {
+        std::string path = m_dir + "/" + name;
+        FILE *fp = fopen(path.c_str(), "w");
+
+        EXPECT_NE(fp, nullptr);
+        EXPECT_EQ(fwrite(content.c_str(), 1, content.size(), fp), content.size());
+        fclose(fp);
+        EXPECT_EQ(chmod(path.c_str(), 0640), 0);
+        return path;
+    }
+
+    static std::string ReadFile(const std::string &path)
+    {
+        std::string content;
+        char buf[4096];
+        size_t n;
+        FILE *fp = fopen(path.c_str(), "r");
+
+        if (fp == nullptr) {
+            return "";
+        }
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            content.append(buf, n);
+        }
+        fclose(fp);
+        return content;
+    }
+
+    std::string Decompress(const std::string &gz_path)
+    {
+        std::string path = gz_path + ".out";
+        FILE *fp = fopen(path.c_str(), "w");
+
+        EXPECT_NE(fp, nullptr);
+        EXPECT_EQ(util_gzip_d(gz_path.c_str(), fp), 0);
+        fclose(fp);
+        return ReadFile(path);
+    }
+
+    std::string m_dir;
+};
+
+TEST_F(UtilsGzipUnitTest, test_util_gzip_z_parallel)
+{
+    // not a multiple of block size, last block is short
+    std::string content = MakeContent(3 * 1024 * 1024 + 123);
+    std::string src = WriteFile("src", content);
+    std::string serial = m_dir + "/serial.gz";
+    std::string parallel = m_dir + "/parallel.gz";
+    struct util_gzip_options serial_opts = { 1, UTIL_GZIP_DEFAULT_LEVEL };
+    struct util_gzip_options parallel_opts = { 4, UTIL_GZIP_DEFAULT_LEVEL };
+    struct stat st;
+
+    ASSERT_EQ(util_gzip_z_parallel(src.c_str(), serial.c_str(), 0600, &serial_opts), 0);
+    ASSERT_EQ(util_gzip_z_parallel(src.c_str(), parallel.c_str(), 0600, &parallel_opts), 0);
+    ASSERT_EQ(stat(parallel.c_str(), &st), 0);
+    ASSERT_EQ(st.st_mode & 0777, 0600U);
+
+    // output does not depend on number of threads
+    std::string serial_gz = ReadFile(serial);
+    ASSERT_EQ(serial_gz, ReadFile(parallel));
+    ASSERT_LT(serial_gz.size(), content.size());
+    bool is_gzip = false;
+    ASSERT_EQ(util_gzip_compressed(parallel.c_str(), &is_gzip), 0);
+    ASSERT_TRUE(is_gzip);
+    ASSERT_EQ(Decompress(parallel), content);
+
+    ASSERT_EQ(util_gzip_z_parallel(src.c_str(), parallel.c_str(), 0600, nullptr), 0);
+    ASSERT_EQ(Decompress(parallel), content);
+
+    struct util_gzip_options invalid_opts = { 2, 10 };
+    ASSERT_NE(util_gzip_z_parallel(src.c_str(), parallel.c_str(), 0600, &invalid_opts), 0);
+    ASSERT_NE(util_gzip_z_parallel((m_dir + "/not-exist").c_str(), parallel.c_str(), 0600, nullptr), 0);
+}
+
+TEST_F(UtilsGzipUnitTest, test_util_gzip_z_parallel_small)
+{
+    std::string empty = WriteFile("empty", "");
+    std::string small = WriteFile("small", "hello");
+    std::string dst = m_dir + "/dst.gz";
+
+    ASSERT_EQ(util_gzip_z_parallel(empty.c_str(), dst.c_str(), 0600, nullptr), 0);
+    ASSERT_EQ(Decompress(dst), "");
+    ASSERT_EQ(util_gzip_z_parallel(small.c_str(), dst.c_str(), 0600, nullptr), 0);
+    ASSERT_EQ(Decompress(dst), "hello");
+}
+
+TEST_F(UtilsGzipUnitTest, test_gzip)
+{
+    std::string content = MakeContent(512 * 1024);
+    std::string log = WriteFile("isulad.log.1", content);
+    std::string gz = log + ".gz";
+    struct stat st;
+
+    ASSERT_EQ(gzip(log.c_str(), log.size()), 0);
+    ASSERT_FALSE(util_file_exists(log.c_str()));
+    ASSERT_EQ(stat(gz.c_str(), &st), 0);
+    ASSERT_EQ(st.st_mode & 0777, 0640U);
+    ASSERT_EQ(Decompress(gz), content);
+
+    ASSERT_NE(gzip(log.c_str(), log.size()), 0);
+    ASSERT_NE(gzip(nullptr, 0), 0);
+}
+
+TEST_F(UtilsGzipUnitTest, test_gzip_hard_link)
+{
+    std::string content = MakeContent(256 * 1024);
+    std::string log = WriteFile("isulad.log.2", content);
+    std::string snapshot = m_dir + "/isulad.log.compress";
+
+    // other links of the file are kept, log compressor commits them afterwards
+    ASSERT_EQ(link(log.c_str(), snapshot.c_str()), 0);
+    ASSERT_EQ(gzip(snapshot.c_str(), snapshot.size()), 0);
+    ASSERT_FALSE(util_file_exists(snapshot.c_str()));
+    ASSERT_EQ(ReadFile(log), content);
+    ASSERT_EQ(Decompress(snapshot + ".gz"), content);
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST_F(UtilsGzipUnitTest, DISABLED_benchmark_gzip_64m)
+{
+    std::string src = WriteFile("src", MakeContent(64 * 1024 * 1024));
+    std::string dst = m_dir + "/dst.gz";
+
+    auto begin = std::chrono::steady_clock::now();
+    ASSERT_EQ(util_gzip_z(src.c_str(), dst.c_str(), 0600), 0);
+    auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+
+    begin = std::chrono::steady_clock::now();
+    ASSERT_EQ(util_gzip_z_parallel(src.c_str(), dst.c_str(), 0600, nullptr), 0);
+    auto parallel_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+
+    std::cout << "util_gzip_z: " << serial_ms.count() << "ms, util_gzip_z_parallel: " << parallel_ms.count() << "ms"
+              << std::endl;
+}
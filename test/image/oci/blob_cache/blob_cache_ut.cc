@@ -0,0 +1,232 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: blob cache unit test
+ *******************************************************************************/
+
+#include <string>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+#include "blob_cache.h"
+#include "sha256.h"
+#include "utils.h"
+#include "utils_file.h"
+
+#define DIGEST_A "sha256:aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+#define DIGEST_B "sha256:bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb"
+#define DIGEST_C "sha256:cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc"
+
+class BlobCacheUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/blob-cache-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+    }
+
+    void TearDown() override
+    {
+        blob_cache_exit();
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    std::string WriteBlob(const std::string &name, size_t size)
+    {
+        std::string path = m_dir + "/" + name;
+        std::string content(size, 'x');
+
+        EXPECT_EQ(util_write_file(path.c_str(), content.c_str(), content.size(), 0600), 0);
+        return path;
+    }
+
+    std::string Digest(const std::string &path)
+    {
+        char *digest = sha256_full_file_digest(path.c_str());
+        std::string ret = digest != nullptr ? digest : "";
+
+        free(digest);
+        return ret;
+    }
+
+    std::string m_dir;
+};
+
+TEST_F(BlobCacheUnitTest, test_disabled)
+{
+    std::string src = WriteBlob("blob", 10);
+    std::string dst = m_dir + "/dst";
+
+    ASSERT_EQ(blob_cache_init((m_dir + "/cache").c_str(), 0), 0);
+    ASSERT_FALSE(blob_cache_enabled());
+    ASSERT_EQ(blob_cache_store(DIGEST_A, src.c_str()), 0);
+    ASSERT_NE(blob_cache_fetch(DIGEST_A, dst.c_str()), 0);
+}
+
+TEST_F(BlobCacheUnitTest, test_fetch_and_stats)
+{
+    struct blob_cache_stats stats;
+    std::string src = WriteBlob("blob", 10);
+    std::string dst = m_dir + "/dst";
+
+    ASSERT_EQ(blob_cache_init((m_dir + "/cache").c_str(), 100), 0);
+    ASSERT_TRUE(blob_cache_enabled());
+
+    ASSERT_NE(blob_cache_fetch(DIGEST_A, dst.c_str()), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_A, src.c_str()), 0);
+    ASSERT_EQ(blob_cache_fetch(DIGEST_A, dst.c_str()), 0);
+    ASSERT_EQ(util_file_size(dst.c_str()), 10);
+
+    blob_cache_get_stats(&stats);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.size, 10);
+    ASSERT_EQ(stats.capacity, 100);
+
+    ASSERT_NE(blob_cache_store("invalid", src.c_str()), 0);
+}
+
+TEST_F(BlobCacheUnitTest, test_lru_eviction)
+{
+    struct blob_cache_stats stats;
+    std::string a = WriteBlob("a", 40);
+    std::string b = WriteBlob("b", 40);
+    std::string c = WriteBlob("c", 40);
+    std::string dst = m_dir + "/dst";
+
+    ASSERT_EQ(blob_cache_init((m_dir + "/cache").c_str(), 100), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_A, a.c_str()), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_B, b.c_str()), 0);
+    // touch a, so b becomes the least recently used one
+    ASSERT_EQ(blob_cache_fetch(DIGEST_A, dst.c_str()), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_C, c.c_str()), 0);
+
+    blob_cache_get_stats(&stats);
+    ASSERT_EQ(stats.evictions, 1);
+    ASSERT_EQ(stats.size, 80);
+
+    ASSERT_EQ(util_path_remove(dst.c_str()), 0);
+    ASSERT_NE(blob_cache_fetch(DIGEST_B, dst.c_str()), 0);
+    ASSERT_EQ(blob_cache_fetch(DIGEST_C, dst.c_str()), 0);
+}
+
+TEST_F(BlobCacheUnitTest, test_reload)
+{
+    struct blob_cache_stats stats;
+    std::string a = WriteBlob("a", 40);
+    std::string digest = Digest(a);
+    std::string dst = m_dir + "/dst";
+    std::string cache = m_dir + "/cache";
+
+    ASSERT_EQ(blob_cache_init(cache.c_str(), 100), 0);
+    ASSERT_EQ(blob_cache_store(digest.c_str(), a.c_str()), 0);
+    blob_cache_exit();
+
+    // leftovers of interrupted store and fetch should be cleaned
+    ASSERT_EQ(util_write_file((cache + "/sha256/tmpfile.tmp").c_str(), "x", 1, 0600), 0);
+    ASSERT_EQ(util_write_file((cache + "/sha256/tmpfile.fetch.1").c_str(), "x", 1, 0600), 0);
+
+    ASSERT_EQ(blob_cache_init(cache.c_str(), 100), 0);
+    blob_cache_get_stats(&stats);
+    ASSERT_EQ(stats.size, 40);
+    ASSERT_FALSE(util_file_exists((cache + "/sha256/tmpfile.tmp").c_str()));
+    ASSERT_FALSE(util_file_exists((cache + "/sha256/tmpfile.fetch.1").c_str()));
+    ASSERT_EQ(blob_cache_fetch(digest.c_str(), dst.c_str()), 0);
+    ASSERT_EQ(Digest(dst), digest);
+}
+
+TEST_F(BlobCacheUnitTest, test_reload_corrupted)
+{
+    struct blob_cache_stats stats;
+    std::string a = WriteBlob("a", 40);
+    std::string digest = Digest(a);
+    std::string dst = m_dir + "/dst";
+    std::string cache = m_dir + "/cache";
+    std::string cached = cache + "/sha256/" + digest.substr(strlen("sha256:"));
+
+    ASSERT_EQ(blob_cache_init(cache.c_str(), 100), 0);
+    ASSERT_EQ(blob_cache_store(digest.c_str(), a.c_str()), 0);
+    blob_cache_exit();
+
+    // same size, so only the digest tells it apart
+    std::string content(40, 'y');
+    ASSERT_EQ(util_write_file(cached.c_str(), content.c_str(), content.size(), 0600), 0);
+
+    ASSERT_EQ(blob_cache_init(cache.c_str(), 100), 0);
+    ASSERT_NE(blob_cache_fetch(digest.c_str(), dst.c_str()), 0);
+    ASSERT_FALSE(util_file_exists(dst.c_str()));
+    ASSERT_FALSE(util_file_exists(cached.c_str()));
+
+    blob_cache_get_stats(&stats);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.size, 0);
+}
+
+TEST_F(BlobCacheUnitTest, test_concurrent_fetch_and_store)
+{
+    std::string a = WriteBlob("a", 1024 * 1024);
+    std::string b = WriteBlob("b", 40);
+    std::string cache = m_dir + "/cache";
+
+    ASSERT_EQ(blob_cache_init(cache.c_str(), 2 * 1024 * 1024), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_B, b.c_str()), 0);
+
+    std::thread storer([&]() {
+        for (int i = 0; i < 20; i++) {
+            EXPECT_EQ(blob_cache_store(DIGEST_A, a.c_str()), 0);
+        }
+    });
+    for (int i = 0; i < 20; i++) {
+        std::string dst = m_dir + "/dst" + std::to_string(i);
+        ASSERT_EQ(blob_cache_fetch(DIGEST_B, dst.c_str()), 0);
+        ASSERT_EQ(util_file_size(dst.c_str()), 40);
+    }
+    storer.join();
+
+    // no tmp or pinned files left in the cache dir
+    size_t count = 0;
+    DIR *dir = opendir((cache + "/sha256").c_str());
+    ASSERT_NE(dir, nullptr);
+    for (struct dirent *ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+        if (ent->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    ASSERT_EQ(count, 2);
+}
+
+TEST_F(BlobCacheUnitTest, test_fetch_not_shared)
+{
+    std::string src = WriteBlob("blob", 10);
+    std::string dst = m_dir + "/dst";
+    std::string again = m_dir + "/again";
+    char *content = nullptr;
+
+    ASSERT_EQ(blob_cache_init((m_dir + "/cache").c_str(), 100), 0);
+    ASSERT_EQ(blob_cache_store(DIGEST_A, src.c_str()), 0);
+    // downloader reuses its file after store
+    ASSERT_EQ(util_write_file(src.c_str(), "yyyyyyyyyy", 10, 0600), 0);
+
+    ASSERT_EQ(blob_cache_fetch(DIGEST_A, dst.c_str()), 0);
+    // consumer of a hit writes and chmods its file
+    ASSERT_EQ(util_write_file(dst.c_str(), "zzzzzzzzzz", 10, 0600), 0);
+    ASSERT_EQ(chmod(dst.c_str(), 0777), 0);
+
+    ASSERT_EQ(blob_cache_fetch(DIGEST_A, again.c_str()), 0);
+    content = util_read_text_file(again.c_str());
+    ASSERT_STREQ(content, "xxxxxxxxxx");
+    free(content);
+}
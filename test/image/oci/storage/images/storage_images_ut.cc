@@ -13,6 +13,7 @@
  * Description: provide oci storage images unit test
  ******************************************************************************/
 #include "image_store.h"
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <algorithm>
@@ -32,6 +33,7 @@
 #include "path.h"
 #include "isula_libutils/imagetool_images_list.h"
 #include "isula_libutils/imagetool_image.h"
+#include "big_data_cache.h"
 #include "storage_mock.h"
 #include "isulad_config_mock.h"
 
@@ -260,7 +262,7 @@ void invokeFreeLayerList(struct layer_list *ptr)
 TEST_F(StorageImagesCompatibilityUnitTest, test_load_v1_image)
 {
     char store_real_path[PATH_MAX] = { 0x00 };
-    struct storage_module_init_options opts;
+    struct storage_module_init_options opts = { 0 };
     std::string dir = GetDirectory() + "/data";
     ASSERT_STRNE(util_clean_path(dir.c_str(), store_real_path, sizeof(store_real_path)), nullptr);
 
@@ -281,7 +283,7 @@ class StorageImagesUnitTest : public testing::Test {
 protected:
     void SetUp() override
     {
-        struct storage_module_init_options opts;
+        struct storage_module_init_options opts = { 0 };
         std::string dir = GetDirectory() + "/data";
         ASSERT_STRNE(util_clean_path(dir.c_str(), store_real_path, sizeof(store_real_path)), nullptr);
 
@@ -297,6 +299,17 @@ protected:
         image_store_free();
     }
 
+    void ReinitWithCache(int64_t capacity)
+    {
+        struct storage_module_init_options opts = { 0 };
+
+        image_store_free();
+        opts.storage_root = store_real_path;
+        opts.driver_name = (char *)"overlay";
+        opts.image_big_data_cache_size = capacity;
+        ASSERT_EQ(image_store_init(&opts), 0);
+    }
+
     void BackUp()
     {
         std::string backup = std::string(store_real_path) + ".bak";
@@ -540,6 +553,79 @@ TEST_F(StorageImagesUnitTest, test_image_store_create)
     free(random_id);
 }
 
+TEST_F(StorageImagesUnitTest, test_image_store_big_data_cache)
+{
+    struct big_data_cache_stats stats;
+
+    ReinitWithCache(1024 * 1024);
+    BackUp();
+
+    char *first = image_store_big_data(ids.at(0).c_str(), "manifest");
+    char *second = image_store_big_data(ids.at(0).c_str(), "manifest");
+    ASSERT_NE(first, nullptr);
+    ASSERT_STREQ(first, second);
+    free(second);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.hits, 1);
+
+    // inspect reads image config through the cache too
+    auto image = image_store_get_image(ids.at(0).c_str());
+    ASSERT_NE(image, nullptr);
+    free_imagetool_image(image);
+    image = image_store_get_image(ids.at(0).c_str());
+    ASSERT_NE(image, nullptr);
+    ASSERT_NE(image->spec, nullptr);
+    free_imagetool_image(image);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.hits, 2);
+
+    // set big data drops the cached item
+    ASSERT_EQ(image_store_set_big_data(ids.at(0).c_str(), "manifest", first), 0);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.invalidations, 1);
+    second = image_store_big_data(ids.at(0).c_str(), "manifest");
+    ASSERT_STREQ(first, second);
+    free(second);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.misses, 3);
+
+    // delete drops all items of the image
+    ASSERT_EQ(image_store_delete(ids.at(0).c_str()), 0);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.invalidations, 3);
+    ASSERT_EQ(stats.size, 0);
+    free(first);
+
+    Restore();
+}
+
+TEST_F(StorageImagesUnitTest, test_image_store_big_data_cache_evict)
+{
+    struct big_data_cache_stats stats;
+    std::string dir = std::string(store_real_path) + "/overlay-images/";
+    int64_t max_size = std::max(util_file_size((dir + ids.at(0) + "/manifest").c_str()),
+                                util_file_size((dir + ids.at(1) + "/manifest").c_str()));
+
+    // room for one manifest only
+    ReinitWithCache(max_size + 100);
+
+    for (auto elem : ids) {
+        char *data = image_store_big_data(elem.c_str(), "manifest");
+        ASSERT_NE(data, nullptr);
+        free(data);
+    }
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.evictions, 1);
+    ASSERT_LE(stats.size, stats.capacity);
+
+    char *data = image_store_big_data(ids.at(1).c_str(), "manifest");
+    free(data);
+    big_data_cache_get_stats(&stats);
+    ASSERT_EQ(stats.hits, 1);
+}
+
 TEST_F(StorageImagesUnitTest, test_image_store_lookup)
 {
     std::string id { "e4db68de4ff27c2adfea0c54bbb73a61a42f5b667c326de4d7d5b19ab71c6a3b" };
@@ -604,6 +690,88 @@ TEST_F(StorageImagesUnitTest, test_image_store_get_all_images)
     free_imagetool_images_list(images_list);
 }
 
+TEST_F(StorageImagesUnitTest, test_image_store_summary_follows_changes)
+{
+    const char *names[] = { "isula.org/library/summary:v1", "isula.org/library/summary:v2" };
+    imagetool_images_list *images_list = nullptr;
+
+    BackUp();
+
+    ASSERT_EQ(image_store_set_names(ids.at(0).c_str(), names, 2), 0);
+    ASSERT_EQ(image_store_set_image_size(ids.at(0).c_str(), 4096), 0);
+    // name moves away from the first image
+    ASSERT_EQ(image_store_add_name(ids.at(1).c_str(), names[1]), 0);
+
+    images_list = (imagetool_images_list *)util_common_calloc_s(sizeof(imagetool_images_list));
+    ASSERT_NE(images_list, nullptr);
+    ASSERT_EQ(image_store_get_all_images(images_list), 0);
+    ASSERT_EQ(images_list->images_len, 2);
+    for (size_t i {}; i < images_list->images_len; i++) {
+        auto img = images_list->images[i];
+        if (std::string(img->id) == ids.at(0)) {
+            ASSERT_EQ(img->size, 4096);
+            ASSERT_EQ(img->repo_tags_len, 1);
+            ASSERT_STREQ(img->repo_tags[0], names[0]);
+        } else {
+            ASSERT_STREQ(img->repo_tags[img->repo_tags_len - 1], names[1]);
+        }
+    }
+    free_imagetool_images_list(images_list);
+
+    auto summary = image_store_get_image_summary(ids.at(1).c_str());
+    ASSERT_NE(summary, nullptr);
+    ASSERT_STREQ(summary->repo_tags[summary->repo_tags_len - 1], names[1]);
+    free_imagetool_image_summary(summary);
+
+    Restore();
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST_F(StorageImagesUnitTest, DISABLED_benchmark_list_1000_images)
+{
+    std::string layer { "6194458b07fcf01f1483d96cd6c34302ffff7f382bb151a6d023c4e80ba3050a" };
+    std::string resource = std::string(store_real_path) +
+                           "/resources/ffc8ef7968a2acb7545006bed022001addaa262c0f760883146c4a4fae54e689/";
+    std::string config_file =
+        resource + "=c2hhMjU2OmZmYzhlZjc5NjhhMmFjYjc1NDUwMDZiZWQwMjIwMDFhZGRhYTI2MmMwZjc2MDg4MzE0NmM0YTRmYWU1NGU2ODk=";
+    std::ifstream config_stream(config_file);
+    std::string config((std::istreambuf_iterator<char>(config_stream)), std::istreambuf_iterator<char>());
+    std::ifstream manifest_stream(resource + "manifest");
+    std::string manifest((std::istreambuf_iterator<char>(manifest_stream)), std::istreambuf_iterator<char>());
+    types_timestamp_t time { 0x00 };
+    const size_t images = 1000;
+    const size_t rounds = 100;
+
+    ASSERT_FALSE(config.empty());
+    BackUp();
+
+    for (size_t i = 0; i < images; i++) {
+        std::string name = "isula.org/bench/image" + std::to_string(i) + ":latest";
+        const char *names[] = { name.c_str() };
+        char *id = image_store_create(nullptr, names, 1, layer.c_str(), "{}", &time, nullptr);
+        ASSERT_NE(id, nullptr);
+        std::string key = "sha256:" + std::string(id);
+        ASSERT_EQ(image_store_set_big_data(id, key.c_str(), config.c_str()), 0);
+        ASSERT_EQ(image_store_set_big_data(id, "manifest", manifest.c_str()), 0);
+        free(id);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        auto images_list = (imagetool_images_list *)util_common_calloc_s(sizeof(imagetool_images_list));
+        ASSERT_NE(images_list, nullptr);
+        ASSERT_EQ(image_store_get_all_images(images_list), 0);
+        ASSERT_EQ(images_list->images_len, images + ids.size());
+        free_imagetool_images_list(images_list);
+    }
+    auto done = std::chrono::steady_clock::now();
+
+    printf("list %zu images: %.2f ms per call\n", images + ids.size(),
+           (double)std::chrono::duration_cast<std::chrono::microseconds>(done - start).count() / rounds / 1000);
+
+    Restore();
+}
+
 TEST_F(StorageImagesUnitTest, test_image_store_get_something)
 {
     char **names = nullptr;
@@ -26,6 +26,7 @@
 #include "libdevmapper_mock.h"
 #include "isulad_config_mock.h"
 #include "wrapper_devmapper.h"
+#include "isula_libutils/image_devmapper_device_info.h"
 
 using ::testing::Invoke;
 using ::testing::NiceMock;
@@ -375,6 +376,68 @@ TEST_F(DriverDevmapperUnitTest, test_devmapper_apply_diff)
     MOCK_CLEAR(umount2);
 }
 
+TEST_F(DriverDevmapperUnitTest, test_devmapper_claim_spare_device)
+{
+    std::string id { "eb29745b8228e1e97c01b1d5c2554a319c00a94d8dd5746a3904222ad65a13f8" };
+    std::string metadata_dir { "/tmp/isulad/data/devicemapper/metadata/" };
+    std::string spare_file = metadata_dir + "spare-0123456789abcdef";
+    std::string spare_json = "{\"hash\": \"spare-0123456789abcdef\", \"device_id\": 5, "
+                             "\"size\": 10737418240, \"transaction_id\": 5}";
+    struct driver_create_opts create_opts = { 0 };
+    image_devmapper_device_info *info = nullptr;
+    parser_error err = nullptr;
+
+    // restart the driver with a spare device left by last run
+    MOCK_SET(umount2, 0);
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    MOCK_CLEAR(umount2);
+    ASSERT_EQ(util_write_file(spare_file.c_str(), spare_json.c_str(), spare_json.length(), 0600), 0);
+
+    char *names = static_cast<char *>(util_common_calloc_s(sizeof(struct dm_names) + strlen("isulad0-pool") + 1));
+    struct dm_names *dname = (struct dm_names *)names;
+    dname->dev = 1;
+    dname->next = 0;
+    strcpy(names + sizeof(struct dm_names), "isulad0-pool");
+    EXPECT_CALL(m_libdevmapper_mock, DMTaskGetNames(_)).WillOnce(Return(dname));
+    EXPECT_CALL(m_libdevmapper_mock, DMSetDevDir(_)).WillOnce(Return(1));
+    EXPECT_CALL(m_libdevmapper_mock, DMTaskGetDriverVersion(_, _, _)).WillOnce(Invoke(invokeDMTaskGetDriverVersion));
+    EXPECT_CALL(m_libdevmapper_mock, DMUdevGetSyncSupport()).WillOnce(Return(1));
+
+    char **driver_opts = static_cast<char **>(util_common_calloc_s((opts->driver_opts_len + 1) * sizeof(char *)));
+    ASSERT_NE(driver_opts, nullptr);
+    memcpy(driver_opts, opts->driver_opts, opts->driver_opts_len * sizeof(char *));
+    driver_opts[opts->driver_opts_len] = strdup("dm.spare_devices=1");
+    free(opts->driver_opts);
+    opts->driver_opts = driver_opts;
+    opts->driver_opts_len++;
+    MOCK_SET_V(util_exec_cmd, invokeUtilExecCmd);
+    MOCK_SET(util_mount, 0);
+    MOCK_SET(umount2, 0);
+    ASSERT_EQ(graphdriver_init(opts), 0);
+    MOCK_CLEAR(util_exec_cmd);
+    MOCK_CLEAR(util_mount);
+    MOCK_CLEAR(umount2);
+
+    // rename of the metadata fails, the spare device is kept for the next layer
+    ASSERT_EQ(util_mkdir_p((metadata_dir + id).c_str(), 0700), 0);
+    ASSERT_NE(graphdriver_create_rw(id.c_str(), nullptr, &create_opts), 0);
+    info = image_devmapper_device_info_parse_file(spare_file.c_str(), nullptr, &err);
+    ASSERT_NE(info, nullptr);
+    ASSERT_EQ(info->device_id, 5);
+    free_image_devmapper_device_info(info);
+
+    ASSERT_EQ(util_path_remove((metadata_dir + id).c_str()), 0);
+    ASSERT_EQ(graphdriver_create_rw(id.c_str(), nullptr, &create_opts), 0);
+    ASSERT_TRUE(graphdriver_layer_exists(id.c_str()));
+    ASSERT_FALSE(util_file_exists(spare_file.c_str()));
+    info = image_devmapper_device_info_parse_file((metadata_dir + id).c_str(), nullptr, &err);
+    ASSERT_NE(info, nullptr);
+    ASSERT_EQ(info->device_id, 5);
+    ASSERT_STREQ(info->hash, id.c_str());
+    free_image_devmapper_device_info(info);
+    free(err);
+}
+
 TEST_F(DriverDevmapperUnitTest, test_wrapper_devmapper)
 {
     ASSERT_STREQ(dev_strerror(ERR_TASK_RUN), "Task run error");
@@ -0,0 +1,143 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: devmapper driver throughput test on a loopback thin pool
+ ******************************************************************************/
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "driver.h"
+#include "utils.h"
+#include "utils_array.h"
+#include "utils_file.h"
+#include "isulad_config_mock.h"
+
+using ::testing::NiceMock;
+
+#define LOOPBACK_DIR "/tmp/isulad-dm-loopback"
+#define LOOPBACK_POOL "isulad-loopback-thinpool"
+
+// needs root, losetup, dmsetup and mkfs.ext4, run with --gtest_also_run_disabled_tests
+class DriverDevmapperLoopbackTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        MockIsuladConf_SetMock(&m_isulad_conf_mock);
+    }
+
+    void TearDown() override
+    {
+        MockIsuladConf_SetMock(nullptr);
+    }
+
+    void SetupPool()
+    {
+        ASSERT_EQ(geteuid(), 0U) << "loopback thin pool needs root";
+        std::string cmd = "mkdir -p " LOOPBACK_DIR " && truncate -s 8G " LOOPBACK_DIR "/data && truncate -s 256M "
+                          LOOPBACK_DIR "/metadata"
+                          " && DATA=$(losetup -f --show " LOOPBACK_DIR "/data)"
+                          " && META=$(losetup -f --show " LOOPBACK_DIR "/metadata)"
+                          " && dd if=/dev/zero of=$META bs=4096 count=1 status=none"
+                          " && dmsetup create " LOOPBACK_POOL " --table \"0 $(blockdev --getsz $DATA) thin-pool $META $DATA 128 32768 1 skip_block_zeroing\"";
+        ASSERT_EQ(system(cmd.c_str()), 0);
+    }
+
+    void TeardownPool()
+    {
+        std::string cmd = "dmsetup remove " LOOPBACK_POOL "; for d in $(losetup -j " LOOPBACK_DIR
+                          "/data -O NAME -n) $(losetup -j " LOOPBACK_DIR "/metadata -O NAME -n); do losetup -d $d; done;"
+                          " rm -rf " LOOPBACK_DIR;
+        (void)system(cmd.c_str());
+    }
+
+    void InitDriver(const char *spare_devices)
+    {
+        struct storage_module_init_options opts = { 0 };
+        char *driver_opts[] = { (char *)"dm.thinpooldev=/dev/mapper/" LOOPBACK_POOL, (char *)"dm.fs=ext4",
+                                (char *)"dm.basesize=1G", (char *)"dm.mkfsarg=-q", (char *)spare_devices };
+
+        opts.storage_root = (char *)LOOPBACK_DIR "/root";
+        opts.storage_run_root = (char *)LOOPBACK_DIR "/run";
+        opts.driver_name = (char *)"devicemapper";
+        opts.driver_opts = driver_opts;
+        opts.driver_opts_len = sizeof(driver_opts) / sizeof(driver_opts[0]);
+        ASSERT_EQ(graphdriver_init(&opts), 0);
+    }
+
+    // each worker repeats create_rw, mount, umount and rm of its own layers
+    void RunParallel(const std::string &name, size_t workers, size_t rounds)
+    {
+        std::vector<std::thread> threads;
+        std::atomic<size_t> failed { 0 };
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([w, rounds, &failed]() {
+                for (size_t r = 0; r < rounds; r++) {
+                    struct driver_create_opts create_opts = { 0 };
+                    std::string id = "loopback-" + std::to_string(w) + "-" + std::to_string(r);
+                    char *mount_dir = nullptr;
+
+                    if (graphdriver_create_rw(id.c_str(), nullptr, &create_opts) != 0) {
+                        failed++;
+                        continue;
+                    }
+                    mount_dir = graphdriver_mount_layer(id.c_str(), nullptr);
+                    if (mount_dir == nullptr || graphdriver_umount_layer(id.c_str()) != 0) {
+                        failed++;
+                    }
+                    free(mount_dir);
+                    if (graphdriver_rm_layer(id.c_str()) != 0) {
+                        failed++;
+                    }
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        auto done = std::chrono::steady_clock::now();
+
+        ASSERT_EQ(failed.load(), 0U);
+        long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(done - start).count();
+        printf("%s: %zu workers, %zu layers, %ld ms, %.1f layers/s\n", name.c_str(), workers, workers * rounds, ms,
+               ms == 0 ? 0.0 : (double)(workers * rounds) * 1000 / ms);
+    }
+
+    NiceMock<MockIsuladConf> m_isulad_conf_mock;
+};
+
+TEST_F(DriverDevmapperLoopbackTest, DISABLED_benchmark_parallel_create_mount_remove)
+{
+    SetupPool();
+    InitDriver("dm.spare_devices=0");
+    RunParallel("serial snapshot", 1, 64);
+    RunParallel("parallel snapshot", 16, 16);
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    TeardownPool();
+}
+
+TEST_F(DriverDevmapperLoopbackTest, DISABLED_benchmark_parallel_create_mount_remove_with_spares)
+{
+    SetupPool();
+    InitDriver("dm.spare_devices=16");
+    RunParallel("parallel with spare devices", 16, 16);
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    TeardownPool();
+}
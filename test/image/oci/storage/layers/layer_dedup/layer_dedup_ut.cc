@@ -0,0 +1,190 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: layer dedup unit test
+ *******************************************************************************/
+
+#include <fcntl.h>
+#include <list>
+#include <string>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+
+#include "layer_dedup.h"
+#include "utils.h"
+#include "utils_file.h"
+
+#define TEST_FILE_SIZE (64 * 1024)
+
+static bool g_hold_result = true;
+static int g_hold_count = 0;
+
+static bool HoldLayers(const char *src_id, const char *dst_id)
+{
+    g_hold_count++;
+    return g_hold_result;
+}
+
+static void ReleaseLayers(void)
+{
+}
+
+class LayerDedupUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/layer-dedup-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        m_tmp = m_dir + "/" + LAYER_DEDUP_TMP_DIR;
+        g_hold_result = true;
+        g_hold_count = 0;
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    std::string MakeFile(const std::string &layer, const std::string &name, char fill, mode_t mode = 0644)
+    {
+        std::string dir = m_dir + "/" + layer + "/diff";
+        std::string path = dir + "/" + name;
+        std::string content(TEST_FILE_SIZE, fill);
+        struct timespec times[2] = { { 1700000000, 0 }, { 1700000000, 0 } };
+        char *parent = util_path_dir(path.c_str());
+
+        EXPECT_EQ(util_mkdir_p(parent, 0755), 0);
+        free(parent);
+        EXPECT_EQ(util_write_file(path.c_str(), content.c_str(), content.size(), mode), 0);
+        EXPECT_EQ(chmod(path.c_str(), mode), 0);
+        EXPECT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+        return path;
+    }
+
+    struct layer_dedup_dir Dir(const std::string &layer, bool is_new, bool allow_hardlink = true)
+    {
+        m_paths.push_back(m_dir + "/" + layer + "/diff");
+        return { layer.c_str(), m_paths.back().c_str(), is_new, allow_hardlink };
+    }
+
+    static ino_t Inode(const std::string &path)
+    {
+        struct stat st;
+
+        if (lstat(path.c_str(), &st) != 0) {
+            return 0;
+        }
+        return st.st_ino;
+    }
+
+    std::string m_dir;
+    std::string m_tmp;
+    // keep dir strings alive while dedup runs
+    std::list<std::string> m_paths;
+};
+
+TEST_F(LayerDedupUnitTest, test_hardlink_across_layers)
+{
+    std::string old_a = MakeFile("old", "a", 'x');
+    std::string new1_a = MakeFile("new1", "a", 'x');
+    std::string new1_b = MakeFile("new1", "sub/b", 'x');
+    std::string new2_c = MakeFile("new2", "c", 'x', 0755);
+    std::string new2_d = MakeFile("new2", "d", 'y');
+    std::string new2_e = MakeFile("new2", "e", 'x');
+    ASSERT_EQ(util_write_file((m_dir + "/new2/diff/small").c_str(), "x", 1, 0644), 0);
+    ino_t old_ino = Inode(old_a);
+
+    std::string old_id = "old";
+    std::string new1_id = "new1";
+    std::string new2_id = "new2";
+    struct layer_dedup_dir dirs[] = { Dir(old_id, false), Dir(new1_id, true), Dir(new2_id, true) };
+    struct layer_dedup_ops ops = { HoldLayers, ReleaseLayers, nullptr };
+    struct layer_dedup_stats stats = { 0 };
+
+    ASSERT_EQ(layer_dedup_dirs(dirs, 3, m_tmp.c_str(), LAYER_DEDUP_HARDLINK, &ops, &stats), 0);
+
+    ASSERT_EQ(Inode(new1_a), old_ino);
+    // a layer never gets two paths of one inode, or its tar would have a hardlink entry
+    ASSERT_NE(Inode(new1_b), old_ino);
+    // mode is shared by hardlinks
+    ASSERT_NE(Inode(new2_c), old_ino);
+    ASSERT_NE(Inode(new2_d), old_ino);
+    ASSERT_EQ(Inode(new2_e), old_ino);
+
+    ASSERT_EQ(stats.files_scanned, 7U);
+    ASSERT_EQ(stats.files_deduped, 2U);
+    ASSERT_EQ(stats.page_cache_saved, 2U * TEST_FILE_SIZE);
+    ASSERT_EQ(g_hold_count, 2);
+    ASSERT_FALSE(util_dir_exists(m_tmp.c_str()));
+
+    // linked files are kept by next pass
+    struct layer_dedup_dir again[] = { Dir(old_id, false), Dir(new1_id, false), Dir(new2_id, true) };
+    stats = { 0 };
+    ASSERT_EQ(layer_dedup_dirs(again, 3, m_tmp.c_str(), LAYER_DEDUP_HARDLINK, &ops, &stats), 0);
+    ASSERT_EQ(stats.files_deduped, 0U);
+}
+
+TEST_F(LayerDedupUnitTest, test_hardlink_not_allowed)
+{
+    std::string old_a = MakeFile("old", "a", 'x');
+    std::string new1_a = MakeFile("new1", "a", 'x');
+    std::string new2_a = MakeFile("new2", "a", 'x');
+    ino_t old_ino = Inode(old_a);
+
+    std::string old_id = "old";
+    std::string new1_id = "new1";
+    std::string new2_id = "new2";
+    // new1 is lower of a container, new2 is refused by hold
+    struct layer_dedup_dir dirs[] = { Dir(old_id, false), Dir(new1_id, true, false), Dir(new2_id, true) };
+    struct layer_dedup_ops ops = { HoldLayers, ReleaseLayers, nullptr };
+    struct layer_dedup_stats stats = { 0 };
+
+    g_hold_result = false;
+    ASSERT_EQ(layer_dedup_dirs(dirs, 3, m_tmp.c_str(), LAYER_DEDUP_HARDLINK, &ops, &stats), 0);
+    ASSERT_NE(Inode(new1_a), old_ino);
+    ASSERT_NE(Inode(new2_a), old_ino);
+    ASSERT_EQ(stats.files_deduped, 0U);
+    ASSERT_EQ(g_hold_count, 1);
+
+    ASSERT_NE(layer_dedup_dirs(dirs, 3, m_tmp.c_str(), LAYER_DEDUP_OFF, &ops, &stats), 0);
+}
+
+TEST_F(LayerDedupUnitTest, test_auto)
+{
+    std::string old_a = MakeFile("old", "a", 'x');
+    std::string new1_a = MakeFile("new1", "a", 'x');
+    char *old_content = nullptr;
+    char *new_content = nullptr;
+
+    std::string old_id = "old";
+    std::string new1_id = "new1";
+    struct layer_dedup_dir dirs[] = { Dir(old_id, false), Dir(new1_id, true) };
+    struct layer_dedup_stats stats = { 0 };
+
+    // reflink on xfs and btrfs, hardlink on other filesystems
+    ASSERT_EQ(layer_dedup_dirs(dirs, 2, m_tmp.c_str(), LAYER_DEDUP_AUTO, nullptr, &stats), 0);
+    ASSERT_EQ(stats.files_deduped, 1U);
+    ASSERT_EQ(util_file_exists(new1_a.c_str()), true);
+    if (stats.page_cache_saved == 0) {
+        ASSERT_NE(Inode(new1_a), Inode(old_a));
+    } else {
+        ASSERT_EQ(Inode(new1_a), Inode(old_a));
+    }
+
+    old_content = util_read_text_file(old_a.c_str());
+    new_content = util_read_text_file(new1_a.c_str());
+    ASSERT_NE(new_content, nullptr);
+    ASSERT_STREQ(old_content, new_content);
+    free(old_content);
+    free(new_content);
+}
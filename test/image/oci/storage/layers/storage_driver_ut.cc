@@ -16,15 +16,21 @@
 #include <cstddef>
 #include <cstring>
 #include <iostream>
+#include <vector>
+#include <chrono>
 #include <climits>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mount.h>
 #include <sys/stat.h>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include "path.h"
 #include "utils.h"
 #include "utils_array.h"
+#include "utils_file.h"
+#include "utils_fs.h"
 #include "driver_overlay2.h"
 #include "driver_quota_mock.h"
 
@@ -100,7 +106,7 @@ int invokeGetPageSize()
     return abs_mount.length() - 1;
 }
 
-int invokeIOCtl(int fd, int cmd)
+int invokeIOCtl(int fd, unsigned long int cmd, void *arg)
 {
     return 0;
 }
@@ -124,7 +130,6 @@ protected:
         std::string isulad_dir { "/tmp/isulad/" };
         mkdir(isulad_dir.c_str(), 0755);
         std::string root_dir = isulad_dir + "data";
-        std::string run_dir = isulad_dir + "data/run";
         std::string data_dir = GetDirectory() + "/data";
 
         support_overlay = check_support_overlay(root_dir);
@@ -144,20 +149,30 @@ protected:
                             + root_dir + "/overlay/9c27e219663c25e0f28493790cc0b88bc973ba3b1686355f221c38a36978ac63/work ";
         ASSERT_EQ(system(mkdir.c_str()), 0);
 
+        EXPECT_CALL(m_driver_quota_mock, QuotaCtl(_, _, _, _)).WillRepeatedly(Invoke(invokeQuotaCtl));
+        InitDriver();
+    }
+
+    void InitDriver(bool quotaAccounting = false)
+    {
+        std::string root_dir = "/tmp/isulad/data";
+        std::string run_dir = "/tmp/isulad/data/run";
         struct storage_module_init_options *opts = (struct storage_module_init_options *)util_common_calloc_s(sizeof(
                                                                                                                   struct storage_module_init_options));
         opts->storage_root = strdup(root_dir.c_str());
         opts->storage_run_root = strdup(run_dir.c_str());
         opts->driver_name = strdup("overlay");
-        opts->driver_opts = (char **)util_common_calloc_s(5 * sizeof(char *));
+        opts->driver_opts = (char **)util_common_calloc_s(6 * sizeof(char *));
         opts->driver_opts[0] = strdup("overlay2.basesize=128M");
         opts->driver_opts[1] = strdup("overlay2.override_kernel_check=true");
         opts->driver_opts[2] = strdup("overlay2.skip_mount_home=false");
         opts->driver_opts[3] = strdup("overlay2.mountopt=rw");
         opts->driver_opts[4] = strdup("overlay2.skip_mount_home=true");
         opts->driver_opts_len = 4;
+        if (quotaAccounting) {
+            opts->driver_opts[opts->driver_opts_len++] = strdup("overlay2.quota_accounting=true");
+        }
 
-        EXPECT_CALL(m_driver_quota_mock, QuotaCtl(_, _, _, _)).WillRepeatedly(Invoke(invokeQuotaCtl));
         ASSERT_EQ(graphdriver_init(opts), 0);
 
         free(opts->storage_root);
@@ -215,7 +230,7 @@ TEST_F(StorageDriverUnitTest, test_graphdriver_create_rw)
     create_opts->storage_opt->values[0] = strdup("128M");
     create_opts->storage_opt->len = 1;
 
-    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _)).WillRepeatedly(Invoke(invokeIOCtl));
+    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _, _)).WillRepeatedly(Invoke(invokeIOCtl));
     ASSERT_EQ(graphdriver_create_rw(id.c_str(), nullptr, create_opts), 0);
     ASSERT_TRUE(graphdriver_layer_exists(id.c_str()));
 
@@ -224,6 +239,89 @@ TEST_F(StorageDriverUnitTest, test_graphdriver_create_rw)
     free_driver_create_opts(create_opts);
 }
 
+static uint32_t g_last_projid = 0;
+static int g_set_limit_calls = 0;
+
+int invokeIOCtlProjid(int fd, unsigned long int cmd, void *arg)
+{
+    struct fsxattr *attr = (struct fsxattr *)arg;
+
+    // the last project id set is reported for every directory
+    if (cmd == FS_IOC_FSSETXATTR) {
+        g_last_projid = attr->fsx_projid;
+    } else if (cmd == FS_IOC_FSGETXATTR) {
+        attr->fsx_projid = g_last_projid;
+    }
+    return 0;
+}
+
+int invokeQuotaCtlUsage(int cmd, const char* special, int id, caddr_t addr)
+{
+    if (cmd == (int)QCMD(Q_XGETQUOTA, FS_PROJ_QUOTA)) {
+        fs_disk_quota_t *d = (fs_disk_quota_t *)addr;
+        d->d_bcount = 8;
+        d->d_icount = 3;
+        return 0;
+    }
+    if (cmd == (int)QCMD(Q_GETQUOTA, FS_PROJ_QUOTA)) {
+        struct dqblk *d = (struct dqblk *)addr;
+        d->dqb_curspace = 4096;
+        d->dqb_curinodes = 3;
+        d->dqb_valid = QIF_USAGE;
+        return 0;
+    }
+    if (cmd == (int)QCMD(Q_XSETQLIM, FS_PROJ_QUOTA) || cmd == (int)QCMD(Q_SETQUOTA, FS_PROJ_QUOTA)) {
+        g_set_limit_calls++;
+        return 0;
+    }
+    return invokeQuotaCtl(cmd, special, id, addr);
+}
+
+TEST_F(StorageDriverUnitTest, test_graphdriver_quota_accounting)
+{
+    if (!support_overlay) {
+        return;
+    }
+
+    char *backing_fs = util_get_fs_name("/tmp/isulad/data");
+    if (backing_fs == nullptr || (strcmp(backing_fs, "xfs") != 0 && strcmp(backing_fs, "extfs") != 0)) {
+        std::cout << "Backing fs cannot support project quota, skip quota accounting test." << std::endl;
+        free(backing_fs);
+        return;
+    }
+    free(backing_fs);
+
+    std::string id { "3e1a2c6f0f5f8f7d0c2b6e9a4d1f3b5c7e9a1b3d5f7c9e1a3b5d7f9c1e3a5b7d" };
+    struct driver_create_opts *create_opts =
+        (struct driver_create_opts *)util_common_calloc_s(sizeof(struct driver_create_opts));
+    ASSERT_NE(create_opts, nullptr);
+    imagetool_fs_info *fs_info = (imagetool_fs_info *)util_common_calloc_s(sizeof(imagetool_fs_info));
+    ASSERT_NE(fs_info, nullptr);
+
+    g_last_projid = 0;
+    g_set_limit_calls = 0;
+    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _, _)).WillRepeatedly(Invoke(invokeIOCtlProjid));
+    EXPECT_CALL(m_driver_quota_mock, QuotaCtl(_, _, _, _)).WillRepeatedly(Invoke(invokeQuotaCtlUsage));
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    InitDriver(true);
+
+    // layer without size opt gets a private project id but no limit
+    ASSERT_EQ(graphdriver_create_rw(id.c_str(), nullptr, create_opts), 0);
+    ASSERT_NE(g_last_projid, 0U);
+    ASSERT_EQ(g_set_limit_calls, 0);
+
+    // usage is read from the quota of the project id instead of walking the diff
+    ASSERT_EQ(graphdriver_get_layer_fs_info(id.c_str(), fs_info), 0);
+    ASSERT_EQ(fs_info->image_filesystems_len, 1);
+    ASSERT_EQ(fs_info->image_filesystems[0]->used_bytes->value, 4096);
+    ASSERT_EQ(fs_info->image_filesystems[0]->inodes_used->value, 3);
+
+    ASSERT_EQ(graphdriver_rm_layer(id.c_str()), 0);
+    ASSERT_FALSE(graphdriver_layer_exists(id.c_str()));
+    free_imagetool_fs_info(fs_info);
+    free_driver_create_opts(create_opts);
+}
+
 TEST_F(StorageDriverUnitTest, test_graphdriver_mount_layer)
 {
     if (!support_overlay) {
@@ -261,6 +359,107 @@ TEST_F(StorageDriverUnitTest, test_graphdriver_mount_layer)
     free(mount_dir);
 }
 
+static struct driver_create_opts *VolatileCreateOpts()
+{
+    struct driver_create_opts *create_opts =
+        (struct driver_create_opts *)util_common_calloc_s(sizeof(struct driver_create_opts));
+
+    create_opts->storage_opt = (json_map_string_string *)util_common_calloc_s(sizeof(json_map_string_string));
+    (void)append_json_map_string_string(create_opts->storage_opt, "volatile", "true");
+    return create_opts;
+}
+
+TEST_F(StorageDriverUnitTest, test_graphdriver_volatile_rw_layer)
+{
+    if (!support_overlay) {
+        return;
+    }
+
+    std::string id { "5a0d1ad0c7bd2c07c95b8a6ed0b1ee3b4ecd0bd75dd3f98d94dbf1a29a99d5f8" };
+    std::string layer_dir = "/tmp/isulad/data/overlay/" + id;
+    std::string incompat = layer_dir + "/work/work/incompat/volatile";
+    struct driver_create_opts *create_opts = VolatileCreateOpts();
+
+    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _, _)).WillRepeatedly(Invoke(invokeIOCtl));
+    ASSERT_EQ(graphdriver_create_rw(id.c_str(), nullptr, create_opts), 0);
+    ASSERT_TRUE(util_file_exists((layer_dir + "/volatile").c_str()));
+
+    // host went down while the layer was mounted volatile in another boot
+    ASSERT_EQ(util_write_file((layer_dir + "/volatile").c_str(), "old-boot-id", strlen("old-boot-id"), 0600), 0);
+    ASSERT_EQ(util_mkdir_p(incompat.c_str(), 0700), 0);
+    ASSERT_EQ(util_write_file((layer_dir + "/diff/half-written").c_str(), "x", 1, 0600), 0);
+
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    InitDriver();
+    ASSERT_FALSE(util_file_exists((layer_dir + "/diff/half-written").c_str()));
+    ASSERT_FALSE(util_dir_exists(incompat.c_str()));
+    ASSERT_TRUE(util_dir_exists((layer_dir + "/diff").c_str()));
+    ASSERT_TRUE(util_dir_exists((layer_dir + "/work").c_str()));
+
+    // isulad restarted in the same boot, upper is kept
+    char *boot_id = util_read_text_file("/proc/sys/kernel/random/boot_id");
+    ASSERT_NE(boot_id, nullptr);
+    *strchrnul(boot_id, '\n') = '\0';
+    ASSERT_EQ(util_write_file((layer_dir + "/volatile").c_str(), boot_id, strlen(boot_id), 0600), 0);
+    ASSERT_EQ(util_mkdir_p(incompat.c_str(), 0700), 0);
+    ASSERT_EQ(util_write_file((layer_dir + "/diff/kept").c_str(), "x", 1, 0600), 0);
+    free(boot_id);
+
+    ASSERT_EQ(graphdriver_cleanup(), 0);
+    InitDriver();
+    ASSERT_TRUE(util_file_exists((layer_dir + "/diff/kept").c_str()));
+
+    ASSERT_EQ(graphdriver_rm_layer(id.c_str()), 0);
+    free_driver_create_opts(create_opts);
+}
+
+TEST_F(StorageDriverUnitTest, test_graphdriver_tmpfs_rw_layer)
+{
+    if (!support_overlay) {
+        return;
+    }
+
+    std::string id { "7c2e3be1d8ce3d18da6c9b7fe1c2ff4c5fde1ce86ee4a09ea5c2b3a0bab0e6a9" };
+    std::string layer_dir = "/tmp/isulad/data/overlay/" + id;
+    struct driver_create_opts *create_opts =
+        (struct driver_create_opts *)util_common_calloc_s(sizeof(struct driver_create_opts));
+    char *mount_dir = nullptr;
+    char *link_id = nullptr;
+    char *link_again = nullptr;
+
+    create_opts->storage_opt = (json_map_string_string *)util_common_calloc_s(sizeof(json_map_string_string));
+    ASSERT_EQ(append_json_map_string_string(create_opts->storage_opt, "tmpfs_size", "bad"), 0);
+    ASSERT_NE(graphdriver_create_rw(id.c_str(), nullptr, create_opts), 0);
+    free(create_opts->storage_opt->values[0]);
+    create_opts->storage_opt->values[0] = util_strdup_s("64M");
+
+    ASSERT_EQ(graphdriver_create_rw(id.c_str(), nullptr, create_opts), 0);
+    ASSERT_TRUE(util_detect_mounted(layer_dir.c_str()));
+    ASSERT_TRUE(util_file_exists((layer_dir + "/tmpfs").c_str()));
+    ASSERT_TRUE(util_dir_exists((layer_dir + "/diff").c_str()));
+    link_id = util_read_text_file((layer_dir + "/link").c_str());
+    ASSERT_NE(link_id, nullptr);
+
+    // tmpfs is gone after a reboot, layer comes back with an empty upper and the same short link
+    ASSERT_EQ(util_write_file((layer_dir + "/diff/lost").c_str(), "x", 1, 0600), 0);
+    ASSERT_EQ(umount2(layer_dir.c_str(), MNT_DETACH), 0);
+    mount_dir = graphdriver_mount_layer(id.c_str(), nullptr);
+    ASSERT_NE(mount_dir, nullptr);
+    ASSERT_TRUE(util_detect_mounted(layer_dir.c_str()));
+    ASSERT_FALSE(util_file_exists((layer_dir + "/diff/lost").c_str()));
+    link_again = util_read_text_file((layer_dir + "/link").c_str());
+    ASSERT_STREQ(link_again, link_id);
+    ASSERT_TRUE(util_dir_exists(("/tmp/isulad/data/overlay/l/" + std::string(link_id)).c_str()));
+    free(link_id);
+    free(link_again);
+    ASSERT_EQ(graphdriver_umount_layer(id.c_str()), 0);
+    free(mount_dir);
+
+    ASSERT_EQ(graphdriver_rm_layer(id.c_str()), 0);
+    ASSERT_FALSE(util_dir_exists(layer_dir.c_str()));
+    free_driver_create_opts(create_opts);
+}
+
 TEST_F(StorageDriverUnitTest, test_graphdriver_try_repair_lowers)
 {
     if (!support_overlay) {
@@ -269,4 +468,101 @@ TEST_F(StorageDriverUnitTest, test_graphdriver_try_repair_lowers)
 
     std::string id { "1be74353c3d0fd55fb5638a52953e6f1bc441e5b1710921db9ec2aa202725569" };
     ASSERT_EQ(graphdriver_try_repair_lowers(id.c_str(), nullptr), 0);
-}
\ No newline at end of file
+}
+
+static double MountLayerChainMs(size_t depth, size_t rounds)
+{
+    std::vector<std::string> ids;
+    char id[65] = { 0 };
+    const char *parent = nullptr;
+    struct driver_create_opts create_opts = { 0 };
+    char *mount_dir = nullptr;
+
+    for (size_t i = 0; i < depth; i++) {
+        EXPECT_EQ(util_generate_random_str(id, 64), 0);
+        ids.push_back(id);
+        EXPECT_EQ(graphdriver_create_ro(id, parent, &create_opts), 0);
+        parent = ids.back().c_str();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        mount_dir = graphdriver_mount_layer(ids.back().c_str(), nullptr);
+        EXPECT_NE(mount_dir, nullptr);
+        free(mount_dir);
+        EXPECT_EQ(graphdriver_umount_layer(ids.back().c_str()), 0);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto it = ids.rbegin(); it != ids.rend(); it++) {
+        EXPECT_EQ(graphdriver_rm_layer(it->c_str()), 0);
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / rounds;
+}
+
+// benchmark of mount and umount per container, run with --gtest_also_run_disabled_tests
+TEST_F(StorageDriverUnitTest, DISABLED_benchmark_mount_layer_chain)
+{
+    if (!support_overlay) {
+        return;
+    }
+
+    EXPECT_CALL(m_driver_quota_mock, GetPageSize()).WillRepeatedly(Invoke(invokeGetPageSize));
+    FLAGS_gmock_catch_leaked_mocks = false;
+    for (size_t depth : { 10, 50, 120 }) {
+        printf("layers: %zu, mount and umount: %.3f ms\n", depth, MountLayerChainMs(depth, 100));
+    }
+    FLAGS_gmock_catch_leaked_mocks = true;
+}
+
+static double WriteHeavyMs(const char *id, struct driver_create_opts *create_opts, size_t files)
+{
+    char *mount_dir = nullptr;
+    std::string content(64 * 1024, 'w');
+
+    EXPECT_EQ(graphdriver_create_rw(id, nullptr, create_opts), 0);
+    mount_dir = graphdriver_mount_layer(id, nullptr);
+    EXPECT_NE(mount_dir, nullptr);
+    if (mount_dir == nullptr) {
+        return 0;
+    }
+
+    // write and fsync like a build or a package install does
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < files; i++) {
+        std::string file = std::string(mount_dir) + "/" + std::to_string(i);
+        int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(util_write_nointr(fd, content.c_str(), content.size()), (ssize_t)content.size());
+        EXPECT_EQ(fsync(fd), 0);
+        close(fd);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(graphdriver_umount_layer(id), 0);
+    EXPECT_EQ(graphdriver_rm_layer(id), 0);
+    free(mount_dir);
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// benchmark of write heavy container with and without volatile upper, run with --gtest_also_run_disabled_tests
+TEST_F(StorageDriverUnitTest, DISABLED_benchmark_volatile_write_heavy)
+{
+    if (!support_overlay) {
+        return;
+    }
+
+    struct driver_create_opts create_opts = { 0 };
+    struct driver_create_opts *volatile_opts = VolatileCreateOpts();
+
+    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _, _)).WillRepeatedly(Invoke(invokeIOCtl));
+    EXPECT_CALL(m_driver_quota_mock, GetPageSize()).WillRepeatedly(Invoke(invokeGetPageSize));
+    FLAGS_gmock_catch_leaked_mocks = false;
+    printf("5000 files with fsync, default upper: %.1f ms\n",
+           WriteHeavyMs("b0a3b4fd1fd7e0c2f9b9a53b1a5d9b4b2f0b7e6c4d3a2b1c0d9e8f7a6b5c4d3e", &create_opts, 5000));
+    printf("5000 files with fsync, volatile upper: %.1f ms\n",
+           WriteHeavyMs("c1b4c5ae2ae8f1d3a0cab64c2b6eac5c3a1c8f7d5e4b3c2d1eaf9a8b7c6d5e4f", volatile_opts, 5000));
+    FLAGS_gmock_catch_leaked_mocks = true;
+    free_driver_create_opts(volatile_opts);
+}
@@ -126,7 +126,7 @@ void free_layer_list(struct layer_list *ptr)
     free(ptr);
 }
 
-int invokeIOCtl(int fd, int cmd)
+int invokeIOCtl(int fd, unsigned long int cmd, void *arg)
 {
     return 0;
 }
@@ -300,7 +300,7 @@ TEST_F(StorageLayersUnitTest, test_layer_store_create)
     layer_opt->names[0] = strdup("layer_name");
     layer_opt->names_len = 1;
 
-    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _)).WillRepeatedly(Invoke(invokeIOCtl));
+    EXPECT_CALL(m_driver_quota_mock, IOCtl(_, _, _)).WillRepeatedly(Invoke(invokeIOCtl));
 
     free_layer_opts(layer_opt);
 }
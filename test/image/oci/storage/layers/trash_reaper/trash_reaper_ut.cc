@@ -0,0 +1,129 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: trash reaper unit test
+ *******************************************************************************/
+
+#include <chrono>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "trash_reaper.h"
+#include "utils.h"
+#include "utils_array.h"
+#include "utils_file.h"
+
+class TrashReaperUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/trash-reaper-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        m_trash = m_dir + "/" + TRASH_REAPER_DIR;
+    }
+
+    void TearDown() override
+    {
+        trash_reaper_exit();
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    void MakeLayer(const std::string &name, size_t files)
+    {
+        std::string dir = m_dir + "/" + name + "/diff";
+        ASSERT_EQ(util_mkdir_p(dir.c_str(), 0700), 0);
+        for (size_t i = 0; i < files; i++) {
+            std::string file = dir + "/" + std::to_string(i);
+            ASSERT_EQ(util_write_file(file.c_str(), "x", 1, 0600), 0);
+        }
+    }
+
+    bool WaitTrashEmpty()
+    {
+        for (int i = 0; i < 500; i++) {
+            char **entries = nullptr;
+            size_t len = 0;
+
+            if (util_list_all_subdir(m_trash.c_str(), &entries) != 0) {
+                return false;
+            }
+            len = util_array_len((const char **)entries);
+            util_free_array(entries);
+            if (len == 0) {
+                return true;
+            }
+            util_usleep_nointerupt(10 * 1000);
+        }
+        return false;
+    }
+
+    std::string m_dir;
+    std::string m_trash;
+};
+
+TEST_F(TrashReaperUnitTest, test_remove_in_background)
+{
+    std::string layer = m_dir + "/layer";
+
+    MakeLayer("layer", 10);
+    ASSERT_EQ(trash_reaper_init(m_trash.c_str()), 0);
+    ASSERT_NE(trash_reaper_init(m_trash.c_str()), 0);
+
+    ASSERT_EQ(trash_reaper_remove(layer.c_str()), 0);
+    ASSERT_FALSE(util_fileself_exists(layer.c_str()));
+    ASSERT_TRUE(WaitTrashEmpty());
+
+    // removing twice is fine
+    ASSERT_EQ(trash_reaper_remove(layer.c_str()), 0);
+}
+
+TEST_F(TrashReaperUnitTest, test_reap_leftovers)
+{
+    std::string leftover = m_trash + "/leftover/diff";
+
+    ASSERT_EQ(util_mkdir_p(leftover.c_str(), 0700), 0);
+    ASSERT_EQ(trash_reaper_init(m_trash.c_str()), 0);
+    ASSERT_TRUE(WaitTrashEmpty());
+}
+
+TEST_F(TrashReaperUnitTest, test_remove_without_reaper)
+{
+    std::string layer = m_dir + "/layer";
+
+    MakeLayer("layer", 10);
+    ASSERT_EQ(trash_reaper_remove(layer.c_str()), 0);
+    ASSERT_FALSE(util_fileself_exists(layer.c_str()));
+    ASSERT_FALSE(util_dir_exists(m_trash.c_str()));
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST_F(TrashReaperUnitTest, DISABLED_benchmark_remove_200k_files)
+{
+    std::string sync_layer = m_dir + "/sync";
+    std::string async_layer = m_dir + "/async";
+
+    MakeLayer("sync", 200000);
+    MakeLayer("async", 200000);
+    ASSERT_EQ(trash_reaper_init(m_trash.c_str()), 0);
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(util_recursive_rmdir(sync_layer.c_str(), 0), 0);
+    auto sync_done = std::chrono::steady_clock::now();
+    ASSERT_EQ(trash_reaper_remove(async_layer.c_str()), 0);
+    auto async_done = std::chrono::steady_clock::now();
+
+    printf("remove 200k files, synchronous: %ld ms, trash: %ld us\n",
+           (long)std::chrono::duration_cast<std::chrono::milliseconds>(sync_done - start).count(),
+           (long)std::chrono::duration_cast<std::chrono::microseconds>(async_done - sync_done).count());
+    ASSERT_TRUE(WaitTrashEmpty());
+}
@@ -12,6 +12,8 @@
  * Create: 2023-03-16
  * Description: provide remote layer support ut
  ******************************************************************************/
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <gtest/gtest.h>
@@ -496,6 +498,56 @@ TEST(remote_support, start_thread)
     sleep(6);
 }
 
+// time from a new remote layer dir showing up to its load into layer store
+TEST_F(RemoteLayerUnitTest, test_new_layer_latency)
+{
+    char tmpl[] = "/tmp/remote-refresh-ut-XXXXXX";
+    const std::string id = "b97242f89c8a29d13aea12843a08441a4bbfc33528f55b60366c1d8f6923d0d4";
+    std::atomic<bool> loaded { false };
+    std::chrono::steady_clock::time_point loaded_at;
+    pthread_rwlock_t rwlock;
+
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    std::string root = tmpl;
+    ASSERT_EQ(util_mkdir_p((root + "/images").c_str(), 0700), 0);
+    ASSERT_EQ(util_mkdir_p((root + "/overlay/l").c_str(), 0700), 0);
+    ASSERT_EQ(remote_image_init((root + "/images").c_str()), 0);
+    ASSERT_EQ(remote_layer_init((root + "/layers").c_str()), 0);
+    ASSERT_EQ(remote_overlay_init((root + "/overlay").c_str()), 0);
+
+    EXPECT_CALL(mock, LayerLoadOneLayer(::testing::_)).WillRepeatedly(Invoke([&](const char *layer_id) {
+        if (id == layer_id) {
+            loaded_at = std::chrono::steady_clock::now();
+            loaded = true;
+        }
+        return 0;
+    }));
+
+    ASSERT_EQ(pthread_rwlock_init(&rwlock, NULL), 0);
+    ASSERT_EQ(remote_start_refresh_thread(&rwlock), 0);
+
+    std::string overlay_layer = root + "/overlay/RO/" + id;
+    std::string link_file = overlay_layer + "/link";
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(util_mkdir_p((overlay_layer + "/diff").c_str(), 0700), 0);
+    ASSERT_EQ(util_write_file(link_file.c_str(), "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26, 0600), 0);
+    ASSERT_EQ(util_mkdir_p((root + "/layers/RO/" + id).c_str(), 0700), 0);
+
+    for (int i = 0; i < 1000 && !loaded; i++) {
+        util_usleep_nointerupt(10 * 1000);
+    }
+    remote_stop_refresh_thread();
+
+    ASSERT_TRUE(loaded.load());
+    long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(loaded_at - start).count();
+    printf("new remote layer loaded after %ld ms\n", ms);
+    // the old poll loop took up to 5 seconds
+    ASSERT_LT(ms, 3000);
+
+    remote_maintain_cleanup();
+    ASSERT_EQ(util_recursive_rmdir(tmpl, 0), 0);
+}
+
 static int prepare_empty_home(const char *layer_home, const char *layer_ro, const char *overlay_home,
                               const char *overlay_ro)
 {
@@ -0,0 +1,260 @@
+/******************************************************************************
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Author: agent
+ * Create: 2026-10-19
+ * Description: writable layer pool unit test
+ *******************************************************************************/
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "rw_layer_pool.h"
+#include "layer_store.h"
+#include "image_store.h"
+#include "utils.h"
+#include "utils_file.h"
+
+// in memory layer store and image store used by the pool
+static std::mutex g_fake_lock;
+// layer id to parent
+static std::map<std::string, std::string> g_fake_layers;
+// image name or id to image id and top layer
+static std::map<std::string, std::pair<std::string, std::string>> g_fake_images;
+
+int layer_store_create(const char *id, const struct layer_opts *opts, const struct io_read_wrapper *content,
+                       char **new_id)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    if (opts == nullptr || !opts->writable || opts->parent == nullptr || g_fake_layers.count(id) != 0) {
+        return -1;
+    }
+    g_fake_layers[id] = opts->parent;
+    return 0;
+}
+
+int layer_store_delete(const char *id)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    return g_fake_layers.erase(id) == 1 ? 0 : -1;
+}
+
+char *image_store_lookup(const char *id)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    auto it = g_fake_images.find(id);
+    return it == g_fake_images.end() ? nullptr : util_strdup_s(it->second.first.c_str());
+}
+
+char *image_store_top_layer(const char *id)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    auto it = g_fake_images.find(id);
+    return it == g_fake_images.end() ? nullptr : util_strdup_s(it->second.second.c_str());
+}
+
+static size_t LayersOn(const std::string &parent)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    size_t n = 0;
+    for (auto &it : g_fake_layers) {
+        n += it.second == parent ? 1 : 0;
+    }
+    return n;
+}
+
+static bool WaitFor(const std::function<bool()> &cond)
+{
+    for (int i = 0; i < 500; i++) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+class RWLayerPoolUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        g_fake_layers.clear();
+        g_fake_images.clear();
+        g_fake_images["busybox:latest"] = { "busybox-id", "busybox-top" };
+        g_fake_images["busybox-id"] = { "busybox-id", "busybox-top" };
+        char tmpl[] = "/tmp/rw-layer-pool-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        ASSERT_EQ(pthread_rwlock_init(&m_storage_lock, nullptr), 0);
+        m_conf = (json_map_string_int64 *)util_common_calloc_s(sizeof(json_map_string_int64));
+        ASSERT_NE(m_conf, nullptr);
+    }
+
+    void TearDown() override
+    {
+        rw_layer_pool_exit();
+        free_json_map_string_int64(m_conf);
+        (void)pthread_rwlock_destroy(&m_storage_lock);
+        ASSERT_EQ(util_recursive_rmdir(m_dir.c_str(), 0), 0);
+    }
+
+    int Init()
+    {
+        return rw_layer_pool_init(m_conf, m_dir.c_str(), &m_storage_lock);
+    }
+
+    // idle layer of the pool left by last run
+    void AddIdleLayer(const std::string &id, const std::string &parent)
+    {
+        {
+            std::lock_guard<std::mutex> guard(g_fake_lock);
+            g_fake_layers[id] = parent;
+        }
+        ASSERT_EQ(util_write_file((m_dir + "/" + id).c_str(), parent.c_str(), parent.size(), 0600), 0);
+    }
+
+    bool Stamped(const std::string &id)
+    {
+        return util_file_exists((m_dir + "/" + id).c_str());
+    }
+
+    char *Take(const char *image_id)
+    {
+        // same as storage rootfs create
+        (void)pthread_rwlock_wrlock(&m_storage_lock);
+        char *id = rw_layer_pool_take(image_id);
+        (void)pthread_rwlock_unlock(&m_storage_lock);
+        return id;
+    }
+
+    std::string m_dir;
+    pthread_rwlock_t m_storage_lock;
+    json_map_string_int64 *m_conf { nullptr };
+};
+
+TEST_F(RWLayerPoolUnitTest, test_refill_and_take)
+{
+    ASSERT_EQ(append_json_map_string_int64(m_conf, "busybox:latest", 2), 0);
+    ASSERT_EQ(append_json_map_string_int64(m_conf, "not-pulled", 1), 0);
+    ASSERT_EQ(Init(), 0);
+    // left by a crash before its layer was created
+    ASSERT_EQ(util_write_file((m_dir + "/orphan").c_str(), "busybox-top", strlen("busybox-top"), 0600), 0);
+    ASSERT_EQ(rw_layer_pool_start(), 0);
+    ASSERT_FALSE(Stamped("orphan"));
+
+    ASSERT_TRUE(WaitFor([]() {
+        return LayersOn("busybox-top") == 2;
+    }));
+    ASSERT_EQ(Take("other-id"), nullptr);
+
+    char *id = Take("busybox-id");
+    ASSERT_NE(id, nullptr);
+    ASSERT_EQ(strlen(id), 64U);
+    ASSERT_FALSE(rw_layer_pool_owns(id));
+    ASSERT_FALSE(Stamped(id));
+    // taken layer belongs to the container now, the pool makes up for it
+    ASSERT_TRUE(WaitFor([]() {
+        return LayersOn("busybox-top") == 3;
+    }));
+    free(id);
+
+    // image pulled after start is picked up on next pass
+    {
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        g_fake_images["not-pulled"] = { "pulled-id", "pulled-top" };
+        g_fake_images["pulled-id"] = { "pulled-id", "pulled-top" };
+    }
+    free(Take("busybox-id"));
+    ASSERT_TRUE(WaitFor([]() {
+        return LayersOn("pulled-top") == 1;
+    }));
+}
+
+TEST_F(RWLayerPoolUnitTest, test_adopt)
+{
+    ASSERT_EQ(append_json_map_string_int64(m_conf, "busybox-id", 1), 0);
+    ASSERT_EQ(Init(), 0);
+    ASSERT_TRUE(rw_layer_pool_enabled());
+    AddIdleLayer("layer-1", "busybox-top");
+    AddIdleLayer("layer-2", "busybox-top");
+    AddIdleLayer("layer-3", "other-top");
+    {
+        // writable layer of a container whose rootfs create was interrupted
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        g_fake_layers["layer-4"] = "busybox-top";
+    }
+
+    ASSERT_FALSE(rw_layer_pool_adopt("layer-4", "busybox-top"));
+    ASSERT_TRUE(rw_layer_pool_adopt("layer-1", "busybox-top"));
+    // pool is full, layers not wanted any more are removed with their stamp
+    ASSERT_FALSE(rw_layer_pool_adopt("layer-2", "busybox-top"));
+    ASSERT_FALSE(rw_layer_pool_adopt("layer-3", "other-top"));
+    ASSERT_FALSE(Stamped("layer-2"));
+    ASSERT_FALSE(Stamped("layer-3"));
+    ASSERT_EQ(LayersOn("other-top"), 0U);
+    // layers of others are not touched
+    ASSERT_FALSE(rw_layer_pool_owns("layer-4"));
+    ASSERT_EQ(LayersOn("busybox-top"), 2U);
+
+    char *id = Take("busybox-id");
+    ASSERT_STREQ(id, "layer-1");
+    ASSERT_FALSE(Stamped("layer-1"));
+    free(id);
+    ASSERT_EQ(Take("busybox-id"), nullptr);
+}
+
+TEST_F(RWLayerPoolUnitTest, test_disabled)
+{
+    ASSERT_EQ(Init(), 0);
+    ASSERT_FALSE(rw_layer_pool_enabled());
+    ASSERT_EQ(rw_layer_pool_start(), 0);
+    ASSERT_EQ(Take("busybox-id"), nullptr);
+}
+
+TEST_F(RWLayerPoolUnitTest, test_drain_and_retag)
+{
+    ASSERT_EQ(append_json_map_string_int64(m_conf, "busybox:latest", 2), 0);
+    ASSERT_EQ(Init(), 0);
+    ASSERT_EQ(rw_layer_pool_start(), 0);
+    ASSERT_TRUE(WaitFor([]() {
+        return LayersOn("busybox-top") == 2;
+    }));
+
+    // tag moves to a new image, idle layers on the old top layer are dropped
+    {
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        g_fake_images["busybox:latest"] = { "busybox-new-id", "busybox-new-top" };
+        g_fake_images["busybox-new-id"] = { "busybox-new-id", "busybox-new-top" };
+    }
+    char *id = Take("busybox-id");
+    ASSERT_NE(id, nullptr);
+    ASSERT_TRUE(WaitFor([]() {
+        return LayersOn("busybox-top") == 1 && LayersOn("busybox-new-top") == 2;
+    }));
+    free(id);
+
+    // image delete removes idle layers before the image layers
+    (void)pthread_rwlock_wrlock(&m_storage_lock);
+    rw_layer_pool_drain("busybox-new-id");
+    size_t left = LayersOn("busybox-new-top");
+    {
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        g_fake_images.erase("busybox:latest");
+        g_fake_images.erase("busybox-new-id");
+    }
+    (void)pthread_rwlock_unlock(&m_storage_lock);
+    ASSERT_EQ(left, 0U);
+    ASSERT_EQ(Take("busybox-new-id"), nullptr);
+}
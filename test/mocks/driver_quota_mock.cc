@@ -15,6 +15,8 @@
 
 #include "driver_quota_mock.h"
 
+#include <cstdarg>
+
 namespace {
 MockDriverQuota *g_driver_quota_mock = nullptr;
 }
@@ -35,7 +37,13 @@ int getpagesize()
 int ioctl(int fd, unsigned long int cmd, ...)
 {
     if (g_driver_quota_mock != nullptr) {
-        return g_driver_quota_mock->IOCtl(fd, cmd);
+        va_list args;
+        void *arg = nullptr;
+
+        va_start(args, cmd);
+        arg = va_arg(args, void *);
+        va_end(args);
+        return g_driver_quota_mock->IOCtl(fd, cmd, arg);
     }
     return 0;
 }
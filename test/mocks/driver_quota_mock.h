@@ -23,7 +23,7 @@ class MockDriverQuota {
 public:
     virtual ~MockDriverQuota() = default;
     MOCK_METHOD0(GetPageSize, int());
-    MOCK_METHOD2(IOCtl, int(int, unsigned long int));
+    MOCK_METHOD3(IOCtl, int(int, unsigned long int, void *));
     MOCK_METHOD4(QuotaCtl, int(int, const char*, int, caddr_t));
 
 };
@@ -20,6 +20,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string>
+#include <thread>
 #include "mock.h"
 #include "isula_rt_ops.h"
 #include <gtest/gtest.h>
@@ -27,6 +31,7 @@
 #include "engine_mock.h"
 #include "isulad_config_mock.h"
 #include "utils.h"
+#include "shim_constants.h"
 
 using ::testing::Args;
 using ::testing::ByRef;
@@ -122,6 +127,71 @@ TEST_F(IsulaRtOpsUnitTest, test_rt_isula_exec)
     ASSERT_EQ(rt_isula_exec("123", "kata-runtime", &params, nullptr), -1);
 }
 
+// acts as the shim of container, which serves one exec request over attach socket
+static void FakeShimExecService(int listen_fd, int status, int shim_exit_code, int exit_code)
+{
+    char buf[BUFSIZ] = { 0 };
+    int result[2] = { shim_exit_code, exit_code };
+    int conn_fd = accept(listen_fd, nullptr, nullptr);
+    if (conn_fd < 0) {
+        return;
+    }
+
+    const std::string prefix = SHIM_EXEC_REQUEST " ";
+    if (read(conn_fd, buf, sizeof(buf) - 1) > 0 && strncmp(buf, prefix.c_str(), prefix.size()) == 0) {
+        std::string workdir(buf + prefix.size());
+        workdir = workdir.substr(0, workdir.find(' '));
+        std::string pid = std::to_string(getpid());
+        (void)util_write_file((workdir + "/pid").c_str(), pid.c_str(), pid.size(), 0600);
+        (void)write(conn_fd, &status, sizeof(status));
+        if (status == 0) {
+            (void)write(conn_fd, result, sizeof(result));
+        }
+    }
+    close(conn_fd);
+}
+
+TEST_F(IsulaRtOpsUnitTest, test_rt_isula_exec_with_container_shim)
+{
+    rt_exec_params_t params = {};
+    defs_process spec = {};
+    const char *console_fifos[3] = { nullptr, "/tmp/isula_exec_shim_ut/stdout", nullptr };
+    std::string state = "/tmp/isula_exec_shim_ut";
+    std::string id = "123";
+    std::string sock = state + "/" + id + "/" + ATTACH_SOCKET;
+    struct sockaddr_un addr = {};
+    int exit_code = -1;
+
+    ASSERT_EQ(util_mkdir_p((state + "/" + id).c_str(), 0700), 0);
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(listen_fd, 0);
+    addr.sun_family = AF_UNIX;
+    (void)strcpy(addr.sun_path, sock.c_str());
+    ASSERT_EQ(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ASSERT_EQ(listen(listen_fd, 1), 0);
+
+    params.rootpath = "/var/lib/isulad/runc";
+    params.state = state.c_str();
+    params.console_fifos = console_fifos;
+    params.suffix = "abc";
+    params.timeout = 10;
+    params.spec = &spec;
+
+    // exit code comes from the shim of container, no isulad-shim is started
+    std::thread shim(FakeShimExecService, listen_fd, 0, 0, 3);
+    ASSERT_EQ(rt_isula_exec(id.c_str(), "runc", &params, &exit_code), 0);
+    shim.join();
+    ASSERT_EQ(exit_code, 3);
+    ASSERT_FALSE(util_dir_exists((state + "/" + id + "/exec/abc").c_str()));
+
+    std::thread timeout_shim(FakeShimExecService, listen_fd, 0, SHIM_EXIT_TIMEOUT, -1);
+    ASSERT_EQ(rt_isula_exec(id.c_str(), "runc", &params, &exit_code), -1);
+    timeout_shim.join();
+
+    close(listen_fd);
+    ASSERT_EQ(util_recursive_rmdir(state.c_str(), 0), 0);
+}
+
 TEST_F(IsulaRtOpsUnitTest, test_rt_isula_status)
 {
     rt_status_params_t params = {};
@@ -164,6 +234,41 @@ TEST_F(IsulaRtOpsUnitTest, test_rt_isula_exec_resize)
     ASSERT_EQ(system(rm_path.c_str()), 0);
 }
 
+TEST_F(IsulaRtOpsUnitTest, test_rt_isula_exec_resize_notify_pid)
+{
+    rt_exec_resize_params_t params = {};
+    std::string id = "123";
+    std::string runtime = "kata-runtime";
+    std::string workdir = "/tmp/isula_exec_resize_notify_ut/123/exec/abc";
+    params.state = "/tmp/isula_exec_resize_notify_ut";
+    params.suffix = "abc";
+    params.width = 80;
+    params.height = 24;
+
+    ASSERT_EQ(util_mkdir_p(workdir.c_str(), 0700), 0);
+    ASSERT_EQ(mkfifo((workdir + "/resize_fifo").c_str(), 0600), 0);
+    ASSERT_EQ(mkfifo((workdir + "/notify_fifo").c_str(), 0600), 0);
+    int resize_fd = open((workdir + "/resize_fifo").c_str(), O_RDONLY | O_NONBLOCK);
+    ASSERT_GE(resize_fd, 0);
+
+    // this process acts as shim and container process, SIGWINCH is ignored by default
+    std::string shim_pid = std::to_string(getpid());
+    ASSERT_EQ(util_write_file((workdir + "/shim-pid").c_str(), shim_pid.c_str(), shim_pid.size(), 0600), 0);
+    int notify_fd = open((workdir + "/notify_fifo").c_str(), O_RDWR | O_NONBLOCK);
+    ASSERT_GE(notify_fd, 0);
+    int pid = getpid();
+    ASSERT_EQ(write(notify_fd, &pid, sizeof(pid)), (ssize_t)sizeof(pid));
+    ASSERT_EQ(rt_isula_exec_resize(id.c_str(), runtime.c_str(), &params), 0);
+
+    // shim exits before writing pid, and runtime never wrote the pid file
+    ASSERT_EQ(util_write_file((workdir + "/shim-pid").c_str(), "999999999", 9, 0600), 0);
+    ASSERT_EQ(rt_isula_exec_resize(id.c_str(), runtime.c_str(), &params), -1);
+
+    close(notify_fd);
+    close(resize_fd);
+    ASSERT_EQ(util_recursive_rmdir(params.state, 0), 0);
+}
+
 TEST_F(IsulaRtOpsUnitTest, test_rt_isula_update)
 {
     rt_update_params_t params = {};
@@ -14,6 +14,9 @@
  ******************************************************************************/
 
 #include "execution_extend.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include "runtime_mock.h"
@@ -85,6 +88,8 @@ public:
     }
     void TearDown() override
     {
+        // sampler must not call mocks after they are cleared, even if a test fails with it running
+        container_stats_sampler_exit();
         MockRuntime_SetMock(nullptr);
         MockContainersStore_SetMock(nullptr);
         MockCollector_SetMock(nullptr);
@@ -265,3 +270,152 @@ TEST_F(ExecutionExtendUnitTest, test_container_extend_callback_init_resume)
     free_container_resume_request(request);
     free_container_resume_response(response);
 }
+
+#define STATS_MOCK_CONTAINERS 500
+
+static std::atomic<int> g_stats_unref_count { 0 };
+static std::atomic<int> g_stats_runtime_calls { 0 };
+// stats of containers whose id has this prefix never finish before deadline
+static const std::string g_slow_stats_prefix = "slow-";
+
+static char **invokeContainersStoreListIds(void)
+{
+    char **ids = nullptr;
+
+    for (int i = 0; i < STATS_MOCK_CONTAINERS; i++) {
+        std::string id = (i % 100 == 0 ? g_slow_stats_prefix : "") + std::to_string(i);
+        if (util_array_append(&ids, id.c_str()) != 0) {
+            util_free_array(ids);
+            return nullptr;
+        }
+    }
+    return ids;
+}
+
+static container_t *invokeStatsContainersStoreGet(const char *id_or_name)
+{
+    container_t *cont = invokeContainersStoreGet(id_or_name);
+    if (cont != nullptr) {
+        cont->common_config->id = util_strdup_s(id_or_name);
+    }
+    return cont;
+}
+
+static void invokeStatsContainerUnref(container_t *cont)
+{
+    free(cont->common_config->id);
+    free(cont->common_config);
+    free(cont);
+    g_stats_unref_count++;
+}
+
+// a runtime that takes 2ms to read stats of one container
+static int invokeRuntimeResourcesStats(const char *name, const char *runtime, const rt_stats_params_t *params,
+                                       struct runtime_container_resources_stats_info *rs_stats)
+{
+    int delay_ms = strncmp(name, g_slow_stats_prefix.c_str(), g_slow_stats_prefix.size()) == 0 ? 500 : 2;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    rs_stats->pids_current = 1;
+    g_stats_runtime_calls++;
+    return 0;
+}
+
+TEST_F(ExecutionExtendUnitTest, test_container_stats_batch_500)
+{
+    service_container_callback_t cb;
+    container_stats_request *request = (container_stats_request *)util_common_calloc_s(sizeof(container_stats_request));
+    container_stats_response *response = nullptr;
+    request->all = true;
+
+    g_stats_unref_count = 0;
+    EXPECT_CALL(m_containersStore, ContainersStoreListIds()).WillRepeatedly(Invoke(invokeContainersStoreListIds));
+    EXPECT_CALL(m_containersStore, ContainersStoreGet(_)).WillRepeatedly(Invoke(invokeStatsContainersStoreGet));
+    EXPECT_CALL(m_containerUnix, ContainerUnref(_)).WillRepeatedly(Invoke(invokeStatsContainerUnref));
+    EXPECT_CALL(m_containerState, IsRunning(_)).WillRepeatedly(Invoke(invokeIsRunning));
+    EXPECT_CALL(m_runtime, RuntimeResourcesStats(_, _, _, _)).WillRepeatedly(Invoke(invokeRuntimeResourcesStats));
+    container_extend_callback_init(&cb);
+
+    // one by one it takes more than 5s
+    auto begin = std::chrono::steady_clock::now();
+    ASSERT_EQ(cb.stats_batch(request, 0, &response), 0);
+    auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    ASSERT_EQ(response->container_stats_len, (size_t)STATS_MOCK_CONTAINERS);
+    ASSERT_LT(cost.count(), 2500);
+    free_container_stats_response(response);
+    response = nullptr;
+
+    // slow containers are left out when deadline expires
+    begin = std::chrono::steady_clock::now();
+    ASSERT_EQ(cb.stats_batch(request, 200, &response), 0);
+    cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    ASSERT_EQ(response->container_stats_len, (size_t)(STATS_MOCK_CONTAINERS - STATS_MOCK_CONTAINERS / 100));
+    ASSERT_LT(cost.count(), 400);
+    free_container_stats_response(response);
+
+    // workers release containers after the response is returned
+    for (int i = 0; i < 200 && g_stats_unref_count < 2 * STATS_MOCK_CONTAINERS; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(g_stats_unref_count, 2 * STATS_MOCK_CONTAINERS);
+    testing::Mock::VerifyAndClearExpectations(&m_runtime);
+    testing::Mock::VerifyAndClearExpectations(&m_containersStore);
+    testing::Mock::VerifyAndClearExpectations(&m_containerUnix);
+    free_container_stats_request(request);
+}
+
+TEST_F(ExecutionExtendUnitTest, test_container_stats_sampler)
+{
+    service_container_callback_t cb;
+    container_stats_request *request = (container_stats_request *)util_common_calloc_s(sizeof(container_stats_request));
+    container_stats_response *response = nullptr;
+    request->all = true;
+
+    g_stats_runtime_calls = 0;
+    EXPECT_CALL(m_containersStore, ContainersStoreListIds()).WillRepeatedly(Invoke(invokeContainersStoreListIds));
+    EXPECT_CALL(m_containersStore, ContainersStoreGet(_)).WillRepeatedly(Invoke(invokeStatsContainersStoreGet));
+    EXPECT_CALL(m_containerUnix, ContainerUnref(_)).WillRepeatedly(Invoke(invokeStatsContainerUnref));
+    EXPECT_CALL(m_containerState, IsRunning(_)).WillRepeatedly(Invoke(invokeIsRunning));
+    EXPECT_CALL(m_runtime, RuntimeResourcesStats(_, _, _, _)).WillRepeatedly(Invoke(invokeRuntimeResourcesStats));
+    container_extend_callback_init(&cb);
+
+    ASSERT_EQ(setenv("ISULAD_STATS_SAMPLE_INTERVAL", "10ms", 1), 0);
+    ASSERT_NE(container_stats_sampler_init(), 0);
+
+    // only the first sample is taken during this test
+    ASSERT_EQ(setenv("ISULAD_STATS_SAMPLE_INTERVAL", "1h", 1), 0);
+    ASSERT_EQ(container_stats_sampler_init(), 0);
+    for (int i = 0; i < 300 && g_stats_runtime_calls < STATS_MOCK_CONTAINERS; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(g_stats_runtime_calls, STATS_MOCK_CONTAINERS);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // stats are served from snapshot without reading runtime stats again
+    auto begin = std::chrono::steady_clock::now();
+    ASSERT_EQ(cb.stats(request, &response), 0);
+    auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    ASSERT_EQ(response->container_stats_len, (size_t)STATS_MOCK_CONTAINERS);
+    ASSERT_EQ(response->container_stats[0]->pids_current, 1U);
+    ASSERT_EQ(g_stats_runtime_calls, STATS_MOCK_CONTAINERS);
+    ASSERT_LT(cost.count(), 500);
+    free_container_stats_response(response);
+    response = nullptr;
+
+    // sampler stops at once though next sample is an hour later, then stats are read on demand
+    begin = std::chrono::steady_clock::now();
+    container_stats_sampler_exit();
+    cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    ASSERT_LT(cost.count(), 500);
+    ASSERT_EQ(cb.stats(request, &response), 0);
+    ASSERT_EQ(response->container_stats_len, (size_t)STATS_MOCK_CONTAINERS);
+    ASSERT_EQ(g_stats_runtime_calls, 2 * STATS_MOCK_CONTAINERS);
+    free_container_stats_response(response);
+    container_stats_sampler_exit();
+
+    unsetenv("ISULAD_STATS_SAMPLE_INTERVAL");
+    testing::Mock::VerifyAndClearExpectations(&m_runtime);
+    testing::Mock::VerifyAndClearExpectations(&m_containersStore);
+    testing::Mock::VerifyAndClearExpectations(&m_containerUnix);
+    free_container_stats_request(request);
+}
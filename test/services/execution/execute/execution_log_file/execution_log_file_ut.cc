@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2026. All rights reserved.
+ * iSulad licensed under the Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *     http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND, EITHER EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT, MERCHANTABILITY OR FIT FOR A PARTICULAR
+ * PURPOSE.
+ * See the Mulan PSL v2 for more details.
+ * Description: container log file reading unit test
+ * Author: agent
+ * Create: 2026-10-19
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include <gtest/gtest.h>
+
+#include "execution_log_file.h"
+#include "log_compress.h"
+#include "utils_file.h"
+
+class ExecutionLogFileUnitTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/execution-log-file-ut-XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        m_dir = tmpl;
+        m_path = m_dir + "/console.log.1";
+        m_gz_path = m_path + LOG_COMPRESS_SUFFIX;
+        for (int i = 0; i < 100; i++) {
+            m_lines.push_back("{\"log\":\"line " + std::to_string(i) + "\\n\",\"stream\":\"stdout\"}\n");
+            m_content += m_lines.back();
+        }
+    }
+
+    void TearDown() override
+    {
+        (void)unlink(m_path.c_str());
+        (void)unlink(m_gz_path.c_str());
+        (void)unlink((m_gz_path + ".tmp").c_str());
+        (void)rmdir(m_dir.c_str());
+    }
+
+    static void WritePlain(const std::string &path, const std::string &content)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+
+    static void WriteCompressed(const std::string &path, const std::string &content)
+    {
+        gzFile gz = gzopen(path.c_str(), "wb");
+
+        ASSERT_NE(gz, nullptr);
+        ASSERT_EQ(gzwrite(gz, content.c_str(), (unsigned int)content.size()), (int)content.size());
+        ASSERT_EQ(gzclose(gz), Z_OK);
+    }
+
+    // same order as the log compressor: compressed file is in place before the plain one is removed
+    void CommitCompressed()
+    {
+        WriteCompressed(m_gz_path + ".tmp", m_content);
+        ASSERT_EQ(rename((m_gz_path + ".tmp").c_str(), m_gz_path.c_str()), 0);
+        ASSERT_EQ(unlink(m_path.c_str()), 0);
+    }
+
+    std::string RacePath(int i)
+    {
+        return m_dir + "/race.log." + std::to_string(i);
+    }
+
+    static std::string ReadAll(gzFile fp)
+    {
+        std::string content;
+        char buf[4096];
+        int n;
+
+        while ((n = gzread(fp, buf, sizeof(buf))) > 0) {
+            content.append(buf, n);
+        }
+        return content;
+    }
+
+    // offset after the first n lines
+    long LineOffset(size_t n)
+    {
+        long pos = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            pos += (long)m_lines[i].size();
+        }
+        return pos;
+    }
+
+    std::string m_dir;
+    std::string m_path;
+    std::string m_gz_path;
+    std::vector<std::string> m_lines;
+    std::string m_content;
+};
+
+TEST_F(ExecutionLogFileUnitTest, test_open_fallback_compressed)
+{
+    gzFile fp = NULL;
+
+    errno = 0;
+    ASSERT_EQ(container_log_file_open(m_path.c_str()), nullptr);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_FALSE(container_log_file_exists(m_path.c_str()));
+
+    WritePlain(m_path, m_content);
+    ASSERT_TRUE(container_log_file_exists(m_path.c_str()));
+    fp = container_log_file_open(m_path.c_str());
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(ReadAll(fp), m_content);
+    gzclose(fp);
+
+    CommitCompressed();
+    ASSERT_TRUE(container_log_file_exists(m_path.c_str()));
+    fp = container_log_file_open(m_path.c_str());
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(ReadAll(fp), m_content);
+    gzclose(fp);
+}
+
+TEST_F(ExecutionLogFileUnitTest, test_seek_plain_offset)
+{
+    char buf[4096] = { 0 };
+    long pos = LineOffset(40);
+    gzFile fp = NULL;
+
+    // offset recorded on the plain file stays valid after it is compressed
+    WritePlain(m_path, m_content);
+    fp = container_log_file_open(m_path.c_str());
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(gzseek(fp, pos, SEEK_SET), pos);
+    ASSERT_NE(gzgets(fp, buf, sizeof(buf)), nullptr);
+    ASSERT_EQ(std::string(buf), m_lines[40]);
+    gzclose(fp);
+
+    CommitCompressed();
+    fp = container_log_file_open(m_path.c_str());
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(gzseek(fp, pos, SEEK_SET), pos);
+    ASSERT_NE(gzgets(fp, buf, sizeof(buf)), nullptr);
+    ASSERT_EQ(std::string(buf), m_lines[40]);
+    ASSERT_EQ(gztell(fp), LineOffset(41));
+    gzclose(fp);
+}
+
+TEST_F(ExecutionLogFileUnitTest, test_tail_lines)
+{
+    int64_t get_line = 0;
+    long pos = 0;
+
+    ASSERT_NE(container_log_find_tail_position(m_path.c_str(), 10, &get_line, &pos), 0);
+
+    for (int compressed = 0; compressed < 2; compressed++) {
+        if (compressed == 0) {
+            WritePlain(m_path, m_content);
+        } else {
+            CommitCompressed();
+        }
+
+        get_line = 0;
+        pos = 0;
+        ASSERT_EQ(container_log_find_tail_position(m_path.c_str(), 10, &get_line, &pos), 0);
+        ASSERT_EQ(get_line, 10);
+        ASSERT_EQ(pos, LineOffset(90));
+
+        get_line = 0;
+        pos = 0;
+        ASSERT_EQ(container_log_find_tail_position(m_path.c_str(), 99, &get_line, &pos), 0);
+        ASSERT_EQ(get_line, 99);
+        ASSERT_EQ(pos, LineOffset(1));
+
+        // whole file is wanted, pos 0 means reading from the start
+        get_line = 0;
+        pos = 0;
+        ASSERT_EQ(container_log_find_tail_position(m_path.c_str(), 150, &get_line, &pos), 0);
+        ASSERT_EQ(get_line, 100);
+        ASSERT_EQ(pos, 0);
+    }
+}
+
+TEST_F(ExecutionLogFileUnitTest, test_plain_to_compressed_race)
+{
+    const int files = 50;
+    std::atomic<bool> stop(false);
+    int failures = 0;
+    gzFile fp = NULL;
+    int64_t get_line = 0;
+    long pos = 0;
+
+    WritePlain(m_path, m_content);
+
+    // file opened before the plain one is removed is still read through its fd
+    fp = container_log_file_open(m_path.c_str());
+    ASSERT_NE(fp, nullptr);
+    CommitCompressed();
+    ASSERT_EQ(ReadAll(fp), m_content);
+    gzclose(fp);
+
+    for (int i = 0; i < files; i++) {
+        WritePlain(RacePath(i), m_content);
+    }
+    std::thread compressor([&]() {
+        for (int i = 0; i < files; i++) {
+            WriteCompressed(RacePath(i) + LOG_COMPRESS_SUFFIX + ".tmp", m_content);
+            (void)rename((RacePath(i) + LOG_COMPRESS_SUFFIX + ".tmp").c_str(),
+                         (RacePath(i) + LOG_COMPRESS_SUFFIX).c_str());
+            (void)unlink(RacePath(i).c_str());
+        }
+        stop = true;
+    });
+
+    // one of the formats is always there, readers never see a file missing while it is compressed
+    while (!stop) {
+        for (int i = 0; i < files; i++) {
+            std::string path = RacePath(i);
+
+            failures += container_log_file_exists(path.c_str()) ? 0 : 1;
+            fp = container_log_file_open(path.c_str());
+            if (fp == NULL) {
+                failures++;
+                continue;
+            }
+            failures += ReadAll(fp) == m_content ? 0 : 1;
+            gzclose(fp);
+
+            get_line = 0;
+            pos = 0;
+            failures += container_log_find_tail_position(path.c_str(), 10, &get_line, &pos) == 0 ? 0 : 1;
+            failures += pos == LineOffset(90) ? 0 : 1;
+        }
+    }
+    compressor.join();
+
+    for (int i = 0; i < files; i++) {
+        ASSERT_FALSE(util_file_exists(RacePath(i).c_str()));
+        (void)unlink((RacePath(i) + LOG_COMPRESS_SUFFIX).c_str());
+    }
+    ASSERT_EQ(failures, 0);
+}